@@ -0,0 +1,77 @@
+/// @ref gtx_matrix_batch
+/// @file glm/gtx/matrix_batch.hpp
+///
+/// @see core (dependence)
+///
+/// @defgroup gtx_matrix_batch GLM_GTX_matrix_batch
+/// @ingroup gtx
+///
+/// Include <glm/gtx/matrix_batch.hpp> to use the features of this extension.
+///
+/// Matrix operations over arrays, for transforming many objects by the same
+/// matrix. On x86 the widest instruction set of the running CPU is used
+/// (SSE2, AVX2 or AVX-512), whatever GLM_ARCH the code was built for: the
+/// kernels are selected once, on first use (see glm/simd/dispatch.h).
+
+#pragma once
+
+// Dependency:
+#include "../glm.hpp"
+#include "../gtc/quaternion.hpp"
+#include <cstddef>
+
+#if GLM_MESSAGES == GLM_ENABLE && !defined(GLM_EXT_INCLUDED)
+#	ifndef GLM_ENABLE_EXPERIMENTAL
+#		pragma message("GLM: GLM_GTX_matrix_batch is an experimental extension and may change in the future. Use #define GLM_ENABLE_EXPERIMENTAL before including it, if you really want to use it.")
+#	else
+#		pragma message("GLM: GLM_GTX_matrix_batch extension included")
+#	endif
+#endif
+
+namespace glm
+{
+	/// @addtogroup gtx_matrix_batch
+	/// @{
+
+	/// Out[i] = m * In[i] for count matrices. Out may be In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchMul(
+		mat<4, 4, float, Q> const& m, mat<4, 4, float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count);
+
+	/// Out[i] = m * In[i] for count vectors. Out may be In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchMul(
+		mat<4, 4, float, Q> const& m, vec<4, float, Q> const* In, vec<4, float, Q>* Out, std::size_t count);
+
+	/// Transforms count vectors stored as separate x, y, z and w arrays:
+	/// (Out[0][i], ..., Out[3][i]) = m * vec4(In[0][i], ..., In[3][i]). Out may be In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchMulSoA(
+		mat<4, 4, float, Q> const& m, float const* const In[4], float* const Out[4], std::size_t count);
+
+	/// Out[i] = inverse(In[i]). Out may be In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchInverse(
+		mat<4, 4, float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count);
+
+	/// Out[i] = transpose(inverse(mat3(In[i]))), the matrix that transforms the
+	/// normals of In[i]. Out must not overlap In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchInverseTranspose(
+		mat<4, 4, float, Q> const* In, mat<3, 3, float, Q>* Out, std::size_t count);
+
+	/// Out[i] = mat4_cast(In[i]) for unit quaternions. Out must not overlap In.
+	/// From GLM_GTX_matrix_batch extension.
+	template<qualifier Q>
+	GLM_FUNC_DECL void batchMat4Cast(
+		qua<float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count);
+
+	/// @}
+}//namespace glm
+
+#include "matrix_batch.inl"
@@ -0,0 +1,77 @@
+/// @ref gtx_matrix_batch
+
+#include "../simd/dispatch.h"
+
+namespace glm
+{
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchMul(mat<4, 4, float, Q> const& m, mat<4, 4, float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count)
+	{
+#		if GLM_HAS_RUNTIME_ISA
+			glm_dispatch().mat4_mul_batch(&m[0][0], reinterpret_cast<float const*>(In), reinterpret_cast<float*>(Out), count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+				Out[i] = m * In[i];
+#		endif
+	}
+
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchMul(mat<4, 4, float, Q> const& m, vec<4, float, Q> const* In, vec<4, float, Q>* Out, std::size_t count)
+	{
+#		if GLM_HAS_RUNTIME_ISA
+			glm_dispatch().mat4_mul_vec4_batch(&m[0][0], reinterpret_cast<float const*>(In), reinterpret_cast<float*>(Out), count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+				Out[i] = m * In[i];
+#		endif
+	}
+
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchMulSoA(mat<4, 4, float, Q> const& m, float const* const In[4], float* const Out[4], std::size_t count)
+	{
+#		if GLM_HAS_RUNTIME_ISA
+			glm_dispatch().mat4_mul_vec4_soa(&m[0][0], In, Out, count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				vec<4, float, Q> const Result = m * vec<4, float, Q>(In[0][i], In[1][i], In[2][i], In[3][i]);
+				for(length_t k = 0; k < 4; ++k)
+					Out[k][i] = Result[k];
+			}
+#		endif
+	}
+
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchInverse(mat<4, 4, float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count)
+	{
+#		if GLM_HAS_RUNTIME_ISA
+			glm_dispatch().mat4_inverse_batch(reinterpret_cast<float const*>(In), reinterpret_cast<float*>(Out), count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+				Out[i] = inverse(In[i]);
+#		endif
+	}
+
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchInverseTranspose(mat<4, 4, float, Q> const* In, mat<3, 3, float, Q>* Out, std::size_t count)
+	{
+#		if GLM_HAS_RUNTIME_ISA
+			glm_dispatch().mat4_inverse_transpose_batch(reinterpret_cast<float const*>(In), reinterpret_cast<float*>(Out), count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+				Out[i] = transpose(inverse(mat<3, 3, float, Q>(In[i])));
+#		endif
+	}
+
+	template<qualifier Q>
+	GLM_FUNC_QUALIFIER void batchMat4Cast(qua<float, Q> const* In, mat<4, 4, float, Q>* Out, std::size_t count)
+	{
+		// The kernels read x, y, z, w
+#		if GLM_HAS_RUNTIME_ISA && !defined(GLM_FORCE_QUAT_DATA_WXYZ)
+			glm_dispatch().quat_to_mat4_batch(reinterpret_cast<float const*>(In), reinterpret_cast<float*>(Out), count);
+#		else
+			for(std::size_t i = 0; i < count; ++i)
+				Out[i] = mat4_cast(In[i]);
+#		endif
+	}
+}//namespace glm
@@ -0,0 +1,121 @@
+/// @ref simd
+/// @file glm/simd/cpu.h
+
+#pragma once
+
+#include "platform.h"
+
+// Instruction sets above the compile time GLM_ARCH, detected at runtime.
+// Functions marked GLM_TARGET_AVX2 or GLM_TARGET_AVX512 may use those
+// intrinsics in a build without -mavx2/-mavx512f and must only be called
+// when glm_cpu_features() reports the matching bit.
+
+#define GLM_CPU_SSE2_BIT		(0x00000001)
+#define GLM_CPU_SSE41_BIT		(0x00000002)
+#define GLM_CPU_AVX_BIT			(0x00000004)
+#define GLM_CPU_AVX2_BIT		(0x00000008) // FMA included
+#define GLM_CPU_AVX512F_BIT		(0x00000010)
+
+// SSE2 is the x86 baseline of every supported compiler, also when GLM_ARCH
+// leaves it out (no GLM_FORCE_INTRINSICS). GLM_FORCE_PURE turns this off.
+#if (GLM_ARCH & GLM_ARCH_X86_BIT) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	if (GLM_COMPILER & GLM_COMPILER_GCC) || (GLM_COMPILER & GLM_COMPILER_CLANG)
+#		define GLM_HAS_RUNTIME_ISA 1
+#		define GLM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#		define GLM_TARGET_AVX512 __attribute__((target("avx512f")))
+#		include <cpuid.h>
+#		include <immintrin.h>
+#	elif (GLM_COMPILER & GLM_COMPILER_VC) && (GLM_COMPILER >= GLM_COMPILER_VC15)
+#		define GLM_HAS_RUNTIME_ISA 1
+#		define GLM_TARGET_AVX2
+#		define GLM_TARGET_AVX512
+#		include <intrin.h>
+#		include <immintrin.h>
+#	endif
+#endif
+
+#ifndef GLM_HAS_RUNTIME_ISA
+#	define GLM_HAS_RUNTIME_ISA 0
+#endif
+
+#if GLM_HAS_RUNTIME_ISA
+
+inline void glm_cpuid(int Info[4], int Leaf, int SubLeaf)
+{
+#	if GLM_COMPILER & GLM_COMPILER_VC
+		__cpuidex(Info, Leaf, SubLeaf);
+#	else
+		unsigned int Registers[4] = {0, 0, 0, 0};
+		__cpuid_count(static_cast<unsigned int>(Leaf), static_cast<unsigned int>(SubLeaf), Registers[0], Registers[1], Registers[2], Registers[3]);
+		for(int i = 0; i < 4; ++i)
+			Info[i] = static_cast<int>(Registers[i]);
+#	endif
+}
+
+// Register state the OS saves on context switches (XCR0)
+inline unsigned long long glm_xgetbv()
+{
+#	if GLM_COMPILER & GLM_COMPILER_VC
+		return _xgetbv(0);
+#	else
+		unsigned int Low = 0, High = 0;
+		__asm__ __volatile__("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+		return (static_cast<unsigned long long>(High) << 32) | Low;
+#	endif
+}
+
+inline int glm_cpu_detect()
+{
+	int Features = GLM_CPU_SSE2_BIT;
+
+	int Info[4];
+	glm_cpuid(Info, 0, 0);
+	int const MaxLeaf = Info[0];
+
+	glm_cpuid(Info, 1, 0);
+	bool const SSE41 = (Info[2] & (1 << 19)) != 0;
+	bool const FMA = (Info[2] & (1 << 12)) != 0;
+	bool const OSXSAVE = (Info[2] & (1 << 27)) != 0;
+	bool const AVX = (Info[2] & (1 << 28)) != 0;
+
+	if(SSE41)
+		Features |= GLM_CPU_SSE41_BIT;
+
+	// AVX registers are only usable when the OS saves YMM (and ZMM) state
+	unsigned long long const XCR0 = OSXSAVE ? glm_xgetbv() : 0;
+	bool const YMM = (XCR0 & 0x06) == 0x06;
+	bool const ZMM = (XCR0 & 0xE6) == 0xE6;
+
+	if(AVX && YMM)
+		Features |= GLM_CPU_AVX_BIT;
+
+	if(MaxLeaf >= 7)
+	{
+		glm_cpuid(Info, 7, 0);
+		bool const AVX2 = (Info[1] & (1 << 5)) != 0;
+		bool const AVX512F = (Info[1] & (1 << 16)) != 0;
+
+		if(AVX && AVX2 && FMA && YMM)
+			Features |= GLM_CPU_AVX2_BIT;
+		if(AVX512F && ZMM)
+			Features |= GLM_CPU_AVX512F_BIT;
+	}
+
+	return Features;
+}
+
+// GLM_CPU_*_BIT of the running CPU, detected once
+inline int glm_cpu_features()
+{
+	static int const Features = glm_cpu_detect();
+	return Features;
+}
+
+#else
+
+inline int glm_cpu_features()
+{
+	return 0;
+}
+
+#endif//GLM_HAS_RUNTIME_ISA
@@ -0,0 +1,72 @@
+/// @ref simd
+/// @file glm/simd/dispatch.h
+
+#pragma once
+
+#include "matrix_batch.h"
+
+#if GLM_HAS_RUNTIME_ISA
+
+// The kernels of one instruction set level. GLM_ARCH fixes the ISA of a
+// build, this table is filled from cpuid when the program runs so one binary
+// uses AVX2 or AVX-512 on the machines that have them.
+struct glm_dispatch_table
+{
+	int Level; // GLM_CPU_*_BIT of the selected kernels
+
+	void (*mat4_mul_batch)(float const* M, float const* In, float* Out, std::size_t Count);
+	void (*mat4_mul_vec4_batch)(float const* M, float const* In, float* Out, std::size_t Count);
+	void (*mat4_mul_vec4_soa)(float const* M, float const* const In[4], float* const Out[4], std::size_t Count);
+	void (*mat4_inverse_batch)(float const* In, float* Out, std::size_t Count);
+	void (*mat4_inverse_transpose_batch)(float const* In, float* Out, std::size_t Count);
+	void (*quat_to_mat4_batch)(float const* In, float* Out, std::size_t Count);
+};
+
+// Kernels for the widest level in Features. Passing less than
+// glm_cpu_features() selects a lower level, for tests and benchmarks.
+inline glm_dispatch_table glm_dispatch_select(int Features)
+{
+	glm_dispatch_table Table;
+
+	if(Features & GLM_CPU_AVX512F_BIT)
+	{
+		Table.Level = GLM_CPU_AVX512F_BIT;
+		Table.mat4_mul_batch = glm_mat4_mul_batch_avx512;
+		Table.mat4_mul_vec4_batch = glm_mat4_mul_vec4_batch_avx512;
+		Table.mat4_mul_vec4_soa = glm_mat4_mul_vec4_soa_avx512;
+		Table.mat4_inverse_batch = glm_mat4_inverse_batch_avx512;
+		Table.mat4_inverse_transpose_batch = glm_mat4_inverse_transpose_batch_avx512;
+		Table.quat_to_mat4_batch = glm_quat_to_mat4_batch_avx512;
+	}
+	else if(Features & GLM_CPU_AVX2_BIT)
+	{
+		Table.Level = GLM_CPU_AVX2_BIT;
+		Table.mat4_mul_batch = glm_mat4_mul_batch_avx2;
+		Table.mat4_mul_vec4_batch = glm_mat4_mul_vec4_batch_avx2;
+		Table.mat4_mul_vec4_soa = glm_mat4_mul_vec4_soa_avx2;
+		Table.mat4_inverse_batch = glm_mat4_inverse_batch_avx2;
+		Table.mat4_inverse_transpose_batch = glm_mat4_inverse_transpose_batch_avx2;
+		Table.quat_to_mat4_batch = glm_quat_to_mat4_batch_avx2;
+	}
+	else
+	{
+		Table.Level = GLM_CPU_SSE2_BIT;
+		Table.mat4_mul_batch = glm_mat4_mul_batch_sse2;
+		Table.mat4_mul_vec4_batch = glm_mat4_mul_vec4_batch_sse2;
+		Table.mat4_mul_vec4_soa = glm_mat4_mul_vec4_soa_sse2;
+		Table.mat4_inverse_batch = glm_mat4_inverse_batch_sse2;
+		Table.mat4_inverse_transpose_batch = glm_mat4_inverse_transpose_batch_sse2;
+		Table.quat_to_mat4_batch = glm_quat_to_mat4_batch_sse2;
+	}
+
+	return Table;
+}
+
+// The table for the running CPU, selected on first use
+inline glm_dispatch_table const& glm_dispatch()
+{
+	static glm_dispatch_table const Table = glm_dispatch_select(glm_cpu_features());
+	return Table;
+}
+
+#endif//GLM_HAS_RUNTIME_ISA
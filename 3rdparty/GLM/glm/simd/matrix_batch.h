@@ -0,0 +1,723 @@
+/// @ref simd
+/// @file glm/simd/matrix_batch.h
+
+#pragma once
+
+#include "cpu.h"
+#include <cstddef>
+
+// Array versions of the matrix.h kernels. Matrices are 16 (mat4) or 9 (mat3)
+// column major floats with no alignment requirement. Built whenever the
+// compiler targets x86 with SSE2, independently of GLM_ARCH; the _avx2 and
+// _avx512 variants need the matching glm_cpu_features() bit, dispatch.h
+// picks one set for the running CPU.
+
+#if GLM_HAS_RUNTIME_ISA
+
+// Out[i] = M * In[i] for Count vec4, Out may be In
+GLM_FUNC_QUALIFIER void glm_mat4_mul_vec4_batch_sse2(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	__m128 const Left0 = _mm_loadu_ps(M + 0);
+	__m128 const Left1 = _mm_loadu_ps(M + 4);
+	__m128 const Left2 = _mm_loadu_ps(M + 8);
+	__m128 const Left3 = _mm_loadu_ps(M + 12);
+
+	for(std::size_t i = 0; i < Count * 4; i += 4)
+	{
+		__m128 const Right = _mm_loadu_ps(In + i);
+
+		__m128 const m0 = _mm_mul_ps(Left0, _mm_shuffle_ps(Right, Right, _MM_SHUFFLE(0, 0, 0, 0)));
+		__m128 const m1 = _mm_mul_ps(Left1, _mm_shuffle_ps(Right, Right, _MM_SHUFFLE(1, 1, 1, 1)));
+		__m128 const m2 = _mm_mul_ps(Left2, _mm_shuffle_ps(Right, Right, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 const m3 = _mm_mul_ps(Left3, _mm_shuffle_ps(Right, Right, _MM_SHUFFLE(3, 3, 3, 3)));
+
+		_mm_storeu_ps(Out + i, _mm_add_ps(_mm_add_ps(m0, m1), _mm_add_ps(m2, m3)));
+	}
+}
+
+// Out[i] = M * In[i], Out may be In. Each column of In[i] is transformed on
+// its own, so this is the vec4 kernel over four times as many vectors.
+GLM_FUNC_QUALIFIER void glm_mat4_mul_batch_sse2(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	glm_mat4_mul_vec4_batch_sse2(M, In, Out, Count * 4);
+}
+
+// Out[k][i] = (M * vec4(In[0][i], In[1][i], In[2][i], In[3][i]))[k], the
+// components in separate arrays, for i in [First, Count). Out may be In.
+GLM_FUNC_QUALIFIER void glm_mat4_mul_vec4_soa_sse2(float const* M, float const* const In[4], float* const Out[4], std::size_t First, std::size_t Count)
+{
+	__m128 Elements[16];
+	for(int e = 0; e < 16; ++e)
+		Elements[e] = _mm_set1_ps(M[e]);
+
+	std::size_t i = First;
+	for(; i + 4 <= Count; i += 4)
+	{
+		__m128 const X = _mm_loadu_ps(In[0] + i);
+		__m128 const Y = _mm_loadu_ps(In[1] + i);
+		__m128 const Z = _mm_loadu_ps(In[2] + i);
+		__m128 const W = _mm_loadu_ps(In[3] + i);
+
+		for(int k = 0; k < 4; ++k)
+		{
+			__m128 const A = _mm_add_ps(_mm_mul_ps(Elements[k], X), _mm_mul_ps(Elements[4 + k], Y));
+			__m128 const B = _mm_add_ps(_mm_mul_ps(Elements[8 + k], Z), _mm_mul_ps(Elements[12 + k], W));
+			_mm_storeu_ps(Out[k] + i, _mm_add_ps(A, B));
+		}
+	}
+
+	for(; i < Count; ++i)
+	{
+		float const X = In[0][i], Y = In[1][i], Z = In[2][i], W = In[3][i];
+		for(int k = 0; k < 4; ++k)
+			Out[k][i] = M[k] * X + M[4 + k] * Y + M[8 + k] * Z + M[12 + k] * W;
+	}
+}
+
+GLM_FUNC_QUALIFIER void glm_mat4_mul_vec4_soa_sse2(float const* M, float const* const In[4], float* const Out[4], std::size_t Count)
+{
+	glm_mat4_mul_vec4_soa_sse2(M, In, Out, 0, Count);
+}
+
+// Three columns of a mat3, the fourth lane of each is ignored
+GLM_FUNC_QUALIFIER void glm_mat3_storeu(float* Out, __m128 C0, __m128 C1, __m128 C2)
+{
+	_mm_storeu_ps(Out + 0, C0);
+	_mm_storeu_ps(Out + 3, C1);
+	_mm_storel_pi(reinterpret_cast<__m64*>(Out + 6), C2);
+	_mm_store_ss(Out + 8, _mm_movehl_ps(C2, C2));
+}
+
+// Out[i] = transpose(inverse(mat3(In[i]))), the normal matrix of a mat4. Out
+// must not overlap In.
+GLM_FUNC_QUALIFIER void glm_mat4_inverse_transpose_batch_sse2(float const* In, float* Out, std::size_t Count)
+{
+	for(std::size_t i = 0; i < Count; ++i)
+	{
+		__m128 const C0 = _mm_loadu_ps(In + i * 16 + 0);
+		__m128 const C1 = _mm_loadu_ps(In + i * 16 + 4);
+		__m128 const C2 = _mm_loadu_ps(In + i * 16 + 8);
+
+		// The rows of the inverse are cross products of the columns, the w
+		// lanes come out as exactly zero
+		__m128 const C0yzx = _mm_shuffle_ps(C0, C0, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 const C0zxy = _mm_shuffle_ps(C0, C0, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 const C1yzx = _mm_shuffle_ps(C1, C1, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 const C1zxy = _mm_shuffle_ps(C1, C1, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 const C2yzx = _mm_shuffle_ps(C2, C2, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 const C2zxy = _mm_shuffle_ps(C2, C2, _MM_SHUFFLE(3, 1, 0, 2));
+
+		__m128 const R0 = _mm_sub_ps(_mm_mul_ps(C1yzx, C2zxy), _mm_mul_ps(C1zxy, C2yzx));
+		__m128 const R1 = _mm_sub_ps(_mm_mul_ps(C2yzx, C0zxy), _mm_mul_ps(C2zxy, C0yzx));
+		__m128 const R2 = _mm_sub_ps(_mm_mul_ps(C0yzx, C1zxy), _mm_mul_ps(C0zxy, C1yzx));
+
+		__m128 Det = _mm_mul_ps(C0, R0);
+		Det = _mm_add_ps(Det, _mm_shuffle_ps(Det, Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm_add_ps(Det, _mm_shuffle_ps(Det, Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m128 const InvDet = _mm_div_ps(_mm_set1_ps(1.0f), Det);
+
+		glm_mat3_storeu(Out + i * 9, _mm_mul_ps(R0, InvDet), _mm_mul_ps(R1, InvDet), _mm_mul_ps(R2, InvDet));
+	}
+}
+
+// cross(A, B) in each 128 bit lane, w comes out as zero
+GLM_FUNC_QUALIFIER __m128 glm_vec3_cross_sse2(__m128 A, __m128 B)
+{
+	__m128 const Ayzx = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 const Byzx = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 const Czxy = _mm_sub_ps(_mm_mul_ps(A, Byzx), _mm_mul_ps(Ayzx, B));
+	return _mm_shuffle_ps(Czxy, Czxy, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Out[i] = inverse(In[i]), Out may be In. Built from cross products of the
+// columns (Lengyel) rather than the cofactors of glm_mat4_inverse: every step
+// stays inside a 128 bit lane, so the wider variants run the same code on two
+// or four matrices at once.
+GLM_FUNC_QUALIFIER void glm_mat4_inverse_batch_sse2(float const* In, float* Out, std::size_t Count)
+{
+	__m128 const Sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+
+	for(std::size_t i = 0; i < Count; ++i)
+	{
+		__m128 const A = _mm_loadu_ps(In + i * 16 + 0);
+		__m128 const B = _mm_loadu_ps(In + i * 16 + 4);
+		__m128 const C = _mm_loadu_ps(In + i * 16 + 8);
+		__m128 const D = _mm_loadu_ps(In + i * 16 + 12);
+
+		// The fourth row
+		__m128 const X = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 const Y = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 const Z = _mm_shuffle_ps(C, C, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 const W = _mm_shuffle_ps(D, D, _MM_SHUFFLE(3, 3, 3, 3));
+
+		// All four have a zero w lane
+		__m128 S = glm_vec3_cross_sse2(A, B);
+		__m128 T = glm_vec3_cross_sse2(C, D);
+		__m128 U = _mm_sub_ps(_mm_mul_ps(A, Y), _mm_mul_ps(B, X));
+		__m128 V = _mm_sub_ps(_mm_mul_ps(C, W), _mm_mul_ps(D, Z));
+
+		__m128 Det = _mm_add_ps(_mm_mul_ps(S, V), _mm_mul_ps(T, U));
+		Det = _mm_add_ps(Det, _mm_shuffle_ps(Det, Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm_add_ps(Det, _mm_shuffle_ps(Det, Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m128 const InvDet = _mm_div_ps(_mm_set1_ps(1.0f), Det);
+		S = _mm_mul_ps(S, InvDet);
+		T = _mm_mul_ps(T, InvDet);
+		U = _mm_mul_ps(U, InvDet);
+		V = _mm_mul_ps(V, InvDet);
+
+		// xyz of the rows of the inverse
+		__m128 const R0 = _mm_add_ps(glm_vec3_cross_sse2(B, V), _mm_mul_ps(T, Y));
+		__m128 const R1 = _mm_sub_ps(glm_vec3_cross_sse2(V, A), _mm_mul_ps(T, X));
+		__m128 const R2 = _mm_add_ps(glm_vec3_cross_sse2(D, U), _mm_mul_ps(S, W));
+		__m128 const R3 = _mm_sub_ps(glm_vec3_cross_sse2(U, C), _mm_mul_ps(S, Z));
+
+		// and their w: (-dot(B, T), dot(A, T), -dot(D, S), dot(C, S))
+		__m128 const E0 = _mm_mul_ps(B, T);
+		__m128 const E1 = _mm_mul_ps(A, T);
+		__m128 const E2 = _mm_mul_ps(D, S);
+		__m128 const E3 = _mm_mul_ps(C, S);
+		__m128 const E01 = _mm_add_ps(_mm_unpacklo_ps(E0, E1), _mm_unpackhi_ps(E0, E1));
+		__m128 const E23 = _mm_add_ps(_mm_unpacklo_ps(E2, E3), _mm_unpackhi_ps(E2, E3));
+		__m128 const Dots = _mm_add_ps(_mm_shuffle_ps(E01, E23, _MM_SHUFFLE(1, 0, 1, 0)), _mm_shuffle_ps(E01, E23, _MM_SHUFFLE(3, 2, 3, 2)));
+
+		// Rows to columns
+		__m128 const R01l = _mm_unpacklo_ps(R0, R1);
+		__m128 const R23l = _mm_unpacklo_ps(R2, R3);
+		__m128 const R01h = _mm_unpackhi_ps(R0, R1);
+		__m128 const R23h = _mm_unpackhi_ps(R2, R3);
+
+		_mm_storeu_ps(Out + i * 16 + 0, _mm_shuffle_ps(R01l, R23l, _MM_SHUFFLE(1, 0, 1, 0)));
+		_mm_storeu_ps(Out + i * 16 + 4, _mm_shuffle_ps(R01l, R23l, _MM_SHUFFLE(3, 2, 3, 2)));
+		_mm_storeu_ps(Out + i * 16 + 8, _mm_shuffle_ps(R01h, R23h, _MM_SHUFFLE(1, 0, 1, 0)));
+		_mm_storeu_ps(Out + i * 16 + 12, _mm_mul_ps(Dots, Sign));
+	}
+}
+
+// Out[i] = mat4_cast(In[i]) for quaternions stored x, y, z, w. Out must not
+// overlap In.
+GLM_FUNC_QUALIFIER void glm_quat_to_mat4_batch_sse2(float const* In, float* Out, std::size_t Count)
+{
+	// Column c is Identity[c] + Sign[c][0] * A0 * B0 + Sign[c][1] * A1 * B1,
+	// the products picked from q and 2 * q by the shuffles below
+	__m128 const Sign00 = _mm_setr_ps(-1.0f, 1.0f, 1.0f, 0.0f);
+	__m128 const Sign01 = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 0.0f);
+	__m128 const Sign10 = _mm_setr_ps(1.0f, -1.0f, 1.0f, 0.0f);
+	__m128 const Sign11 = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 0.0f);
+	__m128 const Sign20 = _mm_setr_ps(1.0f, 1.0f, -1.0f, 0.0f);
+	__m128 const Sign21 = _mm_setr_ps(1.0f, -1.0f, -1.0f, 0.0f);
+	__m128 const Identity0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	__m128 const Identity1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+	__m128 const Identity2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+	__m128 const Identity3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for(std::size_t i = 0; i < Count; ++i)
+	{
+		__m128 const Q = _mm_loadu_ps(In + i * 4);
+		__m128 const Q2 = _mm_add_ps(Q, Q);
+
+		// (1 - 2(yy + zz), 2(xy + wz), 2(xz - wy))
+		__m128 const P00 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 0, 0, 1)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 2, 1, 1)));
+		__m128 const P01 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 3, 3, 2)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 1, 2, 2)));
+		// (2(xy - wz), 1 - 2(xx + zz), 2(yz + wx))
+		__m128 const P10 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 1, 0, 0)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 2, 0, 1)));
+		__m128 const P11 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 3, 2, 3)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		// (2(xz + wy), 2(yz - wx), 1 - 2(xx + yy))
+		__m128 const P20 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 0, 1, 0)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		__m128 const P21 = _mm_mul_ps(_mm_shuffle_ps(Q, Q, _MM_SHUFFLE(3, 1, 3, 3)), _mm_shuffle_ps(Q2, Q2, _MM_SHUFFLE(3, 1, 0, 1)));
+
+		_mm_storeu_ps(Out + i * 16 + 0, _mm_add_ps(Identity0, _mm_add_ps(_mm_mul_ps(Sign00, P00), _mm_mul_ps(Sign01, P01))));
+		_mm_storeu_ps(Out + i * 16 + 4, _mm_add_ps(Identity1, _mm_add_ps(_mm_mul_ps(Sign10, P10), _mm_mul_ps(Sign11, P11))));
+		_mm_storeu_ps(Out + i * 16 + 8, _mm_add_ps(Identity2, _mm_add_ps(_mm_mul_ps(Sign20, P20), _mm_mul_ps(Sign21, P21))));
+		_mm_storeu_ps(Out + i * 16 + 12, Identity3);
+	}
+}
+
+// Two vectors per register, one in each 128 bit lane
+GLM_TARGET_AVX2 inline void glm_mat4_mul_vec4_batch_avx2(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	__m256 const Left0 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(M + 0));
+	__m256 const Left1 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(M + 4));
+	__m256 const Left2 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(M + 8));
+	__m256 const Left3 = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(M + 12));
+
+	std::size_t i = 0;
+	for(; i + 2 <= Count; i += 2)
+	{
+		__m256 const Right = _mm256_loadu_ps(In + i * 4);
+
+		__m256 Result = _mm256_mul_ps(Left0, _mm256_permute_ps(Right, 0x00));
+		Result = _mm256_fmadd_ps(Left1, _mm256_permute_ps(Right, 0x55), Result);
+		Result = _mm256_fmadd_ps(Left2, _mm256_permute_ps(Right, 0xAA), Result);
+		Result = _mm256_fmadd_ps(Left3, _mm256_permute_ps(Right, 0xFF), Result);
+
+		_mm256_storeu_ps(Out + i * 4, Result);
+	}
+
+	glm_mat4_mul_vec4_batch_sse2(M, In + i * 4, Out + i * 4, Count - i);
+}
+
+GLM_TARGET_AVX2 inline void glm_mat4_mul_batch_avx2(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	glm_mat4_mul_vec4_batch_avx2(M, In, Out, Count * 4);
+}
+
+GLM_TARGET_AVX2 inline void glm_mat4_mul_vec4_soa_avx2(float const* M, float const* const In[4], float* const Out[4], std::size_t Count)
+{
+	__m256 Elements[16];
+	for(int e = 0; e < 16; ++e)
+		Elements[e] = _mm256_set1_ps(M[e]);
+
+	std::size_t i = 0;
+	for(; i + 8 <= Count; i += 8)
+	{
+		__m256 const X = _mm256_loadu_ps(In[0] + i);
+		__m256 const Y = _mm256_loadu_ps(In[1] + i);
+		__m256 const Z = _mm256_loadu_ps(In[2] + i);
+		__m256 const W = _mm256_loadu_ps(In[3] + i);
+
+		for(int k = 0; k < 4; ++k)
+		{
+			__m256 Result = _mm256_mul_ps(Elements[k], X);
+			Result = _mm256_fmadd_ps(Elements[4 + k], Y, Result);
+			Result = _mm256_fmadd_ps(Elements[8 + k], Z, Result);
+			Result = _mm256_fmadd_ps(Elements[12 + k], W, Result);
+			_mm256_storeu_ps(Out[k] + i, Result);
+		}
+	}
+
+	glm_mat4_mul_vec4_soa_sse2(M, In, Out, i, Count);
+}
+
+// Two matrices per register, one in each 128 bit lane
+GLM_TARGET_AVX2 inline void glm_mat4_inverse_transpose_batch_avx2(float const* In, float* Out, std::size_t Count)
+{
+	std::size_t i = 0;
+	for(; i + 2 <= Count; i += 2)
+	{
+		// Columns 0-1 and 2-3 of both matrices
+		__m256 const A01 = _mm256_loadu_ps(In + i * 16 + 0);
+		__m256 const A23 = _mm256_loadu_ps(In + i * 16 + 8);
+		__m256 const B01 = _mm256_loadu_ps(In + i * 16 + 16);
+		__m256 const B23 = _mm256_loadu_ps(In + i * 16 + 24);
+
+		__m256 const C0 = _mm256_permute2f128_ps(A01, B01, 0x20);
+		__m256 const C1 = _mm256_permute2f128_ps(A01, B01, 0x31);
+		__m256 const C2 = _mm256_permute2f128_ps(A23, B23, 0x20);
+
+		__m256 const C0yzx = _mm256_permute_ps(C0, _MM_SHUFFLE(3, 0, 2, 1));
+		__m256 const C0zxy = _mm256_permute_ps(C0, _MM_SHUFFLE(3, 1, 0, 2));
+		__m256 const C1yzx = _mm256_permute_ps(C1, _MM_SHUFFLE(3, 0, 2, 1));
+		__m256 const C1zxy = _mm256_permute_ps(C1, _MM_SHUFFLE(3, 1, 0, 2));
+		__m256 const C2yzx = _mm256_permute_ps(C2, _MM_SHUFFLE(3, 0, 2, 1));
+		__m256 const C2zxy = _mm256_permute_ps(C2, _MM_SHUFFLE(3, 1, 0, 2));
+
+		__m256 const R0 = _mm256_fmsub_ps(C1yzx, C2zxy, _mm256_mul_ps(C1zxy, C2yzx));
+		__m256 const R1 = _mm256_fmsub_ps(C2yzx, C0zxy, _mm256_mul_ps(C2zxy, C0yzx));
+		__m256 const R2 = _mm256_fmsub_ps(C0yzx, C1zxy, _mm256_mul_ps(C0zxy, C1yzx));
+
+		__m256 Det = _mm256_mul_ps(C0, R0);
+		Det = _mm256_add_ps(Det, _mm256_permute_ps(Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm256_add_ps(Det, _mm256_permute_ps(Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m256 const InvDet = _mm256_div_ps(_mm256_set1_ps(1.0f), Det);
+		__m256 const N0 = _mm256_mul_ps(R0, InvDet);
+		__m256 const N1 = _mm256_mul_ps(R1, InvDet);
+		__m256 const N2 = _mm256_mul_ps(R2, InvDet);
+
+		glm_mat3_storeu(Out + i * 9, _mm256_castps256_ps128(N0), _mm256_castps256_ps128(N1), _mm256_castps256_ps128(N2));
+		glm_mat3_storeu(Out + i * 9 + 9, _mm256_extractf128_ps(N0, 1), _mm256_extractf128_ps(N1, 1), _mm256_extractf128_ps(N2, 1));
+	}
+
+	glm_mat4_inverse_transpose_batch_sse2(In + i * 16, Out + i * 9, Count - i);
+}
+
+GLM_TARGET_AVX2 inline __m256 glm_vec3_cross_avx2(__m256 A, __m256 B)
+{
+	__m256 const Ayzx = _mm256_permute_ps(A, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256 const Byzx = _mm256_permute_ps(B, _MM_SHUFFLE(3, 0, 2, 1));
+	__m256 const Czxy = _mm256_fmsub_ps(A, Byzx, _mm256_mul_ps(Ayzx, B));
+	return _mm256_permute_ps(Czxy, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Two matrices per register, one in each 128 bit lane
+GLM_TARGET_AVX2 inline void glm_mat4_inverse_batch_avx2(float const* In, float* Out, std::size_t Count)
+{
+	__m256 const Sign = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+
+	std::size_t i = 0;
+	for(; i + 2 <= Count; i += 2)
+	{
+		__m256 const M01 = _mm256_loadu_ps(In + i * 16 + 0);
+		__m256 const M23 = _mm256_loadu_ps(In + i * 16 + 8);
+		__m256 const N01 = _mm256_loadu_ps(In + i * 16 + 16);
+		__m256 const N23 = _mm256_loadu_ps(In + i * 16 + 24);
+
+		__m256 const A = _mm256_permute2f128_ps(M01, N01, 0x20);
+		__m256 const B = _mm256_permute2f128_ps(M01, N01, 0x31);
+		__m256 const C = _mm256_permute2f128_ps(M23, N23, 0x20);
+		__m256 const D = _mm256_permute2f128_ps(M23, N23, 0x31);
+
+		__m256 const X = _mm256_permute_ps(A, _MM_SHUFFLE(3, 3, 3, 3));
+		__m256 const Y = _mm256_permute_ps(B, _MM_SHUFFLE(3, 3, 3, 3));
+		__m256 const Z = _mm256_permute_ps(C, _MM_SHUFFLE(3, 3, 3, 3));
+		__m256 const W = _mm256_permute_ps(D, _MM_SHUFFLE(3, 3, 3, 3));
+
+		__m256 S = glm_vec3_cross_avx2(A, B);
+		__m256 T = glm_vec3_cross_avx2(C, D);
+		__m256 U = _mm256_fmsub_ps(A, Y, _mm256_mul_ps(B, X));
+		__m256 V = _mm256_fmsub_ps(C, W, _mm256_mul_ps(D, Z));
+
+		__m256 Det = _mm256_fmadd_ps(S, V, _mm256_mul_ps(T, U));
+		Det = _mm256_add_ps(Det, _mm256_permute_ps(Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm256_add_ps(Det, _mm256_permute_ps(Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m256 const InvDet = _mm256_div_ps(_mm256_set1_ps(1.0f), Det);
+		S = _mm256_mul_ps(S, InvDet);
+		T = _mm256_mul_ps(T, InvDet);
+		U = _mm256_mul_ps(U, InvDet);
+		V = _mm256_mul_ps(V, InvDet);
+
+		__m256 const R0 = _mm256_fmadd_ps(T, Y, glm_vec3_cross_avx2(B, V));
+		__m256 const R1 = _mm256_fnmadd_ps(T, X, glm_vec3_cross_avx2(V, A));
+		__m256 const R2 = _mm256_fmadd_ps(S, W, glm_vec3_cross_avx2(D, U));
+		__m256 const R3 = _mm256_fnmadd_ps(S, Z, glm_vec3_cross_avx2(U, C));
+
+		__m256 const E0 = _mm256_mul_ps(B, T);
+		__m256 const E1 = _mm256_mul_ps(A, T);
+		__m256 const E2 = _mm256_mul_ps(D, S);
+		__m256 const E3 = _mm256_mul_ps(C, S);
+		__m256 const E01 = _mm256_add_ps(_mm256_unpacklo_ps(E0, E1), _mm256_unpackhi_ps(E0, E1));
+		__m256 const E23 = _mm256_add_ps(_mm256_unpacklo_ps(E2, E3), _mm256_unpackhi_ps(E2, E3));
+		__m256 const Dots = _mm256_add_ps(_mm256_shuffle_ps(E01, E23, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(E01, E23, _MM_SHUFFLE(3, 2, 3, 2)));
+
+		__m256 const R01l = _mm256_unpacklo_ps(R0, R1);
+		__m256 const R23l = _mm256_unpacklo_ps(R2, R3);
+		__m256 const R01h = _mm256_unpackhi_ps(R0, R1);
+		__m256 const R23h = _mm256_unpackhi_ps(R2, R3);
+
+		__m256 const Col0 = _mm256_shuffle_ps(R01l, R23l, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 const Col1 = _mm256_shuffle_ps(R01l, R23l, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 const Col2 = _mm256_shuffle_ps(R01h, R23h, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 const Col3 = _mm256_mul_ps(Dots, Sign);
+
+		_mm256_storeu_ps(Out + i * 16 + 0, _mm256_permute2f128_ps(Col0, Col1, 0x20));
+		_mm256_storeu_ps(Out + i * 16 + 8, _mm256_permute2f128_ps(Col2, Col3, 0x20));
+		_mm256_storeu_ps(Out + i * 16 + 16, _mm256_permute2f128_ps(Col0, Col1, 0x31));
+		_mm256_storeu_ps(Out + i * 16 + 24, _mm256_permute2f128_ps(Col2, Col3, 0x31));
+	}
+
+	glm_mat4_inverse_batch_sse2(In + i * 16, Out + i * 16, Count - i);
+}
+
+// Two quaternions per register, see glm_quat_to_mat4_batch_sse2
+GLM_TARGET_AVX2 inline void glm_quat_to_mat4_batch_avx2(float const* In, float* Out, std::size_t Count)
+{
+	__m256 const Sign00 = _mm256_setr_ps(-1.0f, 1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 1.0f, 0.0f);
+	__m256 const Sign01 = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 0.0f, -1.0f, 1.0f, -1.0f, 0.0f);
+	__m256 const Sign10 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f, 0.0f);
+	__m256 const Sign11 = _mm256_setr_ps(-1.0f, -1.0f, 1.0f, 0.0f, -1.0f, -1.0f, 1.0f, 0.0f);
+	__m256 const Sign20 = _mm256_setr_ps(1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, -1.0f, 0.0f);
+	__m256 const Sign21 = _mm256_setr_ps(1.0f, -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, -1.0f, 0.0f);
+	__m256 const Identity0 = _mm256_setr_ps(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+	__m256 const Identity1 = _mm256_setr_ps(0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+	__m256 const Identity2 = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	__m256 const Identity3 = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+	std::size_t i = 0;
+	for(; i + 2 <= Count; i += 2)
+	{
+		__m256 const Q = _mm256_loadu_ps(In + i * 4);
+		__m256 const Q2 = _mm256_add_ps(Q, Q);
+
+		__m256 const P00 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 0, 0, 1)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 2, 1, 1)));
+		__m256 const P01 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 3, 3, 2)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 1, 2, 2)));
+		__m256 const P10 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 1, 0, 0)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 2, 0, 1)));
+		__m256 const P11 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 3, 2, 3)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		__m256 const P20 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 0, 1, 0)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		__m256 const P21 = _mm256_mul_ps(_mm256_permute_ps(Q, _MM_SHUFFLE(3, 1, 3, 3)), _mm256_permute_ps(Q2, _MM_SHUFFLE(3, 1, 0, 1)));
+
+		__m256 const Col0 = _mm256_fmadd_ps(Sign00, P00, _mm256_fmadd_ps(Sign01, P01, Identity0));
+		__m256 const Col1 = _mm256_fmadd_ps(Sign10, P10, _mm256_fmadd_ps(Sign11, P11, Identity1));
+		__m256 const Col2 = _mm256_fmadd_ps(Sign20, P20, _mm256_fmadd_ps(Sign21, P21, Identity2));
+
+		_mm256_storeu_ps(Out + i * 16 + 0, _mm256_permute2f128_ps(Col0, Col1, 0x20));
+		_mm256_storeu_ps(Out + i * 16 + 8, _mm256_permute2f128_ps(Col2, Identity3, 0x20));
+		_mm256_storeu_ps(Out + i * 16 + 16, _mm256_permute2f128_ps(Col0, Col1, 0x31));
+		_mm256_storeu_ps(Out + i * 16 + 24, _mm256_permute2f128_ps(Col2, Identity3, 0x31));
+	}
+
+	glm_quat_to_mat4_batch_sse2(In + i * 4, Out + i * 16, Count - i);
+}
+
+// GCC 12 warns about the undefined source operands inside the AVX-512
+// intrinsics (fixed in GCC 13)
+#if GLM_COMPILER & GLM_COMPILER_GCC
+#	pragma GCC diagnostic push
+#	pragma GCC diagnostic ignored "-Wuninitialized"
+#	pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Four vectors per register, one in each 128 bit lane
+GLM_TARGET_AVX512 inline void glm_mat4_mul_vec4_batch_avx512(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	// Column c of M repeated in all four lanes
+	__m512 const Left = _mm512_loadu_ps(M);
+	__m512 const Left0 = _mm512_permutexvar_ps(_mm512_setr_epi32(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3), Left);
+	__m512 const Left1 = _mm512_permutexvar_ps(_mm512_setr_epi32(4, 5, 6, 7, 4, 5, 6, 7, 4, 5, 6, 7, 4, 5, 6, 7), Left);
+	__m512 const Left2 = _mm512_permutexvar_ps(_mm512_setr_epi32(8, 9, 10, 11, 8, 9, 10, 11, 8, 9, 10, 11, 8, 9, 10, 11), Left);
+	__m512 const Left3 = _mm512_permutexvar_ps(_mm512_setr_epi32(12, 13, 14, 15, 12, 13, 14, 15, 12, 13, 14, 15, 12, 13, 14, 15), Left);
+
+	std::size_t i = 0;
+	for(; i + 4 <= Count; i += 4)
+	{
+		__m512 const Right = _mm512_loadu_ps(In + i * 4);
+
+		__m512 Result = _mm512_mul_ps(Left0, _mm512_permute_ps(Right, 0x00));
+		Result = _mm512_fmadd_ps(Left1, _mm512_permute_ps(Right, 0x55), Result);
+		Result = _mm512_fmadd_ps(Left2, _mm512_permute_ps(Right, 0xAA), Result);
+		Result = _mm512_fmadd_ps(Left3, _mm512_permute_ps(Right, 0xFF), Result);
+
+		_mm512_storeu_ps(Out + i * 4, Result);
+	}
+
+	glm_mat4_mul_vec4_batch_sse2(M, In + i * 4, Out + i * 4, Count - i);
+}
+
+// A whole matrix per register
+GLM_TARGET_AVX512 inline void glm_mat4_mul_batch_avx512(float const* M, float const* In, float* Out, std::size_t Count)
+{
+	glm_mat4_mul_vec4_batch_avx512(M, In, Out, Count * 4);
+}
+
+GLM_TARGET_AVX512 inline void glm_mat4_mul_vec4_soa_avx512(float const* M, float const* const In[4], float* const Out[4], std::size_t Count)
+{
+	__m512 Elements[16];
+	for(int e = 0; e < 16; ++e)
+		Elements[e] = _mm512_set1_ps(M[e]);
+
+	std::size_t i = 0;
+	for(; i + 16 <= Count; i += 16)
+	{
+		__m512 const X = _mm512_loadu_ps(In[0] + i);
+		__m512 const Y = _mm512_loadu_ps(In[1] + i);
+		__m512 const Z = _mm512_loadu_ps(In[2] + i);
+		__m512 const W = _mm512_loadu_ps(In[3] + i);
+
+		for(int k = 0; k < 4; ++k)
+		{
+			__m512 Result = _mm512_mul_ps(Elements[k], X);
+			Result = _mm512_fmadd_ps(Elements[4 + k], Y, Result);
+			Result = _mm512_fmadd_ps(Elements[8 + k], Z, Result);
+			Result = _mm512_fmadd_ps(Elements[12 + k], W, Result);
+			_mm512_storeu_ps(Out[k] + i, Result);
+		}
+	}
+
+	glm_mat4_mul_vec4_soa_sse2(M, In, Out, i, Count);
+}
+
+// Four matrices per register, one in each 128 bit lane
+GLM_TARGET_AVX512 inline void glm_mat4_inverse_transpose_batch_avx512(float const* In, float* Out, std::size_t Count)
+{
+	// xyz of three columns, packed into the 9 floats of a mat3
+	__m512i const Pack = _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 0, 0, 0, 0, 0, 0, 0);
+
+	std::size_t i = 0;
+	for(; i + 4 <= Count; i += 4)
+	{
+		__m512 const A = _mm512_loadu_ps(In + i * 16 + 0);
+		__m512 const B = _mm512_loadu_ps(In + i * 16 + 16);
+		__m512 const C = _mm512_loadu_ps(In + i * 16 + 32);
+		__m512 const D = _mm512_loadu_ps(In + i * 16 + 48);
+
+		// Transpose the 4x4 grid of columns: C0 = column 0 of A, B, C and D
+		__m512 const AB01 = _mm512_shuffle_f32x4(A, B, _MM_SHUFFLE(1, 0, 1, 0));
+		__m512 const CD01 = _mm512_shuffle_f32x4(C, D, _MM_SHUFFLE(1, 0, 1, 0));
+		__m512 const AB23 = _mm512_shuffle_f32x4(A, B, _MM_SHUFFLE(3, 2, 3, 2));
+		__m512 const CD23 = _mm512_shuffle_f32x4(C, D, _MM_SHUFFLE(3, 2, 3, 2));
+
+		__m512 const C0 = _mm512_shuffle_f32x4(AB01, CD01, _MM_SHUFFLE(2, 0, 2, 0));
+		__m512 const C1 = _mm512_shuffle_f32x4(AB01, CD01, _MM_SHUFFLE(3, 1, 3, 1));
+		__m512 const C2 = _mm512_shuffle_f32x4(AB23, CD23, _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m512 const C0yzx = _mm512_permute_ps(C0, _MM_SHUFFLE(3, 0, 2, 1));
+		__m512 const C0zxy = _mm512_permute_ps(C0, _MM_SHUFFLE(3, 1, 0, 2));
+		__m512 const C1yzx = _mm512_permute_ps(C1, _MM_SHUFFLE(3, 0, 2, 1));
+		__m512 const C1zxy = _mm512_permute_ps(C1, _MM_SHUFFLE(3, 1, 0, 2));
+		__m512 const C2yzx = _mm512_permute_ps(C2, _MM_SHUFFLE(3, 0, 2, 1));
+		__m512 const C2zxy = _mm512_permute_ps(C2, _MM_SHUFFLE(3, 1, 0, 2));
+
+		__m512 const R0 = _mm512_fmsub_ps(C1yzx, C2zxy, _mm512_mul_ps(C1zxy, C2yzx));
+		__m512 const R1 = _mm512_fmsub_ps(C2yzx, C0zxy, _mm512_mul_ps(C2zxy, C0yzx));
+		__m512 const R2 = _mm512_fmsub_ps(C0yzx, C1zxy, _mm512_mul_ps(C0zxy, C1yzx));
+
+		__m512 Det = _mm512_mul_ps(C0, R0);
+		Det = _mm512_add_ps(Det, _mm512_permute_ps(Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm512_add_ps(Det, _mm512_permute_ps(Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m512 const InvDet = _mm512_div_ps(_mm512_set1_ps(1.0f), Det);
+		__m512 const N0 = _mm512_mul_ps(R0, InvDet);
+		__m512 const N1 = _mm512_mul_ps(R1, InvDet);
+		__m512 const N2 = _mm512_mul_ps(R2, InvDet);
+
+		// Back to one matrix per register, the fourth column is unused
+		__m512 const N01a = _mm512_shuffle_f32x4(N0, N1, _MM_SHUFFLE(1, 0, 1, 0));
+		__m512 const N01b = _mm512_shuffle_f32x4(N0, N1, _MM_SHUFFLE(3, 2, 3, 2));
+		__m512 const N22a = _mm512_shuffle_f32x4(N2, N2, _MM_SHUFFLE(1, 0, 1, 0));
+		__m512 const N22b = _mm512_shuffle_f32x4(N2, N2, _MM_SHUFFLE(3, 2, 3, 2));
+
+		__m512 const NA = _mm512_shuffle_f32x4(N01a, N22a, _MM_SHUFFLE(2, 0, 2, 0));
+		__m512 const NB = _mm512_shuffle_f32x4(N01a, N22a, _MM_SHUFFLE(3, 1, 3, 1));
+		__m512 const NC = _mm512_shuffle_f32x4(N01b, N22b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m512 const ND = _mm512_shuffle_f32x4(N01b, N22b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		_mm512_mask_storeu_ps(Out + i * 9 + 0, 0x01FF, _mm512_permutexvar_ps(Pack, NA));
+		_mm512_mask_storeu_ps(Out + i * 9 + 9, 0x01FF, _mm512_permutexvar_ps(Pack, NB));
+		_mm512_mask_storeu_ps(Out + i * 9 + 18, 0x01FF, _mm512_permutexvar_ps(Pack, NC));
+		_mm512_mask_storeu_ps(Out + i * 9 + 27, 0x01FF, _mm512_permutexvar_ps(Pack, ND));
+	}
+
+	glm_mat4_inverse_transpose_batch_sse2(In + i * 16, Out + i * 9, Count - i);
+}
+
+// Transposes the 4x4 grid of 128 bit lanes: lane j of Out[k] is lane k of In[j]
+GLM_TARGET_AVX512 inline void glm_lane_transpose_avx512(__m512 const In[4], __m512 Out[4])
+{
+	__m512 const AB01 = _mm512_shuffle_f32x4(In[0], In[1], _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 const CD01 = _mm512_shuffle_f32x4(In[2], In[3], _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 const AB23 = _mm512_shuffle_f32x4(In[0], In[1], _MM_SHUFFLE(3, 2, 3, 2));
+	__m512 const CD23 = _mm512_shuffle_f32x4(In[2], In[3], _MM_SHUFFLE(3, 2, 3, 2));
+
+	Out[0] = _mm512_shuffle_f32x4(AB01, CD01, _MM_SHUFFLE(2, 0, 2, 0));
+	Out[1] = _mm512_shuffle_f32x4(AB01, CD01, _MM_SHUFFLE(3, 1, 3, 1));
+	Out[2] = _mm512_shuffle_f32x4(AB23, CD23, _MM_SHUFFLE(2, 0, 2, 0));
+	Out[3] = _mm512_shuffle_f32x4(AB23, CD23, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+GLM_TARGET_AVX512 inline __m512 glm_vec3_cross_avx512(__m512 A, __m512 B)
+{
+	__m512 const Ayzx = _mm512_permute_ps(A, _MM_SHUFFLE(3, 0, 2, 1));
+	__m512 const Byzx = _mm512_permute_ps(B, _MM_SHUFFLE(3, 0, 2, 1));
+	__m512 const Czxy = _mm512_fmsub_ps(A, Byzx, _mm512_mul_ps(Ayzx, B));
+	return _mm512_permute_ps(Czxy, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Four matrices per register, one in each 128 bit lane
+GLM_TARGET_AVX512 inline void glm_mat4_inverse_batch_avx512(float const* In, float* Out, std::size_t Count)
+{
+	__m512 const Sign = _mm512_setr4_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+
+	std::size_t i = 0;
+	for(; i + 4 <= Count; i += 4)
+	{
+		__m512 Matrices[4];
+		for(int k = 0; k < 4; ++k)
+			Matrices[k] = _mm512_loadu_ps(In + i * 16 + k * 16);
+
+		__m512 Columns[4];
+		glm_lane_transpose_avx512(Matrices, Columns);
+		__m512 const A = Columns[0];
+		__m512 const B = Columns[1];
+		__m512 const C = Columns[2];
+		__m512 const D = Columns[3];
+
+		__m512 const X = _mm512_permute_ps(A, _MM_SHUFFLE(3, 3, 3, 3));
+		__m512 const Y = _mm512_permute_ps(B, _MM_SHUFFLE(3, 3, 3, 3));
+		__m512 const Z = _mm512_permute_ps(C, _MM_SHUFFLE(3, 3, 3, 3));
+		__m512 const W = _mm512_permute_ps(D, _MM_SHUFFLE(3, 3, 3, 3));
+
+		__m512 S = glm_vec3_cross_avx512(A, B);
+		__m512 T = glm_vec3_cross_avx512(C, D);
+		__m512 U = _mm512_fmsub_ps(A, Y, _mm512_mul_ps(B, X));
+		__m512 V = _mm512_fmsub_ps(C, W, _mm512_mul_ps(D, Z));
+
+		__m512 Det = _mm512_fmadd_ps(S, V, _mm512_mul_ps(T, U));
+		Det = _mm512_add_ps(Det, _mm512_permute_ps(Det, _MM_SHUFFLE(2, 3, 0, 1)));
+		Det = _mm512_add_ps(Det, _mm512_permute_ps(Det, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		__m512 const InvDet = _mm512_div_ps(_mm512_set1_ps(1.0f), Det);
+		S = _mm512_mul_ps(S, InvDet);
+		T = _mm512_mul_ps(T, InvDet);
+		U = _mm512_mul_ps(U, InvDet);
+		V = _mm512_mul_ps(V, InvDet);
+
+		__m512 const R0 = _mm512_fmadd_ps(T, Y, glm_vec3_cross_avx512(B, V));
+		__m512 const R1 = _mm512_fnmadd_ps(T, X, glm_vec3_cross_avx512(V, A));
+		__m512 const R2 = _mm512_fmadd_ps(S, W, glm_vec3_cross_avx512(D, U));
+		__m512 const R3 = _mm512_fnmadd_ps(S, Z, glm_vec3_cross_avx512(U, C));
+
+		__m512 const E0 = _mm512_mul_ps(B, T);
+		__m512 const E1 = _mm512_mul_ps(A, T);
+		__m512 const E2 = _mm512_mul_ps(D, S);
+		__m512 const E3 = _mm512_mul_ps(C, S);
+		__m512 const E01 = _mm512_add_ps(_mm512_unpacklo_ps(E0, E1), _mm512_unpackhi_ps(E0, E1));
+		__m512 const E23 = _mm512_add_ps(_mm512_unpacklo_ps(E2, E3), _mm512_unpackhi_ps(E2, E3));
+		__m512 const Dots = _mm512_add_ps(_mm512_shuffle_ps(E01, E23, _MM_SHUFFLE(1, 0, 1, 0)), _mm512_shuffle_ps(E01, E23, _MM_SHUFFLE(3, 2, 3, 2)));
+
+		__m512 const R01l = _mm512_unpacklo_ps(R0, R1);
+		__m512 const R23l = _mm512_unpacklo_ps(R2, R3);
+		__m512 const R01h = _mm512_unpackhi_ps(R0, R1);
+		__m512 const R23h = _mm512_unpackhi_ps(R2, R3);
+
+		Columns[0] = _mm512_shuffle_ps(R01l, R23l, _MM_SHUFFLE(1, 0, 1, 0));
+		Columns[1] = _mm512_shuffle_ps(R01l, R23l, _MM_SHUFFLE(3, 2, 3, 2));
+		Columns[2] = _mm512_shuffle_ps(R01h, R23h, _MM_SHUFFLE(1, 0, 1, 0));
+		Columns[3] = _mm512_mul_ps(Dots, Sign);
+
+		glm_lane_transpose_avx512(Columns, Matrices);
+		for(int k = 0; k < 4; ++k)
+			_mm512_storeu_ps(Out + i * 16 + k * 16, Matrices[k]);
+	}
+
+	glm_mat4_inverse_batch_sse2(In + i * 16, Out + i * 16, Count - i);
+}
+
+// Four quaternions per register, see glm_quat_to_mat4_batch_sse2
+GLM_TARGET_AVX512 inline void glm_quat_to_mat4_batch_avx512(float const* In, float* Out, std::size_t Count)
+{
+	__m512 const Sign00 = _mm512_setr4_ps(-1.0f, 1.0f, 1.0f, 0.0f);
+	__m512 const Sign01 = _mm512_setr4_ps(-1.0f, 1.0f, -1.0f, 0.0f);
+	__m512 const Sign10 = _mm512_setr4_ps(1.0f, -1.0f, 1.0f, 0.0f);
+	__m512 const Sign11 = _mm512_setr4_ps(-1.0f, -1.0f, 1.0f, 0.0f);
+	__m512 const Sign20 = _mm512_setr4_ps(1.0f, 1.0f, -1.0f, 0.0f);
+	__m512 const Sign21 = _mm512_setr4_ps(1.0f, -1.0f, -1.0f, 0.0f);
+	__m512 const Identity0 = _mm512_setr4_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	__m512 const Identity1 = _mm512_setr4_ps(0.0f, 1.0f, 0.0f, 0.0f);
+	__m512 const Identity2 = _mm512_setr4_ps(0.0f, 0.0f, 1.0f, 0.0f);
+	__m512 const Identity3 = _mm512_setr4_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	std::size_t i = 0;
+	for(; i + 4 <= Count; i += 4)
+	{
+		__m512 const Q = _mm512_loadu_ps(In + i * 4);
+		__m512 const Q2 = _mm512_add_ps(Q, Q);
+
+		__m512 const P00 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 0, 0, 1)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 2, 1, 1)));
+		__m512 const P01 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 3, 3, 2)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 1, 2, 2)));
+		__m512 const P10 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 1, 0, 0)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 2, 0, 1)));
+		__m512 const P11 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 3, 2, 3)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		__m512 const P20 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 0, 1, 0)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 0, 2, 2)));
+		__m512 const P21 = _mm512_mul_ps(_mm512_permute_ps(Q, _MM_SHUFFLE(3, 1, 3, 3)), _mm512_permute_ps(Q2, _MM_SHUFFLE(3, 1, 0, 1)));
+
+		__m512 Columns[4];
+		Columns[0] = _mm512_fmadd_ps(Sign00, P00, _mm512_fmadd_ps(Sign01, P01, Identity0));
+		Columns[1] = _mm512_fmadd_ps(Sign10, P10, _mm512_fmadd_ps(Sign11, P11, Identity1));
+		Columns[2] = _mm512_fmadd_ps(Sign20, P20, _mm512_fmadd_ps(Sign21, P21, Identity2));
+		Columns[3] = Identity3;
+
+		__m512 Matrices[4];
+		glm_lane_transpose_avx512(Columns, Matrices);
+		for(int k = 0; k < 4; ++k)
+			_mm512_storeu_ps(Out + i * 16 + k * 16, Matrices[k]);
+	}
+
+	glm_quat_to_mat4_batch_sse2(In + i * 4, Out + i * 16, Count - i);
+}
+
+#if GLM_COMPILER & GLM_COMPILER_GCC
+#	pragma GCC diagnostic pop
+#endif
+
+#endif//GLM_HAS_RUNTIME_ISA
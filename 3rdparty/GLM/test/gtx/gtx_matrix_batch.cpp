@@ -0,0 +1,278 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/matrix_batch.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_relational.hpp>
+#include <glm/ext/vector_relational.hpp>
+#include <glm/ext/quaternion_relational.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+static std::vector<glm::mat4> make_matrices(std::size_t Count)
+{
+	std::vector<glm::mat4> Result(Count);
+	for(std::size_t i = 0; i < Count; ++i)
+	{
+		float const f = static_cast<float>(i);
+		glm::mat4 M = glm::translate(glm::mat4(1.0f), glm::vec3(f, -2.0f * f, 0.5f));
+		M = glm::rotate(M, 0.3f * f + 0.1f, glm::normalize(glm::vec3(1.0f, f, 2.0f)));
+		Result[i] = glm::scale(M, glm::vec3(1.0f + 0.1f * f, 2.0f, 0.5f + 0.05f * f));
+	}
+	return Result;
+}
+
+static glm::mat4 const Transform(
+	0.5f, 1.0f, 0.0f, 0.0f,
+	-1.0f, 0.5f, 0.2f, 0.0f,
+	0.0f, 0.3f, 2.0f, 0.0f,
+	4.0f, 5.0f, 6.0f, 1.0f);
+
+static int test_mul()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<glm::mat4> const In = make_matrices(Count);
+		std::vector<glm::mat4> Out(Count + 1, glm::mat4(7.0f));
+
+		glm::batchMul(Transform, In.data(), Out.data(), Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Out[i], Transform * In[i], 0.001f)) ? 0 : 1;
+		Error += Out[Count] == glm::mat4(7.0f) ? 0 : 1;
+
+		// In place
+		std::vector<glm::mat4> InPlace = In;
+		glm::batchMul(Transform, InPlace.data(), InPlace.data(), Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(InPlace[i], Out[i], 0.0f)) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_mul_soa()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<float> Components[4];
+		std::vector<float> Results[4];
+		for(int k = 0; k < 4; ++k)
+		{
+			Components[k].resize(Count + 1);
+			Results[k].assign(Count + 1, 7.0f);
+			for(std::size_t i = 0; i < Count; ++i)
+				Components[k][i] = static_cast<float>(i) * 0.25f - static_cast<float>(k);
+		}
+
+		float const* const In[4] = {Components[0].data(), Components[1].data(), Components[2].data(), Components[3].data()};
+		float* const Out[4] = {Results[0].data(), Results[1].data(), Results[2].data(), Results[3].data()};
+
+		glm::batchMulSoA(Transform, In, Out, Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			glm::vec4 const Expected = Transform * glm::vec4(In[0][i], In[1][i], In[2][i], In[3][i]);
+			glm::vec4 const Computed(Out[0][i], Out[1][i], Out[2][i], Out[3][i]);
+			Error += glm::all(glm::equal(Computed, Expected, 0.001f)) ? 0 : 1;
+		}
+		for(int k = 0; k < 4; ++k)
+			Error += Results[k][Count] == 7.0f ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_inverse_transpose()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<glm::mat4> const In = make_matrices(Count);
+		std::vector<glm::mat3> Out(Count + 1, glm::mat3(7.0f));
+
+		glm::batchInverseTranspose(In.data(), Out.data(), Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			glm::mat3 const Expected = glm::transpose(glm::inverse(glm::mat3(In[i])));
+			Error += glm::all(glm::equal(Out[i], Expected, 0.001f)) ? 0 : 1;
+		}
+		Error += Out[Count] == glm::mat3(7.0f) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_mul_vec4()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<glm::vec4> In(Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			In[i] = glm::vec4(static_cast<float>(i), -0.5f * static_cast<float>(i), 2.0f, i % 2 ? 1.0f : 0.0f);
+		std::vector<glm::vec4> Out(Count + 1, glm::vec4(7.0f));
+
+		glm::batchMul(Transform, In.data(), Out.data(), Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Out[i], Transform * In[i], 0.001f)) ? 0 : 1;
+		Error += Out[Count] == glm::vec4(7.0f) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_inverse()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<glm::mat4> In = make_matrices(Count);
+		// A projection, the bottom row is not (0, 0, 0, 1)
+		if(Count > 3)
+			In[3] = glm::frustum(-1.0f, 1.0f, -0.75f, 0.75f, 0.1f, 100.0f);
+		std::vector<glm::mat4> Out(Count + 1, glm::mat4(7.0f));
+
+		glm::batchInverse(In.data(), Out.data(), Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			Error += glm::all(glm::equal(Out[i], glm::inverse(In[i]), 0.001f)) ? 0 : 1;
+			Error += glm::all(glm::equal(Out[i] * In[i], glm::mat4(1.0f), 0.001f)) ? 0 : 1;
+		}
+		Error += Out[Count] == glm::mat4(7.0f) ? 0 : 1;
+
+		// In place
+		glm::batchInverse(In.data(), In.data(), Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(In[i], Out[i], 0.0f)) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_mat4_cast()
+{
+	int Error = 0;
+
+	for(std::size_t Count = 0; Count < 37; ++Count)
+	{
+		std::vector<glm::quat> In(Count);
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			float const f = static_cast<float>(i);
+			In[i] = glm::angleAxis(0.4f * f - 3.0f, glm::normalize(glm::vec3(1.0f, f - 10.0f, 0.5f * f)));
+		}
+		std::vector<glm::mat4> Out(Count + 1, glm::mat4(7.0f));
+
+		glm::batchMat4Cast(In.data(), Out.data(), Count);
+
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Out[i], glm::mat4_cast(In[i]), 0.0001f)) ? 0 : 1;
+		Error += Out[Count] == glm::mat4(7.0f) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+#if GLM_HAS_RUNTIME_ISA
+// Every level the CPU can run against the SSE2 kernels, the dispatch only
+// ever exercises the widest
+static int test_level(int Level)
+{
+	int Error = 0;
+
+	glm_dispatch_table const Reference = glm_dispatch_select(GLM_CPU_SSE2_BIT);
+	glm_dispatch_table const Table = glm_dispatch_select(Level);
+	Error += Table.Level == Level ? 0 : 1;
+
+	for(std::size_t Count = 0; Count < 53; Count += 13)
+	{
+		std::vector<glm::mat4> const In = make_matrices(Count + 1);
+		float const* M = &Transform[0][0];
+		float const* Source = &In[0][0][0];
+
+		std::vector<glm::mat4> Expected(Count + 1), Computed(Count + 1);
+		std::vector<glm::mat3> Expected3(Count + 1), Computed3(Count + 1);
+
+		Reference.mat4_mul_batch(M, Source, &Expected[0][0][0], Count);
+		Table.mat4_mul_batch(M, Source, &Computed[0][0][0], Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed[i], Expected[i], 0.001f)) ? 0 : 1;
+
+		// The matrices as 4 * Count vectors
+		Reference.mat4_mul_vec4_batch(M, Source, &Expected[0][0][0], Count * 4);
+		Table.mat4_mul_vec4_batch(M, Source, &Computed[0][0][0], Count * 4);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed[i], Expected[i], 0.001f)) ? 0 : 1;
+
+		// The matrices as the x, y, z and w arrays of 4 * Count / 4 vectors
+		float const* const SoAIn[4] = {Source, Source + Count * 4, Source + Count * 8, Source + Count * 12};
+		float* const SoAExpected[4] = {&Expected[0][0][0], &Expected[0][0][0] + Count * 4, &Expected[0][0][0] + Count * 8, &Expected[0][0][0] + Count * 12};
+		float* const SoAComputed[4] = {&Computed[0][0][0], &Computed[0][0][0] + Count * 4, &Computed[0][0][0] + Count * 8, &Computed[0][0][0] + Count * 12};
+		Reference.mat4_mul_vec4_soa(M, SoAIn, SoAExpected, Count * 4);
+		Table.mat4_mul_vec4_soa(M, SoAIn, SoAComputed, Count * 4);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed[i], Expected[i], 0.001f)) ? 0 : 1;
+
+		Reference.mat4_inverse_batch(Source, &Expected[0][0][0], Count);
+		Table.mat4_inverse_batch(Source, &Computed[0][0][0], Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed[i], Expected[i], 0.001f)) ? 0 : 1;
+
+		Reference.mat4_inverse_transpose_batch(Source, &Expected3[0][0][0], Count);
+		Table.mat4_inverse_transpose_batch(Source, &Computed3[0][0][0], Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed3[i], Expected3[i], 0.001f)) ? 0 : 1;
+
+		// Any four floats make a quaternion for this comparison
+		Reference.quat_to_mat4_batch(Source, &Expected[0][0][0], Count);
+		Table.quat_to_mat4_batch(Source, &Computed[0][0][0], Count);
+		for(std::size_t i = 0; i < Count; ++i)
+			Error += glm::all(glm::equal(Computed[i], Expected[i], 0.01f)) ? 0 : 1;
+	}
+
+	return Error;
+}
+
+static int test_kernels()
+{
+	int Error = 0;
+
+	int const Features = glm_cpu_features();
+	Error += Features & GLM_CPU_SSE2_BIT ? 0 : 1;
+	Error += glm_dispatch().Level == glm_dispatch_select(Features).Level ? 0 : 1;
+
+	Error += test_level(GLM_CPU_SSE2_BIT);
+	if(Features & GLM_CPU_AVX2_BIT)
+		Error += test_level(GLM_CPU_AVX2_BIT);
+	if(Features & GLM_CPU_AVX512F_BIT)
+		Error += test_level(GLM_CPU_AVX512F_BIT);
+
+	return Error;
+}
+#endif
+
+int main()
+{
+	int Error = 0;
+
+	Error += test_mul();
+	Error += test_mul_vec4();
+	Error += test_mul_soa();
+	Error += test_inverse();
+	Error += test_inverse_transpose();
+	Error += test_mat4_cast();
+#	if GLM_HAS_RUNTIME_ISA
+		Error += test_kernels();
+#	endif
+
+	return Error;
+}
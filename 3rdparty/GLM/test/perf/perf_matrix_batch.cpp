@@ -0,0 +1,261 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/matrix_batch.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_relational.hpp>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+// Scalar loops against glm::batch* and, for each instruction set level the
+// CPU has, the kernels of glm/simd/dispatch.h. Times are the best of a few runs.
+
+static int const Runs = 5;
+
+template <typename functionType>
+static int best_time(functionType Function)
+{
+	long long Best = -1;
+	for(int r = 0; r < Runs; ++r)
+	{
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		Function();
+		std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+		long long const Time = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+		if(Best < 0 || Time < Best)
+			Best = Time;
+	}
+	return static_cast<int>(Best);
+}
+
+#if GLM_HAS_RUNTIME_ISA
+static char const* level_name(int Level)
+{
+	switch(Level)
+	{
+	case GLM_CPU_AVX512F_BIT:
+		return "avx512";
+	case GLM_CPU_AVX2_BIT:
+		return "avx2";
+	default:
+		return "sse2";
+	}
+}
+
+// Runs Function(Table) once per level the CPU supports
+template <typename functionType>
+static void each_level(functionType Function)
+{
+	int const Features = glm_cpu_features();
+	int const Levels[] = {GLM_CPU_SSE2_BIT, GLM_CPU_AVX2_BIT, GLM_CPU_AVX512F_BIT};
+
+	for(int l = 0; l < 3; ++l)
+	{
+		if(!(Features & Levels[l]))
+			continue;
+		glm_dispatch_table const Table = glm_dispatch_select(Levels[l]);
+		std::printf("- %s: %d us\n", level_name(Levels[l]), best_time([&]() { Function(Table); }));
+	}
+}
+#endif
+
+static std::vector<glm::mat4> make_matrices(std::size_t Samples)
+{
+	std::vector<glm::mat4> Result(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+	{
+		float const f = static_cast<float>(i % 1000);
+		glm::mat4 const M = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(f, 1.0f, -f)), f * 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+		Result[i] = glm::scale(M, glm::vec3(1.0f + f * 0.001f));
+	}
+	return Result;
+}
+
+static glm::mat4 const Transform(
+	1.2f, 0.0f, 0.0f, 0.0f,
+	0.0f, 1.8f, 0.0f, 0.0f,
+	0.0f, 0.0f, -1.0f, -1.0f,
+	0.0f, 0.0f, -0.2f, 0.0f);
+
+static int comp_mat4_mul_batch(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::mat4> const In = make_matrices(Samples);
+	std::vector<glm::mat4> Loop(Samples), Batch(Samples);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = Transform * In[i];
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchMul(Transform, In.data(), Batch.data(), Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], Batch[i], 0.01f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA
+		each_level([&](glm_dispatch_table const& Table) { Table.mat4_mul_batch(&Transform[0][0], &In[0][0][0], &Batch[0][0][0], Samples); });
+#	endif
+
+	return Error;
+}
+
+static int comp_mat4_mul_vec4_batch(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::vec4> In(Samples), Loop(Samples), Batch(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+		In[i] = glm::vec4(static_cast<float>(i % 100) * 0.1f, 1.0f, 2.0f, 1.0f);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = Transform * In[i];
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchMul(Transform, In.data(), Batch.data(), Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], Batch[i], 0.01f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA
+		each_level([&](glm_dispatch_table const& Table) { Table.mat4_mul_vec4_batch(&Transform[0][0], &In[0][0], &Batch[0][0], Samples); });
+#	endif
+
+	return Error;
+}
+
+static int comp_mat4_mul_vec4_soa(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<float> Components[4], Results[4];
+	for(int k = 0; k < 4; ++k)
+	{
+		Components[k].resize(Samples);
+		Results[k].resize(Samples);
+		for(std::size_t i = 0; i < Samples; ++i)
+			Components[k][i] = k == 3 ? 1.0f : static_cast<float>(i % 100) * 0.1f + static_cast<float>(k);
+	}
+
+	float const* const In[4] = {Components[0].data(), Components[1].data(), Components[2].data(), Components[3].data()};
+	float* const Out[4] = {Results[0].data(), Results[1].data(), Results[2].data(), Results[3].data()};
+
+	// The usual AoS loop over the same data
+	std::vector<glm::vec4> Vectors(Samples), Loop(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+		Vectors[i] = glm::vec4(In[0][i], In[1][i], In[2][i], In[3][i]);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = Transform * Vectors[i];
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchMulSoA(Transform, In, Out, Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], glm::vec4(Out[0][i], Out[1][i], Out[2][i], Out[3][i]), 0.01f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA
+		each_level([&](glm_dispatch_table const& Table) { Table.mat4_mul_vec4_soa(&Transform[0][0], In, Out, Samples); });
+#	endif
+
+	return Error;
+}
+
+static int comp_mat4_inverse(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::mat4> const In = make_matrices(Samples);
+	std::vector<glm::mat4> Loop(Samples), Batch(Samples);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = glm::inverse(In[i]);
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchInverse(In.data(), Batch.data(), Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], Batch[i], 0.01f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA
+		each_level([&](glm_dispatch_table const& Table) { Table.mat4_inverse_batch(&In[0][0][0], &Batch[0][0][0], Samples); });
+#	endif
+
+	return Error;
+}
+
+static int comp_mat4_inverse_transpose(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::mat4> const In = make_matrices(Samples);
+	std::vector<glm::mat3> Loop(Samples), Batch(Samples);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = glm::transpose(glm::inverse(glm::mat3(In[i])));
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchInverseTranspose(In.data(), Batch.data(), Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], Batch[i], 0.001f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA
+		each_level([&](glm_dispatch_table const& Table) { Table.mat4_inverse_transpose_batch(&In[0][0][0], &Batch[0][0][0], Samples); });
+#	endif
+
+	return Error;
+}
+
+static int comp_mat4_cast(std::size_t Samples)
+{
+	int Error = 0;
+
+	std::vector<glm::quat> In(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+		In[i] = glm::angleAxis(static_cast<float>(i % 1000) * 0.01f, glm::normalize(glm::vec3(1.0f, 2.0f, static_cast<float>(i % 7))));
+	std::vector<glm::mat4> Loop(Samples), Batch(Samples);
+
+	std::printf("- loop: %d us\n", best_time([&]() {
+		for(std::size_t i = 0; i < Samples; ++i)
+			Loop[i] = glm::mat4_cast(In[i]);
+	}));
+	std::printf("- batch: %d us\n", best_time([&]() { glm::batchMat4Cast(In.data(), Batch.data(), Samples); }));
+
+	for(std::size_t i = 0; i < Samples; ++i)
+		Error += glm::all(glm::equal(Loop[i], Batch[i], 0.001f)) ? 0 : 1;
+
+#	if GLM_HAS_RUNTIME_ISA && !defined(GLM_FORCE_QUAT_DATA_WXYZ)
+		each_level([&](glm_dispatch_table const& Table) { Table.quat_to_mat4_batch(&In[0][0], &Batch[0][0][0], Samples); });
+#	endif
+
+	return Error;
+}
+
+int main()
+{
+	std::size_t const Samples = 100000;
+
+	int Error = 0;
+
+	std::printf("mat4 * mat4[]:\n");
+	Error += comp_mat4_mul_batch(Samples);
+
+	std::printf("mat4 * vec4[]:\n");
+	Error += comp_mat4_mul_vec4_batch(Samples);
+
+	std::printf("mat4 * vec4[] (SoA):\n");
+	Error += comp_mat4_mul_vec4_soa(Samples);
+
+	std::printf("inverse(mat4[]):\n");
+	Error += comp_mat4_inverse(Samples);
+
+	std::printf("transpose(inverse(mat3(mat4[]))):\n");
+	Error += comp_mat4_inverse_transpose(Samples);
+
+	std::printf("mat4_cast(quat[]):\n");
+	Error += comp_mat4_cast(Samples);
+
+	return Error;
+}
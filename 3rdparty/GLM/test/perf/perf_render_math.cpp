@@ -0,0 +1,270 @@
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_relational.hpp>
+#include <glm/ext/quaternion_float.hpp>
+#include <glm/ext/quaternion_common.hpp>
+#include <glm/ext/quaternion_trigonometric.hpp>
+#include <glm/ext/vector_relational.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+#include <glm/geometric.hpp>
+#include <glm/simd/cpu.h>
+#if GLM_CONFIG_SIMD == GLM_ENABLE
+#	include <glm/gtc/type_aligned.hpp>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// The GLM calls of a render loop over arrays of Items elements. Built once per
+// instruction set (see CMakeLists.txt), GLM_ARCH being fixed at compile time.
+// Each case is timed Samples times; the median and the median absolute
+// deviation are reported, neither moves much with a few preempted samples.
+//
+// perf_render_math [--samples N] [--json FILE]
+
+static std::size_t const Items = 1024;
+
+static char const* build_name()
+{
+#	if GLM_ARCH & GLM_ARCH_AVX2_BIT
+		return "avx2";
+#	elif GLM_ARCH & GLM_ARCH_AVX_BIT
+		return "avx";
+#	elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+		return "sse2";
+#	else
+		return "scalar";
+#	endif
+}
+
+struct result
+{
+	char const* Name;
+	double Median; // ns per item
+	double Deviation; // median absolute deviation, ns per item
+	double Min;
+	double Max;
+};
+
+static double median(std::vector<double>& Values)
+{
+	std::sort(Values.begin(), Values.end());
+	std::size_t const Half = Values.size() / 2;
+	return Values.size() % 2 ? Values[Half] : (Values[Half - 1] + Values[Half]) * 0.5;
+}
+
+template <typename functionType>
+static result bench(char const* Name, std::size_t Samples, functionType Function)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	// Repeat until a sample lasts 200 us, far above the clock resolution.
+	// This also warms the caches and the branch predictors.
+	std::size_t Repeat = 1;
+	for(;;)
+	{
+		clock::time_point const t1 = clock::now();
+		for(std::size_t r = 0; r < Repeat; ++r)
+			Function();
+		clock::time_point const t2 = clock::now();
+
+		if(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() >= 200 || Repeat >= (1u << 20))
+			break;
+		Repeat *= 2;
+	}
+
+	std::vector<double> Times(Samples);
+	for(std::size_t s = 0; s < Samples; ++s)
+	{
+		clock::time_point const t1 = clock::now();
+		for(std::size_t r = 0; r < Repeat; ++r)
+			Function();
+		clock::time_point const t2 = clock::now();
+
+		Times[s] = std::chrono::duration<double, std::nano>(t2 - t1).count() / static_cast<double>(Repeat * Items);
+	}
+
+	result Result;
+	Result.Name = Name;
+	Result.Median = median(Times);
+	Result.Min = Times.front();
+	Result.Max = Times.back();
+
+	for(std::size_t s = 0; s < Samples; ++s)
+		Times[s] = Times[s] > Result.Median ? Times[s] - Result.Median : Result.Median - Times[s];
+	Result.Deviation = median(Times);
+
+	return Result;
+}
+
+static void print_json(std::FILE* File, std::size_t Samples, std::vector<result> const& Results)
+{
+	std::fprintf(File, "{\n\t\"build\": \"%s\",\n\t\"items\": %u,\n\t\"samples\": %u,\n\t\"unit\": \"ns/item\",\n\t\"results\": [\n",
+		build_name(), static_cast<unsigned>(Items), static_cast<unsigned>(Samples));
+	for(std::size_t i = 0; i < Results.size(); ++i)
+	{
+		result const& R = Results[i];
+		std::fprintf(File, "\t\t{\"name\": \"%s\", \"median\": %.4f, \"mad\": %.4f, \"min\": %.4f, \"max\": %.4f}%s\n",
+			R.Name, R.Median, R.Deviation, R.Min, R.Max, i + 1 < Results.size() ? "," : "");
+	}
+	std::fprintf(File, "\t]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t Samples = 9;
+	char const* JsonPath = GLM_NULLPTR;
+	for(int a = 1; a < argc; ++a)
+	{
+		if(std::strcmp(argv[a], "--samples") == 0 && a + 1 < argc)
+			Samples = static_cast<std::size_t>(std::max(1, std::atoi(argv[++a])));
+		else if(std::strcmp(argv[a], "--json") == 0 && a + 1 < argc)
+			JsonPath = argv[++a];
+	}
+
+#	if (GLM_ARCH & GLM_ARCH_AVX_BIT) && GLM_HAS_RUNTIME_ISA
+		// Built for more than this CPU runs, nothing to measure
+		if(!(glm_cpu_features() & ((GLM_ARCH & GLM_ARCH_AVX2_BIT) ? GLM_CPU_AVX2_BIT : GLM_CPU_AVX_BIT)))
+		{
+			std::printf("%s: not supported by this CPU, skipped\n", build_name());
+			return 0;
+		}
+#	endif
+
+	int Error = 0;
+
+	std::vector<glm::mat4> Models(Items), Matrices(Items);
+	std::vector<glm::vec3> Offsets(Items), Axes(Items);
+	std::vector<glm::vec4> Vectors(Items), Vectors4(Items);
+	std::vector<float> Angles(Items);
+	std::vector<glm::quat> From(Items), To(Items), Quats(Items);
+	std::vector<glm::uint64> Halves(Items);
+	std::vector<glm::uint32> Packed(Items);
+
+	for(std::size_t i = 0; i < Items; ++i)
+	{
+		float const f = static_cast<float>(i);
+		Models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(f, 1.0f, -2.0f));
+		Offsets[i] = glm::vec3(0.5f, f * 0.01f, -1.0f);
+		Axes[i] = glm::normalize(glm::vec3(1.0f, f, 0.5f));
+		Angles[i] = f * 0.001f;
+		Vectors[i] = glm::vec4(std::fmod(f * 0.37f, 1.0f) * 2.0f - 1.0f, 0.25f, -0.5f, 1.0f);
+		From[i] = glm::angleAxis(Angles[i], Axes[i]);
+		To[i] = glm::angleAxis(1.0f - Angles[i], glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	std::vector<result> Results;
+
+	Results.push_back(bench("translate", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Matrices[i] = glm::translate(Models[i], Offsets[i]);
+	}));
+	Results.push_back(bench("rotate", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Matrices[i] = glm::rotate(Models[i], Angles[i], Axes[i]);
+	}));
+	// rotate about a unit axis is the matrix of angleAxis
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::all(glm::equal(Matrices[i], Models[i] * glm::mat4_cast(glm::angleAxis(Angles[i], Axes[i])), 0.001f)) ? 0 : 1;
+
+	Results.push_back(bench("scale", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Matrices[i] = glm::scale(Models[i], Offsets[i]);
+	}));
+	Results.push_back(bench("perspective", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Matrices[i] = glm::perspective(0.5f + Angles[i], 16.0f / 9.0f, 0.1f, 100.0f);
+	}));
+	Results.push_back(bench("slerp", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Quats[i] = glm::slerp(From[i], To[i], 0.3f);
+	}));
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::abs(glm::length(Quats[i]) - 1.0f) < 0.001f ? 0 : 1;
+
+	Results.push_back(bench("mat4_cast", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Matrices[i] = glm::mat4_cast(Quats[i]);
+	}));
+	Results.push_back(bench("normalize_vec3", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Offsets[i] = glm::normalize(Offsets[i] + Axes[i]);
+	}));
+	Results.push_back(bench("normalize_vec4", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Vectors4[i] = glm::normalize(Vectors[i]);
+	}));
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::abs(glm::length(Vectors4[i]) - 1.0f) < 0.001f ? 0 : 1;
+
+#	if GLM_CONFIG_SIMD == GLM_ENABLE
+	{
+		// The SIMD specialisations of GLM only take aligned types
+		std::vector<glm::aligned_vec4> Aligned(Vectors.begin(), Vectors.end()), AlignedOut(Items);
+		Results.push_back(bench("normalize_aligned_vec4", Samples, [&]() {
+			for(std::size_t i = 0; i < Items; ++i)
+				AlignedOut[i] = glm::normalize(Aligned[i]);
+		}));
+		for(std::size_t i = 0; i < Items; ++i)
+			Error += glm::all(glm::equal(glm::vec4(AlignedOut[i]), Vectors4[i], 0.001f)) ? 0 : 1;
+	}
+#	endif
+
+	Results.push_back(bench("packHalf4x16", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Halves[i] = glm::packHalf4x16(Vectors[i]);
+	}));
+	Results.push_back(bench("unpackHalf4x16", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Vectors4[i] = glm::unpackHalf4x16(Halves[i]);
+	}));
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::all(glm::equal(Vectors4[i], Vectors[i], 0.001f)) ? 0 : 1;
+
+	Results.push_back(bench("packUnorm4x8", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Packed[i] = glm::packUnorm4x8(Vectors[i] * 0.5f + 0.5f);
+	}));
+	Results.push_back(bench("unpackUnorm4x8", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Vectors4[i] = glm::unpackUnorm4x8(Packed[i]);
+	}));
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::all(glm::equal(Vectors4[i], Vectors[i] * 0.5f + 0.5f, 1.0f / 255.0f)) ? 0 : 1;
+
+	Results.push_back(bench("packSnorm3x10_1x2", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Packed[i] = glm::packSnorm3x10_1x2(Vectors[i]);
+	}));
+	Results.push_back(bench("unpackSnorm3x10_1x2", Samples, [&]() {
+		for(std::size_t i = 0; i < Items; ++i)
+			Vectors4[i] = glm::unpackSnorm3x10_1x2(Packed[i]);
+	}));
+	for(std::size_t i = 0; i < Items; ++i)
+		Error += glm::all(glm::equal(glm::vec3(Vectors4[i]), glm::vec3(Vectors[i]), 1.0f / 511.0f)) ? 0 : 1;
+
+	std::printf("%s, %u samples of %u items:\n", build_name(), static_cast<unsigned>(Samples), static_cast<unsigned>(Items));
+	for(std::size_t i = 0; i < Results.size(); ++i)
+		std::printf("- %s: %.2f ns (mad %.2f)\n", Results[i].Name, Results[i].Median, Results[i].Deviation);
+
+	if(JsonPath)
+	{
+		std::FILE* File = std::fopen(JsonPath, "w");
+		if(File)
+		{
+			print_json(File, Samples, Results);
+			std::fclose(File);
+		}
+		else
+			++Error;
+	}
+
+	return Error;
+}
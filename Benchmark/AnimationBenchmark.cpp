@@ -0,0 +1,255 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+#include "AnimationClip.h"
+#include "AnimationSet.h"
+#include "Benchmarks.h"
+#include "Skeleton.h"
+#include "Skinning.h"
+#include "ThreadPool.h"
+
+// Characters per millisecond through AnimationSet::Update (sample two
+// compressed clips, blend, skin matrices) on one thread and on the pool, with
+// and without the dual quaternions, then CPU skinning of a 10k vertex mesh.
+// Best of a few frames each.
+
+namespace {
+
+const int frameCount = 10;
+const size_t jointCount = 64;
+const size_t keyCount = 61;
+const float sampleRate = 30.0f;
+
+// Binary tree of joints, every joint one unit from its parent
+void
+BuildSkeleton(Skeleton& skeleton)
+{
+    for (size_t i = 0; i < jointCount; ++i) {
+        JointPose bindPose;
+        if (i > 0)
+            bindPose.translation = glm::vec3(i % 2 ? 0.5f : -0.5f, 1.0f, 0.0f);
+        skeleton.AddJoint(i == 0 ? Skeleton::noParent : static_cast<int>((i - 1) / 2), bindPose);
+    }
+}
+
+// Every joint swings about its own axis, the root also moves
+void
+BuildClip(const Skeleton& skeleton,
+          std::mt19937& random,
+          std::vector<JointPose>& frames,
+          AnimationClip& clip)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<glm::vec3> axes(jointCount);
+    std::vector<float> phases(jointCount), amplitudes(jointCount);
+    for (size_t i = 0; i < jointCount; ++i) {
+        axes[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+        phases[i] = 3.0f * unit(random);
+        amplitudes[i] = 0.5f + 0.4f * unit(random);
+    }
+
+    frames.resize(keyCount * jointCount);
+    for (size_t key = 0; key < keyCount; ++key) {
+        const float phase = 2.0f * 3.14159265f * key / (keyCount - 1);
+
+        for (size_t i = 0; i < jointCount; ++i) {
+            JointPose& pose = frames[key * jointCount + i];
+            pose = skeleton.GetBindPose()[i];
+            pose.rotation = glm::angleAxis(amplitudes[i] * std::sin(phase + phases[i]), axes[i]);
+        }
+
+        frames[key * jointCount].translation = glm::vec3(std::sin(phase),
+                                                         0.1f * std::cos(2.0f * phase),
+                                                         0.0f);
+    }
+
+    clip.Build(frames.data(), keyCount, jointCount, sampleRate);
+}
+
+// Largest rotation (radians) and translation error of the compressed clip at the keys
+void
+MeasureClipError(const AnimationClip& clip, const std::vector<JointPose>& frames)
+{
+    std::vector<JointPose> pose(jointCount);
+    float rotationError = 0.0f, translationError = 0.0f;
+
+    for (size_t key = 0; key < keyCount; ++key) {
+        clip.Sample(key / sampleRate, false, pose.data());
+
+        for (size_t i = 0; i < jointCount; ++i) {
+            const JointPose& expected = frames[key * jointCount + i];
+            // Angle of the rotation between the two, asin stays precise near 0
+            const glm::quat difference = glm::inverse(expected.rotation) * pose[i].rotation;
+            const glm::vec3 axis(difference.x, difference.y, difference.z);
+            const float sine = std::min(glm::length(axis), 1.0f);
+
+            rotationError = std::max(rotationError, 2.0f * std::asin(sine));
+            translationError = std::max(translationError,
+                                        glm::length(expected.translation - pose[i].translation));
+        }
+    }
+
+    printf("clip: %zu joints, %zu keys, %zu bytes raw, %zu compressed, error %.1e rad %.1e units\n",
+           jointCount,
+           keyCount,
+           frames.size() * sizeof(JointPose),
+           clip.GetCompressedSize(),
+           rotationError,
+           translationError);
+}
+
+double
+TimeUpdate(AnimationSet& animations, ThreadPool* pool)
+{
+    double best = 1e30;
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const double start = BenchmarkClock();
+        animations.Update(1.0f / 60.0f, pool);
+        best = std::min(best, BenchmarkClock() - start);
+    }
+
+    return best;
+}
+
+void
+RunSize(size_t characterCount,
+        const Skeleton& skeleton,
+        const AnimationClip& walk,
+        const AnimationClip& run,
+        ThreadPool& pool,
+        std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    AnimationSet animations(skeleton);
+    animations.Resize(characterCount);
+
+    for (size_t i = 0; i < characterCount; ++i) {
+        animations.SetClips(i, &walk, &run, unit(random));
+        animations.SetTime(i, 2.0f * unit(random));
+        animations.SetSpeed(i, 0.8f + 0.4f * unit(random));
+    }
+
+    const double singleTime = TimeUpdate(animations, nullptr);
+    const double poolTime = TimeUpdate(animations, &pool);
+
+    animations.SetSkinningMode(AnimationSet::SkinningMode::DualQuaternion);
+    const double dualQuaternionTime = TimeUpdate(animations, &pool);
+
+    printf("%10zu %9.2f %12.1f %9.2f %12.1f %11.1f\n",
+           characterCount,
+           singleTime * 1e3,
+           characterCount / (singleTime * 1e3),
+           poolTime * 1e3,
+           characterCount / (poolTime * 1e3),
+           characterCount / (dualQuaternionTime * 1e3));
+}
+
+void
+RunSkinning(const Skeleton& skeleton,
+            const AnimationClip& walk,
+            ThreadPool& pool,
+            std::mt19937& random)
+{
+    std::uniform_int_distribution<int> joint(0, jointCount - 1);
+    std::uniform_int_distribution<int> weight(0, 255);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    const size_t vertexCount = 10000;
+    std::vector<SkinnedVertex> vertices(vertexCount);
+
+    for (SkinnedVertex& vertex : vertices) {
+        const glm::vec3 normal = glm::normalize(
+            glm::vec3(unit(random), unit(random), unit(random)));
+        const int weight0 = weight(random);
+        const int weight1 = (255 - weight0) * weight(random) / 255;
+
+        for (int i = 0; i < 3; ++i) {
+            vertex.position[i] = unit(random);
+            vertex.normal[i] = normal[i];
+        }
+
+        for (int i = 0; i < 4; ++i)
+            vertex.joints[i] = static_cast<uint8_t>(joint(random));
+
+        vertex.weights[0] = static_cast<uint8_t>(weight0);
+        vertex.weights[1] = static_cast<uint8_t>(weight1);
+        vertex.weights[2] = static_cast<uint8_t>(255 - weight0 - weight1);
+        vertex.weights[3] = 0;
+    }
+
+    AnimationSet animations(skeleton);
+    animations.Resize(1);
+    animations.SetClips(0, &walk, nullptr, 0.0f);
+    animations.Update(0.5f);
+
+    std::vector<glm::vec4> positions(vertexCount), normals(vertexCount);
+    double singleTime = 1e30, poolTime = 1e30;
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        double start = BenchmarkClock();
+        Skinning::SkinVertices(vertices.data(),
+                               vertexCount,
+                               animations.GetSkinMatrices(),
+                               positions.data(),
+                               normals.data());
+        singleTime = std::min(singleTime, BenchmarkClock() - start);
+
+        start = BenchmarkClock();
+        Skinning::SkinVertices(vertices.data(),
+                               vertexCount,
+                               animations.GetSkinMatrices(),
+                               positions.data(),
+                               normals.data(),
+                               &pool);
+        poolTime = std::min(poolTime, BenchmarkClock() - start);
+    }
+
+    printf("CPU skinning: %zu vertices, %.1f us (%.0f vertices/ms), %.1f us on %u threads\n",
+           vertexCount,
+           singleTime * 1e6,
+           vertexCount / (singleTime * 1e3),
+           poolTime * 1e6,
+           pool.GetThreadCount());
+}
+
+} // namespace
+
+int
+RunAnimationBenchmark(int argc, char** argv)
+{
+    const size_t maxCharacters = argc > 0 ? strtoull(argv[0], nullptr, 10) : 10000;
+
+    std::mt19937 random(1);
+    ThreadPool pool;
+
+    Skeleton skeleton;
+    BuildSkeleton(skeleton);
+
+    std::vector<JointPose> walkFrames, runFrames;
+    AnimationClip walk, run;
+    BuildClip(skeleton, random, walkFrames, walk);
+    BuildClip(skeleton, random, runFrames, run);
+
+    MeasureClipError(walk, walkFrames);
+
+    printf("characters  1 thr ms  chars/ms 1thr  %u thr ms  chars/ms %uthr  DQ chars/ms\n",
+           pool.GetThreadCount(),
+           pool.GetThreadCount());
+
+    for (size_t characterCount = 10; characterCount <= maxCharacters; characterCount *= 10)
+        RunSize(characterCount, skeleton, walk, run, pool, random);
+
+    RunSkinning(skeleton, walk, pool, random);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <chrono>
+
+struct GLFWwindow;
+
+// Each benchmark takes the arguments after its name and returns the exit code
+
+int
+RunAnimationBenchmark(int argc, char** argv);
+int
+RunBvhBenchmark(int argc, char** argv);
+int
+RunCaptureBenchmark(int argc, char** argv);
+int
+RunMaterialBenchmark(int argc, char** argv);
+int
+RunPickBenchmark(int argc, char** argv);
+int
+RunResolutionBenchmark(int argc, char** argv);
+int
+RunTextureBenchmark(int argc, char** argv);
+int
+RunTextureFileBenchmark(int argc, char** argv);
+int
+RunTraceBenchmark(int argc, char** argv);
+int
+RunTransformBenchmark(int argc, char** argv);
+int
+RunVideoBenchmark(int argc, char** argv);
+int
+RunYuvBenchmark(int argc, char** argv);
+
+// Seconds since some fixed point
+inline double
+BenchmarkClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// A hidden 1280x720 window with a current GL 3.3 context, no vsync and GLEW
+// initialised, or nullptr after printing why
+GLFWwindow*
+CreateBenchmarkWindow(const char* title);
+void
+DestroyBenchmarkWindow(GLFWwindow* window);
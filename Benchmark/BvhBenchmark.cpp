@@ -0,0 +1,198 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "Benchmarks.h"
+#include "SceneBvh.h"
+
+// SceneBvh queries against a linear scan over the same boxes, at growing object
+// counts. Objects keep the same density, so a query touches about as many
+// objects at every size and only the search itself grows.
+
+namespace {
+
+const float worldSize = 1000.0f;
+const unsigned int queryCount = 256;
+
+struct Query
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::mat4 viewProjection;
+};
+
+bool
+RayHitsBox(const glm::vec3& origin,
+           const glm::vec3& inverseDirection,
+           const SceneBvh::Aabb& box,
+           float maxDistance,
+           float& distance)
+{
+    const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    const glm::vec3 tMin = glm::min(t0, t1);
+    const glm::vec3 tMax = glm::max(t0, t1);
+
+    distance = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    return distance <= std::min(std::min(tMax.x, tMax.y), tMax.z) && distance <= maxDistance;
+}
+
+bool
+BoxInFrustum(const glm::vec4* planes, const SceneBvh::Aabb& box)
+{
+    for (unsigned int p = 0; p < 6; ++p) {
+        const glm::vec3 corner(planes[p].x >= 0.0f ? box.max.x : box.min.x,
+                               planes[p].y >= 0.0f ? box.max.y : box.min.y,
+                               planes[p].z >= 0.0f ? box.max.z : box.min.z);
+
+        if (glm::dot(glm::vec3(planes[p]), corner) + planes[p].w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+void
+RunSize(size_t objectCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // About 10% of the volume filled at every count
+    const float halfSize = 0.5f * 0.46f * worldSize / std::cbrt(static_cast<float>(objectCount));
+
+    std::vector<SceneBvh::Aabb> bounds(objectCount);
+    for (SceneBvh::Aabb& box : bounds) {
+        const glm::vec3 center(unit(random), unit(random), unit(random));
+        const glm::vec3 extent(unit(random), unit(random), unit(random));
+        box.min = center * worldSize - halfSize * (0.5f + extent);
+        box.max = center * worldSize + halfSize * (0.5f + extent);
+    }
+
+    std::vector<Query> queries(queryCount);
+    const float viewDistance = 20.0f * halfSize;
+
+    for (Query& query : queries) {
+        query.origin = glm::vec3(unit(random), unit(random), unit(random)) * worldSize;
+        query.direction = glm::normalize(
+            glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f);
+        query.viewProjection = glm::perspective(glm::radians(20.0f), 1.0f, 0.1f, viewDistance)
+                               * glm::lookAt(query.origin,
+                                             query.origin + query.direction,
+                                             std::abs(query.direction.y) > 0.9f
+                                                 ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                                 : glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    SceneBvh bvh;
+
+    double start = BenchmarkClock();
+    bvh.Build(bounds);
+    const double buildTime = BenchmarkClock() - start;
+
+    // Every object moves a little
+    for (SceneBvh::Aabb& box : bounds) {
+        box.min += 0.1f * halfSize;
+        box.max += 0.1f * halfSize;
+    }
+
+    start = BenchmarkClock();
+    bvh.Refit(bounds);
+    const double refitTime = BenchmarkClock() - start;
+
+    // Ray picking
+    unsigned int mismatches = 0;
+    std::vector<uint32_t> bvhHits(queryCount);
+
+    start = BenchmarkClock();
+    for (unsigned int q = 0; q < queryCount; ++q)
+        bvhHits[q] = bvh.Raycast(queries[q].origin, queries[q].direction, worldSize * 2.0f);
+    const double bvhRayTime = (BenchmarkClock() - start) / queryCount;
+
+    start = BenchmarkClock();
+    for (unsigned int q = 0; q < queryCount; ++q) {
+        const glm::vec3 inverseDirection = 1.0f / queries[q].direction;
+        float closest = worldSize * 2.0f;
+        uint32_t hit = SceneBvh::invalidObject;
+
+        for (size_t i = 0; i < objectCount; ++i) {
+            float distance;
+            if (RayHitsBox(queries[q].origin, inverseDirection, bounds[i], closest, distance)) {
+                closest = distance;
+                hit = static_cast<uint32_t>(i);
+            }
+        }
+
+        // Ties between overlapping boxes may pick either
+        if (hit != bvhHits[q]
+            && (hit == SceneBvh::invalidObject || bvhHits[q] == SceneBvh::invalidObject)) {
+            ++mismatches;
+        }
+    }
+    const double linearRayTime = (BenchmarkClock() - start) / queryCount;
+
+    // Frustum culling
+    std::vector<uint32_t> visible;
+    size_t bvhVisible = 0;
+
+    start = BenchmarkClock();
+    for (const Query& query : queries) {
+        visible.clear();
+        bvh.QueryFrustum(query.viewProjection, visible);
+        bvhVisible += visible.size();
+    }
+    const double bvhFrustumTime = (BenchmarkClock() - start) / queryCount;
+
+    size_t linearVisible = 0;
+
+    start = BenchmarkClock();
+    for (const Query& query : queries) {
+        const glm::mat4 rows = glm::transpose(query.viewProjection);
+        const glm::vec4 planes[6] = {rows[3] + rows[0],
+                                     rows[3] - rows[0],
+                                     rows[3] + rows[1],
+                                     rows[3] - rows[1],
+                                     rows[3] + rows[2],
+                                     rows[3] - rows[2]};
+
+        for (const SceneBvh::Aabb& box : bounds)
+            linearVisible += BoxInFrustum(planes, box);
+    }
+    const double linearFrustumTime = (BenchmarkClock() - start) / queryCount;
+
+    if (linearVisible != bvhVisible)
+        ++mismatches;
+
+    printf("%9zu %9.1f %9.2f %10.2f %12.2f %10.2f %12.2f %8.1f %s\n",
+           objectCount,
+           buildTime * 1e3,
+           refitTime * 1e3,
+           bvhRayTime * 1e6,
+           linearRayTime * 1e6,
+           bvhFrustumTime * 1e6,
+           linearFrustumTime * 1e6,
+           static_cast<double>(bvhVisible) / queryCount,
+           mismatches ? "MISMATCH" : "");
+}
+
+} // namespace
+
+int
+RunBvhBenchmark(int argc, char** argv)
+{
+    const size_t maxObjects = argc > 0 ? strtoull(argv[0], nullptr, 10) : 1000000;
+
+    std::mt19937 random(1);
+
+    printf("  objects  build ms  refit ms  ray bvh us  ray linear us  frustum us  frustum lin us"
+           "  visible\n");
+
+    for (size_t objectCount = 1000; objectCount <= maxObjects; objectCount *= 10)
+        RunSize(objectCount, random);
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Benchmarks.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "VideoFrame.h"
+#include "YuvConverter.h"
+
+// Frame readback in a hidden window without vsync: a scene of coloured blocks
+// into a width by height Framebuffer, blitted to the window and swapped, with
+// the frame read back by a plain glReadPixels after the swap, then by
+// FrameCapture in RGBA and NV12. Prints the GL thread time per frame of
+// each, the frames dropped and delivered and how many frames late they
+// arrived. Afterwards one frame is captured in both formats and the NV12
+// capture, decoded by YuvConverter, compared with the RGBA one, which is
+// compared with glReadPixels byte for byte.
+
+namespace {
+
+const GLsizei windowWidth = 1280;
+const GLsizei windowHeight = 720;
+const int blockCount = 16;
+const int warmupFrames = 10;
+
+// Blocks on even coordinates counted from the top left, so each 2x2 chroma
+// block of the capture has one colour
+void
+DrawScene(Framebuffer& target, int frame)
+{
+    const GLsizei width = target.GetWidth(), height = target.GetHeight();
+
+    target.Bind();
+    glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_SCISSOR_TEST);
+
+    for (int block = 0; block < blockCount; ++block) {
+        const int seed = block * 7919 + frame * 13;
+        const GLint x = (seed * 31 % std::max(width - 64, 2)) & ~1;
+        const GLint y = ((seed * 17 % std::max(height - 64, 2)) & ~1) + (height & 1);
+
+        glScissor(x, y, 64, 48);
+        glClearColor((block % 4) / 3.0f, (block / 4) / 3.0f, (seed % 256) / 255.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void
+Present(GLFWwindow* window, Framebuffer& target)
+{
+    target.Resolve();
+    Framebuffer::BindDefault(windowWidth, windowHeight);
+    target.BlitToDefault(0, 0, windowWidth, windowHeight);
+    glfwSwapBuffers(window);
+}
+
+// Seconds per frame of the GL thread reading back with glReadPixels
+double
+RunSynchronous(GLFWwindow* window, Framebuffer& target, int frameCount, double& readSeconds)
+{
+    const GLsizei width = target.GetWidth(), height = target.GetHeight();
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+    readSeconds = 0.0;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    double start = 0.0;
+
+    for (int frame = -warmupFrames; frame < frameCount; ++frame) {
+        if (frame == 0) {
+            glFinish();
+            start = BenchmarkClock();
+            readSeconds = 0.0;
+        }
+
+        DrawScene(target, frame);
+        Present(window, target);
+
+        const double readStart = BenchmarkClock();
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.GetID());
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        readSeconds += BenchmarkClock() - readStart;
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    readSeconds /= frameCount;
+    return (BenchmarkClock() - start) / frameCount;
+}
+
+// Seconds per frame with FrameCapture, capturing before the swap like the app
+double
+RunAsynchronous(GLFWwindow* window,
+                Framebuffer& target,
+                FrameCapture::Format format,
+                int frameCount,
+                FrameCapture& capture)
+{
+    const GLsizei width = target.GetWidth(), height = target.GetHeight();
+    std::atomic<unsigned long long> captured {0};
+    unsigned long long delivered = 0, lateFrames = 0, maxLate = 0;
+
+    // Frames are numbered from 0 in capture order, so the number of captures
+    // since is how late each one arrives
+    capture.CreateCapture(width,
+                          height,
+                          format,
+                          [&](const FrameCapture::CapturedFrame& frame) {
+                              const unsigned long long late = captured.load() - frame.frame;
+                              ++delivered;
+                              lateFrames += late;
+                              maxLate = std::max(maxLate, late);
+                          });
+
+    double start = 0.0;
+    FrameCapture::Stats before;
+
+    for (int frame = -warmupFrames; frame < frameCount; ++frame) {
+        if (frame == 0) {
+            glFinish();
+            start = BenchmarkClock();
+            before = capture.GetStats();
+        }
+
+        DrawScene(target, frame);
+        target.Resolve();
+
+        if (capture.Capture(target.GetID(), width, height))
+            ++captured;
+
+        Framebuffer::BindDefault(windowWidth, windowHeight);
+        target.BlitToDefault(0, 0, windowWidth, windowHeight);
+        glfwSwapBuffers(window);
+    }
+
+    const double seconds = (BenchmarkClock() - start) / frameCount;
+
+    capture.Finish();
+
+    const FrameCapture::Stats stats = capture.GetStats();
+    printf("  %llu captured, %llu dropped, %llu delivered, %.2f frames late on average "
+           "(%llu at most), %.3f ms in Capture\n",
+           stats.capturedFrames - before.capturedFrames,
+           stats.droppedFrames - before.droppedFrames,
+           delivered,
+           delivered > 0 ? static_cast<double>(lateFrames) / delivered : 0.0,
+           maxLate,
+           (stats.captureSeconds - before.captureSeconds) * 1000.0 / frameCount);
+
+    return seconds;
+}
+
+// Captures of one frame in format, copied out of the consumer
+std::vector<uint8_t>
+CaptureOne(Framebuffer& target, FrameCapture& capture, FrameCapture::Format format)
+{
+    const GLsizei width = target.GetWidth(), height = target.GetHeight();
+    std::vector<uint8_t> data;
+
+    capture.CreateCapture(width, height, format, [&](const FrameCapture::CapturedFrame& frame) {
+        const size_t firstSize = frame.strides[0] * frame.height;
+        const size_t secondSize =
+            frame.format == FrameCapture::Format::NV12
+                ? frame.strides[1] * VideoFrame::GetPlaneHeight(VideoFormat::NV12, frame.height, 1)
+                : 0;
+
+        data.assign(frame.planes[0], frame.planes[0] + firstSize);
+        if (secondSize > 0)
+            data.insert(data.end(), frame.planes[1], frame.planes[1] + secondSize);
+    });
+
+    capture.Capture(target.GetID(), width, height);
+    capture.Finish();
+
+    return data;
+}
+
+// Checks the RGBA capture against glReadPixels and the NV12 one against both
+void
+Verify(Framebuffer& target, FrameCapture& capture)
+{
+    const GLsizei width = target.GetWidth(), height = target.GetHeight();
+    const size_t rowSize = static_cast<size_t>(width) * 4;
+
+    DrawScene(target, 0);
+    target.Resolve();
+
+    // glReadPixels rows are bottom up
+    std::vector<uint8_t> expected(rowSize * height), flipped(rowSize * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.GetID());
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, flipped.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    for (GLsizei y = 0; y < height; ++y)
+        memcpy(&expected[y * rowSize], &flipped[(height - 1 - y) * rowSize], rowSize);
+
+    const std::vector<uint8_t> rgba = CaptureOne(target, capture, FrameCapture::Format::RGBA);
+    const std::vector<uint8_t> nv12 = CaptureOne(target, capture, FrameCapture::Format::NV12);
+
+    if (rgba.size() != expected.size()
+        || nv12.size() != VideoFrame::GetFrameSize(VideoFormat::NV12, width, height)) {
+        printf("Verification capture missing\n");
+        return;
+    }
+
+    size_t rgbaMismatches = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+        rgbaMismatches += rgba[i] != expected[i];
+
+    VideoFrame frame;
+    frame.format = VideoFormat::NV12;
+    frame.width = width;
+    frame.height = height;
+    frame.planes[0] = nv12.data();
+    frame.strides[0] = static_cast<size_t>(width);
+    frame.planes[1] = nv12.data() + static_cast<size_t>(width) * height;
+    frame.strides[1] = static_cast<size_t>(VideoFrame::GetPlaneWidth(VideoFormat::NV12, width, 1))
+                       * 2;
+
+    std::vector<uint8_t> decoded(rowSize * height);
+    YuvConverter::Convert(frame, ColorMatrix::BT709, ColorRange::Limited, decoded.data(), rowSize);
+
+    int maxError = 0;
+    double totalError = 0.0;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        if (i % 4 == 3)
+            continue;
+
+        const int error = abs(decoded[i] - expected[i]);
+        maxError = std::max(maxError, error);
+        totalError += error;
+    }
+
+    printf("RGBA capture: %zu of %zu bytes differ from glReadPixels\n",
+           rgbaMismatches,
+           expected.size());
+    printf("NV12 capture decoded: max error %d, mean %.3f\n",
+           maxError,
+           totalError / (static_cast<double>(width) * height * 3));
+}
+
+} // namespace
+
+int
+RunCaptureBenchmark(int argc, char** argv)
+{
+    const int width = argc > 0 ? atoi(argv[0]) : windowWidth;
+    const int height = argc > 1 ? atoi(argv[1]) : windowHeight;
+    const int frameCount = argc > 2 ? atoi(argv[2]) : 300;
+
+    if (width <= 0 || height <= 0 || frameCount <= 0)
+        return 1;
+
+    GLFWwindow* window = CreateBenchmarkWindow("Capture benchmark");
+
+    if (!window)
+        return 1;
+
+    {
+        Framebuffer target;
+        if (!target.CreateFramebuffer(width, height)) {
+            DestroyBenchmarkWindow(window);
+            return 1;
+        }
+
+        FrameCapture capture;
+        capture.CreateFromFiles("../OpenGLCourseApp/Shaders/video.vert",
+                                "../OpenGLCourseApp/Shaders/capture_nv12.frag");
+
+        printf("%dx%d, %d frames, %s\n", width, height, frameCount, glGetString(GL_RENDERER));
+
+        double readSeconds = 0.0;
+        const double synchronous = RunSynchronous(window, target, frameCount, readSeconds);
+        printf("glReadPixels: %.3f ms per frame, %.3f ms of it reading\n",
+               synchronous * 1000.0,
+               readSeconds * 1000.0);
+
+        printf("FrameCapture RGBA:\n");
+        const double rgba = RunAsynchronous(window,
+                                            target,
+                                            FrameCapture::Format::RGBA,
+                                            frameCount,
+                                            capture);
+        printf("  %.3f ms per frame\n", rgba * 1000.0);
+
+        printf("FrameCapture NV12:\n");
+        const double nv12 = RunAsynchronous(window,
+                                            target,
+                                            FrameCapture::Format::NV12,
+                                            frameCount,
+                                            capture);
+        printf("  %.3f ms per frame\n", nv12 * 1000.0);
+
+        Verify(target, capture);
+    }
+
+    DestroyBenchmarkWindow(window);
+
+    return 0;
+}
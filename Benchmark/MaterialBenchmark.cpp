@@ -0,0 +1,287 @@
+﻿#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Benchmarks.h"
+#include "GlStats.h"
+#include "MaterialBatch.h"
+
+// Objects with different meshes, textures and colours drawn through
+// MaterialBatch, once as one glMultiDrawElementsIndirect per frame and once
+// as a glDrawElementsBaseVertex per object, in a hidden window without vsync.
+// Reports the CPU time to record and submit a frame, the frame time after
+// glFinish and the GL calls per frame from GlStats, then checks that both
+// modes draw the same pixels.
+
+namespace {
+
+const int frameCount = 200;
+const int warmupFrames = 10;
+const GLsizei textureSize = 64;
+const GLsizei textureLayers = 16;
+const GLsizei targetSize = 512;
+
+// A unit cube and a unit quad, facing +Z
+void
+AddMeshes(MaterialBatch& batch, uint32_t meshes[2])
+{
+    std::vector<MaterialBatch::Vertex> vertices;
+    std::vector<GLuint> indices;
+
+    for (int face = 0; face < 6; ++face) {
+        const int axis = face / 2;
+        const GLfloat sign = face % 2 ? -1.0f : 1.0f;
+        const GLuint first = static_cast<GLuint>(vertices.size());
+
+        for (int corner = 0; corner < 4; ++corner) {
+            const GLfloat u = corner == 1 || corner == 2 ? 1.0f : 0.0f;
+            const GLfloat v = corner >= 2 ? 1.0f : 0.0f;
+            MaterialBatch::Vertex vertex {};
+
+            vertex.position[axis] = sign * 0.5f;
+            vertex.position[(axis + 1) % 3] = (u - 0.5f) * sign;
+            vertex.position[(axis + 2) % 3] = v - 0.5f;
+            vertex.texCoord[0] = u;
+            vertex.texCoord[1] = v;
+            vertex.normal[axis] = sign;
+            vertices.push_back(vertex);
+        }
+
+        const GLuint quad[6] {0, 1, 2, 0, 2, 3};
+        for (GLuint index : quad)
+            indices.push_back(first + index);
+    }
+
+    meshes[0] = batch.AddMesh(vertices.data(),
+                              static_cast<GLsizei>(vertices.size()),
+                              indices.data(),
+                              static_cast<GLsizei>(indices.size()));
+    // The +Z face alone
+    meshes[1] = batch.AddMesh(vertices.data(), 4, indices.data(), 6);
+}
+
+// A checker in a different colour per layer
+void
+FillTextures(Texture& textures)
+{
+    std::vector<uint8_t> pixels(textureSize * textureSize * 4);
+
+    for (GLsizei layer = 0; layer < textureLayers; ++layer) {
+        for (GLsizei y = 0; y < textureSize; ++y) {
+            for (GLsizei x = 0; x < textureSize; ++x) {
+                uint8_t* pixel = &pixels[(y * textureSize + x) * 4];
+                const bool dark = ((x / 8) ^ (y / 8)) & 1;
+
+                pixel[0] = static_cast<uint8_t>(layer * 37 + (dark ? 0 : 128));
+                pixel[1] = static_cast<uint8_t>(layer * 91 + (dark ? 64 : 192));
+                pixel[2] = static_cast<uint8_t>(layer * 53 + (dark ? 32 : 160));
+                pixel[3] = 255;
+            }
+        }
+
+        // Nearest filtering would do, but the array has a mip chain
+        for (GLint level = 0; level < textures.GetLevels(); ++level) {
+            textures.SetImage(level,
+                              layer,
+                              0,
+                              textures.GetLevelHeight(level),
+                              GL_RGBA,
+                              GL_UNSIGNED_BYTE,
+                              pixels.data());
+        }
+    }
+}
+
+// Objects on a square grid, spinning with the frame number
+void
+RecordFrame(MaterialBatch& batch,
+            const uint32_t meshes[2],
+            int objectCount,
+            int materialCount,
+            int frame)
+{
+    const int side = static_cast<int>(ceilf(sqrtf(static_cast<float>(objectCount))));
+    const float spacing = 2.0f / side;
+
+    batch.BeginFrame();
+
+    for (int i = 0; i < objectCount; ++i) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f),
+                                         glm::vec3(-1.0f + spacing * (i % side + 0.5f),
+                                                   -1.0f + spacing * (i / side + 0.5f),
+                                                   0.0f));
+        model = glm::rotate(model, 0.01f * (frame + i), glm::vec3(0.3f, 1.0f, 0.2f));
+        model = glm::scale(model, glm::vec3(spacing * 0.6f));
+
+        batch.AddDraw(meshes[i % 2], static_cast<uint32_t>(i % materialCount), model);
+    }
+}
+
+void
+RunMode(GLFWwindow* window,
+        MaterialBatch& batch,
+        const uint32_t meshes[2],
+        int objectCount,
+        int materialCount,
+        bool multiDraw)
+{
+    const glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -2.0f, 2.0f);
+
+    batch.SetMultiDraw(multiDraw);
+
+    for (int frame = 0; frame < warmupFrames; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        RecordFrame(batch, meshes, objectCount, materialCount, frame);
+        batch.Render(projection);
+        glfwSwapBuffers(window);
+    }
+
+    glFinish();
+    GlStats::EndFrame();
+
+    double cpuSeconds = 0.0;
+    unsigned long long calls = 0;
+    const double start = BenchmarkClock();
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const double frameStart = BenchmarkClock();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        RecordFrame(batch, meshes, objectCount, materialCount, frame);
+        batch.Render(projection);
+
+        cpuSeconds += BenchmarkClock() - frameStart;
+        GlStats::EndFrame();
+        calls += GlStats::GetLastFrame().calls;
+
+        glfwSwapBuffers(window);
+    }
+
+    glFinish();
+    const double seconds = BenchmarkClock() - start;
+
+    printf("%-10s %10.3f %10.3f %10llu %10zu\n",
+           multiDraw ? "multidraw" : "loop",
+           cpuSeconds * 1000.0 / frameCount,
+           seconds * 1000.0 / frameCount,
+           calls / frameCount,
+           batch.GetDrawCalls());
+}
+
+// One frame of either mode into a framebuffer object
+std::vector<uint8_t>
+ReadFrame(MaterialBatch& batch,
+          const uint32_t meshes[2],
+          int objectCount,
+          int materialCount,
+          bool multiDraw)
+{
+    std::vector<uint8_t> pixels(targetSize * targetSize * 4);
+    GLuint FBO = 0, renderbuffers[2] {0, 0};
+
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetSize, targetSize);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, targetSize, targetSize);
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                              GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER,
+                              renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                              GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER,
+                              renderbuffers[1]);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, targetSize, targetSize);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    batch.SetMultiDraw(multiDraw);
+    RecordFrame(batch, meshes, objectCount, materialCount, 0);
+    batch.Render(glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -2.0f, 2.0f));
+
+    glReadPixels(0, 0, targetSize, targetSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(2, renderbuffers);
+
+    return pixels;
+}
+
+} // namespace
+
+int
+RunMaterialBenchmark(int argc, char** argv)
+{
+    const int objectCount = argc > 0 ? atoi(argv[0]) : 10000;
+    const int materialCount = argc > 1 ? atoi(argv[1]) : 64;
+
+    if (objectCount <= 0 || materialCount <= 0
+        || materialCount > static_cast<int>(MaterialBatch::maxMaterials)) {
+        return 1;
+    }
+
+    GLFWwindow* window = CreateBenchmarkWindow("Material benchmark");
+
+    if (!window)
+        return 1;
+
+    GlStats::Install(1);
+    glEnable(GL_DEPTH_TEST);
+
+    {
+        MaterialBatch batch;
+        batch.CreateFromFiles("../OpenGLCourseApp/Shaders/material.vert",
+                              "../OpenGLCourseApp/Shaders/material.frag");
+        batch.CreateTextures(textureSize, textureSize, textureLayers);
+        FillTextures(batch.GetTextures());
+
+        uint32_t meshes[2];
+        AddMeshes(batch, meshes);
+
+        // Every fifth material untextured
+        for (int i = 0; i < materialCount; ++i) {
+            MaterialBatch::Material material;
+            material.baseColor = glm::vec4(0.5f + 0.5f * (i % 3) / 2.0f,
+                                           0.5f + 0.5f * (i % 5) / 4.0f,
+                                           0.5f + 0.5f * (i % 7) / 6.0f,
+                                           1.0f);
+            material.textureLayer = i % 5 == 4 ? -1 : i % textureLayers;
+            batch.AddMaterial(material);
+        }
+
+        printf("%d objects, %d materials, %s\n",
+               objectCount,
+               materialCount,
+               glGetString(GL_RENDERER));
+
+        if (!batch.IsMultiDrawSupported())
+            printf("No glMultiDrawElementsIndirect here, both rows use the loop\n");
+
+        printf("%-10s %10s %10s %10s %10s\n", "mode", "CPU ms", "frame ms", "GL calls", "draws");
+
+        RunMode(window, batch, meshes, objectCount, materialCount, true);
+        RunMode(window, batch, meshes, objectCount, materialCount, false);
+
+        const bool identical = ReadFrame(batch, meshes, objectCount, materialCount, true)
+                               == ReadFrame(batch, meshes, objectCount, materialCount, false);
+        printf("Both modes draw the same pixels: %s\n", identical ? "yes" : "no");
+    }
+
+    GlStats::Uninstall();
+    DestroyBenchmarkWindow(window);
+
+    return 0;
+}
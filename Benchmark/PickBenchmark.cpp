@@ -0,0 +1,171 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "Benchmarks.h"
+#include "TriangleBvh.h"
+
+// TriangleBvh picking against a loop over every triangle, on a bumpy sphere of
+// growing triangle counts. Half the rays aim at the sphere, half are random.
+
+namespace {
+
+const unsigned int queryCount = 512;
+
+struct Query
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+void
+BuildSphere(unsigned int segments,
+            std::vector<glm::vec3>& positions,
+            std::vector<uint32_t>& indices)
+{
+    const float pi = 3.14159265f;
+    const unsigned int rings = segments / 2;
+
+    positions.clear();
+    indices.clear();
+
+    for (unsigned int ring = 0; ring <= rings; ++ring) {
+        for (unsigned int segment = 0; segment <= segments; ++segment) {
+            const float theta = pi * ring / rings;
+            const float phi = 2.0f * pi * segment / segments;
+            const float radius = 1.0f + 0.05f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+
+            positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi),
+                                                   std::cos(theta),
+                                                   std::sin(theta) * std::sin(phi)));
+        }
+    }
+
+    for (unsigned int ring = 0; ring < rings; ++ring) {
+        for (unsigned int segment = 0; segment < segments; ++segment) {
+            const uint32_t a = ring * (segments + 1) + segment;
+            const uint32_t b = a + segments + 1;
+
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+}
+
+// Same two sided test and tie rule as TriangleBvh, distance only
+bool
+LinearPick(const std::vector<glm::vec3>& positions,
+           const std::vector<uint32_t>& indices,
+           const Query& query,
+           float& distance)
+{
+    float closest = 1e30f;
+    bool found = false;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3& p0 = positions[indices[i]];
+        const glm::vec3 edge1 = positions[indices[i + 1]] - p0;
+        const glm::vec3 edge2 = positions[indices[i + 2]] - p0;
+        const glm::vec3 p = glm::cross(query.direction, edge2);
+        const float determinant = glm::dot(edge1, p);
+
+        if (determinant == 0.0f)
+            continue;
+
+        const float inverseDeterminant = 1.0f / determinant;
+        const glm::vec3 s = query.origin - p0;
+        const float u = glm::dot(s, p) * inverseDeterminant;
+        const glm::vec3 q = glm::cross(s, edge1);
+        const float v = glm::dot(query.direction, q) * inverseDeterminant;
+        const float t = glm::dot(edge2, q) * inverseDeterminant;
+
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= closest) {
+            closest = t;
+            found = true;
+        }
+    }
+
+    distance = closest;
+    return found;
+}
+
+void
+RunSize(unsigned int segments, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    BuildSphere(segments, positions, indices);
+
+    std::vector<Query> queries(queryCount);
+    for (unsigned int q = 0; q < queryCount; ++q) {
+        queries[q].origin = glm::vec3(unit(random), unit(random), unit(random)) * 3.0f;
+        queries[q].direction = q % 2 ? glm::vec3(unit(random), unit(random), unit(random)) * 0.5f
+                                         - queries[q].origin
+                                     : glm::vec3(unit(random), unit(random), unit(random));
+    }
+
+    TriangleBvh bvh;
+
+    double start = BenchmarkClock();
+    bvh.Build(positions, indices);
+    const double buildTime = BenchmarkClock() - start;
+
+    std::vector<TriangleBvh::Hit> bvhHits(queryCount);
+    std::vector<bool> bvhFound(queryCount);
+
+    start = BenchmarkClock();
+    for (unsigned int q = 0; q < queryCount; ++q)
+        bvhFound[q] = bvh.Raycast(queries[q].origin, queries[q].direction, 1e30f, bvhHits[q]);
+    const double bvhTime = (BenchmarkClock() - start) / queryCount;
+
+    unsigned int hits = 0;
+    unsigned int mismatches = 0;
+
+    start = BenchmarkClock();
+    for (unsigned int q = 0; q < queryCount; ++q) {
+        float distance;
+        const bool found = LinearPick(positions, indices, queries[q], distance);
+
+        // Triangles sharing the hit edge may win either way, the distance may not
+        if (found != bvhFound[q]
+            || (found && std::abs(distance - bvhHits[q].distance) > 1e-4f * distance)) {
+            ++mismatches;
+        }
+
+        hits += found;
+    }
+    const double linearTime = (BenchmarkClock() - start) / queryCount;
+
+    printf("%10zu %9.1f %10.2f %13.2f %6u %s\n",
+           indices.size() / 3,
+           buildTime * 1e3,
+           bvhTime * 1e6,
+           linearTime * 1e6,
+           hits,
+           mismatches ? "MISMATCH" : "");
+}
+
+} // namespace
+
+int
+RunPickBenchmark(int argc, char** argv)
+{
+    const size_t maxTriangles = argc > 0 ? strtoull(argv[0], nullptr, 10) : 2000000;
+
+    std::mt19937 random(1);
+
+    printf(" triangles  build ms  bvh ray us  linear ray us   hits\n");
+
+    // Four times the triangles per step
+    for (unsigned int segments = 32; static_cast<size_t>(segments) * segments <= maxTriangles;
+         segments *= 2) {
+        RunSize(segments, random);
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Benchmarks.h"
+#include "DynamicResolution.h"
+#include "Framebuffer.h"
+#include "MaterialBatch.h"
+
+// Dynamic resolution against a fill bound load, in a hidden window without
+// vsync: layers of blended full screen quads into a 1280x720 Framebuffer,
+// scaled by DynamicResolution and blitted to the window. The budget is half
+// the measured full resolution GPU time unless given. Halfway through the
+// load drops to a quarter of the layers, so the scale should first fall and
+// then recover. Prints the scale and smoothed GPU time as it goes, the
+// decisions as they are made and how many frames went over budget once
+// settled.
+
+namespace {
+
+const GLsizei targetWidth = 1280;
+const GLsizei targetHeight = 720;
+const int reportInterval = 50;
+const int measureFrames = 20;
+
+struct Scene
+{
+    Framebuffer target;
+    MaterialBatch batch;
+    uint32_t quad {MaterialBatch::invalidIndex};
+};
+
+void
+CreateScene(Scene& scene)
+{
+    scene.target.CreateFramebuffer(targetWidth, targetHeight);
+    scene.batch.CreateFromFiles("../OpenGLCourseApp/Shaders/material.vert",
+                                "../OpenGLCourseApp/Shaders/material.frag");
+
+    const MaterialBatch::Vertex vertices[4] {
+        {{-1.0f, -1.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+        {{1.0f, -1.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+        {{1.0f, 1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+        {{-1.0f, 1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+    };
+    const GLuint indices[6] {0, 1, 2, 0, 2, 3};
+
+    scene.quad = scene.batch.AddMesh(vertices, 4, indices, 6);
+
+    MaterialBatch::Material material;
+    material.baseColor = glm::vec4(0.3f, 0.6f, 0.9f, 0.1f);
+    scene.batch.AddMaterial(material);
+}
+
+// One frame of layers quads at the resolution's current scale
+void
+RenderFrame(GLFWwindow* window, Scene& scene, DynamicResolution& resolution, int layers)
+{
+    GLsizei width = targetWidth, height = targetHeight;
+
+    resolution.BeginFrame();
+    resolution.GetScaledSize(targetWidth, targetHeight, width, height);
+
+    scene.target.SetRenderSize(width, height);
+    scene.target.Bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    scene.batch.BeginFrame();
+    for (int layer = 0; layer < layers; ++layer)
+        scene.batch.AddDraw(scene.quad, 0, glm::mat4(1.0f));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    scene.batch.Render(glm::mat4(1.0f));
+    glDisable(GL_BLEND);
+
+    scene.target.Resolve();
+
+    resolution.EndFrame();
+
+    Framebuffer::BindDefault(targetWidth, targetHeight);
+    scene.target.BlitToDefault(0, 0, targetWidth, targetHeight);
+    glfwSwapBuffers(window);
+}
+
+// Full resolution GPU seconds of the last frame, through the same timer
+// queries with a budget nothing exceeds
+double
+MeasureFullResolution(GLFWwindow* window, Scene& scene, int layers)
+{
+    DynamicResolution::Settings settings;
+    settings.budgetSeconds = 1000.0;
+    settings.lowerThreshold = 0.0;
+    settings.smoothing = 1.0;
+
+    DynamicResolution resolution(settings);
+
+    for (int frame = 0; frame < measureFrames; ++frame)
+        RenderFrame(window, scene, resolution, layers);
+
+    glFinish();
+
+    // Collects the frames still in flight
+    resolution.BeginFrame();
+    resolution.EndFrame();
+
+    return resolution.GetGpuSeconds();
+}
+
+} // namespace
+
+int
+RunResolutionBenchmark(int argc, char** argv)
+{
+    const int layers = argc > 0 ? atoi(argv[0]) : 32;
+    const int frameCount = argc > 1 ? atoi(argv[1]) : 600;
+    const double budgetMilliseconds = argc > 2 ? atof(argv[2]) : 0.0;
+
+    if (layers <= 0 || frameCount <= 0 || budgetMilliseconds < 0.0)
+        return 1;
+
+    GLFWwindow* window = CreateBenchmarkWindow("Resolution benchmark");
+
+    if (!window)
+        return 1;
+
+    {
+        Scene scene;
+        CreateScene(scene);
+
+        const double fullSeconds = MeasureFullResolution(window, scene, layers);
+
+        DynamicResolution::Settings settings;
+        settings.budgetSeconds = budgetMilliseconds > 0.0 ? budgetMilliseconds / 1000.0
+                                                          : fullSeconds * 0.5;
+
+        printf("%dx%d, %d layers, %s\n",
+               targetWidth,
+               targetHeight,
+               layers,
+               glGetString(GL_RENDERER));
+        printf("Full resolution %.2f ms, budget %.2f ms\n",
+               fullSeconds * 1000.0,
+               settings.budgetSeconds * 1000.0);
+
+        DynamicResolution resolution(settings);
+        int lastDecisionFrame = 0, settledFrames = 0, overBudget = 0;
+        size_t decisions = 0;
+
+        for (int frame = 0; frame < frameCount; ++frame) {
+            const int frameLayers = frame < frameCount / 2 ? layers : std::max(layers / 4, 1);
+
+            RenderFrame(window, scene, resolution, frameLayers);
+
+            if (resolution.GetDecisions().size() != decisions) {
+                decisions = resolution.GetDecisions().size();
+                lastDecisionFrame = frame;
+            }
+
+            // Settled: the scale has held for the controller's up window
+            if (frame - lastDecisionFrame > static_cast<int>(settings.upFrames)
+                && resolution.GetGpuSeconds() > 0.0) {
+                ++settledFrames;
+                overBudget += resolution.GetGpuSeconds() > settings.budgetSeconds;
+            }
+
+            if (frame % reportInterval == 0) {
+                printf("frame %4d: %2d layers, scale %.3f, GPU %.2f ms\n",
+                       frame,
+                       frameLayers,
+                       resolution.GetScale(),
+                       resolution.GetGpuSeconds() * 1000.0);
+            }
+        }
+
+        glFinish();
+
+        printf("%zu decisions, %llu dropped queries, %d of %d settled frames over budget\n",
+               resolution.GetDecisions().size(),
+               resolution.GetDroppedFrames(),
+               overBudget,
+               settledFrames);
+    }
+
+    DestroyBenchmarkWindow(window);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Benchmarks.h"
+#include "Texture.h"
+#include "TextureFile.h"
+#include "TextureStreamer.h"
+
+// RGBA8 textures streamed in with their mip chains while frames keep going,
+// in a hidden window without vsync. Reports the upload and mip generation
+// rates, how many frames it took and the longest Update, which must stay
+// short since it never waits on the GPU. Given a KTX, KTX 2 or DDS file, it
+// is then loaded count times with Texture::CreateFromFile, reporting the load
+// time and its texture memory against the same texture in RGBA8.
+
+namespace {
+
+const size_t frameBudget = 16 * 1024 * 1024;
+
+void
+RunFileLoads(const char* fileLocation, int count)
+{
+    double seconds = 0.0;
+    size_t bytes = 0, rgbaBytes = 0;
+
+    for (int i = 0; i < count; ++i) {
+        Texture texture;
+        const double start = BenchmarkClock();
+
+        if (!texture.CreateFromFile(fileLocation))
+            return;
+
+        glFinish();
+        seconds += BenchmarkClock() - start;
+
+        bytes = rgbaBytes = 0;
+
+        for (GLint level = 0; level < texture.GetLevels(); ++level) {
+            const GLsizei width = texture.GetLevelWidth(level);
+            const GLsizei height = texture.GetLevelHeight(level);
+
+            bytes += TextureFile::GetImageSize(texture.GetInternalFormat(), width, height)
+                     * texture.GetLayers();
+            rgbaBytes += TextureFile::GetImageSize(GL_RGBA8, width, height) * texture.GetLayers();
+        }
+    }
+
+    const double megabyte = 1024.0 * 1024.0;
+
+    printf("%s: %.2f ms per load, %.1f MB/s, %.2f MB of texture memory, %.1fx less than RGBA8\n",
+           fileLocation,
+           seconds * 1000.0 / count,
+           bytes * count / megabyte / seconds,
+           bytes / megabyte,
+           static_cast<double>(rgbaBytes) / bytes);
+}
+
+} // namespace
+
+int
+RunTextureBenchmark(int argc, char** argv)
+{
+    const int size = argc > 0 ? atoi(argv[0]) : 2048;
+    const int count = argc > 1 ? atoi(argv[1]) : 16;
+
+    if (size <= 0 || count <= 0)
+        return 1;
+
+    GLFWwindow* window = CreateBenchmarkWindow("Texture benchmark");
+
+    if (!window)
+        return 1;
+
+    printf("%d textures of %dx%d, %s\n", count, size, size, glGetString(GL_RENDERER));
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+    unsigned int state = 12345;
+    for (uint8_t& byte : pixels) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+
+    std::vector<std::unique_ptr<Texture>> textures;
+    int frames = 0;
+    double longestUpdate = 0.0;
+    TextureStreamer::Stats stats;
+
+    {
+        TextureStreamer streamer;
+        const double start = BenchmarkClock();
+
+        for (int i = 0; i < count; ++i) {
+            textures.emplace_back(new Texture());
+            textures.back()->CreateTexture(Texture::Type::Texture2D, GL_RGBA8, size, size);
+            streamer.RequestImage(textures.back().get(), 0, GL_RGBA, pixels.data());
+        }
+
+        const double requested = BenchmarkClock();
+        printf("RequestImage %.2f ms each\n", (requested - start) * 1000.0 / count);
+
+        for (;;) {
+            const double updateStart = BenchmarkClock();
+            streamer.Update(frameBudget);
+            longestUpdate = std::max(longestUpdate, BenchmarkClock() - updateStart);
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            glfwSwapBuffers(window);
+            ++frames;
+
+            if (streamer.GetPendingCount() == 0
+                && std::all_of(textures.begin(),
+                               textures.end(),
+                               [](const std::unique_ptr<Texture>& texture) {
+                                   return texture->IsReady();
+                               })) {
+                break;
+            }
+        }
+
+        printf("All ready after %d frames, %.1f ms\n", frames, (BenchmarkClock() - start) * 1000.0);
+
+        stats = streamer.GetStats();
+        streamer.ClearStreamer();
+    }
+
+    const double megabyte = 1024.0 * 1024.0;
+
+    printf("Upload %.1f MB in %.1f ms of Update, %.1f MB/s\n",
+           stats.uploadedBytes / megabyte,
+           stats.uploadSeconds * 1000.0,
+           stats.uploadSeconds > 0.0 ? stats.uploadedBytes / megabyte / stats.uploadSeconds : 0.0);
+    printf("Mips %.1f MB in %.1f ms of loader threads, %.1f MB/s\n",
+           stats.mipBytes / megabyte,
+           stats.mipSeconds * 1000.0,
+           stats.mipSeconds > 0.0 ? stats.mipBytes / megabyte / stats.mipSeconds : 0.0);
+    printf("Longest Update %.2f ms, %llu with every buffer busy\n",
+           longestUpdate * 1000.0,
+           stats.busyUpdates);
+
+    textures.clear();
+
+    if (argc > 2)
+        RunFileLoads(argv[2], count);
+
+    DestroyBenchmarkWindow(window);
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Benchmarks.h"
+#include "TextureFile.h"
+
+// TextureFile::Open on small KTX, KTX 2 and DDS files, CPU only: the time to
+// map and validate each, then copies of each with the header cut short, the
+// data cut short and the layer count set past the limit (up to 0xFFFFFFFF),
+// every one of which must be rejected without allocating. Returns 1 if any
+// is accepted.
+
+namespace {
+
+const GLsizei imageSize = 8;
+
+struct Container
+{
+    const char* fileLocation;
+    // Where the layer count (KTX numberOfArrayElements, KTX 2 layerCount,
+    // DDS DX10 arraySize) is, and how long the header
+    size_t layerCountOffset;
+    size_t headerSize;
+};
+
+const Container containers[] = {
+    {"texturefile_benchmark.ktx", 48, 64},
+    {"texturefile_benchmark.ktx2", 32, 80},
+    {"texturefile_benchmark.dds", 140, 148},
+};
+
+const uint32_t oversizedLayers[] = {2049, 0x40000000, 0xFFFFFFFF};
+
+template <typename T>
+void
+Append(std::vector<uint8_t>& bytes, T value)
+{
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(&value);
+    bytes.insert(bytes.end(), begin, begin + sizeof(value));
+}
+
+bool
+WriteBytes(const char* fileLocation, const std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(fileLocation, "wb");
+
+    if (!file)
+        return false;
+
+    const bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && written;
+}
+
+std::vector<uint8_t>
+ReadBytes(const char* fileLocation)
+{
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(fileLocation, "rb");
+
+    if (!file)
+        return bytes;
+
+    uint8_t buffer[4096];
+    size_t count = 0;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.insert(bytes.end(), buffer, buffer + count);
+
+    fclose(file);
+    return bytes;
+}
+
+// TextureFile::Write has no KTX 1, so one RGBA8 level by hand
+bool
+WriteKtx(const char* fileLocation, const std::vector<uint8_t>& pixels)
+{
+    const uint8_t identifier[12] =
+        {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> bytes(identifier, identifier + sizeof(identifier));
+
+    Append<uint32_t>(bytes, 0x04030201);
+    Append<uint32_t>(bytes, GL_UNSIGNED_BYTE);
+    Append<uint32_t>(bytes, 1);
+    Append<uint32_t>(bytes, GL_RGBA);
+    Append<uint32_t>(bytes, GL_RGBA8);
+    Append<uint32_t>(bytes, GL_RGBA);
+    Append<uint32_t>(bytes, imageSize);
+    Append<uint32_t>(bytes, imageSize);
+    Append<uint32_t>(bytes, 0);
+    Append<uint32_t>(bytes, 0);
+    Append<uint32_t>(bytes, 1);
+    Append<uint32_t>(bytes, 1);
+    Append<uint32_t>(bytes, 0);
+    Append<uint32_t>(bytes, static_cast<uint32_t>(pixels.size()));
+    bytes.insert(bytes.end(), pixels.begin(), pixels.end());
+
+    return WriteBytes(fileLocation, bytes);
+}
+
+bool
+WriteContainers()
+{
+    // R8 in KTX 2 and DDS, which puts DDS through its DX10 header
+    std::vector<uint8_t> pixels(static_cast<size_t>(imageSize) * imageSize * 4, 0x80);
+    std::vector<uint8_t> red(static_cast<size_t>(imageSize) * imageSize, 0x40);
+    const void* levels[1] = {red.data()};
+
+    return WriteKtx(containers[0].fileLocation, pixels)
+           && TextureFile::Write(containers[1].fileLocation,
+                                 GL_R8,
+                                 imageSize,
+                                 imageSize,
+                                 1,
+                                 levels)
+           && TextureFile::Write(containers[2].fileLocation,
+                                 GL_R8,
+                                 imageSize,
+                                 imageSize,
+                                 1,
+                                 levels);
+}
+
+// Whether Open takes bytes written to fileLocation
+bool
+Accepts(const char* fileLocation, const std::vector<uint8_t>& bytes)
+{
+    if (!WriteBytes(fileLocation, bytes))
+        return true;
+
+    TextureFile file;
+    return file.Open(fileLocation);
+}
+
+// Corrupt copies of container accepted by Open
+int
+CountAccepted(const Container& container, const char* corruptLocation)
+{
+    const std::vector<uint8_t> valid = ReadBytes(container.fileLocation);
+    int accepted = 0;
+
+    if (valid.size() <= container.headerSize)
+        return 1;
+
+    std::vector<uint8_t> bytes(valid.begin(), valid.begin() + container.headerSize - 1);
+    accepted += Accepts(corruptLocation, bytes);
+
+    bytes.assign(valid.begin(), valid.end() - 1);
+    accepted += Accepts(corruptLocation, bytes);
+
+    for (uint32_t layers : oversizedLayers) {
+        bytes = valid;
+        memcpy(&bytes[container.layerCountOffset], &layers, sizeof(layers));
+        accepted += Accepts(corruptLocation, bytes);
+    }
+
+    return accepted;
+}
+
+} // namespace
+
+int
+RunTextureFileBenchmark(int argc, char** argv)
+{
+    const int iterations = argc > 0 ? atoi(argv[0]) : 10000;
+    const char* corruptLocation = "texturefile_benchmark_corrupt.bin";
+
+    if (iterations <= 0)
+        return 1;
+
+    if (!WriteContainers()) {
+        printf("Could not write the test files\n");
+        return 1;
+    }
+
+    int accepted = 0;
+
+    for (const Container& container : containers) {
+        const double start = BenchmarkClock();
+        bool opened = true;
+
+        for (int i = 0; i < iterations && opened; ++i) {
+            TextureFile file;
+            opened = file.Open(container.fileLocation);
+        }
+
+        if (!opened) {
+            ++accepted;
+            continue;
+        }
+
+        printf("%-28s Open %.2f us\n",
+               container.fileLocation,
+               (BenchmarkClock() - start) * 1e6 / iterations);
+
+        // Open prints why each one is rejected
+        const int corruptAccepted = CountAccepted(container, corruptLocation);
+        printf("%-28s %d corrupt copies accepted\n", container.fileLocation, corruptAccepted);
+        accepted += corruptAccepted;
+
+        remove(container.fileLocation);
+    }
+
+    remove(corruptLocation);
+
+    return accepted > 0 ? 1 : 0;
+}
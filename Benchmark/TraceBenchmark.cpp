@@ -0,0 +1,128 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Tracing.h"
+
+// Cost of an empty TRACE_SCOPE while not recording and while recording, on
+// one thread and on several at once. Bursts stay below a ring's capacity and
+// the writer drains between them, so nothing is dropped. Median of the bursts.
+
+namespace {
+
+const int burstScopes = 4096;
+const int burstCount = 40;
+
+// Keeps the loop from being optimised away
+volatile int sink = 0;
+
+double
+TimeBursts(int scopeCount)
+{
+    std::vector<double> times;
+
+    for (int burst = 0; burst < burstCount; ++burst) {
+        const double start = BenchmarkClock();
+        for (int i = 0; i < scopeCount; ++i) {
+            TRACE_SCOPE("Benchmark");
+            sink = i;
+        }
+        times.push_back((BenchmarkClock() - start) / scopeCount);
+
+        // Give the writer thread time to drain the ring
+        if (Tracer::IsRecording())
+            std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Two of these per scope, the floor of the recording cost
+double
+TimeClock(int readCount)
+{
+    std::vector<double> times;
+
+    for (int burst = 0; burst < burstCount; ++burst) {
+        const double start = BenchmarkClock();
+        for (int i = 0; i < readCount; ++i)
+            sink = static_cast<int>(Tracer::Now());
+        times.push_back((BenchmarkClock() - start) / readCount);
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+double
+TimeLoop(int scopeCount)
+{
+    std::vector<double> times;
+
+    for (int burst = 0; burst < burstCount; ++burst) {
+        const double start = BenchmarkClock();
+        for (int i = 0; i < scopeCount; ++i)
+            sink = i;
+        times.push_back((BenchmarkClock() - start) / scopeCount);
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+} // namespace
+
+int
+RunTraceBenchmark(int argc, char** argv)
+{
+    const unsigned int threadCount =
+        argc > 0 ? static_cast<unsigned int>(strtoul(argv[0], nullptr, 10))
+                 : std::max(2u, std::thread::hardware_concurrency());
+
+#if !TRACING_ENABLED
+    printf("Built with TRACING_ENABLED 0, TRACE_SCOPE compiles to nothing\n");
+#endif
+
+    const double loop = TimeLoop(burstScopes);
+    const double idle = TimeBursts(burstScopes) - loop;
+    const double clock = TimeClock(burstScopes) - loop;
+
+    if (!Tracer::Start("trace_benchmark.json"))
+        return 1;
+
+    TRACE_THREAD_NAME("Benchmark");
+    const double recording = TimeBursts(burstScopes) - loop;
+
+    // Every thread writes its own ring
+    std::vector<double> threadTimes(threadCount);
+    std::vector<std::thread> threads;
+
+    for (unsigned int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([t, &threadTimes]() {
+            TRACE_THREAD_NAME("Benchmark worker");
+            threadTimes[t] = TimeBursts(burstScopes);
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    Tracer::Stop();
+
+    const double threaded = *std::max_element(threadTimes.begin(), threadTimes.end()) - loop;
+
+    printf("ns per scope: not recording %.1f, recording %.1f, %u threads recording %.1f\n",
+           idle * 1e9,
+           recording * 1e9,
+           threadCount,
+           threaded * 1e9);
+    printf("ns per trace clock read: %.1f (two per recorded scope)\n", clock * 1e9);
+    printf("dropped events: %llu, trace written to trace_benchmark.json\n",
+           static_cast<unsigned long long>(Tracer::GetDroppedEvents()));
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "Benchmarks.h"
+#include "TransformSet.h"
+
+// Per frame model matrices of spinning objects: the glm::translate, rotate,
+// scale chain main.cpp used against TransformSet (quaternion integration and a
+// batched quaternion to matrix conversion). Best of a few frames each.
+
+namespace {
+
+const int frameCount = 20;
+
+void
+RunSize(size_t objectCount, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<glm::vec3> positions(objectCount), axes(objectCount), pivots(objectCount);
+    std::vector<float> speeds(objectCount), angles(objectCount, 0.0f);
+    std::vector<float> scales(objectCount);
+
+    TransformSet transforms;
+    transforms.Resize(objectCount);
+
+    for (size_t i = 0; i < objectCount; ++i) {
+        positions[i] = glm::vec3(unit(random), unit(random), unit(random)) * 10.0f;
+        axes[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random))
+                                 + glm::vec3(0.0f, 2.0f, 0.0f));
+        pivots[i] = glm::vec3(unit(random), unit(random), unit(random));
+        speeds[i] = 0.01f + 0.01f * unit(random);
+        scales[i] = 1.0f + 0.5f * unit(random);
+
+        transforms.SetPosition(i, positions[i]);
+        transforms.SetScale(i, glm::vec3(scales[i]));
+        transforms.SetPivot(i, pivots[i]);
+        transforms.SetAngularVelocity(i, axes[i] * speeds[i]);
+    }
+
+    std::vector<glm::mat4> rotateModels(objectCount), quatModels;
+    double rotateTime = 1e30, integrateTime = 1e30, buildTime = 1e30;
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        double start = BenchmarkClock();
+        for (size_t i = 0; i < objectCount; ++i) {
+            angles[i] += speeds[i];
+
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+            model = glm::rotate(model, angles[i], axes[i]);
+            model = glm::scale(model, glm::vec3(scales[i]));
+            rotateModels[i] = glm::translate(model, -pivots[i]);
+        }
+        rotateTime = std::min(rotateTime, BenchmarkClock() - start);
+
+        start = BenchmarkClock();
+        transforms.Integrate(1.0f);
+        integrateTime = std::min(integrateTime, BenchmarkClock() - start);
+
+        start = BenchmarkClock();
+        transforms.BuildModels(quatModels);
+        buildTime = std::min(buildTime, BenchmarkClock() - start);
+    }
+
+    // Both paths turned every object by the same angle
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < objectCount; ++i) {
+        for (int column = 0; column < 4; ++column) {
+            const glm::vec4 difference = glm::abs(rotateModels[i][column] - quatModels[i][column]);
+            maxDifference = std::max(maxDifference,
+                                     std::max(std::max(difference.x, difference.y),
+                                              std::max(difference.z, difference.w)));
+        }
+    }
+
+    printf("%9zu %10.1f %13.1f %9.1f %10.1f %8.1e\n",
+           objectCount,
+           rotateTime * 1e6,
+           integrateTime * 1e6,
+           buildTime * 1e6,
+           (integrateTime + buildTime) * 1e6,
+           maxDifference);
+}
+
+} // namespace
+
+int
+RunTransformBenchmark(int argc, char** argv)
+{
+    const size_t maxObjects = argc > 0 ? strtoull(argv[0], nullptr, 10) : 1000000;
+
+    std::mt19937 random(1);
+
+    printf("  objects  rotate us  integrate us  build us  quat us  max diff\n");
+
+    for (size_t objectCount = 1000; objectCount <= maxObjects; objectCount *= 10)
+        RunSize(objectCount, random);
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Benchmarks.h"
+#include "VideoFrame.h"
+#include "VideoRenderer.h"
+#include "YuvConverter.h"
+
+// Video frames uploaded and drawn as fast as the GPU takes them, in a hidden
+// window without vsync. Each frame is a full Upload (copy into the pixel
+// unpack ring, texture update) and Render; the clock stops after glFinish.
+// Afterwards one frame is drawn at 1:1 into a framebuffer object and
+// compared with YuvConverter byte for byte.
+
+namespace {
+
+const int frameVariants = 4;
+const int warmupFrames = 10;
+
+// Gradients that move between variants so no two consecutive frames match
+std::vector<uint8_t>
+MakeFrame(VideoFormat format, int width, int height, int variant, VideoFrame& frame)
+{
+    std::vector<uint8_t> data(VideoFrame::GetFrameSize(format, width, height));
+    size_t offset = 0;
+
+    frame = VideoFrame();
+    frame.format = format;
+    frame.width = width;
+    frame.height = height;
+
+    for (int plane = 0; plane < VideoFrame::GetPlaneCount(format); ++plane) {
+        const int planeWidth = VideoFrame::GetPlaneWidth(format, width, plane);
+        const int planeHeight = VideoFrame::GetPlaneHeight(format, height, plane);
+        const size_t rowSize = static_cast<size_t>(planeWidth)
+                               * VideoFrame::GetPlaneChannels(format, plane);
+
+        frame.planes[plane] = data.data() + offset;
+        frame.strides[plane] = rowSize;
+
+        for (int y = 0; y < planeHeight; ++y) {
+            for (size_t x = 0; x < rowSize; ++x)
+                data[offset + y * rowSize + x] = static_cast<uint8_t>(x + y * 3 + variant * 16);
+        }
+
+        offset += rowSize * planeHeight;
+    }
+
+    // Moving the vector out keeps the buffer the planes point into
+    return data;
+}
+
+// Bytes where the shader and the CPU converter disagree
+size_t
+CompareWithCpu(VideoRenderer& renderer, const VideoFrame& frame)
+{
+    const size_t rowSize = static_cast<size_t>(frame.width) * 4;
+    std::vector<uint8_t> gpu(rowSize * frame.height), cpu(rowSize * frame.height);
+
+    GLuint FBO = 0, colour = 0;
+    glGenRenderbuffers(1, &colour);
+    glBindRenderbuffer(GL_RENDERBUFFER, colour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, frame.width, frame.height);
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, frame.width, frame.height);
+
+    renderer.Upload(frame);
+    renderer.Render();
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, frame.width, frame.height, GL_RGBA, GL_UNSIGNED_BYTE, gpu.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &colour);
+
+    YuvConverter::Convert(frame, ColorMatrix::BT709, ColorRange::Limited, cpu.data(), rowSize);
+
+    // glReadPixels rows start at the bottom
+    size_t mismatches = 0;
+    for (int row = 0; row < frame.height; ++row) {
+        const uint8_t* gpuRow = gpu.data() + (frame.height - 1 - row) * rowSize;
+        const uint8_t* cpuRow = cpu.data() + row * rowSize;
+
+        for (size_t i = 0; i < rowSize; ++i)
+            mismatches += gpuRow[i] != cpuRow[i];
+    }
+
+    return mismatches;
+}
+
+void
+RunFormat(GLFWwindow* window,
+          VideoFormat format,
+          const char* name,
+          int width,
+          int height,
+          int frameCount)
+{
+    std::vector<std::vector<uint8_t>> data(frameVariants);
+    VideoFrame frames[frameVariants];
+
+    for (int i = 0; i < frameVariants; ++i)
+        data[i] = MakeFrame(format, width, height, i, frames[i]);
+
+    VideoRenderer renderer;
+    renderer.CreateFromFiles("../OpenGLCourseApp/Shaders/video.vert",
+                             "../OpenGLCourseApp/Shaders/video.frag");
+
+    for (int i = 0; i < warmupFrames; ++i) {
+        renderer.Upload(frames[i % frameVariants]);
+        renderer.Render();
+        glfwSwapBuffers(window);
+    }
+
+    glFinish();
+
+    const unsigned long long startBytes = renderer.GetUploadedBytes();
+    const unsigned long long startStalls = renderer.GetStalls();
+    const double start = BenchmarkClock();
+
+    for (int i = 0; i < frameCount; ++i) {
+        renderer.Upload(frames[i % frameVariants]);
+        renderer.Render();
+        glfwSwapBuffers(window);
+    }
+
+    glFinish();
+    const double seconds = BenchmarkClock() - start;
+
+    const double framesPerSecond = frameCount / seconds;
+    const double megabytes = (renderer.GetUploadedBytes() - startBytes) / (1024.0 * 1024.0);
+
+    const unsigned long long stalls = renderer.GetStalls() - startStalls;
+
+    printf("%-6s %10.1f %10.1f %8llu %8s %12zu\n",
+           name,
+           framesPerSecond,
+           megabytes / seconds,
+           stalls,
+           framesPerSecond >= 60.0 ? "yes" : "no",
+           CompareWithCpu(renderer, frames[0]));
+}
+
+} // namespace
+
+int
+RunVideoBenchmark(int argc, char** argv)
+{
+    const int width = argc > 0 ? atoi(argv[0]) : 3840;
+    const int height = argc > 1 ? atoi(argv[1]) : 2160;
+    const int frameCount = argc > 2 ? atoi(argv[2]) : 300;
+
+    if (width <= 0 || height <= 0 || frameCount <= 0)
+        return 1;
+
+    GLFWwindow* window = CreateBenchmarkWindow("Video benchmark");
+
+    if (!window)
+        return 1;
+
+    printf("%dx%d, %d frames, %s\n", width, height, frameCount, glGetString(GL_RENDERER));
+    printf("%-6s %10s %10s %8s %8s %12s\n",
+           "format",
+           "frames/s",
+           "MB/s",
+           "stalls",
+           "60 fps",
+           "vs CPU");
+
+    RunFormat(window, VideoFormat::NV12, "NV12", width, height, frameCount);
+    RunFormat(window, VideoFormat::I420, "I420", width, height, frameCount);
+    RunFormat(window, VideoFormat::YUYV, "YUYV", width, height, frameCount);
+
+    DestroyBenchmarkWindow(window);
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "ThreadPool.h"
+#include "VideoFrame.h"
+#include "YuvConverter.h"
+
+// CPU YUV to RGBA8 in megapixels per second, every kernel on one thread and
+// on a pool, after checking each kernel's output against the scalar one byte
+// for byte. Odd sizes also exercise the scalar tails. Median of the runs.
+
+namespace {
+
+const int runCount = 9;
+
+std::vector<uint8_t>
+MakeFrame(VideoFormat format, int width, int height, VideoFrame& frame)
+{
+    std::vector<uint8_t> data(VideoFrame::GetFrameSize(format, width, height));
+    size_t offset = 0;
+
+    // Noise, so every clamp and both signs of chroma show up
+    unsigned int state = 12345;
+    for (uint8_t& byte : data) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+
+    frame = VideoFrame();
+    frame.format = format;
+    frame.width = width;
+    frame.height = height;
+
+    for (int plane = 0; plane < VideoFrame::GetPlaneCount(format); ++plane) {
+        const size_t rowSize = static_cast<size_t>(VideoFrame::GetPlaneWidth(format, width, plane))
+                               * VideoFrame::GetPlaneChannels(format, plane);
+        frame.planes[plane] = data.data() + offset;
+        frame.strides[plane] = rowSize;
+        offset += rowSize * VideoFrame::GetPlaneHeight(format, height, plane);
+    }
+
+    return data;
+}
+
+double
+TimeConvert(const VideoFrame& frame, uint8_t* rgba, ThreadPool* pool, YuvConverter::Kernel kernel)
+{
+    std::vector<double> times;
+
+    for (int run = 0; run < runCount; ++run) {
+        const double start = BenchmarkClock();
+        YuvConverter::Convert(
+            frame, ColorMatrix::BT709, ColorRange::Limited, rgba, frame.width * 4, pool, kernel);
+        times.push_back(BenchmarkClock() - start);
+    }
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Bytes that differ from the scalar kernel over every matrix and range
+size_t
+CountMismatches(const VideoFrame& frame, YuvConverter::Kernel kernel)
+{
+    const size_t size = static_cast<size_t>(frame.width) * frame.height * 4;
+    std::vector<uint8_t> expected(size), actual(size);
+    size_t mismatches = 0;
+
+    for (ColorMatrix matrix : {ColorMatrix::BT601, ColorMatrix::BT709}) {
+        for (ColorRange range : {ColorRange::Limited, ColorRange::Full}) {
+            YuvConverter::Convert(frame,
+                                  matrix,
+                                  range,
+                                  expected.data(),
+                                  frame.width * 4,
+                                  nullptr,
+                                  YuvConverter::Kernel::Scalar);
+            YuvConverter::Convert(
+                frame, matrix, range, actual.data(), frame.width * 4, nullptr, kernel);
+
+            for (size_t i = 0; i < size; ++i)
+                mismatches += expected[i] != actual[i];
+        }
+    }
+
+    return mismatches;
+}
+
+} // namespace
+
+int
+RunYuvBenchmark(int argc, char** argv)
+{
+    const int width = argc > 0 ? atoi(argv[0]) : 3840;
+    const int height = argc > 1 ? atoi(argv[1]) : 2160;
+
+    if (width <= 0 || height <= 0)
+        return 1;
+
+    ThreadPool pool;
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+
+    const YuvConverter::Kernel kernels[] = {
+        YuvConverter::Kernel::Scalar, YuvConverter::Kernel::SSE2, YuvConverter::Kernel::AVX2};
+    const struct
+    {
+        VideoFormat format;
+        const char* name;
+    } formats[] = {
+        {VideoFormat::NV12, "NV12"}, {VideoFormat::I420, "I420"}, {VideoFormat::YUYV, "YUYV"}};
+
+    printf("%dx%d to RGBA8, %u threads in the pool\n", width, height, pool.GetThreadCount());
+    printf("%-6s %-7s %12s %12s %12s\n", "format", "kernel", "1 thread", "pool", "mismatches");
+
+    // Small odd frame for the exactness check, the tails differ from the big one
+    const int checkWidth = 173, checkHeight = 31;
+
+    for (const auto& format : formats) {
+        VideoFrame frame, checkFrame;
+        const std::vector<uint8_t> data = MakeFrame(format.format, width, height, frame);
+        const std::vector<uint8_t> checkData = MakeFrame(
+            format.format, checkWidth, checkHeight, checkFrame);
+
+        for (YuvConverter::Kernel kernel : kernels) {
+            // YUYV has no SIMD kernel, it would time the scalar one again
+            if (!YuvConverter::IsSupported(kernel)
+                || (format.format == VideoFormat::YUYV && kernel != YuvConverter::Kernel::Scalar))
+                continue;
+
+            const double megapixels = width * static_cast<double>(height) / 1e6;
+            const double single = TimeConvert(frame, rgba.data(), nullptr, kernel);
+            const double threaded = TimeConvert(frame, rgba.data(), &pool, kernel);
+            const size_t mismatches = CountMismatches(frame, kernel)
+                                      + CountMismatches(checkFrame, kernel);
+
+            printf("%-6s %-7s %7.1f MP/s %7.1f MP/s %12zu\n",
+                   format.name,
+                   YuvConverter::GetKernelName(kernel),
+                   megapixels / single,
+                   megapixels / threaded,
+                   mismatches);
+        }
+    }
+
+    return 0;
+}
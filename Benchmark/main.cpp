@@ -0,0 +1,51 @@
+﻿#include <stdio.h>
+#include <string.h>
+
+#include "Benchmarks.h"
+
+// Benchmarks of the engine code, CPU only except capture, material, resolution,
+// texture and video, which open a hidden window for their GL context
+// Usage: Benchmark <name> [arguments]
+
+namespace {
+
+struct Benchmark
+{
+    const char* name;
+    const char* arguments;
+    int (*run)(int argc, char** argv);
+};
+
+const Benchmark benchmarks[] = {
+    {"animation", "[characters]", RunAnimationBenchmark},
+    {"bvh", "[objects]", RunBvhBenchmark},
+    {"capture", "[width height frames]", RunCaptureBenchmark},
+    {"material", "[objects materials]", RunMaterialBenchmark},
+    {"pick", "[triangles]", RunPickBenchmark},
+    {"resolution", "[layers frames [budget_ms]]", RunResolutionBenchmark},
+    {"texture", "[size count [file.ktx|file.ktx2|file.dds]]", RunTextureBenchmark},
+    {"texturefile", "[iterations]", RunTextureFileBenchmark},
+    {"trace", "[threads]", RunTraceBenchmark},
+    {"transform", "[objects]", RunTransformBenchmark},
+    {"video", "[width height frames]", RunVideoBenchmark},
+    {"yuv", "[width height]", RunYuvBenchmark},
+};
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    if (argc >= 2) {
+        for (const Benchmark& benchmark : benchmarks) {
+            if (strcmp(argv[1], benchmark.name) == 0)
+                return benchmark.run(argc - 2, argv + 2);
+        }
+    }
+
+    printf("Usage:\n");
+    for (const Benchmark& benchmark : benchmarks)
+        printf("  %s %s %s\n", argv[0], benchmark.name, benchmark.arguments);
+
+    return 1;
+}
@@ -0,0 +1,121 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+// Converts an OBJ or binary PLY into the binary mesh container loaded by Mesh::CreateFromFile
+// Usage: MeshConverter input.obj|input.ply output.oglm
+//        MeshConverter --bench input.obj|input.ply [threads]
+
+int
+main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+        MeshImporter importer;
+        importer.SetThreadCount(argc > 3 ? atoi(argv[3]) : 0);
+
+        // First run warms the page cache, report the best of the rest
+        double best = 0.0;
+        for (int run = 0; run < 4; ++run) {
+            if (!importer.Import(argv[2]))
+                return 1;
+
+            if (run > 0 && importer.GetThroughput() > best)
+                best = importer.GetThroughput();
+        }
+
+        printf("%s: %.1f MB/s\n", argv[2], best);
+        return 0;
+    }
+
+    if (argc != 3) {
+        printf("Usage: %s input.obj|input.ply output.oglm\n", argv[0]);
+        printf("       %s --bench input.obj|input.ply [threads]\n", argv[0]);
+        return 1;
+    }
+
+    MeshImporter importer;
+
+    if (!importer.Import(argv[1]))
+        return 1;
+
+    std::vector<GLfloat>& vertices = importer.GetVertices();
+    std::vector<unsigned int>& indices = importer.GetIndices();
+    const unsigned int stride = importer.GetStride();
+
+    MeshOptimizer::Optimize(vertices, indices, stride);
+
+    // LODs share the (already fetch ordered) vertex buffer
+    std::vector<unsigned int> lodIndices;
+    std::vector<Mesh::Lod> lods;
+    MeshSimplifier::BuildLodChain(vertices,
+                                  stride,
+                                  indices,
+                                  MeshFileHeader::maxLods,
+                                  lodIndices,
+                                  lods);
+    indices.swap(lodIndices);
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.vertexStride = sizeof(GLfloat) * stride;
+    header.vertexCount = static_cast<uint32_t>(vertices.size() / stride);
+
+    Mesh::VertexAttribute attributes[3];
+    header.attributeCount = importer.GetAttributes(attributes);
+
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        header.attributes[i].location = attributes[i].location;
+        header.attributes[i].components = attributes[i].components;
+        header.attributes[i].type = attributes[i].type;
+        header.attributes[i].normalized = attributes[i].normalized;
+        header.attributes[i].offset = attributes[i].offset;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        header.boundsMin[i] = importer.GetBoundsMin()[i];
+        header.boundsMax[i] = importer.GetBoundsMax()[i];
+    }
+
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    for (uint32_t i = 0; i < header.lodCount; ++i) {
+        header.lods[i].firstIndex = static_cast<uint32_t>(lods[i].firstIndex);
+        header.lods[i].indexCount = static_cast<uint32_t>(lods[i].indexCount);
+        header.lods[i].error = lods[i].error;
+    }
+
+    // Half the index bandwidth when the vertex count allows it
+    std::vector<unsigned short> shortIndices;
+    const void* indexData = indices.data();
+
+    if (header.vertexCount <= 0xFFFF) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indexData = shortIndices.data();
+        header.indexType = GL_UNSIGNED_SHORT;
+        header.indexDataSize = sizeof(unsigned short) * indices.size();
+    } else {
+        header.indexType = GL_UNSIGNED_INT;
+        header.indexDataSize = sizeof(unsigned int) * indices.size();
+    }
+
+    if (!MeshFile::Write(argv[2], header, vertices.data(), indexData))
+        return 1;
+
+    printf("%s: %u vertices, %u LODs\n", argv[2], header.vertexCount, header.lodCount);
+
+    for (uint32_t i = 0; i < header.lodCount; ++i)
+        printf("  LOD %u: %u triangles, error %g\n",
+               i,
+               header.lods[i].indexCount / 3,
+               header.lods[i].error);
+
+    return 0;
+}
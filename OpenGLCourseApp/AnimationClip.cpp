@@ -0,0 +1,224 @@
+﻿#include "AnimationClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// The three smaller components of a unit quaternion lie within +-1/sqrt(2)
+const float smallestThreeRange = 0.70710678f;
+const float rotationScale = 32767.0f / (2.0f * smallestThreeRange);
+const float rotationBias = 16383.5f;
+
+// Largest component's index in the top bits of the first two keys, the other
+// three at 15 bits each. The largest is made positive and rebuilt from unit length.
+void
+EncodeRotation(const glm::quat& rotation, uint16_t* key)
+{
+    const float components[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; ++i) {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    }
+
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint16_t values[3];
+    for (unsigned int i = 0, j = 0; i < 4; ++i) {
+        if (i == largest)
+            continue;
+
+        const float value = std::floor(components[i] * sign * rotationScale + rotationBias + 0.5f);
+        values[j++] = static_cast<uint16_t>(std::min(std::max(value, 0.0f), 32767.0f));
+    }
+
+    key[0] = static_cast<uint16_t>(values[0] | ((largest >> 1) << 15));
+    key[1] = static_cast<uint16_t>(values[1] | ((largest & 1) << 15));
+    key[2] = values[2];
+}
+
+glm::quat
+DecodeRotation(const uint16_t* key)
+{
+    const unsigned int largest = ((key[0] >> 15) << 1) | (key[1] >> 15);
+    const float a = ((key[0] & 0x7fff) - rotationBias) * (1.0f / rotationScale);
+    const float b = ((key[1] & 0x7fff) - rotationBias) * (1.0f / rotationScale);
+    const float c = (key[2] - rotationBias) * (1.0f / rotationScale);
+    const float d = std::sqrt(std::max(1.0f - a * a - b * b - c * c, 0.0f));
+
+    // Selects instead of a switch, the largest component changes from joint to joint
+    const float x = largest == 0 ? d : a;
+    const float y = largest == 0 ? a : (largest == 1 ? d : b);
+    const float z = largest == 3 ? c : (largest == 2 ? d : b);
+    const float w = largest == 3 ? d : c;
+
+    return glm::quat(w, x, y, z);
+}
+
+// 16 bits per component between minimum and minimum + extent
+void
+EncodeRange(const glm::vec3& value,
+            const glm::vec3& minimum,
+            const glm::vec3& extent,
+            uint16_t* key)
+{
+    for (int i = 0; i < 3; ++i) {
+        const float unit = extent[i] > 0.0f ? (value[i] - minimum[i]) / extent[i] : 0.0f;
+        const float clamped = std::min(std::max(unit, 0.0f), 1.0f);
+        key[i] = static_cast<uint16_t>(std::floor(clamped * 65535.0f + 0.5f));
+    }
+}
+
+} // namespace
+
+void
+AnimationClip::Build(const JointPose* frames,
+                     size_t frameCount,
+                     size_t jointCount,
+                     float sampleRate,
+                     float tolerance)
+{
+    frameCount_ = frameCount;
+    sampleRate_ = sampleRate;
+
+    constantPose_.assign(frames, frames + (frameCount > 0 ? jointCount : 0));
+    rotationTracks_.clear();
+    translationTracks_.clear();
+    scaleTracks_.clear();
+    keys_.clear();
+
+    // Half angle cosine of a turn by tolerance radians
+    const float rotationTolerance = tolerance * tolerance / 8.0f;
+
+    for (size_t joint = 0; joint < constantPose_.size(); ++joint) {
+        const JointPose& first = constantPose_[joint];
+        glm::vec3 translationMin = first.translation, translationMax = first.translation;
+        glm::vec3 scaleMin = first.scale, scaleMax = first.scale;
+        bool rotationMoves = false;
+
+        for (size_t frame = 1; frame < frameCount; ++frame) {
+            const JointPose& pose = frames[frame * jointCount + joint];
+
+            const float cosine = std::abs(glm::dot(first.rotation, pose.rotation));
+
+            rotationMoves |= 1.0f - cosine > rotationTolerance;
+            translationMin = glm::min(translationMin, pose.translation);
+            translationMax = glm::max(translationMax, pose.translation);
+            scaleMin = glm::min(scaleMin, pose.scale);
+            scaleMax = glm::max(scaleMax, pose.scale);
+        }
+
+        const uint32_t track = static_cast<uint32_t>(joint);
+
+        if (rotationMoves)
+            rotationTracks_.push_back(track);
+        const glm::vec3 translationExtent = translationMax - translationMin;
+        const glm::vec3 scaleExtent = scaleMax - scaleMin;
+
+        if (glm::any(glm::greaterThan(translationExtent, glm::vec3(tolerance))))
+            translationTracks_.push_back(RangeTrack {track, translationMin, translationExtent});
+        if (glm::any(glm::greaterThan(scaleExtent, glm::vec3(tolerance))))
+            scaleTracks_.push_back(RangeTrack {track, scaleMin, scaleExtent});
+    }
+
+    keysPerFrame_ = 3 * (rotationTracks_.size() + translationTracks_.size() + scaleTracks_.size());
+    keys_.resize(keysPerFrame_ * frameCount);
+
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        const JointPose* pose = frames + frame * jointCount;
+        uint16_t* key = keys_.data() + frame * keysPerFrame_;
+
+        for (uint32_t joint : rotationTracks_) {
+            EncodeRotation(pose[joint].rotation, key);
+            key += 3;
+        }
+
+        for (const RangeTrack& track : translationTracks_) {
+            EncodeRange(pose[track.joint].translation, track.minimum, track.extent, key);
+            key += 3;
+        }
+
+        for (const RangeTrack& track : scaleTracks_) {
+            EncodeRange(pose[track.joint].scale, track.minimum, track.extent, key);
+            key += 3;
+        }
+    }
+}
+
+size_t
+AnimationClip::GetCompressedSize() const
+{
+    return keys_.size() * sizeof(uint16_t) + constantPose_.size() * sizeof(JointPose)
+           + rotationTracks_.size() * sizeof(uint32_t)
+           + (translationTracks_.size() + scaleTracks_.size()) * sizeof(RangeTrack);
+}
+
+void
+AnimationClip::Sample(float time, bool loop, JointPose* pose) const
+{
+    const float duration = GetDuration();
+
+    if (duration <= 0.0f) {
+        std::copy(constantPose_.begin(), constantPose_.end(), pose);
+        return;
+    }
+
+    if (loop) {
+        time = std::fmod(time, duration);
+        if (time < 0.0f)
+            time += duration;
+    } else {
+        time = std::min(std::max(time, 0.0f), duration);
+    }
+
+    const float frame = time * sampleRate_;
+    const size_t frame0 = std::min(static_cast<size_t>(frame), frameCount_ - 1);
+    const size_t frame1 = std::min(frame0 + 1, frameCount_ - 1);
+
+    SampleFrames(frame0, frame1, frame - static_cast<float>(frame0), pose);
+}
+
+void
+AnimationClip::SampleFrames(size_t frame0, size_t frame1, float alpha, JointPose* pose) const
+{
+    std::copy(constantPose_.begin(), constantPose_.end(), pose);
+
+    const uint16_t* key0 = keys_.data() + frame0 * keysPerFrame_;
+    const uint16_t* key1 = keys_.data() + frame1 * keysPerFrame_;
+    const float alpha0 = 1.0f - alpha;
+
+    for (uint32_t joint : rotationTracks_) {
+        const glm::quat from = DecodeRotation(key0);
+        const glm::quat to = DecodeRotation(key1);
+        const float toWeight = glm::dot(from, to) < 0.0f ? -alpha : alpha;
+
+        const glm::quat blended = from * alpha0 + to * toWeight;
+
+        pose[joint].rotation = blended * (1.0f / std::sqrt(glm::dot(blended, blended)));
+        key0 += 3;
+        key1 += 3;
+    }
+
+    // Lerp the quantized keys, one multiply add to dequantize
+    const float unit = 1.0f / 65535.0f;
+
+    for (const RangeTrack& track : translationTracks_) {
+        const glm::vec3 value = glm::vec3(key0[0], key0[1], key0[2]) * alpha0
+                                + glm::vec3(key1[0], key1[1], key1[2]) * alpha;
+
+        pose[track.joint].translation = track.minimum + track.extent * (value * unit);
+        key0 += 3;
+        key1 += 3;
+    }
+
+    for (const RangeTrack& track : scaleTracks_) {
+        const glm::vec3 value = glm::vec3(key0[0], key0[1], key0[2]) * alpha0
+                                + glm::vec3(key1[0], key1[1], key1[2]) * alpha;
+
+        pose[track.joint].scale = track.minimum + track.extent * (value * unit);
+        key0 += 3;
+        key1 += 3;
+    }
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Skeleton.h"
+
+// Keyframed joint poses at a fixed sample rate, compressed. Channels that do
+// not move are stored once, rotations are quantized to 48 bits (smallest three)
+// and translations and scales to 16 bits per component within the track's
+// range. The keys of one frame are adjacent, so sampling reads two short runs.
+class AnimationClip
+{
+public:
+    // frames holds frameCount * jointCount poses, frame major. A channel whose
+    // keys all stay within tolerance of the first is made constant.
+    void Build(const JointPose* frames,
+               size_t frameCount,
+               size_t jointCount,
+               float sampleRate,
+               float tolerance = 1e-4f);
+
+    size_t GetJointCount() const
+    {
+        return constantPose_.size();
+    }
+
+    // Seconds from the first frame to the last
+    float GetDuration() const
+    {
+        return frameCount_ > 1 ? (frameCount_ - 1) / sampleRate_ : 0.0f;
+    }
+
+    // Bytes of keys and track tables
+    size_t GetCompressedSize() const;
+
+    // Pose at time in seconds, keys blended linearly (rotations normalised).
+    // loop wraps time into the clip, otherwise it is clamped.
+    void Sample(float time, bool loop, JointPose* pose) const;
+
+private:
+    // Dequantization of one animated translation or scale track
+    struct RangeTrack
+    {
+        uint32_t joint;
+        glm::vec3 minimum;
+        glm::vec3 extent;
+    };
+
+    size_t frameCount_ {0};
+    float sampleRate_ {30.0f};
+
+    // Every joint's first frame, the animated channels are written over it
+    std::vector<JointPose> constantPose_;
+
+    std::vector<uint32_t> rotationTracks_;
+    std::vector<RangeTrack> translationTracks_;
+    std::vector<RangeTrack> scaleTracks_;
+
+    // Per frame: rotations, then translations, then scales, 3 values per track
+    std::vector<uint16_t> keys_;
+    size_t keysPerFrame_ {0};
+
+    void SampleFrames(size_t frame0, size_t frame1, float alpha, JointPose* pose) const;
+};
@@ -0,0 +1,131 @@
+﻿#include "AnimationSet.h"
+
+#include <algorithm>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <gtx/dual_quaternion.hpp>
+
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+AnimationSet::AnimationSet(const Skeleton& skeleton)
+    : skeleton_(skeleton)
+{
+}
+
+void
+AnimationSet::Resize(size_t count)
+{
+    baseClips_.resize(count, nullptr);
+    blendClips_.resize(count, nullptr);
+    blendWeights_.resize(count, 0.0f);
+    times_.resize(count, 0.0f);
+    speeds_.resize(count, 1.0f);
+
+    skinMatrices_.resize(count * GetJointCount(), glm::mat4(1.0f));
+    skinDualQuaternions_.resize(2 * count * GetJointCount(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void
+AnimationSet::SetClips(size_t character,
+                       const AnimationClip* base,
+                       const AnimationClip* blend,
+                       float blendWeight)
+{
+    baseClips_[character] = base;
+    blendClips_[character] = blend;
+    blendWeights_[character] = blendWeight;
+}
+
+void
+AnimationSet::Update(float timeStep, ThreadPool* pool)
+{
+    TRACE_SCOPE("AnimationSet::Update");
+
+    const size_t count = GetCount();
+
+    for (size_t i = 0; i < count; ++i)
+        times_[i] += timeStep * speeds_[i];
+
+    // A few tasks per thread evens out the load, every task has its own scratch
+    const size_t threadCount = pool != nullptr ? pool->GetThreadCount() : 1;
+    const size_t taskCount = threadCount > 1 ? std::max<size_t>(std::min(count, threadCount * 4), 1)
+                                             : 1;
+    const size_t charactersPerTask = (count + taskCount - 1) / taskCount;
+
+    if (scratch_.size() < taskCount)
+        scratch_.resize(taskCount);
+
+    auto runTask = [&](unsigned int task) {
+        Scratch& scratch = scratch_[task];
+        scratch.basePose.resize(GetJointCount());
+        scratch.blendPose.resize(GetJointCount());
+        scratch.models.resize(GetJointCount());
+
+        const size_t last = std::min((task + 1) * charactersPerTask, count);
+        for (size_t i = task * charactersPerTask; i < last; ++i)
+            UpdateCharacter(i, scratch);
+    };
+
+    if (taskCount > 1) {
+        pool->ParallelFor(static_cast<unsigned int>(taskCount), runTask);
+    } else {
+        runTask(0);
+    }
+}
+
+void
+AnimationSet::UpdateCharacter(size_t character, Scratch& scratch)
+{
+    const size_t jointCount = GetJointCount();
+    const AnimationClip* base = baseClips_[character];
+    const AnimationClip* blend = blendClips_[character];
+    // A missing clip leaves the other one at full weight
+    float weight = blendWeights_[character];
+    if (blend == nullptr)
+        weight = 0.0f;
+    else if (base == nullptr)
+        weight = 1.0f;
+    const JointPose* pose = scratch.basePose.data();
+
+    if (base != nullptr && weight < 1.0f) {
+        base->Sample(times_[character], true, scratch.basePose.data());
+    } else {
+        const JointPose* bindPose = skeleton_.GetBindPose();
+        std::copy(bindPose, bindPose + jointCount, scratch.basePose.begin());
+    }
+
+    // Only sample the second clip while it shows
+    if (weight > 0.0f) {
+        blend->Sample(times_[character], true, scratch.blendPose.data());
+
+        if (weight < 1.0f) {
+            Skeleton::BlendPoses(scratch.basePose.data(),
+                                 scratch.blendPose.data(),
+                                 weight,
+                                 jointCount,
+                                 scratch.basePose.data());
+        } else {
+            pose = scratch.blendPose.data();
+        }
+    }
+
+    glm::mat4* skin = skinMatrices_.data() + character * jointCount;
+    skeleton_.BuildSkinMatrices(pose, scratch.models.data(), skin);
+
+    if (mode_ != SkinningMode::DualQuaternion)
+        return;
+
+    // Rigid skin matrices: the rotation part is orthonormal
+    glm::vec4* dualQuaternions = skinDualQuaternions_.data() + 2 * character * jointCount;
+
+    for (size_t i = 0; i < jointCount; ++i) {
+        const glm::quat rotation = glm::normalize(glm::quat_cast(glm::mat3(skin[i])));
+        const glm::dualquat joint(rotation, glm::vec3(skin[i][3]));
+        const glm::quat& real = joint.real;
+        const glm::quat& dual = joint.dual;
+
+        dualQuaternions[2 * i] = glm::vec4(real.x, real.y, real.z, real.w);
+        dualQuaternions[2 * i + 1] = glm::vec4(dual.x, dual.y, dual.z, dual.w);
+    }
+}
@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <glm.hpp>
+
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
+class ThreadPool;
+
+// Characters sharing one skeleton, each playing a base clip blended with a
+// second one. Update samples, blends and builds the skinning data of every
+// character, spread over a thread pool, ready to upload as one block.
+class AnimationSet
+{
+public:
+    enum class SkinningMode
+    {
+        // Skin matrices only
+        LinearBlend,
+        // Skin matrices and dual quaternions, the joints must not scale
+        DualQuaternion
+    };
+
+    explicit AnimationSet(const Skeleton& skeleton);
+
+    // Added characters play nothing and stay in the bind pose
+    void Resize(size_t count);
+
+    size_t GetCount() const
+    {
+        return times_.size();
+    }
+
+    size_t GetJointCount() const
+    {
+        return skeleton_.GetJointCount();
+    }
+
+    // blendWeight 0 plays base only, 1 blend only. Either clip may be null,
+    // a clip must animate the skeleton's joints.
+    void SetClips(size_t character,
+                  const AnimationClip* base,
+                  const AnimationClip* blend,
+                  float blendWeight);
+
+    void SetBlendWeight(size_t character, float blendWeight)
+    {
+        blendWeights_[character] = blendWeight;
+    }
+
+    // Both clips run on the same clock, in seconds, and loop
+    void SetTime(size_t character, float time)
+    {
+        times_[character] = time;
+    }
+
+    void SetSpeed(size_t character, float speed)
+    {
+        speeds_[character] = speed;
+    }
+
+    void SetSkinningMode(SkinningMode mode)
+    {
+        mode_ = mode;
+    }
+
+    // Advances every clock by timeStep times its speed and rebuilds the
+    // skinning data. pool may be null.
+    void Update(float timeStep, ThreadPool* pool = nullptr);
+
+    // GetJointCount() matrices per character, characters one after another
+    const glm::mat4* GetSkinMatrices(size_t character = 0) const
+    {
+        return skinMatrices_.data() + character * GetJointCount();
+    }
+
+    // Real then dual part per joint, each (x, y, z, w), laid out like the skin
+    // matrices. Only written in DualQuaternion mode.
+    const glm::vec4* GetSkinDualQuaternions(size_t character = 0) const
+    {
+        return skinDualQuaternions_.data() + 2 * character * GetJointCount();
+    }
+
+private:
+    // Poses and model matrices of one character, one set per task of Update
+    struct Scratch
+    {
+        std::vector<JointPose> basePose;
+        std::vector<JointPose> blendPose;
+        std::vector<glm::mat4> models;
+    };
+
+    const Skeleton& skeleton_;
+    SkinningMode mode_ {SkinningMode::LinearBlend};
+
+    std::vector<const AnimationClip*> baseClips_;
+    std::vector<const AnimationClip*> blendClips_;
+    std::vector<float> blendWeights_;
+    std::vector<float> times_;
+    std::vector<float> speeds_;
+
+    std::vector<glm::mat4> skinMatrices_;
+    std::vector<glm::vec4> skinDualQuaternions_;
+
+    std::vector<Scratch> scratch_;
+
+    void UpdateCharacter(size_t character, Scratch& scratch);
+};
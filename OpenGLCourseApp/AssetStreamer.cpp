@@ -0,0 +1,426 @@
+﻿#include "AssetStreamer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+struct AssetStreamer::DecodedMesh
+{
+    Mesh* mesh {nullptr};
+
+    // Whichever one decoded the file owns the data below
+    MeshFile file;
+    MeshImporter importer;
+    std::vector<unsigned int> lodIndices;
+
+    const char* vertexData {nullptr};
+    GLsizeiptr vertexDataSize {0};
+    GLsizei vertexStride {0};
+    Mesh::VertexAttribute attributes[MeshFileHeader::maxAttributes];
+    unsigned int numOfAttributes {0};
+
+    const char* indexData {nullptr};
+    GLsizeiptr indexDataSize {0};
+    GLsizei numOfIndices {0};
+    GLenum indexType {GL_UNSIGNED_INT};
+    std::vector<Mesh::Lod> lods;
+    std::vector<Meshlet> meshlets;
+
+    glm::vec3 boundsMin {0.0f};
+    glm::vec3 boundsMax {0.0f};
+
+    // Bytes copied so far, vertex data first then index data
+    GLsizeiptr uploaded {0};
+    bool started {false};
+};
+
+namespace {
+
+// Fault the mapped pages in on the loader thread instead of during the copy
+void
+TouchPages(const char* data, size_t size)
+{
+    volatile char sink = 0;
+
+    for (size_t i = 0; i < size; i += 4096)
+        sink += data[i];
+}
+
+} // namespace
+
+AssetStreamer::AssetStreamer(unsigned int threadCount)
+{
+    workers_ = ThreadPool::StartThreads(threadCount, [this]() { WorkerLoop(); });
+}
+
+AssetStreamer::~AssetStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    condition_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+
+    ClearStreamer();
+}
+
+void
+AssetStreamer::RequestMesh(Mesh* mesh, const char* fileLocation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(MeshRequest {mesh, fileLocation});
+    }
+
+    condition_.notify_one();
+}
+
+size_t
+AssetStreamer::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return requests_.size() + decoding_ + decoded_.size() + uploading_.size();
+}
+
+void
+AssetStreamer::ClearStreamer()
+{
+    for (GLsync& fence : regionFences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (stagingBuffer_ != 0) {
+        glDeleteBuffers(1, &stagingBuffer_);
+        stagingBuffer_ = 0;
+    }
+
+    stagingRegionSize_ = 0;
+    stagingRegion_ = 0;
+    uploading_.clear();
+}
+
+void
+AssetStreamer::Update(size_t byteBudget)
+{
+    TRACE_SCOPE("AssetStreamer::Update");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        while (!decoded_.empty()) {
+            uploading_.push_back(std::move(decoded_.front()));
+            decoded_.pop_front();
+        }
+    }
+
+    if (uploading_.empty() || byteBudget == 0)
+        return;
+
+    if (stagingRegionSize_ != static_cast<GLsizeiptr>(byteBudget))
+        AllocateStaging(static_cast<GLsizeiptr>(byteBudget));
+
+    // The GPU may still be copying out of this region, try again next frame
+    // rather than stalling
+    GLsync& regionFence = regionFences_[stagingRegion_];
+
+    if (regionFence) {
+        GLenum result = glClientWaitSync(regionFence, 0, 0);
+
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return;
+
+        glDeleteSync(regionFence);
+        regionFence = nullptr;
+    }
+
+    const GLintptr regionOffset = stagingRegion_ * stagingRegionSize_;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer_);
+
+    // Unsynchronized: the region fence above already guarantees the GPU is done with it
+    char* staging = static_cast<char*>(glMapBufferRange(GL_COPY_READ_BUFFER,
+                                                        regionOffset,
+                                                        stagingRegionSize_,
+                                                        GL_MAP_WRITE_BIT
+                                                            | GL_MAP_INVALIDATE_RANGE_BIT
+                                                            | GL_MAP_UNSYNCHRONIZED_BIT));
+
+    if (!staging) {
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return;
+    }
+
+    struct Copy
+    {
+        GLuint buffer;
+        GLintptr readOffset;
+        GLintptr writeOffset;
+        GLsizeiptr size;
+    };
+
+    std::vector<Copy> copies;
+    std::vector<Mesh*> finished;
+    GLsizeiptr used = 0;
+
+    while (!uploading_.empty() && used < stagingRegionSize_) {
+        DecodedMesh& decoded = *uploading_.front();
+
+        if (!decoded.started)
+            BeginMesh(decoded);
+
+        const GLsizeiptr total = decoded.vertexDataSize + decoded.indexDataSize;
+
+        while (decoded.uploaded < total && used < stagingRegionSize_) {
+            const bool vertexPart = decoded.uploaded < decoded.vertexDataSize;
+            const GLsizeiptr partOffset = vertexPart ? decoded.uploaded
+                                                     : decoded.uploaded - decoded.vertexDataSize;
+            const GLsizeiptr partSize = vertexPart ? decoded.vertexDataSize
+                                                   : decoded.indexDataSize;
+            const GLsizeiptr size = std::min(partSize - partOffset, stagingRegionSize_ - used);
+            const char* source = vertexPart ? decoded.vertexData : decoded.indexData;
+
+            memcpy(staging + used, source + partOffset, size);
+
+            copies.push_back(Copy {vertexPart ? decoded.mesh->GetVertexBuffer()
+                                              : decoded.mesh->GetIndexBuffer(),
+                                   regionOffset + used,
+                                   partOffset,
+                                   size});
+
+            used += size;
+            decoded.uploaded += size;
+        }
+
+        if (decoded.uploaded < total)
+            break;
+
+        // Everything is in staging, the CPU copy can go
+        finished.push_back(decoded.mesh);
+        uploading_.pop_front();
+    }
+
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+    for (const Copy& copy : copies) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                            GL_COPY_WRITE_BUFFER,
+                            copy.readOffset,
+                            copy.writeOffset,
+                            copy.size);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    for (Mesh* mesh : finished)
+        mesh->EndUpload(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    regionFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stagingRegion_ = (stagingRegion_ + 1) % stagingRegions;
+}
+
+void
+AssetStreamer::WorkerLoop()
+{
+    TRACE_THREAD_NAME("Asset loader");
+
+    for (;;) {
+        MeshRequest request;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+
+            if (stopping_)
+                return;
+
+            request = std::move(requests_.front());
+            requests_.pop_front();
+            ++decoding_;
+        }
+
+        std::unique_ptr<DecodedMesh> decoded;
+        {
+            TRACE_SCOPE("AssetStreamer::Decode");
+            decoded = Decode(request);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --decoding_;
+
+        if (decoded)
+            decoded_.push_back(std::move(decoded));
+    }
+}
+
+std::unique_ptr<AssetStreamer::DecodedMesh>
+AssetStreamer::Decode(const MeshRequest& request)
+{
+    std::unique_ptr<DecodedMesh> decoded(new DecodedMesh());
+    decoded->mesh = request.mesh;
+
+    const char* fileLocation = request.fileLocation.c_str();
+    const char* extension = strrchr(fileLocation, '.');
+
+    if (extension && (strcmp(extension, ".obj") == 0 || strcmp(extension, ".ply") == 0)) {
+        MeshImporter& importer = decoded->importer;
+
+        // Already running on a pool thread
+        importer.SetThreadCount(1);
+
+        if (!importer.Import(fileLocation))
+            return nullptr;
+
+        decoded->vertexData = reinterpret_cast<const char*>(importer.GetVertices().data());
+        decoded->vertexDataSize = sizeof(GLfloat) * importer.GetVertices().size();
+        decoded->vertexStride = sizeof(GLfloat) * importer.GetStride();
+        decoded->numOfAttributes = importer.GetAttributes(decoded->attributes);
+
+        // Simplification is the expensive part, keep it on the loader thread
+        std::vector<unsigned int>& lodIndices = decoded->lodIndices;
+        MeshSimplifier::BuildLodChain(importer.GetVertices(),
+                                      importer.GetStride(),
+                                      importer.GetIndices(),
+                                      MeshFileHeader::maxLods,
+                                      lodIndices,
+                                      decoded->lods);
+
+        if (decoded->lods[0].indexCount / 3 >= static_cast<GLsizei>(MeshletBuilder::minTriangles)) {
+            decoded->meshlets = MeshletBuilder::Build(importer.GetVertices(),
+                                                      importer.GetStride(),
+                                                      lodIndices.data(),
+                                                      decoded->lods[0].indexCount);
+        }
+
+        decoded->indexData = reinterpret_cast<const char*>(lodIndices.data());
+        decoded->numOfIndices = static_cast<GLsizei>(lodIndices.size());
+        decoded->indexDataSize = sizeof(unsigned int) * lodIndices.size();
+        decoded->indexType = GL_UNSIGNED_INT;
+
+        decoded->boundsMin = importer.GetBoundsMin();
+        decoded->boundsMax = importer.GetBoundsMax();
+
+        return decoded;
+    }
+
+    MeshFile& file = decoded->file;
+
+    if (!file.Open(fileLocation))
+        return nullptr;
+
+    const MeshFileHeader& header = file.GetHeader();
+
+    decoded->vertexData = static_cast<const char*>(file.GetVertexData());
+    decoded->vertexDataSize = static_cast<GLsizeiptr>(header.vertexDataSize);
+    decoded->vertexStride = header.vertexStride;
+    decoded->numOfAttributes = header.attributeCount;
+
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        decoded->attributes[i].location = header.attributes[i].location;
+        decoded->attributes[i].components = header.attributes[i].components;
+        decoded->attributes[i].type = header.attributes[i].type;
+        decoded->attributes[i].normalized = header.attributes[i].normalized ? GL_TRUE : GL_FALSE;
+        decoded->attributes[i].offset = header.attributes[i].offset;
+    }
+
+    const uint64_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    decoded->indexData = static_cast<const char*>(file.GetIndexData());
+    decoded->indexDataSize = static_cast<GLsizeiptr>(header.indexDataSize);
+    decoded->numOfIndices = static_cast<GLsizei>(header.indexDataSize / indexSize);
+    decoded->indexType = header.indexType;
+
+    decoded->lods.resize(header.lodCount);
+    for (uint32_t i = 0; i < header.lodCount; ++i) {
+        decoded->lods[i].firstIndex = static_cast<GLsizei>(header.lods[i].firstIndex);
+        decoded->lods[i].indexCount = static_cast<GLsizei>(header.lods[i].indexCount);
+        decoded->lods[i].error = header.lods[i].error;
+    }
+
+    decoded->boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    decoded->boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    TouchPages(decoded->vertexData, header.vertexDataSize);
+    TouchPages(decoded->indexData, header.indexDataSize);
+
+    return decoded;
+}
+
+void
+AssetStreamer::AllocateStaging(GLsizeiptr regionSize)
+{
+    for (GLsync& fence : regionFences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (stagingBuffer_ == 0)
+        glGenBuffers(1, &stagingBuffer_);
+
+    // Re-specifying the store orphans the old one, in-flight copies keep reading it
+    glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer_);
+    glBufferData(GL_COPY_READ_BUFFER, regionSize * stagingRegions, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    stagingRegionSize_ = regionSize;
+    stagingRegion_ = 0;
+}
+
+void
+AssetStreamer::BeginMesh(DecodedMesh& decoded)
+{
+    Mesh* mesh = decoded.mesh;
+
+    // Storage only, filled by the staging copies
+    mesh->ClearMesh();
+    mesh->CreateMesh(nullptr,
+                     decoded.vertexDataSize,
+                     decoded.vertexStride,
+                     decoded.attributes,
+                     decoded.numOfAttributes,
+                     nullptr,
+                     decoded.numOfIndices,
+                     decoded.indexType);
+    mesh->SetLods(decoded.lods);
+    mesh->SetMeshlets(decoded.meshlets);
+    mesh->SetBounds(decoded.boundsMin, decoded.boundsMax);
+
+    if (mesh->IsPickable()) {
+        for (unsigned int i = 0; i < decoded.numOfAttributes; ++i) {
+            if (decoded.attributes[i].location == 0 && decoded.attributes[i].type == GL_FLOAT
+                && decoded.attributes[i].components >= 3) {
+                mesh->SetPickingGeometry(decoded.vertexData,
+                                         decoded.vertexDataSize,
+                                         decoded.vertexStride,
+                                         decoded.attributes[i].offset,
+                                         decoded.indexData,
+                                         decoded.numOfIndices,
+                                         decoded.indexType);
+                break;
+            }
+        }
+    }
+
+    mesh->BeginUpload();
+
+    decoded.started = true;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+class Mesh;
+
+// Background asset loading.
+//
+// Loader threads read and decode files (.oglm, .obj, .ply). Once per frame the
+// GL thread calls Update(), which copies decoded data into the destination
+// buffers through a ring of unsynchronized staging buffer regions, at most
+// byteBudget bytes per frame. A mesh becomes renderable once the fence after
+// its last copy has signalled (Mesh::IsReady).
+class AssetStreamer
+{
+public:
+    // 0 uses every hardware thread but one
+    explicit AssetStreamer(unsigned int threadCount = 0);
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // The mesh must stay alive until it IsReady() or the streamer is destroyed
+    void RequestMesh(Mesh* mesh, const char* fileLocation);
+
+    // GL thread only, once per frame
+    void Update(size_t byteBudget = 8 * 1024 * 1024);
+
+    // Requests not yet renderable (decoding or uploading)
+    size_t GetPendingCount();
+
+    // Releases GL objects, needs the context current
+    void ClearStreamer();
+
+private:
+    struct MeshRequest
+    {
+        Mesh* mesh;
+        std::string fileLocation;
+    };
+
+    struct DecodedMesh;
+
+    // One staging region per frame in flight
+    static const unsigned int stagingRegions = 3;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<MeshRequest> requests_;
+    std::deque<std::unique_ptr<DecodedMesh>> decoded_;
+    size_t decoding_ {0};
+    bool stopping_ {false};
+
+    // GL thread only
+    std::deque<std::unique_ptr<DecodedMesh>> uploading_;
+    GLuint stagingBuffer_ {0};
+    GLsizeiptr stagingRegionSize_ {0};
+    unsigned int stagingRegion_ {0};
+    GLsync regionFences_[stagingRegions] {nullptr, nullptr, nullptr};
+
+    void WorkerLoop();
+    static std::unique_ptr<DecodedMesh> Decode(const MeshRequest& request);
+
+    void AllocateStaging(GLsizeiptr regionSize);
+    void BeginMesh(DecodedMesh& decoded);
+};
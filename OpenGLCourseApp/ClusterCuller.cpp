@@ -0,0 +1,206 @@
+﻿#include "ClusterCuller.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTER_CULLER_SSE2 1
+#endif
+
+#include "ThreadPool.h"
+
+ClusterCuller::ClusterCuller() {}
+
+ClusterCuller::~ClusterCuller()
+{
+    ClearCuller();
+}
+
+void
+ClusterCuller::SetMeshlets(const std::vector<Meshlet>& meshlets)
+{
+    clusterCount_ = meshlets.size();
+    visibleCount_ = 0;
+
+    const size_t padded = (clusterCount_ + 3) & ~size_t(3);
+
+    // Padding sits far behind every plane with no radius
+    centerX_.assign(padded, 0.0f);
+    centerY_.assign(padded, 0.0f);
+    centerZ_.assign(padded, 0.0f);
+    radius_.assign(padded, -1e30f);
+    axisX_.assign(padded, 0.0f);
+    axisY_.assign(padded, 0.0f);
+    axisZ_.assign(padded, 1.0f);
+    cutoff_.assign(padded, 1.0f);
+    firstIndex_.assign(padded, 0);
+    indexCount_.assign(padded, 0);
+    visible_.assign(padded, 0);
+
+    for (size_t i = 0; i < clusterCount_; ++i) {
+        const Meshlet& meshlet = meshlets[i];
+
+        centerX_[i] = meshlet.center.x;
+        centerY_[i] = meshlet.center.y;
+        centerZ_[i] = meshlet.center.z;
+        radius_[i] = meshlet.radius;
+        axisX_[i] = meshlet.coneAxis.x;
+        axisY_[i] = meshlet.coneAxis.y;
+        axisZ_[i] = meshlet.coneAxis.z;
+        cutoff_[i] = meshlet.coneCutoff;
+        firstIndex_[i] = meshlet.firstIndex;
+        indexCount_[i] = meshlet.indexCount;
+    }
+}
+
+void
+ClusterCuller::ClearCuller()
+{
+    clusterCount_ = 0;
+    visibleCount_ = 0;
+
+    centerX_.clear();
+    centerY_.clear();
+    centerZ_.clear();
+    radius_.clear();
+    axisX_.clear();
+    axisY_.clear();
+    axisZ_.clear();
+    cutoff_.clear();
+    firstIndex_.clear();
+    indexCount_.clear();
+    visible_.clear();
+}
+
+void
+ClusterCuller::Cull(const glm::mat4& modelView,
+                    const glm::mat4& projection,
+                    GLsizeiptr indexSize,
+                    std::vector<GLsizei>& counts,
+                    std::vector<const void*>& offsets,
+                    ThreadPool* pool)
+{
+    counts.clear();
+    offsets.clear();
+    visibleCount_ = 0;
+
+    if (clusterCount_ == 0)
+        return;
+
+    // Gribb/Hartmann planes of the object space frustum, normalized so the
+    // plane distance compares against the object space radius
+    const glm::mat4 clip = projection * modelView;
+    const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    glm::vec4 planes[6] = {
+        row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    const glm::vec3 camera(glm::inverse(modelView)[3]);
+
+    const size_t padded = centerX_.size();
+    const size_t jobCount = (padded + clustersPerJob - 1) / clustersPerJob;
+
+    if (pool && jobCount > 1) {
+        pool->ParallelFor(static_cast<unsigned int>(jobCount), [&](unsigned int job) {
+            const size_t begin = job * clustersPerJob;
+            CullRange(planes, camera, begin, std::min(begin + clustersPerJob, padded));
+        });
+    } else {
+        CullRange(planes, camera, 0, padded);
+    }
+
+    // Clusters are consecutive in the index buffer, runs of visible ones are one draw
+    for (size_t i = 0; i < clusterCount_; ++i) {
+        if (!visible_[i])
+            continue;
+
+        ++visibleCount_;
+
+        if (i > 0 && visible_[i - 1]) {
+            counts.back() += indexCount_[i];
+            continue;
+        }
+
+        counts.push_back(indexCount_[i]);
+        offsets.push_back(reinterpret_cast<const void*>(
+            static_cast<uintptr_t>(indexSize * firstIndex_[i])));
+    }
+}
+
+void
+ClusterCuller::CullRange(const glm::vec4* planes, const glm::vec3& camera, size_t begin, size_t end)
+{
+#ifdef CLUSTER_CULLER_SSE2
+    const __m128 cameraX = _mm_set1_ps(camera.x);
+    const __m128 cameraY = _mm_set1_ps(camera.y);
+    const __m128 cameraZ = _mm_set1_ps(camera.z);
+
+    for (size_t i = begin; i < end; i += 4) {
+        const __m128 x = _mm_loadu_ps(&centerX_[i]);
+        const __m128 y = _mm_loadu_ps(&centerY_[i]);
+        const __m128 z = _mm_loadu_ps(&centerZ_[i]);
+        const __m128 radius = _mm_loadu_ps(&radius_[i]);
+        const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        // Inside or touching every plane
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (unsigned int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p].x)),
+                                         _mm_mul_ps(y, _mm_set1_ps(planes[p].y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(planes[p].z)));
+            distance = _mm_add_ps(distance, _mm_set1_ps(planes[p].w));
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        // Backfacing when dot(center - camera, axis) >= cutoff * |center - camera| + radius
+        const __m128 dx = _mm_sub_ps(x, cameraX);
+        const __m128 dy = _mm_sub_ps(y, cameraY);
+        const __m128 dz = _mm_sub_ps(z, cameraZ);
+
+        __m128 along = _mm_mul_ps(dx, _mm_loadu_ps(&axisX_[i]));
+        along = _mm_add_ps(along, _mm_mul_ps(dy, _mm_loadu_ps(&axisY_[i])));
+        along = _mm_add_ps(along, _mm_mul_ps(dz, _mm_loadu_ps(&axisZ_[i])));
+
+        __m128 length = _mm_mul_ps(dx, dx);
+        length = _mm_add_ps(length, _mm_mul_ps(dy, dy));
+        length = _mm_add_ps(length, _mm_mul_ps(dz, dz));
+        length = _mm_sqrt_ps(length);
+
+        const __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff_[i]), length), radius);
+        visible = _mm_and_ps(visible, _mm_cmplt_ps(along, limit));
+
+        const int mask = _mm_movemask_ps(visible);
+
+        visible_[i] = mask & 1;
+        visible_[i + 1] = (mask >> 1) & 1;
+        visible_[i + 2] = (mask >> 2) & 1;
+        visible_[i + 3] = (mask >> 3) & 1;
+    }
+#else
+    for (size_t i = begin; i < end; ++i) {
+        const glm::vec3 center(centerX_[i], centerY_[i], centerZ_[i]);
+        bool visible = true;
+
+        for (unsigned int p = 0; p < 6 && visible; ++p)
+            visible = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius_[i];
+
+        const glm::vec3 toCenter = center - camera;
+        const glm::vec3 axis(axisX_[i], axisY_[i], axisZ_[i]);
+
+        if (visible
+            && glm::dot(toCenter, axis) >= cutoff_[i] * glm::length(toCenter) + radius_[i]) {
+            visible = false;
+        }
+
+        visible_[i] = visible;
+    }
+#endif
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "MeshletBuilder.h"
+
+class ThreadPool;
+
+// Frustum and normal cone culling of meshlets on the CPU.
+//
+// Bounds are kept as structure of arrays so four clusters are tested per SSE
+// instruction. Everything happens in object space: the frustum planes and the
+// camera position are moved there once per call instead of moving every cluster.
+class ClusterCuller
+{
+public:
+    ClusterCuller();
+    ~ClusterCuller();
+
+    void SetMeshlets(const std::vector<Meshlet>& meshlets);
+    void ClearCuller();
+
+    size_t GetClusterCount() const
+    {
+        return clusterCount_;
+    }
+    size_t GetVisibleCount() const
+    {
+        return visibleCount_;
+    }
+
+    // Fills glMultiDrawElements arguments for the visible clusters, neighbouring
+    // clusters are merged into one draw. indexSize is in bytes. Spreads over the
+    // pool when there are enough clusters, pool may be null.
+    void Cull(const glm::mat4& modelView,
+              const glm::mat4& projection,
+              GLsizeiptr indexSize,
+              std::vector<GLsizei>& counts,
+              std::vector<const void*>& offsets,
+              ThreadPool* pool = nullptr);
+
+private:
+    // Clusters per pool job
+    static const size_t clustersPerJob = 4096;
+
+    size_t clusterCount_ {0};
+    size_t visibleCount_ {0};
+
+    // Padded to a multiple of 4 with clusters that are never visible
+    std::vector<float> centerX_, centerY_, centerZ_, radius_;
+    std::vector<float> axisX_, axisY_, axisZ_, cutoff_;
+    std::vector<GLsizei> firstIndex_, indexCount_;
+
+    std::vector<unsigned char> visible_;
+
+    void CullRange(const glm::vec4* planes, const glm::vec3& camera, size_t begin, size_t end);
+};
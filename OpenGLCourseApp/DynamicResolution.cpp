@@ -0,0 +1,217 @@
+﻿#include "DynamicResolution.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution()
+    : DynamicResolution(Settings())
+{}
+
+DynamicResolution::DynamicResolution(const Settings& settings, unsigned int framesInFlight)
+    : settings_(settings)
+    , slots_(std::max(framesInFlight, 2u))
+{
+    settings_.minScale = std::min(settings_.minScale, settings_.maxScale);
+    scale_ = Quantize(settings_.maxScale);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    for (QuerySlot& slot : slots_) {
+        if (slot.query != 0)
+            glDeleteQueries(1, &slot.query);
+    }
+}
+
+void
+DynamicResolution::BeginFrame()
+{
+    Collect();
+
+    QuerySlot& slot = slots_[frame_ % slots_.size()];
+
+    // Still not done a full ring later, reusing the query must not wait
+    if (slot.pending) {
+        slot.pending = false;
+        ++droppedFrames_;
+    }
+
+    if (slot.query == 0)
+        glGenQueries(1, &slot.query);
+
+    slot.frame = frame_;
+    slot.scale = scale_;
+    glBeginQuery(GL_TIME_ELAPSED, slot.query);
+    timing_ = true;
+}
+
+void
+DynamicResolution::EndFrame()
+{
+    if (!timing_)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    slots_[frame_ % slots_.size()].pending = true;
+    timing_ = false;
+    ++frame_;
+}
+
+bool
+DynamicResolution::AddMeasurement(unsigned long long frame, float renderedScale, double gpuSeconds)
+{
+    // Frames in flight when the scale changed
+    if (renderedScale != scale_)
+        return false;
+
+    if (smoothedSeconds_ == 0.0)
+        smoothedSeconds_ = gpuSeconds;
+    else
+        smoothedSeconds_ += settings_.smoothing * (gpuSeconds - smoothedSeconds_);
+
+    const double budget = settings_.budgetSeconds;
+
+    if (gpuSeconds > budget * settings_.upperThreshold) {
+        runSeconds_ = framesAbove_ == 0 ? gpuSeconds : std::min(runSeconds_, gpuSeconds);
+        ++framesAbove_;
+        framesBelow_ = 0;
+    } else if (gpuSeconds < budget * settings_.lowerThreshold) {
+        runSeconds_ = framesBelow_ == 0 ? gpuSeconds : std::max(runSeconds_, gpuSeconds);
+        ++framesBelow_;
+        framesAbove_ = 0;
+    } else {
+        ResetRun();
+        return false;
+    }
+
+    const bool down = framesAbove_ >= settings_.downFrames;
+    const bool up = framesBelow_ >= settings_.upFrames;
+
+    if (!down && !up)
+        return false;
+
+    // The scale that would land in the middle of the band
+    const double target = budget * 0.5 * (settings_.lowerThreshold + settings_.upperThreshold);
+    const double ratio = target / std::max(runSeconds_, 1e-9);
+    const float wanted = scale_ * static_cast<float>(std::sqrt(ratio));
+    float next = scale_;
+
+    if (down) {
+        next = std::min(Quantize(wanted), Quantize(scale_ - settings_.scaleStep));
+    } else {
+        const float largest = scale_ + settings_.maxUpSteps * settings_.scaleStep;
+        next = std::max(Quantize(std::min(wanted, largest)),
+                        Quantize(scale_ + settings_.scaleStep));
+    }
+
+    if (next == scale_) {
+        // At a limit, start counting again
+        ResetRun();
+        return false;
+    }
+
+    SetScale(frame, next);
+
+    return true;
+}
+
+void
+DynamicResolution::GetScaledSize(GLsizei width,
+                                 GLsizei height,
+                                 GLsizei& scaledWidth,
+                                 GLsizei& scaledHeight) const
+{
+    scaledWidth = std::max(static_cast<GLsizei>(std::lround(width * scale_)), 1);
+    scaledHeight = std::max(static_cast<GLsizei>(std::lround(height * scale_)), 1);
+}
+
+bool
+DynamicResolution::WriteLog(const char* fileLocation) const
+{
+    FILE* file = fopen(fileLocation, "w");
+
+    if (file == nullptr) {
+        printf("Failed to write %s\n", fileLocation);
+        return false;
+    }
+
+    fprintf(file, "frame,gpu_ms,from_scale,to_scale\n");
+
+    for (const Decision& decision : decisions_) {
+        fprintf(file,
+                "%llu,%.3f,%.4f,%.4f\n",
+                decision.frame,
+                decision.gpuSeconds * 1000.0,
+                decision.fromScale,
+                decision.toScale);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+void
+DynamicResolution::Collect()
+{
+    // Oldest first, the GPU finishes frames in order
+    const unsigned long long oldest = frame_ >= slots_.size() ? frame_ - slots_.size() : 0;
+
+    for (unsigned long long frame = oldest; frame < frame_; ++frame) {
+        QuerySlot& slot = slots_[frame % slots_.size()];
+
+        if (!slot.pending || slot.frame != frame)
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+            break;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &nanoseconds);
+        slot.pending = false;
+
+        AddMeasurement(slot.frame, slot.scale, nanoseconds * 1e-9);
+    }
+}
+
+float
+DynamicResolution::Quantize(float scale) const
+{
+    // The epsilon keeps exact multiples from rounding down a step
+    const float steps = std::floor(scale / settings_.scaleStep + 1e-3f);
+
+    return std::min(std::max(steps * settings_.scaleStep, settings_.minScale), settings_.maxScale);
+}
+
+void
+DynamicResolution::SetScale(unsigned long long frame, float scale)
+{
+    const Decision decision {frame, runSeconds_, scale_, scale};
+    decisions_.push_back(decision);
+
+    if (settings_.printDecisions) {
+        printf("Frame %llu: GPU %.2f ms of %.2f ms, resolution scale %.3f -> %.3f\n",
+               frame,
+               runSeconds_ * 1000.0,
+               settings_.budgetSeconds * 1000.0,
+               scale_,
+               scale);
+    }
+
+    scale_ = scale;
+    smoothedSeconds_ = 0.0;
+    ResetRun();
+}
+
+void
+DynamicResolution::ResetRun()
+{
+    framesAbove_ = 0;
+    framesBelow_ = 0;
+    runSeconds_ = 0.0;
+}
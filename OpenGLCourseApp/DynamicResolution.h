@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <GL/glew.h>
+
+// Dynamic resolution: a render scale that keeps the GPU time of the scaled
+// work (the offscreen scene, see Framebuffer::SetRenderSize) within a budget.
+//
+// BeginFrame and EndFrame wrap that work in a GL_TIME_ELAPSED query. The
+// queries of the last framesInFlight frames live in a ring and are only read
+// once available, so results arrive a few frames late and nothing waits for
+// the GPU. Each result goes through AddMeasurement. GPU time is taken to grow
+// with the pixel count, the square of the scale.
+//
+// Hysteresis: nothing changes while measurements sit between the lower and
+// upper thresholds. Scaling down takes downFrames measurements in a row above
+// the band, scaling up upFrames below it and at most maxUpSteps steps at a
+// time; a single spike changes nothing. The new scale comes from the run's
+// measurement closest to the band, and measurements of frames rendered at an
+// older scale are dropped. Scales are multiples of scaleStep. Every change is
+// printed and kept for WriteLog.
+class DynamicResolution
+{
+public:
+    struct Settings
+    {
+        double budgetSeconds {1.0 / 60.0};
+        float minScale {0.5f};
+        float maxScale {1.0f};
+        float scaleStep {1.0f / 32.0f};
+
+        // Fractions of the budget; a change aims between the two
+        double lowerThreshold {0.75};
+        double upperThreshold {0.95};
+
+        unsigned int downFrames {3};
+        unsigned int upFrames {30};
+        unsigned int maxUpSteps {2};
+
+        // Weight of each new measurement in the smoothed time (reporting only)
+        double smoothing {0.25};
+
+        bool printDecisions {true};
+    };
+
+    struct Decision
+    {
+        unsigned long long frame;
+        // The run's GPU seconds that led to the change
+        double gpuSeconds;
+        float fromScale;
+        float toScale;
+    };
+
+    DynamicResolution();
+    explicit DynamicResolution(const Settings& settings, unsigned int framesInFlight = 4);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Around the work that scales, once per frame. Collects finished
+    // queries, and may change the scale, in BeginFrame.
+    void BeginFrame();
+    void EndFrame();
+
+    // The GPU time of frame (for the log), rendered at renderedScale;
+    // returns whether the scale changed. Called with the query results, or
+    // directly without GL.
+    bool AddMeasurement(unsigned long long frame, float renderedScale, double gpuSeconds);
+
+    float GetScale() const
+    {
+        return scale_;
+    }
+
+    // width by height scaled, at least 1 by 1
+    void GetScaledSize(GLsizei width,
+                       GLsizei height,
+                       GLsizei& scaledWidth,
+                       GLsizei& scaledHeight) const;
+
+    // Smoothed GPU seconds, 0 until a measurement arrives
+    double GetGpuSeconds() const
+    {
+        return smoothedSeconds_;
+    }
+
+    const std::vector<Decision>& GetDecisions() const
+    {
+        return decisions_;
+    }
+
+    // Frames whose query was still pending when its slot came round again
+    unsigned long long GetDroppedFrames() const
+    {
+        return droppedFrames_;
+    }
+
+    // The decisions as CSV: frame, the run's GPU ms, old and new scale
+    bool WriteLog(const char* fileLocation) const;
+
+private:
+    struct QuerySlot
+    {
+        GLuint query {0};
+        unsigned long long frame {0};
+        float scale {1.0f};
+        bool pending {false};
+    };
+
+    Settings settings_;
+    std::vector<QuerySlot> slots_;
+
+    float scale_;
+    unsigned long long frame_ {0};
+    unsigned long long droppedFrames_ {0};
+    bool timing_ {false};
+
+    double smoothedSeconds_ {0.0};
+    unsigned int framesAbove_ {0};
+    unsigned int framesBelow_ {0};
+    // Lowest time of the current run above the band, highest below it
+    double runSeconds_ {0.0};
+
+    std::vector<Decision> decisions_;
+
+    void Collect();
+    // Rounds down to a step, within the limits
+    float Quantize(float scale) const;
+    void SetScale(unsigned long long frame, float scale);
+    void ResetRun();
+};
@@ -0,0 +1,419 @@
+﻿#include "FrameCapture.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "GlStats.h"
+#include "Tracing.h"
+
+namespace {
+
+double
+Seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+FrameCapture::FrameCapture(unsigned int bufferCount)
+    : slots_(std::max(bufferCount, 2u))
+{
+    worker_ = std::thread(&FrameCapture::WorkerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    Finish();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    condition_.notify_all();
+    worker_.join();
+
+    ClearCapture();
+
+    if (VAO_ != 0)
+        glDeleteVertexArrays(1, &VAO_);
+}
+
+void
+FrameCapture::CreateFromFiles(const char* vertexLocation, const char* fragmentLocation)
+{
+    shader_.CreateFromFiles(vertexLocation, fragmentLocation);
+
+    uniformPlane_ = shader_.GetUniformLocation("plane");
+    uniformSize_ = shader_.GetUniformLocation("captureSize");
+    uniformLumaWeights_ = shader_.GetUniformLocation("lumaWeights");
+    uniformRange_ = shader_.GetUniformLocation("codeRange");
+
+    shader_.UseShader();
+    glUniform1i(shader_.GetUniformLocation("captureTexture"), 0);
+    Shader::UnUseShader();
+
+    // The quad comes from gl_VertexID, but core profile draws need a vertex array
+    if (VAO_ == 0)
+        glGenVertexArrays(1, &VAO_);
+}
+
+bool
+FrameCapture::CreateCapture(int width,
+                            int height,
+                            Format format,
+                            const Consumer& consumer,
+                            ColorMatrix matrix,
+                            ColorRange range)
+{
+    TRACE_SCOPE("FrameCapture::CreateCapture");
+
+    Finish();
+    ClearCapture();
+
+    if (format == Format::NV12 && VAO_ == 0) {
+        printf("NV12 capture needs the conversion shader, see CreateFromFiles!\n");
+        return false;
+    }
+
+    if (!colorTarget_.CreateFramebuffer(width, height, 0, GL_RGBA8, 0))
+        return false;
+
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    matrix_ = matrix;
+    range_ = range;
+    consumer_ = consumer;
+    frameSize_ = static_cast<size_t>(width) * height * 4;
+
+    if (format == Format::NV12) {
+        frameSize_ = VideoFrame::GetFrameSize(VideoFormat::NV12, width, height);
+
+        if (!lumaTarget_.CreateFramebuffer(width, height, 0, GL_R8, 0)
+            || !chromaTarget_.CreateFramebuffer(VideoFrame::GetPlaneWidth(VideoFormat::NV12,
+                                                                          width,
+                                                                          1),
+                                                VideoFrame::GetPlaneHeight(VideoFormat::NV12,
+                                                                           height,
+                                                                           1),
+                                                0,
+                                                GL_RG8,
+                                                0)) {
+            ClearCapture();
+            return false;
+        }
+    }
+
+    for (Slot& slot : slots_) {
+        glGenBuffers(1, &slot.PBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize_, nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
+
+bool
+FrameCapture::Capture(GLuint readFramebuffer, GLsizei sourceWidth, GLsizei sourceHeight)
+{
+    TRACE_SCOPE("FrameCapture::Capture");
+
+    if (slots_[0].PBO == 0)
+        return false;
+
+    const double start = Seconds();
+
+    Collect(false);
+
+    Slot& slot = slots_[next_];
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (slot.state != SlotState::Free) {
+            ++stats_.droppedFrames;
+            return false;
+        }
+    }
+
+    GLint drawBinding = 0, readBinding = 0, viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawBinding);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readBinding);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Both would clip or mix into the copies below
+    const GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_BLEND);
+
+    // Flipped so rows come back top down, scaled when the sizes differ
+    const bool sameSize = sourceWidth == width_ && sourceHeight == height_;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorTarget_.GetID());
+    glBlitFramebuffer(0,
+                      0,
+                      sourceWidth,
+                      sourceHeight,
+                      0,
+                      height_,
+                      width_,
+                      0,
+                      GL_COLOR_BUFFER_BIT,
+                      sameSize ? GL_NEAREST : GL_LINEAR);
+
+    if (format_ == Format::NV12)
+        ConvertToNv12();
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+
+    if (format_ == Format::NV12) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, lumaTarget_.GetID());
+        glReadPixels(0, 0, width_, height_, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, chromaTarget_.GetID());
+        glReadPixels(0,
+                     0,
+                     chromaTarget_.GetWidth(),
+                     chromaTarget_.GetHeight(),
+                     GL_RG,
+                     GL_UNSIGNED_BYTE,
+                     reinterpret_cast<void*>(static_cast<size_t>(width_) * height_));
+    } else {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, colorTarget_.GetID());
+        glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame_++;
+    next_ = (next_ + 1) % slots_.size();
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawBinding);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readBinding);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (scissor)
+        glEnable(GL_SCISSOR_TEST);
+    if (blend)
+        glEnable(GL_BLEND);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot.state = SlotState::Reading;
+    ++stats_.capturedFrames;
+    stats_.readBytes += frameSize_;
+    stats_.captureSeconds += Seconds() - start;
+
+    return true;
+}
+
+void
+FrameCapture::Finish()
+{
+    TRACE_SCOPE("FrameCapture::Finish");
+
+    Collect(true);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() {
+            return std::none_of(slots_.begin(), slots_.end(), [](const Slot& slot) {
+                return slot.state == SlotState::Consuming;
+            });
+        });
+    }
+
+    Collect(false);
+}
+
+FrameCapture::Stats
+FrameCapture::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void
+FrameCapture::ClearCapture()
+{
+    for (Slot& slot : slots_) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        if (slot.PBO != 0) {
+            glDeleteBuffers(1, &slot.PBO);
+            slot.PBO = 0;
+        }
+
+        slot.mapped = nullptr;
+        slot.state = SlotState::Free;
+    }
+
+    colorTarget_.ClearFramebuffer();
+    lumaTarget_.ClearFramebuffer();
+    chromaTarget_.ClearFramebuffer();
+
+    next_ = 0;
+    frame_ = 0;
+    width_ = 0;
+    height_ = 0;
+    frameSize_ = 0;
+}
+
+void
+FrameCapture::Collect(bool wait)
+{
+    // Oldest first, from the slot the next capture goes to; the GPU finishes
+    // copies in order
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const unsigned int index = static_cast<unsigned int>((next_ + i) % slots_.size());
+        Slot& slot = slots_[index];
+        SlotState state;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            state = slot.state;
+        }
+
+        if (state == SlotState::Consumed) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.mapped = nullptr;
+            slot.state = SlotState::Free;
+            continue;
+        }
+
+        if (state != SlotState::Reading)
+            continue;
+
+        GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+        while (wait && result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+        if (result == GL_TIMEOUT_EXPIRED)
+            break;
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        // The copy is done, mapping does not wait
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+        const void* mapped = result == GL_WAIT_FAILED
+                                 ? nullptr
+                                 : glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                                    0,
+                                                    frameSize_,
+                                                    GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (mapped == nullptr) {
+            slot.state = SlotState::Free;
+            ++stats_.droppedFrames;
+            continue;
+        }
+
+        slot.mapped = static_cast<const uint8_t*>(mapped);
+        slot.state = SlotState::Consuming;
+        queue_.push_back(index);
+        condition_.notify_all();
+    }
+}
+
+void
+FrameCapture::ConvertToNv12()
+{
+    const bool bt709 = matrix_ == ColorMatrix::BT709;
+    const bool limited = range_ == ColorRange::Limited;
+    const GLfloat kr = bt709 ? 0.2126f : 0.299f;
+    const GLfloat kb = bt709 ? 0.0722f : 0.114f;
+
+    shader_.UseShader();
+    glUniform2i(uniformSize_, width_, height_);
+    glUniform3f(uniformLumaWeights_, kr, 1.0f - kr - kb, kb);
+    glUniform3f(uniformRange_,
+                limited ? 219.0f : 255.0f,
+                limited ? 16.0f : 0.0f,
+                limited ? 224.0f : 255.0f);
+
+    colorTarget_.GetColorTexture().Bind(0);
+    glBindVertexArray(VAO_);
+
+    lumaTarget_.Bind();
+    glUniform1i(uniformPlane_, 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    chromaTarget_.Bind();
+    glUniform1i(uniformPlane_, 1);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Shader::UnUseShader();
+}
+
+void
+FrameCapture::WorkerLoop()
+{
+    TRACE_THREAD_NAME("Frame capture");
+
+    for (;;) {
+        unsigned int index = 0;
+        CapturedFrame frame {};
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+
+            if (stopping_)
+                return;
+
+            index = queue_.front();
+            queue_.pop_front();
+
+            const Slot& slot = slots_[index];
+            frame.frame = slot.frame;
+            frame.format = format_;
+            frame.width = width_;
+            frame.height = height_;
+            frame.planes[0] = slot.mapped;
+            frame.strides[0] = static_cast<size_t>(width_) * (format_ == Format::NV12 ? 1 : 4);
+
+            if (format_ == Format::NV12) {
+                frame.planes[1] = slot.mapped + static_cast<size_t>(width_) * height_;
+                frame.strides[1] = static_cast<size_t>(
+                                       VideoFrame::GetPlaneWidth(VideoFormat::NV12, width_, 1))
+                                   * 2;
+            }
+        }
+
+        if (consumer_) {
+            TRACE_SCOPE("FrameCapture::Consumer");
+            consumer_(frame);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_[index].state = SlotState::Consumed;
+            ++stats_.deliveredFrames;
+        }
+
+        condition_.notify_all();
+    }
+}
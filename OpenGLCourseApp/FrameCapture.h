@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Framebuffer.h"
+#include "Shader.h"
+#include "VideoFrame.h"
+
+// Asynchronous readback of rendered frames (screenshots, video capture).
+//
+// Capture copies a framebuffer into a capture target of its own (scaled, and
+// flipped so row 0 is the top), optionally converts it to NV12 there in two
+// passes, and glReadPixels it into the next of a ring of pixel pack buffers,
+// followed by a fence. Later Captures poll the fences without waiting, map
+// the buffers whose copy has finished and hand them to a worker thread,
+// which calls the consumer with the mapped memory. The buffer returns to
+// the ring once the consumer is done. With three buffers frame N-2 is
+// delivered while frame N is captured. When the next buffer is still in use
+// the frame is dropped and counted rather than waited for, so Capture never
+// stalls the GL thread; Finish waits for everything at the end.
+class FrameCapture
+{
+public:
+    enum class Format
+    {
+        RGBA,
+        NV12,
+    };
+
+    // Valid during the consumer call only. Rows top down; RGBA has one
+    // plane, NV12 a Y plane and an interleaved UV plane.
+    struct CapturedFrame
+    {
+        // Captures since CreateCapture before this one
+        unsigned long long frame;
+        Format format;
+        int width;
+        int height;
+        const uint8_t* planes[2];
+        size_t strides[2];
+    };
+
+    typedef std::function<void(const CapturedFrame&)> Consumer;
+
+    struct Stats
+    {
+        unsigned long long capturedFrames {0};
+        unsigned long long deliveredFrames {0};
+        // Captures that found the next buffer still in use
+        unsigned long long droppedFrames {0};
+        unsigned long long readBytes {0};
+        // GL thread time in Capture
+        double captureSeconds {0.0};
+    };
+
+    explicit FrameCapture(unsigned int bufferCount = 3);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // The NV12 conversion, Shaders/video.vert and Shaders/capture_nv12.frag;
+    // not needed for RGBA
+    void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
+
+    // Frames of width by height in format, delivered to consumer on the
+    // worker thread
+    bool CreateCapture(int width,
+                       int height,
+                       Format format,
+                       const Consumer& consumer,
+                       ColorMatrix matrix = ColorMatrix::BT709,
+                       ColorRange range = ColorRange::Limited);
+
+    // The bottom left sourceWidth by sourceHeight of readFramebuffer (0 for
+    // the window's back buffer, before the swap). Returns false when the
+    // frame was dropped. Restores the framebuffer bindings and viewport.
+    bool Capture(GLuint readFramebuffer, GLsizei sourceWidth, GLsizei sourceHeight);
+
+    // Waits until every captured frame has been delivered
+    void Finish();
+
+    Stats GetStats();
+
+    // Releases GL objects after Finish, needs the context current
+    void ClearCapture();
+
+private:
+    enum class SlotState
+    {
+        Free,
+        // glReadPixels queued, fence pending
+        Reading,
+        // Mapped, with the worker
+        Consuming,
+        // Worker done, to unmap
+        Consumed,
+    };
+
+    struct Slot
+    {
+        GLuint PBO {0};
+        GLsync fence {nullptr};
+        unsigned long long frame {0};
+        const uint8_t* mapped {nullptr};
+        SlotState state {SlotState::Free};
+    };
+
+    Shader shader_;
+    GLint uniformPlane_ {-1};
+    GLint uniformSize_ {-1};
+    GLint uniformLumaWeights_ {-1};
+    GLint uniformRange_ {-1};
+    GLuint VAO_ {0};
+
+    // Flipped copy of the source, and the NV12 planes rendered from it
+    Framebuffer colorTarget_;
+    Framebuffer lumaTarget_;
+    Framebuffer chromaTarget_;
+
+    int width_ {0};
+    int height_ {0};
+    Format format_ {Format::RGBA};
+    ColorMatrix matrix_ {ColorMatrix::BT709};
+    ColorRange range_ {ColorRange::Limited};
+    size_t frameSize_ {0};
+    Consumer consumer_;
+
+    // Slot state changes by the worker and stats_ are under mutex_
+    std::vector<Slot> slots_;
+    unsigned int next_ {0};
+    unsigned long long frame_ {0};
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<unsigned int> queue_;
+    bool stopping_ {false};
+    Stats stats_;
+
+    // Hands finished copies to the worker and recycles consumed buffers;
+    // wait blocks on the fences and the worker instead of polling
+    void Collect(bool wait);
+    void ConvertToNv12();
+    void WorkerLoop();
+};
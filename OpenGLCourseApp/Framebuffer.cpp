@@ -0,0 +1,280 @@
+﻿#include "Framebuffer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "GlStats.h"
+#include "Tracing.h"
+
+namespace {
+
+GLenum
+DepthAttachment(GLenum depthFormat)
+{
+    return depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8
+               ? GL_DEPTH_STENCIL_ATTACHMENT
+               : GL_DEPTH_ATTACHMENT;
+}
+
+// Render targets are read back at their own size, no mips and no wrapping
+void
+SetTargetSampling(Texture& texture, GLint filter)
+{
+    glBindTexture(GL_TEXTURE_2D, texture.GetID());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+} // namespace
+
+Framebuffer::Framebuffer() {}
+
+Framebuffer::~Framebuffer()
+{
+    ClearFramebuffer();
+}
+
+bool
+Framebuffer::CreateFramebuffer(GLsizei width,
+                               GLsizei height,
+                               GLsizei samples,
+                               GLenum colorFormat,
+                               GLenum depthFormat)
+{
+    TRACE_SCOPE("Framebuffer::CreateFramebuffer");
+
+    ClearFramebuffer();
+
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+
+    width_ = width;
+    height_ = height;
+    renderWidth_ = width;
+    renderHeight_ = height;
+    samples_ = std::min(samples, static_cast<GLsizei>(maxSamples));
+    samples_ = samples_ > 1 ? samples_ : 0;
+    depthFormat_ = depthFormat;
+
+    if (!colorTexture_.CreateTexture(Texture::Type::Texture2D, colorFormat, width, height, 1, 1)) {
+        ClearFramebuffer();
+        return false;
+    }
+
+    SetTargetSampling(colorTexture_, GL_LINEAR);
+
+    if (depthFormat != 0) {
+        if (!depthTexture_.CreateTexture(Texture::Type::Texture2D,
+                                         depthFormat,
+                                         width,
+                                         height,
+                                         1,
+                                         1)) {
+            ClearFramebuffer();
+            return false;
+        }
+
+        SetTargetSampling(depthTexture_, GL_NEAREST);
+    }
+
+    glGenFramebuffers(1, &FBO_);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,
+                           GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D,
+                           colorTexture_.GetID(),
+                           0);
+
+    if (depthFormat != 0) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               DepthAttachment(depthFormat),
+                               GL_TEXTURE_2D,
+                               depthTexture_.GetID(),
+                               0);
+    }
+
+    bool complete = CheckStatus(GL_FRAMEBUFFER, "Framebuffer");
+
+    if (complete && samples_ > 0) {
+        glGenRenderbuffers(1, &colorRenderbuffer_);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer_);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples_, colorFormat, width, height);
+
+        if (depthFormat != 0) {
+            glGenRenderbuffers(1, &depthRenderbuffer_);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer_);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER,
+                                             samples_,
+                                             depthFormat,
+                                             width,
+                                             height);
+        }
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &multisampleFBO_);
+        glBindFramebuffer(GL_FRAMEBUFFER, multisampleFBO_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                  GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER,
+                                  colorRenderbuffer_);
+
+        if (depthFormat != 0) {
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                      DepthAttachment(depthFormat),
+                                      GL_RENDERBUFFER,
+                                      depthRenderbuffer_);
+        }
+
+        complete = CheckStatus(GL_FRAMEBUFFER, "Multisampled framebuffer");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        ClearFramebuffer();
+        return false;
+    }
+
+    return true;
+}
+
+void
+Framebuffer::SetRenderSize(GLsizei width, GLsizei height)
+{
+    renderWidth_ = std::min(std::max(width, 1), width_);
+    renderHeight_ = std::min(std::max(height, 1), height_);
+}
+
+void
+Framebuffer::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, multisampleFBO_ != 0 ? multisampleFBO_ : FBO_);
+    glViewport(0, 0, renderWidth_, renderHeight_);
+}
+
+void
+Framebuffer::Resolve()
+{
+    TRACE_SCOPE("Framebuffer::Resolve");
+
+    if (multisampleFBO_ != 0) {
+        // Depth only resolves with GL_NEAREST, one sample per pixel
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFBO_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO_);
+        glBlitFramebuffer(0,
+                          0,
+                          renderWidth_,
+                          renderHeight_,
+                          0,
+                          0,
+                          renderWidth_,
+                          renderHeight_,
+                          GL_COLOR_BUFFER_BIT | (depthFormat_ != 0 ? GL_DEPTH_BUFFER_BIT : 0),
+                          GL_NEAREST);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void
+Framebuffer::BlitToDefault(GLint x, GLint y, GLsizei width, GLsizei height, GLenum filter)
+{
+    TRACE_SCOPE("Framebuffer::BlitToDefault");
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0,
+                      0,
+                      renderWidth_,
+                      renderHeight_,
+                      x,
+                      y,
+                      x + width,
+                      y + height,
+                      GL_COLOR_BUFFER_BIT,
+                      filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void
+Framebuffer::BindDefault(GLsizei width, GLsizei height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void
+Framebuffer::FitRect(GLsizei sourceWidth,
+                     GLsizei sourceHeight,
+                     GLsizei width,
+                     GLsizei height,
+                     GLint& x,
+                     GLint& y,
+                     GLsizei& fitWidth,
+                     GLsizei& fitHeight)
+{
+    // Compared as products so no ratio is rounded
+    if (static_cast<long long>(width) * sourceHeight
+        > static_cast<long long>(height) * sourceWidth) {
+        fitHeight = height;
+        fitWidth = static_cast<GLsizei>(static_cast<long long>(height) * sourceWidth
+                                        / sourceHeight);
+    } else {
+        fitWidth = width;
+        fitHeight = static_cast<GLsizei>(static_cast<long long>(width) * sourceHeight
+                                         / sourceWidth);
+    }
+
+    x = (width - fitWidth) / 2;
+    y = (height - fitHeight) / 2;
+}
+
+void
+Framebuffer::ClearFramebuffer()
+{
+    GLuint* framebuffers[] = {&FBO_, &multisampleFBO_};
+
+    for (GLuint* framebuffer : framebuffers) {
+        if (*framebuffer != 0) {
+            glDeleteFramebuffers(1, framebuffer);
+            *framebuffer = 0;
+        }
+    }
+
+    GLuint* renderbuffers[] = {&colorRenderbuffer_, &depthRenderbuffer_};
+
+    for (GLuint* renderbuffer : renderbuffers) {
+        if (*renderbuffer != 0) {
+            glDeleteRenderbuffers(1, renderbuffer);
+            *renderbuffer = 0;
+        }
+    }
+
+    colorTexture_.ClearTexture();
+    depthTexture_.ClearTexture();
+
+    width_ = 0;
+    height_ = 0;
+    renderWidth_ = 0;
+    renderHeight_ = 0;
+    samples_ = 0;
+    depthFormat_ = 0;
+}
+
+bool
+Framebuffer::CheckStatus(GLenum target, const char* name)
+{
+    const GLenum status = glCheckFramebufferStatus(target);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("%s %dx%d is incomplete: 0x%X!\n", name, width_, height_, status);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+
+#include "Texture.h"
+
+// An offscreen render target: colour and depth textures that can be sampled
+// afterwards, optionally rendered through multisampled renderbuffers.
+//
+// Without samples the textures are attached directly. With samples, drawing
+// goes to multisampled colour and depth renderbuffers and Resolve blits them
+// into the textures (glBlitFramebuffer). BlitToDefault scales the colour onto
+// the window's framebuffer, so a scene can render at a fixed internal
+// resolution whatever the window size. SetRenderSize renders into the
+// bottom left corner only, for dynamic resolution without reallocating.
+class Framebuffer
+{
+public:
+    Framebuffer();
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // depthFormat 0 leaves out depth. samples is clamped to GL_MAX_SAMPLES,
+    // 0 or 1 renders straight into the textures. On failure the framebuffer
+    // is left empty.
+    bool CreateFramebuffer(GLsizei width,
+                           GLsizei height,
+                           GLsizei samples = 0,
+                           GLenum colorFormat = GL_RGBA8,
+                           GLenum depthFormat = GL_DEPTH_COMPONENT24);
+
+    // The part of the target Bind, Resolve and BlitToDefault cover, clamped
+    // to the allocated size. CreateFramebuffer sets the whole target.
+    void SetRenderSize(GLsizei width, GLsizei height);
+
+    // Draws go here from now on, the viewport covers the render size
+    void Bind();
+
+    // Multisampled colour and depth into the textures, nothing to do
+    // without samples. Leaves the default framebuffer bound for drawing.
+    void Resolve();
+
+    // Resolved colour (the render size) scaled into a rectangle of the
+    // default framebuffer, GL_LINEAR or GL_NEAREST
+    void BlitToDefault(GLint x, GLint y, GLsizei width, GLsizei height, GLenum filter = GL_LINEAR);
+
+    // Back to the window, with a viewport of its size
+    static void BindDefault(GLsizei width, GLsizei height);
+
+    // The largest rectangle of a width by height area with the aspect ratio
+    // of sourceWidth by sourceHeight, centred (letterbox or pillarbox)
+    static void FitRect(GLsizei sourceWidth,
+                        GLsizei sourceHeight,
+                        GLsizei width,
+                        GLsizei height,
+                        GLint& x,
+                        GLint& y,
+                        GLsizei& fitWidth,
+                        GLsizei& fitHeight);
+
+    // Render-to-texture results, valid after Resolve
+    Texture& GetColorTexture()
+    {
+        return colorTexture_;
+    }
+    Texture& GetDepthTexture()
+    {
+        return depthTexture_;
+    }
+
+    // The resolved framebuffer, to read from (glReadPixels, FrameCapture)
+    GLuint GetID() const
+    {
+        return FBO_;
+    }
+
+    GLsizei GetWidth() const
+    {
+        return width_;
+    }
+    GLsizei GetHeight() const
+    {
+        return height_;
+    }
+    GLsizei GetRenderWidth() const
+    {
+        return renderWidth_;
+    }
+    GLsizei GetRenderHeight() const
+    {
+        return renderHeight_;
+    }
+    GLsizei GetSamples() const
+    {
+        return samples_;
+    }
+
+    void ClearFramebuffer();
+
+private:
+    // Samples the textures; drawn into directly without multisampling
+    GLuint FBO_ {0};
+    // The multisampled renderbuffers, 0 without multisampling
+    GLuint multisampleFBO_ {0};
+    GLuint colorRenderbuffer_ {0};
+    GLuint depthRenderbuffer_ {0};
+
+    Texture colorTexture_;
+    Texture depthTexture_;
+
+    GLsizei width_ {0};
+    GLsizei height_ {0};
+    GLsizei renderWidth_ {0};
+    GLsizei renderHeight_ {0};
+    GLsizei samples_ {0};
+    GLenum depthFormat_ {0};
+
+    bool CheckStatus(GLenum target, const char* name);
+};
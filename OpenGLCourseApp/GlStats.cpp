@@ -0,0 +1,977 @@
+﻿#include "GlStats.h"
+
+#include <stdio.h>
+
+#include <deque>
+
+namespace {
+
+// Every GLEW loaded entry point that is counted: return type, name, parameters,
+// arguments and what else the call does to the statistics
+#define GL_STATS_ENTRY_POINTS(X)                                                                 \
+    X(void, ActiveTexture, (GLenum texture), (texture), OnActiveTexture(texture))                \
+    X(void, BeginQuery, (GLenum target, GLuint id), (target, id), (void)0)                       \
+    X(void,                                                                                      \
+      BindBuffer,                                                                                \
+      (GLenum target, GLuint buffer),                                                            \
+      (target, buffer),                                                                          \
+      OnBindBuffer(target, buffer, false))                                                       \
+    X(void,                                                                                      \
+      BindBufferBase,                                                                            \
+      (GLenum target, GLuint index, GLuint buffer),                                              \
+      (target, index, buffer),                                                                   \
+      OnBindBuffer(target, buffer, true))                                                        \
+    X(void,                                                                                      \
+      BindBufferRange,                                                                           \
+      (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size),            \
+      (target, index, buffer, offset, size),                                                     \
+      OnBindBuffer(target, buffer, true))                                                        \
+    X(void,                                                                                      \
+      BindFramebuffer,                                                                           \
+      (GLenum target, GLuint framebuffer),                                                       \
+      (target, framebuffer),                                                                     \
+      (void)0)                                                                                   \
+    X(void, BindSampler, (GLuint unit, GLuint sampler), (unit, sampler), (void)0)                \
+    X(void, BindVertexArray, (GLuint array), (array), OnBindVertexArray(array))                  \
+    X(void,                                                                                      \
+      BlitFramebuffer,                                                                           \
+      (GLint srcX0,                                                                              \
+       GLint srcY0,                                                                              \
+       GLint srcX1,                                                                              \
+       GLint srcY1,                                                                              \
+       GLint dstX0,                                                                              \
+       GLint dstY0,                                                                              \
+       GLint dstX1,                                                                              \
+       GLint dstY1,                                                                              \
+       GLbitfield mask,                                                                          \
+       GLenum filter),                                                                           \
+      (srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter),                    \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      BufferData,                                                                                \
+      (GLenum target, GLsizeiptr size, const void* data, GLenum usage),                          \
+      (target, size, data, usage),                                                               \
+      OnBufferUpload(data != nullptr ? size : 0))                                                \
+    X(void,                                                                                      \
+      BufferStorage,                                                                             \
+      (GLenum target, GLsizeiptr size, const void* data, GLbitfield flags),                      \
+      (target, size, data, flags),                                                               \
+      OnBufferUpload(data != nullptr ? size : 0))                                                \
+    X(void,                                                                                      \
+      BufferSubData,                                                                             \
+      (GLenum target, GLintptr offset, GLsizeiptr size, const void* data),                       \
+      (target, offset, size, data),                                                              \
+      OnBufferUpload(size))                                                                      \
+    X(GLenum,                                                                                    \
+      ClientWaitSync,                                                                            \
+      (GLsync sync, GLbitfield flags, GLuint64 timeout),                                         \
+      (sync, flags, timeout),                                                                    \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      CompressedTexSubImage2D,                                                                   \
+      (GLenum target,                                                                            \
+       GLint level,                                                                              \
+       GLint xOffset,                                                                            \
+       GLint yOffset,                                                                            \
+       GLsizei width,                                                                            \
+       GLsizei height,                                                                           \
+       GLenum format,                                                                            \
+       GLsizei imageSize,                                                                        \
+       const void* data),                                                                        \
+      (target, level, xOffset, yOffset, width, height, format, imageSize, data),                 \
+      OnTextureUpload(imageSize))                                                                \
+    X(void,                                                                                      \
+      CompressedTexSubImage3D,                                                                   \
+      (GLenum target,                                                                            \
+       GLint level,                                                                              \
+       GLint xOffset,                                                                            \
+       GLint yOffset,                                                                            \
+       GLint zOffset,                                                                            \
+       GLsizei width,                                                                            \
+       GLsizei height,                                                                           \
+       GLsizei depth,                                                                            \
+       GLenum format,                                                                            \
+       GLsizei imageSize,                                                                        \
+       const void* data),                                                                        \
+      (target, level, xOffset, yOffset, zOffset, width, height, depth, format, imageSize, data), \
+      OnTextureUpload(imageSize))                                                                \
+    X(void,                                                                                      \
+      CopyBufferSubData,                                                                         \
+      (GLenum readTarget,                                                                        \
+       GLenum writeTarget,                                                                       \
+       GLintptr readOffset,                                                                      \
+       GLintptr writeOffset,                                                                     \
+       GLsizeiptr size),                                                                         \
+      (readTarget, writeTarget, readOffset, writeOffset, size),                                  \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      DeleteBuffers,                                                                             \
+      (GLsizei n, const GLuint* buffers),                                                        \
+      (n, buffers),                                                                              \
+      OnDeleteBuffers(n, buffers))                                                               \
+    X(void, DeleteProgram, (GLuint program), (program), (void)0)                                 \
+    X(void, DeleteSync, (GLsync sync), (sync), (void)0)                                          \
+    X(void,                                                                                      \
+      DeleteVertexArrays,                                                                        \
+      (GLsizei n, const GLuint* arrays),                                                         \
+      (n, arrays),                                                                               \
+      OnDeleteVertexArrays(n, arrays))                                                           \
+    X(void, DisableVertexAttribArray, (GLuint index), (index), (void)0)                          \
+    X(void,                                                                                      \
+      DrawArraysInstanced,                                                                       \
+      (GLenum mode, GLint first, GLsizei count, GLsizei instances),                              \
+      (mode, first, count, instances),                                                           \
+      OnDraw(1, static_cast<unsigned long long>(count) * instances))                             \
+    X(void,                                                                                      \
+      DrawElementsBaseVertex,                                                                    \
+      (GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex),          \
+      (mode, count, type, indices, baseVertex),                                                  \
+      OnDraw(1, count))                                                                          \
+    X(void,                                                                                      \
+      DrawElementsIndirect,                                                                      \
+      (GLenum mode, GLenum type, const void* indirect),                                          \
+      (mode, type, indirect),                                                                    \
+      OnDraw(1, 0))                                                                              \
+    X(void,                                                                                      \
+      DrawElementsInstanced,                                                                     \
+      (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances),         \
+      (mode, count, type, indices, instances),                                                   \
+      OnDraw(1, static_cast<unsigned long long>(count) * instances))                             \
+    X(void,                                                                                      \
+      DrawRangeElements,                                                                         \
+      (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices),  \
+      (mode, start, end, count, type, indices),                                                  \
+      OnDraw(1, count))                                                                          \
+    X(void, EndQuery, (GLenum target), (target), (void)0)                                        \
+    X(void, EnableVertexAttribArray, (GLuint index), (index), (void)0)                           \
+    X(GLsync, FenceSync, (GLenum condition, GLbitfield flags), (condition, flags), (void)0)      \
+    X(void,                                                                                      \
+      FlushMappedBufferRange,                                                                    \
+      (GLenum target, GLintptr offset, GLsizeiptr length),                                       \
+      (target, offset, length),                                                                  \
+      (void)0)                                                                                   \
+    X(void, GenBuffers, (GLsizei n, GLuint* buffers), (n, buffers), (void)0)                     \
+    X(void, GenVertexArrays, (GLsizei n, GLuint* arrays), (n, arrays), (void)0)                  \
+    X(void, GenerateMipmap, (GLenum target), (target), (void)0)                                  \
+    X(void, GetInteger64v, (GLenum pname, GLint64* data), (pname, data), (void)0)                \
+    X(void,                                                                                      \
+      GetQueryObjectiv,                                                                          \
+      (GLuint id, GLenum pname, GLint* params),                                                  \
+      (id, pname, params),                                                                       \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      GetQueryObjectui64v,                                                                       \
+      (GLuint id, GLenum pname, GLuint64* params),                                               \
+      (id, pname, params),                                                                       \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      GetQueryObjectuiv,                                                                         \
+      (GLuint id, GLenum pname, GLuint* params),                                                 \
+      (id, pname, params),                                                                       \
+      (void)0)                                                                                   \
+    X(void*,                                                                                     \
+      MapBufferRange,                                                                            \
+      (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access),                    \
+      (target, offset, length, access),                                                          \
+      OnMapBuffer(length, access))                                                               \
+    X(void,                                                                                      \
+      MultiDrawArrays,                                                                           \
+      (GLenum mode, const GLint* first, const GLsizei* count, GLsizei drawCount),                \
+      (mode, first, count, drawCount),                                                           \
+      OnDraw(drawCount, SumCounts(count, drawCount)))                                            \
+    X(void,                                                                                      \
+      MultiDrawElements,                                                                         \
+      (GLenum mode,                                                                              \
+       const GLsizei* count,                                                                     \
+       GLenum type,                                                                              \
+       const void* const* indices,                                                               \
+       GLsizei drawCount),                                                                       \
+      (mode, count, type, indices, drawCount),                                                   \
+      OnDraw(drawCount, SumCounts(count, drawCount)))                                            \
+    X(void,                                                                                      \
+      MultiDrawElementsIndirect,                                                                 \
+      (GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride),       \
+      (mode, type, indirect, drawCount, stride),                                                 \
+      OnDraw(drawCount, 0))                                                                      \
+    X(void, QueryCounter, (GLuint id, GLenum target), (id, target), (void)0)                     \
+    X(void,                                                                                      \
+      TexImage3D,                                                                                \
+      (GLenum target,                                                                            \
+       GLint level,                                                                              \
+       GLint internalFormat,                                                                     \
+       GLsizei width,                                                                            \
+       GLsizei height,                                                                           \
+       GLsizei depth,                                                                            \
+       GLint border,                                                                             \
+       GLenum format,                                                                            \
+       GLenum type,                                                                              \
+       const void* pixels),                                                                      \
+      (target, level, internalFormat, width, height, depth, border, format, type, pixels),       \
+      OnTextureImage(width, height, depth, format, type, pixels))                                \
+    X(void,                                                                                      \
+      TexStorage2D,                                                                              \
+      (GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height),     \
+      (target, levels, internalFormat, width, height),                                           \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      TexStorage3D,                                                                              \
+      (GLenum target,                                                                            \
+       GLsizei levels,                                                                           \
+       GLenum internalFormat,                                                                    \
+       GLsizei width,                                                                            \
+       GLsizei height,                                                                           \
+       GLsizei depth),                                                                           \
+      (target, levels, internalFormat, width, height, depth),                                    \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      TexSubImage3D,                                                                             \
+      (GLenum target,                                                                            \
+       GLint level,                                                                              \
+       GLint xOffset,                                                                            \
+       GLint yOffset,                                                                            \
+       GLint zOffset,                                                                            \
+       GLsizei width,                                                                            \
+       GLsizei height,                                                                           \
+       GLsizei depth,                                                                            \
+       GLenum format,                                                                            \
+       GLenum type,                                                                              \
+       const void* pixels),                                                                      \
+      (target, level, xOffset, yOffset, zOffset, width, height, depth, format, type, pixels),    \
+      OnTextureImage(width, height, depth, format, type, pixels))                                \
+    X(void, Uniform1f, (GLint location, GLfloat v0), (location, v0), OnUniform())                \
+    X(void, Uniform1i, (GLint location, GLint v0), (location, v0), OnUniform())                  \
+    X(void,                                                                                      \
+      Uniform2f,                                                                                 \
+      (GLint location, GLfloat v0, GLfloat v1),                                                  \
+      (location, v0, v1),                                                                        \
+      OnUniform())                                                                               \
+    X(void, Uniform2i, (GLint location, GLint v0, GLint v1), (location, v0, v1), OnUniform())    \
+    X(void,                                                                                      \
+      Uniform3f,                                                                                 \
+      (GLint location, GLfloat v0, GLfloat v1, GLfloat v2),                                      \
+      (location, v0, v1, v2),                                                                    \
+      OnUniform())                                                                               \
+    X(void,                                                                                      \
+      Uniform4f,                                                                                 \
+      (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3),                          \
+      (location, v0, v1, v2, v3),                                                                \
+      OnUniform())                                                                               \
+    X(void,                                                                                      \
+      Uniform4fv,                                                                                \
+      (GLint location, GLsizei count, const GLfloat* value),                                     \
+      (location, count, value),                                                                  \
+      OnUniform())                                                                               \
+    X(void,                                                                                      \
+      Uniform4i,                                                                                 \
+      (GLint location, GLint v0, GLint v1, GLint v2, GLint v3),                                  \
+      (location, v0, v1, v2, v3),                                                                \
+      OnUniform())                                                                               \
+    X(void,                                                                                      \
+      UniformMatrix3fv,                                                                          \
+      (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),                \
+      (location, count, transpose, value),                                                       \
+      OnUniform())                                                                               \
+    X(void,                                                                                      \
+      UniformMatrix4fv,                                                                          \
+      (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),                \
+      (location, count, transpose, value),                                                       \
+      OnUniform())                                                                               \
+    X(GLboolean, UnmapBuffer, (GLenum target), (target), (void)0)                                \
+    X(void, UseProgram, (GLuint program), (program), OnUseProgram(program))                      \
+    X(void, VertexAttrib4fv, (GLuint index, const GLfloat* v), (index, v), (void)0)              \
+    X(void, VertexAttribDivisor, (GLuint index, GLuint divisor), (index, divisor), (void)0)      \
+    X(void, VertexAttribI1ui, (GLuint index, GLuint x), (index, x), (void)0)                     \
+    X(void,                                                                                      \
+      VertexAttribIPointer,                                                                      \
+      (GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer),              \
+      (index, size, type, stride, pointer),                                                      \
+      (void)0)                                                                                   \
+    X(void,                                                                                      \
+      VertexAttribPointer,                                                                       \
+      (GLuint index,                                                                             \
+       GLint size,                                                                               \
+       GLenum type,                                                                              \
+       GLboolean normalized,                                                                     \
+       GLsizei stride,                                                                           \
+       const void* pointer),                                                                     \
+      (index, size, type, normalized, stride, pointer),                                          \
+      (void)0)
+
+// The GL 1.1 entry points GlStats wraps itself
+#define GL_STATS_CORE_ENTRY_POINTS(X)                                                            \
+    X(BindTexture)                                                                               \
+    X(Clear)                                                                                     \
+    X(DeleteTextures)                                                                            \
+    X(Disable)                                                                                   \
+    X(DrawArrays)                                                                                \
+    X(DrawElements)                                                                              \
+    X(Enable)                                                                                    \
+    X(GetIntegerv)                                                                               \
+    X(IsEnabled)                                                                                 \
+    X(PixelStorei)                                                                               \
+    X(ReadPixels)                                                                                \
+    X(TexImage2D)                                                                                \
+    X(TexSubImage2D)                                                                             \
+    X(Viewport)
+
+#define GL_STATS_ENUM(ret, name, params, args, hook) name##Entry,
+#define GL_STATS_CORE_ENUM(name) name##Entry,
+
+enum EntryPoint : size_t
+{
+    GL_STATS_ENTRY_POINTS(GL_STATS_ENUM) GL_STATS_CORE_ENTRY_POINTS(GL_STATS_CORE_ENUM)
+        entryPointCount
+};
+
+#define GL_STATS_NAME(ret, name, params, args, hook) "gl" #name,
+#define GL_STATS_CORE_NAME(name) "gl" #name,
+
+const char* const entryPointNames[entryPointCount] = {
+    GL_STATS_ENTRY_POINTS(GL_STATS_NAME) GL_STATS_CORE_ENTRY_POINTS(GL_STATS_CORE_NAME)};
+
+// Shadowed binding that matches nothing, the next bind always counts as a change
+const GLuint unknownBinding = ~0u;
+
+const GLenum bufferTargets[] = {GL_ARRAY_BUFFER,
+                                GL_ELEMENT_ARRAY_BUFFER,
+                                GL_UNIFORM_BUFFER,
+                                GL_COPY_READ_BUFFER,
+                                GL_COPY_WRITE_BUFFER,
+                                GL_PIXEL_PACK_BUFFER,
+                                GL_PIXEL_UNPACK_BUFFER,
+                                GL_SHADER_STORAGE_BUFFER,
+                                GL_DRAW_INDIRECT_BUFFER,
+                                GL_TEXTURE_BUFFER};
+const size_t bufferTargetCount = sizeof(bufferTargets) / sizeof(bufferTargets[0]);
+
+const GLenum textureTargets[] = {
+    GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D};
+const size_t textureTargetCount = sizeof(textureTargets) / sizeof(textureTargets[0]);
+const size_t maxTextureUnits = 32;
+
+struct State
+{
+    bool installed {false};
+    size_t historyFrames {0};
+
+    GlStats::FrameStats current;
+    GlStats::FrameStats last;
+    std::deque<GlStats::FrameStats> history;
+
+    // What the counted calls bound last, used to tell changes from redundant binds
+    GLuint program {unknownBinding};
+    GLuint vertexArray {unknownBinding};
+    GLuint buffers[bufferTargetCount];
+    size_t textureUnit {0};
+    GLuint textures[maxTextureUnits][textureTargetCount];
+};
+
+State state;
+
+#define GL_STATS_ORIGINAL(ret, name, params, args, hook) decltype(__glew##name) original##name;
+
+GL_STATS_ENTRY_POINTS(GL_STATS_ORIGINAL)
+
+void
+ForgetBindings()
+{
+    state.program = unknownBinding;
+    state.vertexArray = unknownBinding;
+    state.textureUnit = 0;
+
+    for (GLuint& buffer : state.buffers)
+        buffer = unknownBinding;
+
+    for (auto& unit : state.textures) {
+        for (GLuint& texture : unit)
+            texture = unknownBinding;
+    }
+}
+
+GLuint*
+BufferBinding(GLenum target)
+{
+    for (size_t i = 0; i < bufferTargetCount; ++i) {
+        if (bufferTargets[i] == target)
+            return &state.buffers[i];
+    }
+
+    return nullptr;
+}
+
+GLuint*
+TextureBinding(GLenum target)
+{
+    if (state.textureUnit >= maxTextureUnits)
+        return nullptr;
+
+    for (size_t i = 0; i < textureTargetCount; ++i) {
+        if (textureTargets[i] == target)
+            return &state.textures[state.textureUnit][i];
+    }
+
+    return nullptr;
+}
+
+// An untracked binding (nullptr) always counts as a change
+void
+CountBind(GLuint* binding, GLuint object, unsigned long long& changes)
+{
+    if (binding != nullptr && *binding == object) {
+        ++state.current.redundantBinds;
+        return;
+    }
+
+    ++changes;
+
+    if (binding != nullptr)
+        *binding = object;
+}
+
+// Deleting a bound object binds 0 in its place
+void
+ForgetDeleted(GLuint* bindings, size_t count, GLsizei n, const GLuint* objects)
+{
+    for (GLsizei i = 0; i < n; ++i) {
+        for (size_t j = 0; j < count; ++j) {
+            if (objects[i] != 0 && bindings[j] == objects[i])
+                bindings[j] = 0;
+        }
+    }
+}
+
+void
+Count(size_t entryPoint)
+{
+    ++state.current.calls;
+    ++state.current.entryPointCalls[entryPoint];
+}
+
+void
+OnActiveTexture(GLenum texture)
+{
+    state.textureUnit = texture - GL_TEXTURE0;
+}
+
+// An indexed bind also replaces the generic binding, but the indexed binding
+// itself is not shadowed so it always counts as a change
+void
+OnBindBuffer(GLenum target, GLuint buffer, bool indexed)
+{
+    GLuint* binding = BufferBinding(target);
+
+    if (indexed) {
+        ++state.current.bufferBindChanges;
+
+        if (binding != nullptr)
+            *binding = buffer;
+
+        return;
+    }
+
+    CountBind(binding, buffer, state.current.bufferBindChanges);
+}
+
+// The element array binding belongs to the vertex array
+void
+OnBindVertexArray(GLuint array)
+{
+    if (state.vertexArray != array)
+        *BufferBinding(GL_ELEMENT_ARRAY_BUFFER) = unknownBinding;
+
+    CountBind(&state.vertexArray, array, state.current.vertexArrayChanges);
+}
+
+void
+OnUseProgram(GLuint program)
+{
+    CountBind(&state.program, program, state.current.programChanges);
+}
+
+void
+OnUniform()
+{
+    ++state.current.uniformCalls;
+}
+
+void
+OnBufferUpload(GLsizeiptr size)
+{
+    state.current.bufferBytes += static_cast<unsigned long long>(size);
+}
+
+void
+OnMapBuffer(GLsizeiptr length, GLbitfield access)
+{
+    if ((access & GL_MAP_WRITE_BIT) != 0)
+        state.current.mappedBytes += static_cast<unsigned long long>(length);
+}
+
+void
+OnDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    ForgetDeleted(state.buffers, bufferTargetCount, n, buffers);
+}
+
+void
+OnDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    ForgetDeleted(&state.vertexArray, 1, n, arrays);
+}
+
+void
+OnDraw(GLsizei draws, unsigned long long elements)
+{
+    state.current.drawCalls += static_cast<unsigned long long>(draws);
+    state.current.drawElements += elements;
+}
+
+unsigned long long
+SumCounts(const GLsizei* counts, GLsizei drawCount)
+{
+    unsigned long long sum = 0;
+
+    for (GLsizei i = 0; i < drawCount; ++i)
+        sum += static_cast<unsigned long long>(counts[i]);
+
+    return sum;
+}
+
+void
+OnTextureUpload(GLsizei size)
+{
+    state.current.textureBytes += static_cast<unsigned long long>(size);
+}
+
+// Bytes per pixel of an uncompressed upload, 0 if unknown
+size_t
+PixelSize(GLenum format, GLenum type)
+{
+    switch (type) {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+        return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    default:
+        break;
+    }
+
+    size_t componentSize = 0;
+
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        componentSize = 1;
+        break;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        componentSize = 2;
+        break;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        componentSize = 4;
+        break;
+    default:
+        return 0;
+    }
+
+    switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        return componentSize;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        return 2 * componentSize;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+        return 3 * componentSize;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+    case GL_BGRA_INTEGER:
+        return 4 * componentSize;
+    default:
+        return 0;
+    }
+}
+
+// An image without pixels and without a pixel unpack buffer only allocates
+void
+OnTextureImage(GLsizei width,
+               GLsizei height,
+               GLsizei depth,
+               GLenum format,
+               GLenum type,
+               const void* pixels)
+{
+    const GLuint unpackBuffer = *BufferBinding(GL_PIXEL_UNPACK_BUFFER);
+
+    if (pixels == nullptr && (unpackBuffer == 0 || unpackBuffer == unknownBinding))
+        return;
+
+    state.current.textureBytes += static_cast<unsigned long long>(width)
+                                  * static_cast<unsigned long long>(height)
+                                  * static_cast<unsigned long long>(depth)
+                                  * PixelSize(format, type);
+}
+
+#define GL_STATS_WRAPPER(ret, name, params, args, hook)                                          \
+    ret GLAPIENTRY Counted##name params                                                          \
+    {                                                                                            \
+        Count(name##Entry);                                                                      \
+        hook;                                                                                    \
+        return original##name args;                                                              \
+    }
+
+GL_STATS_ENTRY_POINTS(GL_STATS_WRAPPER)
+
+void
+WriteFrame(FILE* file, const GlStats::FrameStats& stats)
+{
+    fprintf(file,
+            "{\"frame\":%llu,\"calls\":%llu,\"drawCalls\":%llu,\"drawElements\":%llu,"
+            "\"bufferBytes\":%llu,\"mappedBytes\":%llu,\"textureBytes\":%llu,"
+            "\"uniformCalls\":%llu,\"programChanges\":%llu,\"vertexArrayChanges\":%llu,"
+            "\"bufferBindChanges\":%llu,\"textureBindChanges\":%llu,\"redundantBinds\":%llu,"
+            "\"entryPointCalls\":[",
+            stats.frame,
+            stats.calls,
+            stats.drawCalls,
+            stats.drawElements,
+            stats.bufferBytes,
+            stats.mappedBytes,
+            stats.textureBytes,
+            stats.uniformCalls,
+            stats.programChanges,
+            stats.vertexArrayChanges,
+            stats.bufferBindChanges,
+            stats.textureBindChanges,
+            stats.redundantBinds);
+
+    for (size_t i = 0; i < stats.entryPointCalls.size(); ++i)
+        fprintf(file, i == 0 ? "%u" : ",%u", stats.entryPointCalls[i]);
+
+    fprintf(file, "]}");
+}
+
+} // namespace
+
+bool
+GlStats::Install(size_t historyFrames)
+{
+#if GL_STATS_ENABLED
+    // Any loaded pointer tells glewInit ran
+    if (state.installed || __glewBindBuffer == nullptr)
+        return false;
+
+#define GL_STATS_INSTALL(ret, name, params, args, hook)                                          \
+    original##name = __glew##name;                                                               \
+    if (original##name != nullptr)                                                               \
+        __glew##name = Counted##name;
+
+    GL_STATS_ENTRY_POINTS(GL_STATS_INSTALL)
+
+    state.installed = true;
+    state.historyFrames = historyFrames;
+    state.current = FrameStats();
+    state.current.entryPointCalls.assign(entryPointCount, 0);
+    state.last = FrameStats();
+    state.history.clear();
+    ForgetBindings();
+
+    return true;
+#else
+    (void)historyFrames;
+    return false;
+#endif
+}
+
+void
+GlStats::Uninstall()
+{
+    if (!state.installed)
+        return;
+
+#define GL_STATS_UNINSTALL(ret, name, params, args, hook)                                        \
+    if (original##name != nullptr)                                                               \
+        __glew##name = original##name;
+
+    GL_STATS_ENTRY_POINTS(GL_STATS_UNINSTALL)
+
+    state.installed = false;
+}
+
+bool
+GlStats::IsInstalled()
+{
+    return state.installed;
+}
+
+void
+GlStats::EndFrame()
+{
+    if (!state.installed)
+        return;
+
+    const unsigned long long frame = state.current.frame;
+
+    state.last = state.current;
+
+    if (state.historyFrames > 0) {
+        if (state.history.size() >= state.historyFrames)
+            state.history.pop_front();
+
+        state.history.push_back(state.current);
+    }
+
+    state.current = FrameStats();
+    state.current.frame = frame + 1;
+    state.current.entryPointCalls.assign(entryPointCount, 0);
+}
+
+const GlStats::FrameStats&
+GlStats::GetLastFrame()
+{
+    return state.last;
+}
+
+size_t
+GlStats::GetEntryPointCount()
+{
+    return entryPointCount;
+}
+
+const char*
+GlStats::GetEntryPointName(size_t entryPoint)
+{
+    return entryPoint < entryPointCount ? entryPointNames[entryPoint] : nullptr;
+}
+
+void
+GlStats::FormatSummary(const FrameStats& stats, char* text, size_t size)
+{
+    snprintf(text,
+             size,
+             "%llu GL calls, %llu draws, %llu programs, %llu binds (%llu redundant), "
+             "%.1f KB buffers, %.1f KB mapped, %.1f KB textures",
+             stats.calls,
+             stats.drawCalls,
+             stats.programChanges,
+             stats.vertexArrayChanges + stats.bufferBindChanges + stats.textureBindChanges,
+             stats.redundantBinds,
+             stats.bufferBytes / 1024.0,
+             stats.mappedBytes / 1024.0,
+             stats.textureBytes / 1024.0);
+}
+
+bool
+GlStats::WriteJson(const char* fileLocation)
+{
+    FILE* file = fopen(fileLocation, "w");
+
+    if (file == nullptr) {
+        printf("Failed to write %s\n", fileLocation);
+        return false;
+    }
+
+    fprintf(file, "{\"entryPoints\":[");
+
+    for (size_t i = 0; i < entryPointCount; ++i)
+        fprintf(file, i == 0 ? "\"%s\"" : ",\"%s\"", entryPointNames[i]);
+
+    fprintf(file, "],\n\"frames\":[");
+
+    for (size_t i = 0; i < state.history.size(); ++i) {
+        fprintf(file, i == 0 ? "\n" : ",\n");
+        WriteFrame(file, state.history[i]);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return true;
+}
+
+// The GL 1.1 wrappers call through with the macros suppressed by the parentheses
+
+void GLAPIENTRY
+GlStats::BindTexture(GLenum target, GLuint texture)
+{
+    if (state.installed) {
+        Count(BindTextureEntry);
+        CountBind(TextureBinding(target), texture, state.current.textureBindChanges);
+    }
+
+    (glBindTexture)(target, texture);
+}
+
+void GLAPIENTRY
+GlStats::Clear(GLbitfield mask)
+{
+    if (state.installed)
+        Count(ClearEntry);
+
+    (glClear)(mask);
+}
+
+void GLAPIENTRY
+GlStats::DeleteTextures(GLsizei n, const GLuint* textures)
+{
+    if (state.installed) {
+        Count(DeleteTexturesEntry);
+        ForgetDeleted(&state.textures[0][0], maxTextureUnits * textureTargetCount, n, textures);
+    }
+
+    (glDeleteTextures)(n, textures);
+}
+
+void GLAPIENTRY
+GlStats::Disable(GLenum cap)
+{
+    if (state.installed)
+        Count(DisableEntry);
+
+    (glDisable)(cap);
+}
+
+void GLAPIENTRY
+GlStats::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    if (state.installed) {
+        Count(DrawArraysEntry);
+        OnDraw(1, count);
+    }
+
+    (glDrawArrays)(mode, first, count);
+}
+
+void GLAPIENTRY
+GlStats::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    if (state.installed) {
+        Count(DrawElementsEntry);
+        OnDraw(1, count);
+    }
+
+    (glDrawElements)(mode, count, type, indices);
+}
+
+void GLAPIENTRY
+GlStats::Enable(GLenum cap)
+{
+    if (state.installed)
+        Count(EnableEntry);
+
+    (glEnable)(cap);
+}
+
+void GLAPIENTRY
+GlStats::GetIntegerv(GLenum pname, GLint* data)
+{
+    if (state.installed)
+        Count(GetIntegervEntry);
+
+    (glGetIntegerv)(pname, data);
+}
+
+GLboolean GLAPIENTRY
+GlStats::IsEnabled(GLenum cap)
+{
+    if (state.installed)
+        Count(IsEnabledEntry);
+
+    return (glIsEnabled)(cap);
+}
+
+void GLAPIENTRY
+GlStats::PixelStorei(GLenum pname, GLint param)
+{
+    if (state.installed)
+        Count(PixelStoreiEntry);
+
+    (glPixelStorei)(pname, param);
+}
+
+void GLAPIENTRY
+GlStats::ReadPixels(GLint x,
+                    GLint y,
+                    GLsizei width,
+                    GLsizei height,
+                    GLenum format,
+                    GLenum type,
+                    void* pixels)
+{
+    if (state.installed)
+        Count(ReadPixelsEntry);
+
+    (glReadPixels)(x, y, width, height, format, type, pixels);
+}
+
+void GLAPIENTRY
+GlStats::TexImage2D(GLenum target,
+                    GLint level,
+                    GLint internalFormat,
+                    GLsizei width,
+                    GLsizei height,
+                    GLint border,
+                    GLenum format,
+                    GLenum type,
+                    const void* pixels)
+{
+    if (state.installed) {
+        Count(TexImage2DEntry);
+        OnTextureImage(width, height, 1, format, type, pixels);
+    }
+
+    (glTexImage2D)(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void GLAPIENTRY
+GlStats::TexSubImage2D(GLenum target,
+                       GLint level,
+                       GLint xOffset,
+                       GLint yOffset,
+                       GLsizei width,
+                       GLsizei height,
+                       GLenum format,
+                       GLenum type,
+                       const void* pixels)
+{
+    if (state.installed) {
+        Count(TexSubImage2DEntry);
+        OnTextureImage(width, height, 1, format, type, pixels);
+    }
+
+    (glTexSubImage2D)(target, level, xOffset, yOffset, width, height, format, type, pixels);
+}
+
+void GLAPIENTRY
+GlStats::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (state.installed)
+        Count(ViewportEntry);
+
+    (glViewport)(x, y, width, height);
+}
@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <GL/glew.h>
+
+// GL call counting.
+//
+// Install swaps GLEW's function pointers for wrappers that count every call
+// by entry point, the bytes handed to glBufferData/glBufferSubData and the
+// texture uploads, draws and the binds that actually change state, then call
+// the driver. EndFrame closes a frame. GL thread only, after glewInit.
+//
+// GL 1.1 entry points (glDrawElements, glTexSubImage2D, glBindTexture, ...)
+// are exported by the GL library rather than loaded by GLEW, so there is no
+// pointer to swap. The macros at the end of this file route them through
+// counting functions instead; a file issuing those calls includes this
+// header after GL/glew.h. Building with GL_STATS_ENABLED 0 removes the macros
+// and Install does nothing.
+#ifndef GL_STATS_ENABLED
+#define GL_STATS_ENABLED 1
+#endif
+
+class GlStats
+{
+public:
+    struct FrameStats
+    {
+        unsigned long long frame {0};
+        unsigned long long calls {0};
+        unsigned long long drawCalls {0};
+        // Indices (or vertices) submitted, times instances, indirect draws not included
+        unsigned long long drawElements {0};
+        // Data passed to glBufferData, glBufferSubData and glBufferStorage
+        unsigned long long bufferBytes {0};
+        // Ranges mapped for writing
+        unsigned long long mappedBytes {0};
+        // glTex(Sub)Image* and glCompressedTexSubImage*, from memory or a bound PBO
+        unsigned long long textureBytes {0};
+        unsigned long long uniformCalls {0};
+        unsigned long long programChanges {0};
+        unsigned long long vertexArrayChanges {0};
+        unsigned long long bufferBindChanges {0};
+        unsigned long long textureBindChanges {0};
+        // Binds of whatever was already bound
+        unsigned long long redundantBinds {0};
+        // Indexed like GetEntryPointName
+        std::vector<unsigned int> entryPointCalls;
+    };
+
+    // Returns false when already installed, compiled out or before glewInit.
+    // historyFrames finished frames are kept for WriteJson.
+    static bool Install(size_t historyFrames = 600);
+
+    // Puts GLEW's pointers back
+    static void Uninstall();
+
+    static bool IsInstalled();
+
+    // The calls since the previous EndFrame become the last frame
+    static void EndFrame();
+
+    // Latest finished frame, empty until one arrives
+    static const FrameStats& GetLastFrame();
+
+    static size_t GetEntryPointCount();
+    static const char* GetEntryPointName(size_t entryPoint);
+
+    // One line summary of a frame (window title, console)
+    static void FormatSummary(const FrameStats& stats, char* text, size_t size);
+
+    // The kept frames as JSON, entry point names once and then one object per frame
+    static bool WriteJson(const char* fileLocation);
+
+    // Counted GL 1.1 entry points, see the macros below
+    static void GLAPIENTRY BindTexture(GLenum target, GLuint texture);
+    static void GLAPIENTRY Clear(GLbitfield mask);
+    static void GLAPIENTRY DeleteTextures(GLsizei n, const GLuint* textures);
+    static void GLAPIENTRY Disable(GLenum cap);
+    static void GLAPIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count);
+    static void GLAPIENTRY DrawElements(GLenum mode,
+                                        GLsizei count,
+                                        GLenum type,
+                                        const void* indices);
+    static void GLAPIENTRY Enable(GLenum cap);
+    static void GLAPIENTRY GetIntegerv(GLenum pname, GLint* data);
+    static GLboolean GLAPIENTRY IsEnabled(GLenum cap);
+    static void GLAPIENTRY PixelStorei(GLenum pname, GLint param);
+    static void GLAPIENTRY ReadPixels(GLint x,
+                                      GLint y,
+                                      GLsizei width,
+                                      GLsizei height,
+                                      GLenum format,
+                                      GLenum type,
+                                      void* pixels);
+    static void GLAPIENTRY TexImage2D(GLenum target,
+                                      GLint level,
+                                      GLint internalFormat,
+                                      GLsizei width,
+                                      GLsizei height,
+                                      GLint border,
+                                      GLenum format,
+                                      GLenum type,
+                                      const void* pixels);
+    static void GLAPIENTRY TexSubImage2D(GLenum target,
+                                         GLint level,
+                                         GLint xOffset,
+                                         GLint yOffset,
+                                         GLsizei width,
+                                         GLsizei height,
+                                         GLenum format,
+                                         GLenum type,
+                                         const void* pixels);
+    static void GLAPIENTRY Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+};
+
+#if GL_STATS_ENABLED
+#define glBindTexture(target, texture) GlStats::BindTexture(target, texture)
+#define glClear(mask) GlStats::Clear(mask)
+#define glDeleteTextures(n, textures) GlStats::DeleteTextures(n, textures)
+#define glDisable(cap) GlStats::Disable(cap)
+#define glDrawArrays(mode, first, count) GlStats::DrawArrays(mode, first, count)
+#define glDrawElements(mode, count, type, indices) \
+    GlStats::DrawElements(mode, count, type, indices)
+#define glEnable(cap) GlStats::Enable(cap)
+#define glGetIntegerv(pname, data) GlStats::GetIntegerv(pname, data)
+#define glIsEnabled(cap) GlStats::IsEnabled(cap)
+#define glPixelStorei(pname, param) GlStats::PixelStorei(pname, param)
+#define glReadPixels(x, y, width, height, format, type, pixels) \
+    GlStats::ReadPixels(x, y, width, height, format, type, pixels)
+#define glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels) \
+    GlStats::TexImage2D(target, level, internalFormat, width, height, border, format, type, pixels)
+#define glTexSubImage2D(target, level, xOffset, yOffset, width, height, format, type, pixels) \
+    GlStats::TexSubImage2D(target, level, xOffset, yOffset, width, height, format, type, pixels)
+#define glViewport(x, y, width, height) GlStats::Viewport(x, y, width, height)
+#endif
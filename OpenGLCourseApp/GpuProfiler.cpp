@@ -0,0 +1,243 @@
+﻿#include "GpuProfiler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+double
+CpuSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Names are string literals, only quotes and backslashes need escaping
+void
+WriteJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+} // namespace
+
+GpuProfiler::GpuProfiler(unsigned int framesInFlight, size_t historyFrames)
+    : slots_(framesInFlight > 0 ? std::max(framesInFlight, 2u) : 0)
+    , historyFrames_(historyFrames)
+{
+    // Core since 3.3
+    timerQueries_ = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (FrameSlot& slot : slots_) {
+        if (!slot.queries.empty())
+            glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+    }
+}
+
+void
+GpuProfiler::BeginFrame()
+{
+    if (slots_.empty())
+        return;
+
+    if (timerQueries_ && !calibrated_)
+        Calibrate();
+
+    // Oldest first, the GPU finishes frames in order
+    const unsigned long long oldest = frame_ >= slots_.size() ? frame_ - slots_.size() + 1 : 0;
+
+    for (unsigned long long frame = oldest; frame < frame_; ++frame) {
+        FrameSlot& slot = slots_[frame % slots_.size()];
+
+        if (slot.pending && !Collect(slot))
+            break;
+    }
+
+    current_ = &slots_[frame_ % slots_.size()];
+
+    // Still not done a full ring later, reusing its queries must not wait
+    if (current_->pending) {
+        current_->pending = false;
+        ++droppedFrames_;
+    }
+
+    current_->frame = frame_;
+    current_->scopes.clear();
+    stack_.clear();
+}
+
+void
+GpuProfiler::EndFrame()
+{
+    if (current_ == nullptr)
+        return;
+
+    while (!stack_.empty())
+        EndScope();
+
+    current_->pending = true;
+    current_ = nullptr;
+    ++frame_;
+}
+
+void
+GpuProfiler::BeginScope(const char* name)
+{
+    if (current_ == nullptr)
+        return;
+
+    const size_t scope = current_->scopes.size();
+
+    if (timerQueries_)
+        glQueryCounter(QueryAt(*current_, 2 * scope), GL_TIMESTAMP);
+
+    current_->scopes.push_back(
+        OpenScope {name, static_cast<unsigned int>(stack_.size()), CpuSeconds(), 0.0});
+    stack_.push_back(scope);
+}
+
+void
+GpuProfiler::EndScope()
+{
+    if (current_ == nullptr || stack_.empty())
+        return;
+
+    const size_t scope = stack_.back();
+    stack_.pop_back();
+
+    current_->scopes[scope].cpuEnd = CpuSeconds();
+
+    if (timerQueries_) {
+        current_->lastQuery = 2 * scope + 1;
+        glQueryCounter(QueryAt(*current_, current_->lastQuery), GL_TIMESTAMP);
+    }
+}
+
+bool
+GpuProfiler::WriteChromeTrace(const char* fileLocation) const
+{
+    FILE* file = fopen(fileLocation, "w");
+
+    if (file == nullptr) {
+        printf("Failed to write %s\n", fileLocation);
+        return false;
+    }
+
+    // Microseconds from the first kept scope
+    const double origin = history_.empty() || history_.front().scopes.empty()
+                              ? 0.0
+                              : history_.front().scopes.front().cpuBegin;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,");
+    fprintf(file, "\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,");
+    fprintf(file, "\"args\":{\"name\":\"GPU\"}}");
+
+    for (const FrameTiming& frame : history_) {
+        for (const ScopeTiming& scope : frame.scopes) {
+            for (int gpu = 0; gpu < (timerQueries_ ? 2 : 1); ++gpu) {
+                const double begin = gpu ? scope.gpuBegin : scope.cpuBegin;
+                const double end = gpu ? scope.gpuEnd : scope.cpuEnd;
+
+                fprintf(file, ",\n{\"name\":");
+                WriteJsonString(file, scope.name);
+                fprintf(file,
+                        ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"args\":{\"frame\":%llu}}",
+                        gpu + 1,
+                        (begin - origin) * 1e6,
+                        std::max(end - begin, 0.0) * 1e6,
+                        frame.frame);
+            }
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return true;
+}
+
+void
+GpuProfiler::Calibrate()
+{
+    // Current GPU time without waiting for queued work
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+
+    gpuToCpu_ = CpuSeconds() - gpuNow * 1e-9;
+    calibrated_ = true;
+}
+
+bool
+GpuProfiler::Collect(FrameSlot& slot)
+{
+    const size_t queryCount = 2 * slot.scopes.size();
+
+    // The last query issued in the frame done means all of them are
+    if (timerQueries_ && queryCount > 0) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(slot.queries[slot.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+            return false;
+    }
+
+    FrameTiming timing;
+    timing.frame = slot.frame;
+    timing.scopes.reserve(slot.scopes.size());
+
+    for (size_t i = 0; i < slot.scopes.size(); ++i) {
+        const OpenScope& scope = slot.scopes[i];
+        GLuint64 gpuBegin = 0, gpuEnd = 0;
+
+        if (timerQueries_) {
+            glGetQueryObjectui64v(slot.queries[2 * i], GL_QUERY_RESULT, &gpuBegin);
+            glGetQueryObjectui64v(slot.queries[2 * i + 1], GL_QUERY_RESULT, &gpuEnd);
+        }
+
+        timing.scopes.push_back(ScopeTiming {scope.name,
+                                             scope.depth,
+                                             scope.cpuBegin,
+                                             scope.cpuEnd,
+                                             gpuBegin * 1e-9 + gpuToCpu_,
+                                             gpuEnd * 1e-9 + gpuToCpu_});
+    }
+
+    slot.pending = false;
+    lastFrame_ = timing;
+
+    if (historyFrames_ > 0) {
+        if (history_.size() == historyFrames_)
+            history_.pop_front();
+        history_.push_back(std::move(timing));
+    }
+
+    return true;
+}
+
+GLuint
+GpuProfiler::QueryAt(FrameSlot& slot, size_t index)
+{
+    if (index >= slot.queries.size()) {
+        const size_t oldSize = slot.queries.size();
+        slot.queries.resize(std::max<size_t>(index + 1, oldSize * 2));
+        glGenQueries(static_cast<GLsizei>(slot.queries.size() - oldSize),
+                     slot.queries.data() + oldSize);
+    }
+
+    return slot.queries[index];
+}
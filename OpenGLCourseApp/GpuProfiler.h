@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <deque>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Nested CPU and GPU timing of the render loop.
+//
+// Each scope records the CPU clock and a GL_TIMESTAMP query (glQueryCounter) at
+// both ends. Timestamps rather than GL_TIME_ELAPSED, which cannot nest. The
+// queries of the last framesInFlight frames live in a ring and are only read
+// once available, so nothing waits for the GPU; results arrive a few frames
+// late. A frame whose queries are still pending when its slot comes round
+// again is dropped. GL thread only, needs the context current.
+class GpuProfiler
+{
+public:
+    // One finished scope, seconds on the CPU clock (GPU times are shifted onto it)
+    struct ScopeTiming
+    {
+        const char* name;
+        unsigned int depth;
+        double cpuBegin;
+        double cpuEnd;
+        double gpuBegin;
+        double gpuEnd;
+    };
+
+    // Every scope of one frame, parents before their children
+    struct FrameTiming
+    {
+        unsigned long long frame;
+        std::vector<ScopeTiming> scopes;
+    };
+
+    // Closes a scope when it goes out of scope
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, const char* name)
+            : profiler_(profiler)
+        {
+            profiler_.BeginScope(name);
+        }
+
+        ~Scope()
+        {
+            profiler_.EndScope();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler& profiler_;
+    };
+
+    // historyFrames finished frames are kept for WriteChromeTrace. With
+    // framesInFlight 0 nothing is recorded and every call is a no-op.
+    explicit GpuProfiler(unsigned int framesInFlight = 4, size_t historyFrames = 600);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Collects whatever earlier frames finished and starts recording a new one
+    void BeginFrame();
+    void EndFrame();
+
+    // name must outlive the profiler (a string literal)
+    void BeginScope(const char* name);
+    void EndScope();
+
+    // Latest finished frame, empty until one arrives
+    const FrameTiming& GetLastFrame() const
+    {
+        return lastFrame_;
+    }
+
+    // Frames whose queries were not available in time
+    unsigned long long GetDroppedFrames() const
+    {
+        return droppedFrames_;
+    }
+
+    // The kept frames as Chrome trace event JSON (chrome://tracing, Perfetto),
+    // the CPU and the GPU scopes as two threads
+    bool WriteChromeTrace(const char* fileLocation) const;
+
+private:
+    struct OpenScope
+    {
+        const char* name;
+        unsigned int depth;
+        double cpuBegin;
+        double cpuEnd;
+    };
+
+    // Queries 2i and 2i + 1 are the ends of scope i. Scopes nest, so the last
+    // query issued is the end of the outermost scope, not queries.back()
+    struct FrameSlot
+    {
+        unsigned long long frame {0};
+        std::vector<OpenScope> scopes;
+        std::vector<GLuint> queries;
+        size_t lastQuery {0};
+        bool pending {false};
+    };
+
+    std::vector<FrameSlot> slots_;
+    size_t historyFrames_;
+    std::deque<FrameTiming> history_;
+    FrameTiming lastFrame_;
+
+    unsigned long long frame_ {0};
+    unsigned long long droppedFrames_ {0};
+    FrameSlot* current_ {nullptr};
+    std::vector<size_t> stack_;
+
+    bool timerQueries_ {false};
+    // CPU clock minus GPU clock, seconds
+    double gpuToCpu_ {0.0};
+    bool calibrated_ {false};
+
+    void Calibrate();
+    bool Collect(FrameSlot& slot);
+    GLuint QueryAt(FrameSlot& slot, size_t index);
+};
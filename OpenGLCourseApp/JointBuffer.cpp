@@ -0,0 +1,70 @@
+﻿#include "JointBuffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+JointBuffer::JointBuffer(GLsizeiptr blockSize)
+    : blockSize_(blockSize)
+{
+}
+
+JointBuffer::~JointBuffer()
+{
+    ClearBuffer();
+}
+
+void
+JointBuffer::Upload(const void* data, GLsizeiptr dataSize, size_t blockCount)
+{
+    if (UBO_ == 0) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        blockStride_ = (blockSize_ + alignment - 1) / alignment * alignment;
+
+        glGenBuffers(1, &UBO_);
+    }
+
+    const GLsizeiptr size = blockStride_ * static_cast<GLsizeiptr>(blockCount);
+
+    if (size == 0)
+        return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO_);
+
+    // New storage every frame, the draws of the last frame keep theirs
+    capacity_ = std::max(capacity_, size);
+    glBufferData(GL_UNIFORM_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+
+    unsigned char* mapped = static_cast<unsigned char*>(glMapBufferRange(
+        GL_UNIFORM_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    if (mapped != nullptr) {
+        const unsigned char* source = static_cast<const unsigned char*>(data);
+        const GLsizeiptr copySize = std::min(dataSize, blockSize_);
+
+        for (size_t i = 0; i < blockCount; ++i)
+            memcpy(mapped + i * blockStride_, source + i * dataSize, copySize);
+
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void
+JointBuffer::Bind(GLuint binding, size_t block)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, UBO_, blockStride_ * block, blockSize_);
+}
+
+void
+JointBuffer::ClearBuffer()
+{
+    if (UBO_ != 0) {
+        glDeleteBuffers(1, &UBO_);
+        UBO_ = 0;
+    }
+
+    capacity_ = 0;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+// Uniform buffer with the joints of every skinned character, refilled once a
+// frame. Each character gets a block at an offset glBindBufferRange accepts,
+// so a draw only rebinds a range instead of uploading its joints.
+class JointBuffer
+{
+public:
+    // blockSize is the size of the shader's uniform block in bytes
+    explicit JointBuffer(GLsizeiptr blockSize);
+    ~JointBuffer();
+
+    JointBuffer(const JointBuffer&) = delete;
+    JointBuffer& operator=(const JointBuffer&) = delete;
+
+    // Copies blockCount blocks of dataSize bytes (at most blockSize), one
+    // after another in data. The previous contents are orphaned, not waited on.
+    void Upload(const void* data, GLsizeiptr dataSize, size_t blockCount);
+
+    // Binds block to uniform buffer binding point binding
+    void Bind(GLuint binding, size_t block);
+
+    void ClearBuffer();
+
+private:
+    GLuint UBO_ {0};
+    GLsizeiptr blockSize_ {0};
+    GLsizeiptr blockStride_ {0};
+    GLsizeiptr capacity_ {0};
+};
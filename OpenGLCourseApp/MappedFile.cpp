@@ -0,0 +1,112 @@
+﻿#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool
+MappedFile::Open(const char* fileLocation)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileLocation,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN,
+                              NULL);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Failed to open %s! File does not exist\n", fileLocation);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+
+    HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* mapping = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+    file_ = file;
+    fileMapping_ = fileMapping;
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(fileLocation, O_RDONLY);
+
+    if (fd < 0) {
+        printf("Failed to open %s! File does not exist\n", fileLocation);
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+
+    void* mapping = NULL;
+    if (fileStat.st_size > 0) {
+        mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+        } else {
+            // Files are consumed front to back
+            madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+            madvise(mapping, fileStat.st_size, MADV_WILLNEED);
+        }
+    }
+
+    // The mapping keeps the pages alive on its own
+    close(fd);
+    size_ = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    mapping_ = mapping;
+
+    if (!mapping_) {
+        printf("Failed to map %s!\n", fileLocation);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void
+MappedFile::Close()
+{
+#ifdef _WIN32
+    if (mapping_)
+        UnmapViewOfFile(mapping_);
+
+    if (fileMapping_)
+        CloseHandle(fileMapping_);
+
+    if (file_)
+        CloseHandle(file_);
+#else
+    if (mapping_)
+        munmap(mapping_, size_);
+#endif
+
+    mapping_ = nullptr;
+    fileMapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* fileLocation);
+    void Close();
+
+    const char* GetData() const
+    {
+        return static_cast<const char*>(mapping_);
+    }
+    size_t GetSize() const
+    {
+        return size_;
+    }
+
+private:
+    void* mapping_ {nullptr};
+    size_t size_ {0};
+
+    // Windows HANDLEs, the POSIX descriptor is closed right after mmap
+    void* file_ {nullptr};
+    void* fileMapping_ {nullptr};
+};
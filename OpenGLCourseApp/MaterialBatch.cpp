@@ -0,0 +1,358 @@
+﻿#include "MaterialBatch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gtc/type_ptr.hpp>
+
+#include "GlStats.h"
+#include "Tracing.h"
+
+namespace {
+
+const GLuint modelLocation = 3;
+const GLuint materialLocation = 7;
+
+} // namespace
+
+MaterialBatch::MaterialBatch() {}
+
+MaterialBatch::~MaterialBatch()
+{
+    ClearBatch();
+}
+
+void
+MaterialBatch::CreateFromFiles(const char* vertexLocation, const char* fragmentLocation)
+{
+    shader_.CreateFromFiles(vertexLocation, fragmentLocation);
+
+    uniformProjection_ = shader_.GetUniformLocation("projection");
+    shader_.BindUniformBlock("Materials", materialBinding);
+
+    // The array never changes units
+    shader_.UseShader();
+    glUniform1i(shader_.GetUniformLocation("materialTextures"), 0);
+    Shader::UnUseShader();
+}
+
+bool
+MaterialBatch::CreateTextures(GLsizei width,
+                              GLsizei height,
+                              GLsizei layers,
+                              GLenum internalFormat,
+                              GLsizei levels)
+{
+    return textures_.CreateTexture(Texture::Type::Array,
+                                   internalFormat,
+                                   width,
+                                   height,
+                                   layers,
+                                   levels);
+}
+
+uint32_t
+MaterialBatch::AddMesh(const Vertex* vertices,
+                       GLsizei vertexCount,
+                       const GLuint* indices,
+                       GLsizei indexCount)
+{
+    if (vertexCount <= 0 || indexCount <= 0)
+        return invalidIndex;
+
+    for (GLsizei i = 0; i < indexCount; ++i) {
+        if (indices[i] >= static_cast<GLuint>(vertexCount)) {
+            printf("Mesh index %u is past its %d vertices!\n", indices[i], vertexCount);
+            return invalidIndex;
+        }
+    }
+
+    // Indices stay relative to the mesh, baseVertex offsets them at draw time
+    MeshRange range;
+    range.firstIndex = static_cast<GLuint>(indices_.size());
+    range.indexCount = indexCount;
+    range.baseVertex = static_cast<GLint>(vertices_.size());
+
+    vertices_.insert(vertices_.end(), vertices, vertices + vertexCount);
+    indices_.insert(indices_.end(), indices, indices + indexCount);
+    meshes_.push_back(range);
+    geometryDirty_ = true;
+
+    return static_cast<uint32_t>(meshes_.size() - 1);
+}
+
+uint32_t
+MaterialBatch::AddMaterial(const Material& material)
+{
+    if (materials_.size() >= maxMaterials)
+        return invalidIndex;
+
+    materials_.emplace_back();
+    SetMaterial(static_cast<uint32_t>(materials_.size() - 1), material);
+
+    return static_cast<uint32_t>(materials_.size() - 1);
+}
+
+void
+MaterialBatch::SetMaterial(uint32_t index, const Material& material)
+{
+    if (index >= materials_.size())
+        return;
+
+    MaterialData& data = materials_[index];
+    memcpy(data.baseColor, glm::value_ptr(material.baseColor), sizeof(data.baseColor));
+    data.texture[0] = material.textureLayer;
+    data.texture[1] = data.texture[2] = data.texture[3] = 0;
+    materialsDirty_ = true;
+}
+
+bool
+MaterialBatch::IsMultiDrawSupported() const
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void
+MaterialBatch::BeginFrame()
+{
+    draws_.clear();
+}
+
+void
+MaterialBatch::AddDraw(uint32_t mesh, uint32_t material, const glm::mat4& model)
+{
+    if (mesh >= meshes_.size() || material >= materials_.size())
+        return;
+
+    draws_.emplace_back();
+    DrawData& draw = draws_.back();
+    memcpy(draw.model, glm::value_ptr(model), sizeof(draw.model));
+    draw.material = material;
+    draw.padding[0] = draw.padding[1] = draw.padding[2] = 0;
+
+    // The command list only depends on the draws, so it is built here
+    // rather than in Render
+    if (commands_.size() < draws_.size())
+        commands_.resize(draws_.size());
+
+    const MeshRange& range = meshes_[mesh];
+    DrawCommand& command = commands_[draws_.size() - 1];
+    command.count = static_cast<GLuint>(range.indexCount);
+    command.instanceCount = 1;
+    command.firstIndex = range.firstIndex;
+    command.baseVertex = range.baseVertex;
+    command.baseInstance = static_cast<GLuint>(draws_.size() - 1);
+}
+
+void
+MaterialBatch::Render(const glm::mat4& projection)
+{
+    TRACE_SCOPE("MaterialBatch::Render");
+
+    drawCalls_ = 0;
+
+    if (draws_.empty())
+        return;
+
+    if (VAO_ == 0)
+        CreateBuffers();
+
+    if (geometryDirty_)
+        UploadGeometry();
+
+    if (materialsDirty_) {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO_);
+        glBufferSubData(GL_UNIFORM_BUFFER,
+                        0,
+                        materials_.size() * sizeof(MaterialData),
+                        materials_.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        materialsDirty_ = false;
+    }
+
+    shader_.UseShader();
+    glUniformMatrix4fv(uniformProjection_, 1, GL_FALSE, glm::value_ptr(projection));
+
+    textures_.Bind(0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, materialBinding, UBO_);
+    glBindVertexArray(VAO_);
+
+    const bool multiDraw = multiDraw_ && IsMultiDrawSupported();
+
+    for (GLuint column = 0; column < 4; ++column) {
+        if (multiDraw)
+            glEnableVertexAttribArray(modelLocation + column);
+        else
+            glDisableVertexAttribArray(modelLocation + column);
+    }
+
+    if (multiDraw) {
+        glEnableVertexAttribArray(materialLocation);
+
+        // Orphaned every frame so the driver never waits on last frame's rows
+        glBindBuffer(GL_ARRAY_BUFFER, drawBuffer_);
+        glBufferData(GL_ARRAY_BUFFER,
+                     draws_.size() * sizeof(DrawData),
+                     draws_.data(),
+                     GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                     draws_.size() * sizeof(DrawCommand),
+                     commands_.data(),
+                     GL_STREAM_DRAW);
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES,
+                                    GL_UNSIGNED_INT,
+                                    nullptr,
+                                    static_cast<GLsizei>(draws_.size()),
+                                    sizeof(DrawCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        drawCalls_ = 1;
+    } else {
+        glDisableVertexAttribArray(materialLocation);
+
+        // Disabled arrays read the current attribute value instead
+        for (size_t i = 0; i < draws_.size(); ++i) {
+            const DrawData& draw = draws_[i];
+            const DrawCommand& command = commands_[i];
+
+            for (GLuint column = 0; column < 4; ++column)
+                glVertexAttrib4fv(modelLocation + column, draw.model + column * 4);
+
+            glVertexAttribI1ui(materialLocation, draw.material);
+            glDrawElementsBaseVertex(GL_TRIANGLES,
+                                     static_cast<GLsizei>(command.count),
+                                     GL_UNSIGNED_INT,
+                                     reinterpret_cast<const void*>(command.firstIndex
+                                                                   * sizeof(GLuint)),
+                                     command.baseVertex);
+        }
+
+        drawCalls_ = draws_.size();
+    }
+
+    glBindVertexArray(0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, materialBinding, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    Shader::UnUseShader();
+}
+
+void
+MaterialBatch::CreateBuffers()
+{
+    glGenVertexArrays(1, &VAO_);
+    glGenBuffers(1, &VBO_);
+    glGenBuffers(1, &IBO_);
+    glGenBuffers(1, &drawBuffer_);
+    glGenBuffers(1, &indirectBuffer_);
+    glGenBuffers(1, &UBO_);
+
+    // The whole block, a range smaller than the shader's array is an error
+    // on some drivers
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO_);
+    glBufferData(GL_UNIFORM_BUFFER, maxMaterials * sizeof(MaterialData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindVertexArray(VAO_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glVertexAttribPointer(0,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, position)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1,
+                          2,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, texCoord)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          sizeof(Vertex),
+                          reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+    glEnableVertexAttribArray(2);
+
+    // One row per instance; each draw is a single instance whose
+    // baseInstance is its row
+    glBindBuffer(GL_ARRAY_BUFFER, drawBuffer_);
+
+    for (GLuint column = 0; column < 4; ++column) {
+        glVertexAttribPointer(modelLocation + column,
+                              4,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              sizeof(DrawData),
+                              reinterpret_cast<const void*>(column * 4 * sizeof(GLfloat)));
+        glVertexAttribDivisor(modelLocation + column, 1);
+    }
+
+    glVertexAttribIPointer(materialLocation,
+                           1,
+                           GL_UNSIGNED_INT,
+                           sizeof(DrawData),
+                           reinterpret_cast<const void*>(offsetof(DrawData, material)));
+    glVertexAttribDivisor(materialLocation, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void
+MaterialBatch::UploadGeometry()
+{
+    glBindVertexArray(VAO_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glBufferData(GL_ARRAY_BUFFER,
+                 vertices_.size() * sizeof(Vertex),
+                 vertices_.data(),
+                 GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 indices_.size() * sizeof(GLuint),
+                 indices_.data(),
+                 GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    geometryDirty_ = false;
+}
+
+void
+MaterialBatch::ClearBatch()
+{
+    GLuint* buffers[] = {&VBO_, &IBO_, &drawBuffer_, &indirectBuffer_, &UBO_};
+
+    for (GLuint* buffer : buffers) {
+        if (*buffer != 0) {
+            glDeleteBuffers(1, buffer);
+            *buffer = 0;
+        }
+    }
+
+    if (VAO_ != 0) {
+        glDeleteVertexArrays(1, &VAO_);
+        VAO_ = 0;
+    }
+
+    textures_.ClearTexture();
+    vertices_.clear();
+    indices_.clear();
+    meshes_.clear();
+    materials_.clear();
+    draws_.clear();
+    commands_.clear();
+    geometryDirty_ = false;
+    materialsDirty_ = false;
+    drawCalls_ = 0;
+}
@@ -0,0 +1,168 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "Shader.h"
+#include "Texture.h"
+
+// Meshes with different materials drawn without a texture or buffer bind
+// between them.
+//
+// Every mesh is appended to one vertex and one index buffer, every material
+// texture is a layer of one 2D texture array and the material table is a
+// uniform block, so nothing changes between draws but the per-draw model
+// matrix and material index. Those are instanced vertex attributes, one row
+// per draw. With GL 4.3 (or ARB_multi_draw_indirect and ARB_base_instance)
+// Render issues the frame's draws as a single glMultiDrawElementsIndirect,
+// each command's baseInstance picking its row; otherwise it loops over
+// glDrawElementsBaseVertex with the row set as constant attributes.
+class MaterialBatch
+{
+public:
+    static const uint32_t maxMaterials = 256;
+    static const uint32_t invalidIndex = 0xFFFFFFFF;
+
+    // Uniform buffer binding point of the material table
+    static const GLuint materialBinding = 1;
+
+    // MeshImporter's layout, locations 0 to 2
+    struct Vertex
+    {
+        GLfloat position[3];
+        GLfloat texCoord[2];
+        GLfloat normal[3];
+    };
+
+    // textureLayer -1 uses baseColor alone, otherwise it multiplies the layer
+    struct Material
+    {
+        glm::vec4 baseColor {1.0f};
+        GLint textureLayer {-1};
+    };
+
+    MaterialBatch();
+    ~MaterialBatch();
+
+    MaterialBatch(const MaterialBatch&) = delete;
+    MaterialBatch& operator=(const MaterialBatch&) = delete;
+
+    // Shaders/material.vert and Shaders/material.frag
+    void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
+
+    // The texture array all materials sample, layers of width by height with
+    // their mips. Filled through GetTextures (SetImage, LoadLayerFromFile,
+    // TextureStreamer); until the array IsReady textured materials sample
+    // black. levels 0 is the full mip chain, files given to
+    // LoadLayerFromFile need at least levels of their own.
+    bool CreateTextures(GLsizei width,
+                        GLsizei height,
+                        GLsizei layers,
+                        GLenum internalFormat = GL_RGBA8,
+                        GLsizei levels = 0);
+    Texture& GetTextures()
+    {
+        return textures_;
+    }
+
+    // Returns the mesh's index, invalidIndex when the batch can't take it
+    uint32_t AddMesh(const Vertex* vertices,
+                     GLsizei vertexCount,
+                     const GLuint* indices,
+                     GLsizei indexCount);
+
+    // Returns the material's index, invalidIndex once maxMaterials exist
+    uint32_t AddMaterial(const Material& material);
+    void SetMaterial(uint32_t index, const Material& material);
+
+    // Draws are collected between BeginFrame and Render
+    void BeginFrame();
+    void AddDraw(uint32_t mesh, uint32_t material, const glm::mat4& model);
+    void Render(const glm::mat4& projection);
+
+    // Off forces the per-draw loop, for comparison
+    void SetMultiDraw(bool multiDraw)
+    {
+        multiDraw_ = multiDraw;
+    }
+    bool IsMultiDrawSupported() const;
+
+    size_t GetDrawCount() const
+    {
+        return draws_.size();
+    }
+    // GL draw calls of the last Render, 1 when multi-draw was used
+    size_t GetDrawCalls() const
+    {
+        return drawCalls_;
+    }
+
+    void ClearBatch();
+
+private:
+    // One instanced row, locations 3 to 6 (model) and 7 (material)
+    struct DrawData
+    {
+        GLfloat model[16];
+        GLuint material;
+        GLuint padding[3];
+    };
+
+    // glMultiDrawElementsIndirect's command layout
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct MeshRange
+    {
+        GLuint firstIndex;
+        GLsizei indexCount;
+        GLint baseVertex;
+    };
+
+    // std140 layout of one material in the uniform block
+    struct MaterialData
+    {
+        GLfloat baseColor[4];
+        GLint texture[4];
+    };
+
+    Shader shader_;
+    GLint uniformProjection_ {-1};
+
+    Texture textures_;
+
+    GLuint VAO_ {0};
+    GLuint VBO_ {0};
+    GLuint IBO_ {0};
+    GLuint drawBuffer_ {0};
+    GLuint indirectBuffer_ {0};
+    GLuint UBO_ {0};
+
+    std::vector<Vertex> vertices_;
+    std::vector<GLuint> indices_;
+    std::vector<MeshRange> meshes_;
+    bool geometryDirty_ {false};
+
+    std::vector<MaterialData> materials_;
+    bool materialsDirty_ {false};
+
+    std::vector<DrawData> draws_;
+    std::vector<DrawCommand> commands_;
+    bool multiDraw_ {true};
+    size_t drawCalls_ {0};
+
+    void CreateBuffers();
+    void UploadGeometry();
+};
@@ -1,5 +1,17 @@
 ﻿#include "Mesh.h"
 
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "GlStats.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "Tracing.h"
+#include "TriangleBvh.h"
+
 Mesh::Mesh() {}
 
 Mesh::~Mesh()
@@ -13,7 +25,72 @@ Mesh::CreateMesh(GLfloat* vertices,
                  unsigned int numOfVertices,
                  unsigned int numOfIndices)
 {
+    // x, y, z -> 3 value a vertex
+    // location 0
+    VertexAttribute position;
+
+    CreateMesh(vertices,
+               sizeof(vertices[0]) * numOfVertices,
+               sizeof(vertices[0]) * 3,
+               &position,
+               1,
+               indices,
+               numOfIndices,
+               GL_UNSIGNED_INT);
+
+    if (numOfVertices >= 3) {
+        boundsMin_ = boundsMax_ = glm::vec3(vertices[0], vertices[1], vertices[2]);
+
+        for (unsigned int i = 3; i + 2 < numOfVertices; i += 3) {
+            glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+            boundsMin_ = glm::min(boundsMin_, position);
+            boundsMax_ = glm::max(boundsMax_, position);
+        }
+    }
+}
+
+void
+Mesh::CreateMesh(const void* vertexData,
+                 GLsizeiptr vertexDataSize,
+                 GLsizei vertexStride,
+                 const VertexAttribute* attributes,
+                 unsigned int numOfAttributes,
+                 const void* indexData,
+                 GLsizei numOfIndices,
+                 GLenum indexType)
+{
+    TRACE_SCOPE("Mesh::CreateMesh");
+
     indexCount_ = numOfIndices;
+    indexType_ = indexType;
+
+    lods_.assign(1, Lod {0, numOfIndices, 0.0f});
+    currentLod_ = 0;
+
+    culler_.ClearCuller();
+    clustersCulled_ = false;
+
+    pickBvh_.reset();
+    pickPositions_.clear();
+    pickIndices_.clear();
+
+    if (pickable_ && vertexData && indexData) {
+        for (unsigned int i = 0; i < numOfAttributes; ++i) {
+            if (attributes[i].location == 0 && attributes[i].type == GL_FLOAT
+                && attributes[i].components >= 3) {
+                SetPickingGeometry(vertexData,
+                                   vertexDataSize,
+                                   vertexStride,
+                                   attributes[i].offset,
+                                   indexData,
+                                   numOfIndices,
+                                   indexType);
+                break;
+            }
+        }
+    }
+
+    const GLsizeiptr indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
 
     // VAO
     glGenVertexArrays(1, &VAO_);
@@ -22,22 +99,27 @@ Mesh::CreateMesh(GLfloat* vertices,
     // IBO (EBO)
     glGenBuffers(1, &IBO_);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 sizeof(indices[0]) * numOfIndices,
-                 indices,
-                 GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * numOfIndices, indexData, GL_STATIC_DRAW);
 
     // VBO
     glGenBuffers(1, &VBO_);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(indices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexDataSize, vertexData, GL_STATIC_DRAW);
 
     // Now IBO and the VBO are binded to VAO
 
-    // x, y, z -> 3 value a vertex
-    // location 0
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    for (unsigned int i = 0; i < numOfAttributes; ++i) {
+        const VertexAttribute& attribute = attributes[i];
+
+        glVertexAttribPointer(attribute.location,
+                              attribute.components,
+                              attribute.type,
+                              attribute.normalized,
+                              vertexStride,
+                              reinterpret_cast<const void*>(
+                                  static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(attribute.location);
+    }
 
     // unbind VAO, VBO
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -48,13 +130,298 @@ Mesh::CreateMesh(GLfloat* vertices,
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+bool
+Mesh::CreateFromFile(const char* fileLocation)
+{
+    TRACE_SCOPE("Mesh::CreateFromFile");
+
+    const char* extension = strrchr(fileLocation, '.');
+
+    // Source formats go through the importer, everything else is a container
+    if (extension && (strcmp(extension, ".obj") == 0 || strcmp(extension, ".ply") == 0)) {
+        MeshImporter importer;
+
+        if (!importer.Import(fileLocation))
+            return false;
+
+        VertexAttribute attributes[3];
+        unsigned int numOfAttributes = importer.GetAttributes(attributes);
+
+        std::vector<unsigned int> lodIndices;
+        std::vector<Lod> lods;
+        MeshSimplifier::BuildLodChain(importer.GetVertices(),
+                                      importer.GetStride(),
+                                      importer.GetIndices(),
+                                      MeshFileHeader::maxLods,
+                                      lodIndices,
+                                      lods);
+
+        // Dense meshes also get LOD 0 split into clusters for culling
+        std::vector<Meshlet> meshlets;
+        if (lods[0].indexCount / 3 >= static_cast<GLsizei>(MeshletBuilder::minTriangles)) {
+            meshlets = MeshletBuilder::Build(importer.GetVertices(),
+                                             importer.GetStride(),
+                                             lodIndices.data(),
+                                             lods[0].indexCount);
+        }
+
+        CreateMesh(importer.GetVertices().data(),
+                   sizeof(GLfloat) * importer.GetVertices().size(),
+                   sizeof(GLfloat) * importer.GetStride(),
+                   attributes,
+                   numOfAttributes,
+                   lodIndices.data(),
+                   static_cast<GLsizei>(lodIndices.size()),
+                   GL_UNSIGNED_INT);
+
+        SetLods(lods);
+        SetMeshlets(meshlets);
+        boundsMin_ = importer.GetBoundsMin();
+        boundsMax_ = importer.GetBoundsMax();
+
+        return true;
+    }
+
+    MeshFile file;
+
+    if (!file.Open(fileLocation))
+        return false;
+
+    const MeshFileHeader& header = file.GetHeader();
+
+    VertexAttribute attributes[MeshFileHeader::maxAttributes];
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        attributes[i].location = header.attributes[i].location;
+        attributes[i].components = header.attributes[i].components;
+        attributes[i].type = header.attributes[i].type;
+        attributes[i].normalized = header.attributes[i].normalized ? GL_TRUE : GL_FALSE;
+        attributes[i].offset = header.attributes[i].offset;
+    }
+
+    const uint64_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    // Straight from the mapping, the pages are read by the driver copy
+    CreateMesh(file.GetVertexData(),
+               static_cast<GLsizeiptr>(header.vertexDataSize),
+               header.vertexStride,
+               attributes,
+               header.attributeCount,
+               file.GetIndexData(),
+               static_cast<GLsizei>(header.indexDataSize / indexSize),
+               header.indexType);
+
+    std::vector<Lod> lods(header.lodCount);
+    for (uint32_t i = 0; i < header.lodCount; ++i) {
+        lods[i].firstIndex = static_cast<GLsizei>(header.lods[i].firstIndex);
+        lods[i].indexCount = static_cast<GLsizei>(header.lods[i].indexCount);
+        lods[i].error = header.lods[i].error;
+    }
+
+    SetLods(lods);
+
+    boundsMin_ = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax_ = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    return true;
+}
+
+void
+Mesh::SetLods(const std::vector<Lod>& lods)
+{
+    if (lods.empty()) {
+        lods_.assign(1, Lod {0, indexCount_, 0.0f});
+    } else {
+        lods_ = lods;
+    }
+
+    currentLod_ = 0;
+}
+
+void
+Mesh::SelectLod(const glm::mat4& modelView,
+                const glm::mat4& projection,
+                float viewportHeight,
+                float pixelError)
+{
+    currentLod_ = 0;
+
+    if (lods_.size() < 2)
+        return;
+
+    // Largest axis scale, errors and the radius are in object space
+    const float scale = std::max(glm::length(glm::vec3(modelView[0])),
+                                 std::max(glm::length(glm::vec3(modelView[1])),
+                                          glm::length(glm::vec3(modelView[2]))));
+
+    const glm::vec3 center = (boundsMin_ + boundsMax_) * 0.5f;
+    const float radius = glm::length(boundsMax_ - boundsMin_) * 0.5f * scale;
+    const float distance = -glm::vec3(modelView * glm::vec4(center, 1.0f)).z - radius;
+
+    // Camera inside the sphere, keep full detail
+    if (distance <= 0.0f)
+        return;
+
+    // Perspective projection: [1][1] = cot(fovy / 2)
+    const float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f / distance;
+
+    for (unsigned int lod = static_cast<unsigned int>(lods_.size()) - 1; lod > 0; --lod) {
+        if (lods_[lod].error * scale * pixelsPerUnit <= pixelError) {
+            currentLod_ = lod;
+            return;
+        }
+    }
+}
+
+void
+Mesh::CullClusters(const glm::mat4& modelView, const glm::mat4& projection, ThreadPool* pool)
+{
+    clustersCulled_ = false;
+
+    if (currentLod_ != 0 || culler_.GetClusterCount() == 0)
+        return;
+
+    culler_.Cull(modelView,
+                 projection,
+                 indexType_ == GL_UNSIGNED_SHORT ? 2 : 4,
+                 clusterCounts_,
+                 clusterOffsets_,
+                 pool);
+
+    clustersCulled_ = true;
+}
+
+void
+Mesh::SetPickingGeometry(const void* vertexData,
+                         GLsizeiptr vertexDataSize,
+                         GLsizei vertexStride,
+                         GLuint positionOffset,
+                         const void* indexData,
+                         GLsizei numOfIndices,
+                         GLenum indexType)
+{
+    pickBvh_.reset();
+
+    const char* vertexBytes = static_cast<const char*>(vertexData);
+    const size_t numOfVertices = static_cast<size_t>(vertexDataSize / vertexStride);
+
+    pickPositions_.resize(numOfVertices);
+    for (size_t i = 0; i < numOfVertices; ++i) {
+        memcpy(&pickPositions_[i],
+               vertexBytes + i * vertexStride + positionOffset,
+               sizeof(glm::vec3));
+    }
+
+    pickIndices_.resize(numOfIndices);
+    if (indexType == GL_UNSIGNED_SHORT) {
+        const uint16_t* indices = static_cast<const uint16_t*>(indexData);
+        std::copy(indices, indices + numOfIndices, pickIndices_.begin());
+    } else {
+        memcpy(pickIndices_.data(), indexData, sizeof(uint32_t) * numOfIndices);
+    }
+}
+
+bool
+Mesh::Pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, MeshHit& hit)
+{
+    if (!pickBvh_) {
+        if (pickIndices_.empty() || lods_.empty())
+            return false;
+
+        // LOD 0 only, coarser LODs are never picked
+        const Lod& lod = lods_[0];
+        const std::vector<uint32_t> indices(pickIndices_.begin() + lod.firstIndex,
+                                            pickIndices_.begin() + lod.firstIndex + lod.indexCount);
+
+        pickBvh_.reset(new TriangleBvh());
+        pickBvh_->Build(pickPositions_, indices);
+
+        std::vector<glm::vec3>().swap(pickPositions_);
+        std::vector<uint32_t>().swap(pickIndices_);
+    }
+
+    TriangleBvh::Hit triangleHit;
+
+    if (!pickBvh_->Raycast(origin, direction, maxDistance, triangleHit))
+        return false;
+
+    hit.mesh = this;
+    hit.triangle = triangleHit.triangle;
+    hit.barycentrics = glm::vec3(1.0f - triangleHit.u - triangleHit.v,
+                                 triangleHit.u,
+                                 triangleHit.v);
+    hit.distance = triangleHit.distance;
+
+    return true;
+}
+
+void
+Mesh::BeginUpload()
+{
+    uploading_ = true;
+}
+
+void
+Mesh::EndUpload(GLsync fence)
+{
+    uploading_ = false;
+
+    if (uploadFence_)
+        glDeleteSync(uploadFence_);
+
+    uploadFence_ = fence;
+}
+
+bool
+Mesh::IsReady()
+{
+    if (VAO_ == 0 || uploading_)
+        return false;
+
+    if (uploadFence_) {
+        // Poll only, never wait on the GPU here
+        GLenum result = glClientWaitSync(uploadFence_, 0, 0);
+
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return false;
+
+        glDeleteSync(uploadFence_);
+        uploadFence_ = nullptr;
+    }
+
+    return true;
+}
+
 void
 Mesh::RenderMesh()
 {
+    TRACE_SCOPE("Mesh::RenderMesh");
+
+    // The cull result only holds for this draw
+    const bool culled = clustersCulled_ && currentLod_ == 0;
+    clustersCulled_ = false;
+
+    if (!IsReady() || (culled && clusterCounts_.empty()))
+        return;
+
     glBindVertexArray(VAO_);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO_);
 
-    glDrawElements(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, 0);
+    if (culled) {
+        glMultiDrawElements(GL_TRIANGLES,
+                            clusterCounts_.data(),
+                            indexType_,
+                            clusterOffsets_.data(),
+                            static_cast<GLsizei>(clusterCounts_.size()));
+    } else {
+        const Lod& lod = lods_[currentLod_];
+        const GLsizeiptr indexSize = indexType_ == GL_UNSIGNED_SHORT ? 2 : 4;
+
+        glDrawElements(GL_TRIANGLES,
+                       lod.indexCount,
+                       indexType_,
+                       reinterpret_cast<const void*>(
+                           static_cast<uintptr_t>(indexSize * lod.firstIndex)));
+    }
 
     glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -78,5 +445,20 @@ Mesh::ClearMesh()
         VAO_ = 0;
     }
 
+    if (uploadFence_) {
+        glDeleteSync(uploadFence_);
+        uploadFence_ = nullptr;
+    }
+
+    uploading_ = false;
     indexCount_ = 0;
+    indexType_ = GL_UNSIGNED_INT;
+    lods_.clear();
+    currentLod_ = 0;
+    culler_.ClearCuller();
+    clustersCulled_ = false;
+    pickPositions_.clear();
+    pickIndices_.clear();
+    pickBvh_.reset();
+    boundsMin_ = boundsMax_ = glm::vec3(0.0f);
 }
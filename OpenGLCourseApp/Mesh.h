@@ -1,23 +1,200 @@
 ﻿#pragma once
 
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
 #include <GL/glew.h>
 
+#include <glm.hpp>
+
+#include "ClusterCuller.h"
+
+class ThreadPool;
+class TriangleBvh;
+
 class Mesh
 {
 public:
+    // One attribute of an interleaved vertex
+    struct VertexAttribute
+    {
+        GLuint location {0};
+        GLint components {3};
+        GLenum type {GL_FLOAT};
+        GLboolean normalized {GL_FALSE};
+        GLuint offset {0};
+    };
+
+    // A range of the index buffer, LOD 0 is the full detail mesh. error is the
+    // object space distance the simplified surface may be off by.
+    struct Lod
+    {
+        GLsizei firstIndex {0};
+        GLsizei indexCount {0};
+        float error {0.0f};
+    };
+
+    // Result of Pick, triangle counts from the start of LOD 0
+    struct MeshHit
+    {
+        const Mesh* mesh {nullptr};
+        uint32_t triangle {0};
+        // Weights of the triangle's three vertices at the hit point
+        glm::vec3 barycentrics {0.0f};
+        // In units of the ray direction
+        float distance {0.0f};
+    };
+
     Mesh();
     ~Mesh();
 
+    // numOfVertices is the number of floats, x, y, z per vertex
     void CreateMesh(GLfloat* vertices,
                     unsigned int* indices,
                     unsigned int numOfVertices,
                     unsigned int numOfIndices);
+
+    // Uploads interleaved vertex and index blobs as they are (no copies),
+    // bounds are left to the caller
+    void CreateMesh(const void* vertexData,
+                    GLsizeiptr vertexDataSize,
+                    GLsizei vertexStride,
+                    const VertexAttribute* attributes,
+                    unsigned int numOfAttributes,
+                    const void* indexData,
+                    GLsizei numOfIndices,
+                    GLenum indexType);
+
+    // Loads a binary mesh container (see MeshFile.h), or imports .obj/.ply
+    // and builds its LOD chain (see MeshSimplifier.h)
+    bool CreateFromFile(const char* fileLocation);
+
     void RenderMesh();
     void ClearMesh();
 
+    // Streamed creation (see AssetStreamer): CreateMesh with null data allocates
+    // the buffers, the data is copied in over several frames and the mesh only
+    // renders once the fence after the last copy has signalled.
+    void BeginUpload();
+    void EndUpload(GLsync fence);
+    bool IsReady();
+
+    GLuint GetVertexBuffer() const
+    {
+        return VBO_;
+    }
+    GLuint GetIndexBuffer() const
+    {
+        return IBO_;
+    }
+
+    void SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        boundsMin_ = boundsMin;
+        boundsMax_ = boundsMax;
+    }
+
+    // Ranges into the index buffer, coarser LODs later. CreateMesh resets to a
+    // single LOD covering every index.
+    void SetLods(const std::vector<Lod>& lods);
+    unsigned int GetLodCount() const
+    {
+        return static_cast<unsigned int>(lods_.size());
+    }
+
+    // Picks the coarsest LOD whose error, projected at the nearest point of the
+    // bounding sphere, stays within pixelError pixels. modelView places the mesh
+    // in view space, viewportHeight is in pixels.
+    void SelectLod(const glm::mat4& modelView,
+                   const glm::mat4& projection,
+                   float viewportHeight,
+                   float pixelError = 1.0f);
+    void SetLod(unsigned int lod)
+    {
+        currentLod_ = lod < lods_.size() ? lod : 0;
+    }
+    unsigned int GetLod() const
+    {
+        return currentLod_;
+    }
+
+    // Clusters of LOD 0 (see MeshletBuilder.h), the index buffer must already
+    // be in meshlet order
+    void SetMeshlets(const std::vector<Meshlet>& meshlets)
+    {
+        culler_.SetMeshlets(meshlets);
+    }
+    size_t GetVisibleClusterCount() const
+    {
+        return culler_.GetVisibleCount();
+    }
+
+    // Culls the LOD 0 clusters for the next RenderMesh only, which then draws the
+    // visible ones with a single glMultiDrawElements. No effect on other LODs or
+    // meshes without meshlets.
+    void CullClusters(const glm::mat4& modelView,
+                      const glm::mat4& projection,
+                      ThreadPool* pool = nullptr);
+
+    // Pickable meshes keep a CPU copy of positions and indices from CreateMesh
+    // (the float position at location 0), set before CreateMesh
+    void SetPickable(bool pickable)
+    {
+        pickable_ = pickable;
+    }
+    bool IsPickable() const
+    {
+        return pickable_;
+    }
+
+    // The same copy for meshes created without data (see AssetStreamer)
+    void SetPickingGeometry(const void* vertexData,
+                            GLsizeiptr vertexDataSize,
+                            GLsizei vertexStride,
+                            GLuint positionOffset,
+                            const void* indexData,
+                            GLsizei numOfIndices,
+                            GLenum indexType);
+
+    // Nearest LOD 0 triangle along an object space ray. The first call builds a
+    // triangle BVH (see TriangleBvh.h) and drops the CPU copy.
+    bool Pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, MeshHit& hit);
+
+    // Object space AABB
+    const glm::vec3& GetBoundsMin() const
+    {
+        return boundsMin_;
+    }
+    const glm::vec3& GetBoundsMax() const
+    {
+        return boundsMax_;
+    }
+
 private:
     GLuint VAO_ {0};
     GLuint VBO_ {0};
     GLuint IBO_ {0};
     GLsizei indexCount_ {0};
+    GLenum indexType_ {GL_UNSIGNED_INT};
+
+    std::vector<Lod> lods_;
+    unsigned int currentLod_ {0};
+
+    ClusterCuller culler_;
+    std::vector<GLsizei> clusterCounts_;
+    std::vector<const void*> clusterOffsets_;
+    bool clustersCulled_ {false};
+
+    bool pickable_ {false};
+    std::vector<glm::vec3> pickPositions_;
+    std::vector<uint32_t> pickIndices_;
+    std::unique_ptr<TriangleBvh> pickBvh_;
+
+    bool uploading_ {false};
+    GLsync uploadFence_ {nullptr};
+
+    glm::vec3 boundsMin_ {0.0f};
+    glm::vec3 boundsMax_ {0.0f};
 };
@@ -0,0 +1,223 @@
+﻿#include "MeshFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+const char meshFileMagic[4] = {'O', 'G', 'L', 'M'};
+
+// GL_MAX_VERTEX_ATTRIBS is at least this everywhere
+const uint32_t maxLocations = 16;
+
+uint64_t
+AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Bytes of one component, 0 for types glVertexAttribPointer doesn't take here
+uint32_t
+ComponentSize(uint32_t type)
+{
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Whether [offset, offset + length) lies within size bytes, without overflow
+bool
+FitsIn(uint64_t offset, uint64_t length, uint64_t size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+template <typename Index>
+bool
+IndicesBelow(const char* data, uint64_t count, uint32_t vertexCount)
+{
+    const Index* indices = reinterpret_cast<const Index*>(data);
+
+    for (uint64_t i = 0; i < count; ++i) {
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+MeshFile::MeshFile() {}
+
+MeshFile::~MeshFile()
+{
+    Close();
+}
+
+bool
+MeshFile::Open(const char* fileLocation)
+{
+    if (!file_.Open(fileLocation))
+        return false;
+
+    if (!Validate(fileLocation)) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void
+MeshFile::Close()
+{
+    file_.Close();
+}
+
+const void*
+MeshFile::GetVertexData() const
+{
+    return file_.GetData() + GetHeader().vertexDataOffset;
+}
+
+const void*
+MeshFile::GetIndexData() const
+{
+    return file_.GetData() + GetHeader().indexDataOffset;
+}
+
+bool
+MeshFile::Validate(const char* fileLocation) const
+{
+    const size_t size = file_.GetSize();
+
+    if (size < sizeof(MeshFileHeader)) {
+        printf("Mesh %s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    const MeshFileHeader& header = GetHeader();
+
+    if (memcmp(header.magic, meshFileMagic, sizeof(meshFileMagic)) != 0) {
+        printf("%s is not a mesh file!\n", fileLocation);
+        return false;
+    }
+
+    if (header.version != currentVersion) {
+        printf("Mesh %s has unsupported version %u!\n", fileLocation, header.version);
+        return false;
+    }
+
+    const uint64_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    // Indices are read in place below, so their blob must be aligned for them
+    if ((header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+        || header.attributeCount == 0 || header.attributeCount > MeshFileHeader::maxAttributes
+        || header.lodCount == 0 || header.lodCount > MeshFileHeader::maxLods
+        || header.vertexStride == 0
+        || header.vertexDataSize != static_cast<uint64_t>(header.vertexStride) * header.vertexCount
+        || !FitsIn(header.vertexDataOffset, header.vertexDataSize, size)
+        || !FitsIn(header.indexDataOffset, header.indexDataSize, size)
+        || header.indexDataOffset % indexSize != 0) {
+        printf("Mesh %s has a corrupt header!\n", fileLocation);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        const MeshFileAttribute& attribute = header.attributes[i];
+        const uint32_t componentSize = ComponentSize(attribute.type);
+
+        if (componentSize == 0 || attribute.components == 0 || attribute.components > 4
+            || attribute.location >= maxLocations
+            || !FitsIn(attribute.offset,
+                       static_cast<uint64_t>(attribute.components) * componentSize,
+                       header.vertexStride)) {
+            printf("Mesh %s attribute %u is out of range!\n", fileLocation, i);
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.lodCount; ++i) {
+        const MeshFileLod& lod = header.lods[i];
+
+        if ((static_cast<uint64_t>(lod.firstIndex) + lod.indexCount) * indexSize
+            > header.indexDataSize) {
+            printf("Mesh %s LOD %u is out of range!\n", fileLocation, i);
+            return false;
+        }
+    }
+
+    // Every index in the blob, not just the LODs', names a vertex
+    const char* indexData = file_.GetData() + header.indexDataOffset;
+    const uint64_t indexCount = header.indexDataSize / indexSize;
+    const bool indicesValid =
+        header.indexType == GL_UNSIGNED_SHORT
+            ? IndicesBelow<uint16_t>(indexData, indexCount, header.vertexCount)
+            : IndicesBelow<uint32_t>(indexData, indexCount, header.vertexCount);
+
+    if (!indicesValid) {
+        printf("Mesh %s has indices past its %u vertices!\n", fileLocation, header.vertexCount);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+MeshFile::Write(const char* fileLocation,
+                MeshFileHeader header,
+                const void* vertexData,
+                const void* indexData)
+{
+    memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+    header.version = currentVersion;
+
+    header.vertexDataSize = static_cast<uint64_t>(header.vertexStride) * header.vertexCount;
+    header.vertexDataOffset = AlignUp(sizeof(MeshFileHeader), blobAlignment);
+    header.indexDataOffset = AlignUp(header.vertexDataOffset + header.vertexDataSize,
+                                     blobAlignment);
+
+    FILE* file = fopen(fileLocation, "wb");
+
+    if (!file) {
+        printf("Failed to write mesh %s!\n", fileLocation);
+        return false;
+    }
+
+    const std::vector<char> padding(blobAlignment, 0);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    ok = ok
+         && fwrite(padding.data(), 1, header.vertexDataOffset - sizeof(header), file)
+                == header.vertexDataOffset - sizeof(header);
+    ok = ok
+         && fwrite(vertexData, 1, header.vertexDataSize, file) == header.vertexDataSize;
+
+    const uint64_t vertexEnd = header.vertexDataOffset + header.vertexDataSize;
+    ok = ok
+         && fwrite(padding.data(), 1, header.indexDataOffset - vertexEnd, file)
+                == header.indexDataOffset - vertexEnd;
+    ok = ok && fwrite(indexData, 1, header.indexDataSize, file) == header.indexDataSize;
+
+    if (fclose(file) != 0 || !ok) {
+        printf("Failed to write mesh %s!\n", fileLocation);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "MappedFile.h"
+
+// Binary mesh container (.oglm)
+//
+// [MeshFileHeader][pad][vertex blob][pad][index blob]
+//
+// Blobs are aligned to MeshFile::blobAlignment so the memory mapped file can be
+// handed straight to glBufferData. All LODs share the vertex blob and store their
+// indices back to back in the index blob, LOD 0 first. Little endian only.
+struct MeshFileAttribute
+{
+    uint32_t location;
+    uint32_t components;
+    uint32_t type; // GL_FLOAT, GL_UNSIGNED_BYTE...
+    uint32_t normalized;
+    uint32_t offset; // bytes from the start of the vertex
+};
+
+struct MeshFileLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // object space simplification error, 0 for LOD 0
+    uint32_t reserved;
+};
+
+struct MeshFileHeader
+{
+    static const uint32_t maxAttributes = 8;
+    static const uint32_t maxLods = 8;
+
+    char magic[4]; // "OGLM"
+    uint32_t version;
+
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t attributeCount;
+    uint32_t indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+
+    float boundsMin[3];
+    float boundsMax[3];
+
+    uint32_t lodCount;
+    uint32_t reserved;
+
+    MeshFileAttribute attributes[maxAttributes];
+    MeshFileLod lods[maxLods];
+};
+
+// Read-only memory mapping of a mesh container
+class MeshFile
+{
+public:
+    static const uint32_t currentVersion = 1;
+    static const size_t blobAlignment = 64;
+
+    MeshFile();
+    ~MeshFile();
+
+    // Maps the file and validates the header, the attribute layout and that
+    // every index names a vertex; the vertex blob is not touched
+    bool Open(const char* fileLocation);
+    void Close();
+
+    const MeshFileHeader& GetHeader() const
+    {
+        return *reinterpret_cast<const MeshFileHeader*>(file_.GetData());
+    }
+
+    // Pointers into the mapping, valid until Close()
+    const void* GetVertexData() const;
+    const void* GetIndexData() const;
+
+    // Fills in magic, version, offsets and sizes of the header and writes the container
+    static bool Write(const char* fileLocation,
+                      MeshFileHeader header,
+                      const void* vertexData,
+                      const void* indexData);
+
+private:
+    MappedFile file_;
+
+    bool Validate(const char* fileLocation) const;
+};
@@ -0,0 +1,985 @@
+﻿#include "MeshImporter.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace {
+
+// Below this everything is parsed on the calling thread
+const size_t minChunkSize = 1 << 20;
+
+const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                              1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                              1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Runs function(chunk) for every chunk, chunk 0 on the calling thread
+template<typename Function>
+void
+ParallelFor(unsigned int chunkCount, Function function)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(chunkCount);
+
+    for (unsigned int i = 1; i < chunkCount; ++i)
+        workers.emplace_back(function, i);
+
+    function(0);
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+inline bool
+IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool
+IsDigit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline const char*
+SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+        ++p;
+
+    return p;
+}
+
+// Decimal float without locale lookups or a terminating zero.
+// Returns the end of the number, or nullptr if there is none.
+const char*
+ParseFloat(const char* p, const char* end, GLfloat& value)
+{
+    p = SkipSpaces(p, end);
+
+    const char* start = p;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool anyDigit = false;
+
+    for (; p < end && IsDigit(*p); ++p) {
+        anyDigit = true;
+
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (++p; p < end && IsDigit(*p); ++p) {
+            anyDigit = true;
+
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+
+    if (!anyDigit) {
+        // nan, inf and friends are rare enough for strtod
+        char buffer[32] {0};
+        size_t length = std::min(static_cast<size_t>(end - start), sizeof(buffer) - 1);
+        memcpy(buffer, start, length);
+
+        char* stop = nullptr;
+        value = strtof(buffer, &stop);
+
+        return stop == buffer ? nullptr : start + (stop - buffer);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+
+        if (e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = *e == '-';
+            ++e;
+        }
+
+        if (e < end && IsDigit(*e)) {
+            int explicitExponent = 0;
+
+            for (; e < end && IsDigit(*e); ++e) {
+                if (explicitExponent < 10000)
+                    explicitExponent = explicitExponent * 10 + (*e - '0');
+            }
+
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = e;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+
+    if (exponent < 0) {
+        result = -exponent <= 22 ? result / powersOfTen[-exponent] : result * pow(10.0, exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 22 ? result * powersOfTen[exponent] : result * pow(10.0, exponent);
+    }
+
+    value = static_cast<GLfloat>(negative ? -result : result);
+
+    return p;
+}
+
+const char*
+ParseInt(const char* p, const char* end, int64_t& value)
+{
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    if (p >= end || !IsDigit(*p))
+        return nullptr;
+
+    int64_t result = 0;
+    for (; p < end && IsDigit(*p); ++p)
+        result = result * 10 + (*p - '0');
+
+    value = negative ? -result : result;
+
+    return p;
+}
+
+// ---------------------------------------------------------------------------
+// OBJ
+// ---------------------------------------------------------------------------
+
+// One face corner, attributes are 0: position, 1: texcoord, 2: normal
+struct ObjCorner
+{
+    int64_t index[3];
+    uint8_t present;
+    // Negative OBJ indices are resolved against the chunk first and need the
+    // attribute count of all previous chunks added later
+    uint8_t chunkRelative;
+};
+
+struct ObjChunk
+{
+    std::vector<GLfloat> positions;
+    std::vector<GLfloat> texCoords;
+    std::vector<GLfloat> normals;
+
+    // Triangulated, three per triangle
+    std::vector<ObjCorner> corners;
+
+    size_t base[3] {0, 0, 0};
+    bool hasTexCoords {false};
+    bool hasNormals {false};
+    bool ok {true};
+};
+
+void
+ParseObjFace(const char* p, const char* lineEnd, ObjChunk& chunk, std::vector<ObjCorner>& face)
+{
+    face.clear();
+
+    const size_t counts[3] = {chunk.positions.size() / 3,
+                              chunk.texCoords.size() / 2,
+                              chunk.normals.size() / 3};
+
+    for (p = SkipSpaces(p, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd)) {
+        ObjCorner corner;
+        memset(&corner, 0, sizeof(corner));
+
+        // v, v/vt, v//vn, v/vt/vn
+        for (unsigned int k = 0; k < 3; ++k) {
+            if (k > 0) {
+                if (p >= lineEnd || *p != '/')
+                    break;
+                ++p;
+            }
+
+            if (k > 0 && p < lineEnd && *p == '/')
+                continue;
+
+            int64_t raw = 0;
+            p = ParseInt(p, lineEnd, raw);
+
+            if (!p || raw == 0) {
+                chunk.ok = false;
+                return;
+            }
+
+            if (raw > 0) {
+                corner.index[k] = raw - 1;
+            } else {
+                corner.index[k] = static_cast<int64_t>(counts[k]) + raw;
+                corner.chunkRelative |= 1 << k;
+            }
+
+            corner.present |= 1 << k;
+        }
+
+        if (!(corner.present & 1)) {
+            chunk.ok = false;
+            return;
+        }
+
+        face.push_back(corner);
+
+        // Ignore anything glued to the corner we do not understand
+        while (p < lineEnd && !IsSpace(*p))
+            ++p;
+    }
+
+    // Fan triangulation
+    for (size_t i = 2; i < face.size(); ++i) {
+        chunk.corners.push_back(face[0]);
+        chunk.corners.push_back(face[i - 1]);
+        chunk.corners.push_back(face[i]);
+    }
+}
+
+void
+ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    std::vector<ObjCorner> face;
+
+    while (p < end && chunk.ok) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+
+        p = SkipSpaces(p, lineEnd);
+
+        if (lineEnd - p >= 2 && p[0] == 'v' && IsSpace(p[1])) {
+            GLfloat xyz[3] {0.0f, 0.0f, 0.0f};
+            const char* q = p + 2;
+
+            for (unsigned int i = 0; i < 3 && q; ++i)
+                q = ParseFloat(q, lineEnd, xyz[i]);
+
+            chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+        } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) {
+            GLfloat uv[2] {0.0f, 0.0f};
+            const char* q = p + 3;
+
+            for (unsigned int i = 0; i < 2 && q; ++i)
+                q = ParseFloat(q, lineEnd, uv[i]);
+
+            chunk.texCoords.insert(chunk.texCoords.end(), uv, uv + 2);
+        } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2])) {
+            GLfloat normal[3] {0.0f, 0.0f, 0.0f};
+            const char* q = p + 3;
+
+            for (unsigned int i = 0; i < 3 && q; ++i)
+                q = ParseFloat(q, lineEnd, normal[i]);
+
+            chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+        } else if (lineEnd - p >= 2 && p[0] == 'f' && IsSpace(p[1])) {
+            ParseObjFace(p + 2, lineEnd, chunk, face);
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+const unsigned int emptySlot = ~0u;
+
+// Open addressing map from a (position, texcoord, normal) corner to an output vertex
+class CornerWelder
+{
+public:
+    explicit CornerWelder(size_t expectedVertices)
+    {
+        size_t capacity = 64;
+        while (capacity < expectedVertices * 2)
+            capacity *= 2;
+
+        table_.assign(capacity, emptySlot);
+    }
+
+    // Returns the vertex of the corner and whether it was just added
+    unsigned int Insert(const uint32_t key[3], bool& added)
+    {
+        if ((keys_.size() / 3 + 1) * 2 > table_.size())
+            Grow();
+
+        const size_t mask = table_.size() - 1;
+
+        for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+            const unsigned int vertex = table_[slot];
+
+            if (vertex == emptySlot) {
+                const unsigned int next = static_cast<unsigned int>(keys_.size() / 3);
+                keys_.insert(keys_.end(), key, key + 3);
+                table_[slot] = next;
+                added = true;
+                return next;
+            }
+
+            const uint32_t* existing = &keys_[static_cast<size_t>(vertex) * 3];
+            if (existing[0] == key[0] && existing[1] == key[1] && existing[2] == key[2]) {
+                added = false;
+                return vertex;
+            }
+        }
+    }
+
+private:
+    std::vector<unsigned int> table_;
+    std::vector<uint32_t> keys_;
+
+    static size_t Hash(const uint32_t key[3])
+    {
+        uint64_t h = key[0] * 0x9E3779B97F4A7C15ull;
+        h ^= (key[1] + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        h ^= (key[2] + 0x165667B19E3779F9ull) * 0x85EBCA77C2B2AE63ull;
+        h ^= h >> 29;
+
+        return static_cast<size_t>(h);
+    }
+
+    void Grow()
+    {
+        table_.assign(table_.size() * 2, emptySlot);
+        const size_t mask = table_.size() - 1;
+
+        for (size_t vertex = 0; vertex < keys_.size() / 3; ++vertex) {
+            size_t slot = Hash(&keys_[vertex * 3]) & mask;
+            while (table_[slot] != emptySlot)
+                slot = (slot + 1) & mask;
+
+            table_[slot] = static_cast<unsigned int>(vertex);
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// PLY
+// ---------------------------------------------------------------------------
+
+enum class PlyType { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type {PlyType::Invalid};
+    bool isList {false};
+    PlyType countType {PlyType::Invalid};
+    size_t offset {0}; // fixed size elements only
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count {0};
+    std::vector<PlyProperty> properties;
+    bool fixedSize {true};
+    size_t stride {0};
+};
+
+PlyType
+ParsePlyType(const std::string& name)
+{
+    if (name == "char" || name == "int8")
+        return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::UInt8;
+    if (name == "short" || name == "int16")
+        return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::UInt16;
+    if (name == "int" || name == "int32")
+        return PlyType::Int32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::UInt32;
+    if (name == "float" || name == "float32")
+        return PlyType::Float32;
+    if (name == "double" || name == "float64")
+        return PlyType::Float64;
+
+    return PlyType::Invalid;
+}
+
+size_t
+PlyTypeSize(PlyType type)
+{
+    switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template<typename T>
+T
+ReadRaw(const char* p, bool swapBytes)
+{
+    T value;
+
+    if (swapBytes) {
+        char reversed[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i)
+            reversed[i] = p[sizeof(T) - 1 - i];
+
+        memcpy(&value, reversed, sizeof(T));
+    } else {
+        memcpy(&value, p, sizeof(T));
+    }
+
+    return value;
+}
+
+double
+ReadPly(const char* p, PlyType type, bool swapBytes)
+{
+    switch (type) {
+    case PlyType::Int8:
+        return ReadRaw<int8_t>(p, false);
+    case PlyType::UInt8:
+        return ReadRaw<uint8_t>(p, false);
+    case PlyType::Int16:
+        return ReadRaw<int16_t>(p, swapBytes);
+    case PlyType::UInt16:
+        return ReadRaw<uint16_t>(p, swapBytes);
+    case PlyType::Int32:
+        return ReadRaw<int32_t>(p, swapBytes);
+    case PlyType::UInt32:
+        return ReadRaw<uint32_t>(p, swapBytes);
+    case PlyType::Float32:
+        return ReadRaw<float>(p, swapBytes);
+    case PlyType::Float64:
+        return ReadRaw<double>(p, swapBytes);
+    default:
+        return 0.0;
+    }
+}
+
+int
+FindProperty(const PlyElement& element, const char* name, const char* alternative = nullptr)
+{
+    for (size_t i = 0; i < element.properties.size(); ++i) {
+        const std::string& property = element.properties[i].name;
+
+        if (property == name || (alternative && property == alternative))
+            return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+} // namespace
+
+MeshImporter::MeshImporter() {}
+
+MeshImporter::~MeshImporter() {}
+
+bool
+MeshImporter::Import(const char* fileLocation)
+{
+    vertices_.clear();
+    indices_.clear();
+    stride_ = 3;
+    hasTexCoords_ = hasNormals_ = false;
+    seconds_ = 0.0;
+    bytes_ = 0;
+
+    const char* extension = strrchr(fileLocation, '.');
+    const bool isObj = extension
+                       && (strcmp(extension, ".obj") == 0 || strcmp(extension, ".OBJ") == 0);
+    const bool isPly = extension
+                       && (strcmp(extension, ".ply") == 0 || strcmp(extension, ".PLY") == 0);
+
+    if (!isObj && !isPly) {
+        printf("Unsupported mesh format %s!\n", fileLocation);
+        return false;
+    }
+
+    std::chrono::high_resolution_clock::time_point start =
+        std::chrono::high_resolution_clock::now();
+
+    MappedFile file;
+    if (!file.Open(fileLocation))
+        return false;
+
+    const bool ok = isObj ? ImportObj(file.GetData(), file.GetSize())
+                          : ImportPly(file.GetData(), file.GetSize());
+
+    if (!ok || indices_.empty()) {
+        printf("Failed to import %s!\n", fileLocation);
+        vertices_.clear();
+        indices_.clear();
+        return false;
+    }
+
+    ComputeBounds();
+
+    std::chrono::high_resolution_clock::time_point stop =
+        std::chrono::high_resolution_clock::now();
+    seconds_ = std::chrono::duration<double>(stop - start).count();
+    bytes_ = file.GetSize();
+
+    printf("Imported %s: %zu vertices, %zu triangles, %.1f MB in %.3f s (%.1f MB/s)\n",
+           fileLocation,
+           vertices_.size() / stride_,
+           indices_.size() / 3,
+           bytes_ / (1024.0 * 1024.0),
+           seconds_,
+           GetThroughput());
+
+    return true;
+}
+
+unsigned int
+MeshImporter::GetAttributes(Mesh::VertexAttribute* attributes) const
+{
+    unsigned int count = 0;
+    GLuint offset = 0;
+
+    attributes[count].location = positionLocation;
+    attributes[count].components = 3;
+    attributes[count].offset = offset;
+    offset += sizeof(GLfloat) * 3;
+    ++count;
+
+    if (hasTexCoords_) {
+        attributes[count].location = texCoordLocation;
+        attributes[count].components = 2;
+        attributes[count].offset = offset;
+        offset += sizeof(GLfloat) * 2;
+        ++count;
+    }
+
+    if (hasNormals_) {
+        attributes[count].location = normalLocation;
+        attributes[count].components = 3;
+        attributes[count].offset = offset;
+        ++count;
+    }
+
+    return count;
+}
+
+bool
+MeshImporter::ImportObj(const char* data, size_t size)
+{
+    const char* end = data + size;
+
+    // Chunks start right after a line break
+    unsigned int chunkCount = static_cast<unsigned int>(
+        std::max<size_t>(1, std::min<size_t>(ThreadCount(), size / minChunkSize)));
+
+    std::vector<const char*> chunkStart(chunkCount + 1, end);
+    chunkStart[0] = data;
+
+    for (unsigned int i = 1; i < chunkCount; ++i) {
+        const char* p = std::max(data + size / chunkCount * i, chunkStart[i - 1]);
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        chunkStart[i] = lineEnd ? lineEnd + 1 : end;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+
+    ParallelFor(chunkCount, [&](unsigned int i) {
+        ParseObjChunk(chunkStart[i], chunkStart[i + 1], chunks[i]);
+    });
+
+    size_t totals[3] {0, 0, 0};
+    size_t cornerCount = 0;
+
+    for (ObjChunk& chunk : chunks) {
+        if (!chunk.ok)
+            return false;
+
+        chunk.base[0] = totals[0];
+        chunk.base[1] = totals[1];
+        chunk.base[2] = totals[2];
+
+        totals[0] += chunk.positions.size() / 3;
+        totals[1] += chunk.texCoords.size() / 2;
+        totals[2] += chunk.normals.size() / 3;
+        cornerCount += chunk.corners.size();
+    }
+
+    if (cornerCount > 0xFFFFFFFFull || totals[0] >= 0xFFFFFFFFull)
+        return false;
+
+    // Resolve every corner to an absolute index
+    ParallelFor(chunkCount, [&](unsigned int i) {
+        ObjChunk& chunk = chunks[i];
+
+        for (ObjCorner& corner : chunk.corners) {
+            for (unsigned int k = 0; k < 3; ++k) {
+                if (!(corner.present & (1 << k)))
+                    continue;
+
+                if (corner.chunkRelative & (1 << k))
+                    corner.index[k] += static_cast<int64_t>(chunk.base[k]);
+
+                if (corner.index[k] < 0 || corner.index[k] >= static_cast<int64_t>(totals[k])) {
+                    chunk.ok = false;
+                    return;
+                }
+            }
+
+            chunk.hasTexCoords |= (corner.present & 2) != 0;
+            chunk.hasNormals |= (corner.present & 4) != 0;
+        }
+    });
+
+    for (const ObjChunk& chunk : chunks) {
+        if (!chunk.ok)
+            return false;
+
+        hasTexCoords_ |= chunk.hasTexCoords;
+        hasNormals_ |= chunk.hasNormals;
+    }
+
+    stride_ = 3 + (hasTexCoords_ ? 2 : 0) + (hasNormals_ ? 3 : 0);
+
+    // Gather the attribute streams so resolved indices can address them directly
+    std::vector<GLfloat> positions, texCoords, normals;
+    positions.reserve(totals[0] * 3);
+    texCoords.reserve(totals[1] * 2);
+    normals.reserve(totals[2] * 3);
+
+    for (ObjChunk& chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+        std::vector<GLfloat>().swap(chunk.positions);
+        std::vector<GLfloat>().swap(chunk.texCoords);
+        std::vector<GLfloat>().swap(chunk.normals);
+    }
+
+    // Weld identical corners into interleaved vertices
+    CornerWelder welder(totals[0]);
+    indices_.reserve(cornerCount);
+    vertices_.reserve(totals[0] * stride_);
+
+    const uint32_t absent = ~0u;
+
+    for (const ObjChunk& chunk : chunks) {
+        for (const ObjCorner& corner : chunk.corners) {
+            const uint32_t key[3] = {
+                static_cast<uint32_t>(corner.index[0]),
+                (corner.present & 2) ? static_cast<uint32_t>(corner.index[1]) : absent,
+                (corner.present & 4) ? static_cast<uint32_t>(corner.index[2]) : absent};
+
+            bool added = false;
+            indices_.push_back(welder.Insert(key, added));
+
+            if (!added)
+                continue;
+
+            const GLfloat* position = &positions[static_cast<size_t>(key[0]) * 3];
+            vertices_.insert(vertices_.end(), position, position + 3);
+
+            if (hasTexCoords_) {
+                if (key[1] != absent) {
+                    const GLfloat* uv = &texCoords[static_cast<size_t>(key[1]) * 2];
+                    vertices_.insert(vertices_.end(), uv, uv + 2);
+                } else {
+                    vertices_.insert(vertices_.end(), 2, 0.0f);
+                }
+            }
+
+            if (hasNormals_) {
+                if (key[2] != absent) {
+                    const GLfloat* normal = &normals[static_cast<size_t>(key[2]) * 3];
+                    vertices_.insert(vertices_.end(), normal, normal + 3);
+                } else {
+                    vertices_.insert(vertices_.end(), 3, 0.0f);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool
+MeshImporter::ImportPly(const char* data, size_t size)
+{
+    const char* end = data + size;
+    const char* p = data;
+
+    std::vector<PlyElement> elements;
+    bool binary = false;
+    bool swapBytes = false;
+    bool headerDone = false;
+
+    const uint16_t endianProbe = 1;
+    const bool hostLittleEndian = *reinterpret_cast<const uint8_t*>(&endianProbe) == 1;
+
+    // The header is a handful of lines, plain strings are fine here
+    while (p < end && !headerDone) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            return false;
+
+        std::istringstream line(std::string(p, lineEnd));
+        std::string keyword;
+        line >> keyword;
+
+        if (p == data && keyword != "ply") {
+            return false;
+        } else if (keyword == "format") {
+            std::string format;
+            line >> format;
+
+            if (format == "binary_little_endian") {
+                binary = true;
+                swapBytes = !hostLittleEndian;
+            } else if (format == "binary_big_endian") {
+                binary = true;
+                swapBytes = hostLittleEndian;
+            }
+        } else if (keyword == "element") {
+            PlyElement element;
+            line >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            PlyElement& element = elements.back();
+            PlyProperty property;
+            std::string type;
+            line >> type;
+
+            if (type == "list") {
+                std::string countType, itemType;
+                line >> countType >> itemType;
+
+                property.isList = true;
+                property.countType = ParsePlyType(countType);
+                property.type = ParsePlyType(itemType);
+                element.fixedSize = false;
+            } else {
+                property.type = ParsePlyType(type);
+                property.offset = element.stride;
+                element.stride += PlyTypeSize(property.type);
+            }
+
+            line >> property.name;
+
+            if (property.type == PlyType::Invalid
+                || (property.isList && property.countType == PlyType::Invalid)) {
+                return false;
+            }
+
+            element.properties.push_back(property);
+        } else if (keyword == "end_header") {
+            headerDone = true;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    if (!headerDone || !binary) {
+        printf("Only binary PLY files are supported!\n");
+        return false;
+    }
+
+    size_t vertexCount = 0;
+
+    for (const PlyElement& element : elements) {
+        if (element.name == "vertex") {
+            const int x = FindProperty(element, "x");
+            const int y = FindProperty(element, "y");
+            const int z = FindProperty(element, "z");
+
+            if (!element.fixedSize || x < 0 || y < 0 || z < 0
+                || static_cast<size_t>(end - p) / element.stride < element.count) {
+                return false;
+            }
+
+            const int u = std::max(FindProperty(element, "u", "s"),
+                                   FindProperty(element, "texture_u", "texture_s"));
+            const int v = std::max(FindProperty(element, "v", "t"),
+                                   FindProperty(element, "texture_v", "texture_t"));
+            const int nx = FindProperty(element, "nx");
+            const int ny = FindProperty(element, "ny");
+            const int nz = FindProperty(element, "nz");
+
+            hasTexCoords_ = u >= 0 && v >= 0;
+            hasNormals_ = nx >= 0 && ny >= 0 && nz >= 0;
+            stride_ = 3 + (hasTexCoords_ ? 2 : 0) + (hasNormals_ ? 3 : 0);
+
+            std::vector<int> sources = {x, y, z};
+            if (hasTexCoords_) {
+                sources.push_back(u);
+                sources.push_back(v);
+            }
+            if (hasNormals_) {
+                sources.push_back(nx);
+                sources.push_back(ny);
+                sources.push_back(nz);
+            }
+
+            vertexCount = element.count;
+            vertices_.resize(vertexCount * stride_);
+
+            // Fixed stride records convert independently
+            const unsigned int chunkCount = static_cast<unsigned int>(std::max<size_t>(
+                1, std::min<size_t>(ThreadCount(), vertexCount * element.stride / minChunkSize)));
+            const char* records = p;
+
+            ParallelFor(chunkCount, [&](unsigned int chunk) {
+                const size_t begin = vertexCount * chunk / chunkCount;
+                const size_t last = vertexCount * (chunk + 1) / chunkCount;
+
+                for (size_t i = begin; i < last; ++i) {
+                    const char* record = records + i * element.stride;
+                    GLfloat* out = &vertices_[i * stride_];
+
+                    for (size_t s = 0; s < sources.size(); ++s) {
+                        const PlyProperty& property = element.properties[sources[s]];
+                        out[s] = static_cast<GLfloat>(
+                            ReadPly(record + property.offset, property.type, swapBytes));
+                    }
+                }
+            });
+
+            p += vertexCount * element.stride;
+        } else if (element.name == "face") {
+            const int list = FindProperty(element, "vertex_indices", "vertex_index");
+            if (list < 0 || !element.properties[list].isList)
+                return false;
+
+            indices_.reserve(element.count * 3);
+            std::vector<unsigned int> face;
+
+            for (size_t f = 0; f < element.count; ++f) {
+                for (size_t i = 0; i < element.properties.size(); ++i) {
+                    const PlyProperty& property = element.properties[i];
+                    const size_t itemSize = PlyTypeSize(property.type);
+
+                    if (!property.isList) {
+                        if (static_cast<size_t>(end - p) < itemSize)
+                            return false;
+
+                        p += itemSize;
+                        continue;
+                    }
+
+                    const size_t countSize = PlyTypeSize(property.countType);
+                    if (static_cast<size_t>(end - p) < countSize)
+                        return false;
+
+                    const size_t count = static_cast<size_t>(
+                        ReadPly(p, property.countType, swapBytes));
+                    p += countSize;
+
+                    if (static_cast<size_t>(end - p) / itemSize < count)
+                        return false;
+
+                    if (static_cast<int>(i) != list) {
+                        p += count * itemSize;
+                        continue;
+                    }
+
+                    face.clear();
+                    for (size_t c = 0; c < count; ++c, p += itemSize) {
+                        const double index = ReadPly(p, property.type, swapBytes);
+
+                        if (index < 0.0 || index >= static_cast<double>(vertexCount))
+                            return false;
+
+                        face.push_back(static_cast<unsigned int>(index));
+                    }
+
+                    for (size_t c = 2; c < face.size(); ++c) {
+                        indices_.push_back(face[0]);
+                        indices_.push_back(face[c - 1]);
+                        indices_.push_back(face[c]);
+                    }
+                }
+            }
+        } else if (element.fixedSize) {
+            if (static_cast<size_t>(end - p) / std::max<size_t>(element.stride, 1) < element.count)
+                return false;
+
+            p += element.count * element.stride;
+        } else {
+            // Unknown element with lists, walk it
+            for (size_t e = 0; e < element.count; ++e) {
+                for (const PlyProperty& property : element.properties) {
+                    size_t count = 1;
+
+                    if (property.isList) {
+                        const size_t countSize = PlyTypeSize(property.countType);
+                        if (static_cast<size_t>(end - p) < countSize)
+                            return false;
+
+                        count = static_cast<size_t>(ReadPly(p, property.countType, swapBytes));
+                        p += countSize;
+                    }
+
+                    if (static_cast<size_t>(end - p) / PlyTypeSize(property.type) < count)
+                        return false;
+
+                    p += count * PlyTypeSize(property.type);
+                }
+            }
+        }
+    }
+
+    // Vertex welding is not needed, PLY vertices are already shared
+    return !vertices_.empty();
+}
+
+void
+MeshImporter::ComputeBounds()
+{
+    boundsMin_ = boundsMax_ = glm::vec3(vertices_[0], vertices_[1], vertices_[2]);
+
+    for (size_t i = stride_; i + 2 < vertices_.size(); i += stride_) {
+        glm::vec3 position(vertices_[i], vertices_[i + 1], vertices_[i + 2]);
+        boundsMin_ = glm::min(boundsMin_, position);
+        boundsMax_ = glm::max(boundsMax_, position);
+    }
+}
+
+unsigned int
+MeshImporter::ThreadCount() const
+{
+    if (threadCount_ > 0)
+        return threadCount_;
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
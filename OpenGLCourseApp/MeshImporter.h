@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "Mesh.h"
+
+// Wavefront OBJ and PLY (binary) importer producing Mesh-ready interleaved buffers.
+// The file is memory mapped and parsed in parallel chunks.
+class MeshImporter
+{
+public:
+    // Attribute locations of the interleaved vertex
+    static const GLuint positionLocation = 0;
+    static const GLuint texCoordLocation = 1;
+    static const GLuint normalLocation = 2;
+
+    MeshImporter();
+    ~MeshImporter();
+
+    // 0 uses every hardware thread
+    void SetThreadCount(unsigned int threadCount)
+    {
+        threadCount_ = threadCount;
+    }
+
+    // .obj or .ply by extension
+    bool Import(const char* fileLocation);
+
+    // Interleaved x, y, z [u, v] [nx, ny, nz]
+    std::vector<GLfloat>& GetVertices()
+    {
+        return vertices_;
+    }
+    std::vector<unsigned int>& GetIndices()
+    {
+        return indices_;
+    }
+
+    // Floats per vertex
+    unsigned int GetStride() const
+    {
+        return stride_;
+    }
+
+    // Fills up to 3 attributes for Mesh::CreateMesh, returns how many
+    unsigned int GetAttributes(Mesh::VertexAttribute* attributes) const;
+
+    const glm::vec3& GetBoundsMin() const
+    {
+        return boundsMin_;
+    }
+    const glm::vec3& GetBoundsMax() const
+    {
+        return boundsMax_;
+    }
+
+    // Input megabytes per second of the last import
+    double GetThroughput() const
+    {
+        return seconds_ > 0.0 ? bytes_ / (1024.0 * 1024.0) / seconds_ : 0.0;
+    }
+
+private:
+    std::vector<GLfloat> vertices_;
+    std::vector<unsigned int> indices_;
+    unsigned int stride_ {3};
+    bool hasTexCoords_ {false};
+    bool hasNormals_ {false};
+
+    glm::vec3 boundsMin_ {0.0f};
+    glm::vec3 boundsMax_ {0.0f};
+
+    unsigned int threadCount_ {0};
+    double seconds_ {0.0};
+    size_t bytes_ {0};
+
+    bool ImportObj(const char* data, size_t size);
+    bool ImportPly(const char* data, size_t size);
+
+    void ComputeBounds();
+    unsigned int ThreadCount() const;
+};
@@ -0,0 +1,487 @@
+﻿#include "MeshOptimizer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include <glm.hpp>
+
+namespace {
+
+// Forsyth "Linear-Speed Vertex Cache Optimisation" tuning values
+const unsigned int forsythCacheSize = 32;
+const float cacheDecayPower = 1.5f;
+const float lastTriScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+// Hardware-like FIFO used for the overdraw clustering
+const unsigned int overdrawCacheSize = 16;
+
+float
+ScoreVertex(int cachePosition, unsigned int remainingValence)
+{
+    // No triangles left, never pick it again
+    if (remainingValence == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // Used by the triangle just emitted, slightly penalised so
+            // strips do not keep bouncing around the same fan
+            score = lastTriScore;
+        } else {
+            const float scaler = 1.0f / (forsythCacheSize - 3);
+            score = 1.0f - (cachePosition - 3) * scaler;
+            score = powf(score, cacheDecayPower);
+        }
+    }
+
+    // Boost vertices with few triangles left so lone triangles get finished
+    score += valenceBoostScale * powf(static_cast<float>(remainingValence), -valenceBoostPower);
+
+    return score;
+}
+
+glm::vec3
+Position(const std::vector<GLfloat>& vertices, unsigned int stride, unsigned int index)
+{
+    const GLfloat* v = &vertices[static_cast<size_t>(index) * stride];
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+// Hash/equality on the raw vertex data for welding
+struct VertexHasher
+{
+    const GLfloat* data;
+    unsigned int stride;
+
+    size_t operator()(unsigned int index) const
+    {
+        const GLfloat* v = data + static_cast<size_t>(index) * stride;
+
+        // FNV-1a over the float bits, -0.0 folded into 0.0
+        size_t hash = 2166136261u;
+        for (unsigned int i = 0; i < stride; ++i) {
+            unsigned int bits = 0;
+            GLfloat value = v[i] == 0.0f ? 0.0f : v[i];
+            memcpy(&bits, &value, sizeof(bits));
+            hash = (hash ^ bits) * 16777619u;
+        }
+
+        return hash;
+    }
+};
+
+struct VertexEqual
+{
+    const GLfloat* data;
+    unsigned int stride;
+
+    bool operator()(unsigned int lhs, unsigned int rhs) const
+    {
+        const GLfloat* a = data + static_cast<size_t>(lhs) * stride;
+        const GLfloat* b = data + static_cast<size_t>(rhs) * stride;
+
+        for (unsigned int i = 0; i < stride; ++i) {
+            if (a[i] != b[i])
+                return false;
+        }
+
+        return true;
+    }
+};
+
+} // namespace
+
+void
+MeshOptimizer::Optimize(std::vector<GLfloat>& vertices,
+                        std::vector<unsigned int>& indices,
+                        unsigned int stride)
+{
+    if (stride < 3 || vertices.size() % stride != 0 || indices.size() % 3 != 0) {
+        printf("Mesh optimizer: unsupported layout (stride %u, %zu floats, %zu indices)\n",
+               stride,
+               vertices.size(),
+               indices.size());
+        return;
+    }
+
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+
+    for (unsigned int index : indices) {
+        if (index >= vertexCount) {
+            printf("Mesh optimizer: index %u out of range (%u vertices)\n", index, vertexCount);
+            return;
+        }
+    }
+
+    VertexCacheStatistics before = AnalyzeVertexCache(indices, vertexCount);
+
+    unsigned int weldedCount = WeldVertices(vertices, indices, stride);
+    OptimizeVertexCache(indices, weldedCount);
+    OptimizeOverdraw(indices, vertices, stride);
+    OptimizeVertexFetch(vertices, indices, stride);
+
+    const unsigned int optimizedCount = static_cast<unsigned int>(vertices.size() / stride);
+    VertexCacheStatistics after = AnalyzeVertexCache(indices, optimizedCount);
+
+    printf("Mesh optimizer: %u -> %u vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+           vertexCount,
+           optimizedCount,
+           before.acmr,
+           after.acmr,
+           before.atvr,
+           after.atvr);
+}
+
+unsigned int
+MeshOptimizer::WeldVertices(std::vector<GLfloat>& vertices,
+                            std::vector<unsigned int>& indices,
+                            unsigned int stride)
+{
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+
+    std::unordered_map<unsigned int, unsigned int, VertexHasher, VertexEqual> unique(
+        vertexCount,
+        VertexHasher {vertices.data(), stride},
+        VertexEqual {vertices.data(), stride});
+
+    // remap[old] = new, new vertices are compacted towards the front in place
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<GLfloat> welded;
+    welded.reserve(vertices.size());
+
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        unsigned int next = static_cast<unsigned int>(welded.size() / stride);
+        auto it = unique.emplace(v, next);
+
+        if (it.second) {
+            welded.insert(welded.end(),
+                          vertices.begin() + static_cast<size_t>(v) * stride,
+                          vertices.begin() + static_cast<size_t>(v + 1) * stride);
+        }
+
+        remap[v] = it.first->second;
+    }
+
+    for (unsigned int& index : indices)
+        index = remap[index];
+
+    // unique holds pointers into vertices, swap only once it is done
+    vertices.swap(welded);
+
+    return static_cast<unsigned int>(vertices.size() / stride);
+}
+
+void
+MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0 || vertexCount == 0)
+        return;
+
+    // Vertex -> triangle adjacency (CSR), the live range of each vertex
+    // shrinks as its triangles get emitted
+    std::vector<unsigned int> valence(vertexCount, 0);
+    for (unsigned int index : indices)
+        ++valence[index];
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + valence[v];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+        vertexScore[v] = ScoreVertex(-1, valence[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+
+    long long bestTriangle = -1;
+    float bestScore = -1.0f;
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+                           + vertexScore[indices[t * 3 + 2]];
+
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            bestTriangle = static_cast<long long>(t);
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(forsythCacheSize + 3);
+    nextCache.reserve(forsythCacheSize + 3);
+
+    size_t cursor = 0;
+
+    while (result.size() < indices.size()) {
+        if (bestTriangle < 0) {
+            // Nothing adjacent to the cache, restart from the next unused triangle
+            while (emitted[cursor])
+                ++cursor;
+
+            bestTriangle = static_cast<long long>(cursor);
+        }
+
+        const size_t best = static_cast<size_t>(bestTriangle);
+        emitted[best] = 1;
+
+        const unsigned int* tri = &indices[best * 3];
+
+        nextCache.clear();
+
+        for (unsigned int k = 0; k < 3; ++k) {
+            const unsigned int v = tri[k];
+            result.push_back(v);
+
+            // Remove the triangle from the live adjacency of v
+            const unsigned int begin = offsets[v];
+            const unsigned int end = begin + valence[v];
+            for (unsigned int i = begin; i < end; ++i) {
+                if (adjacency[i] == best) {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    break;
+                }
+            }
+            --valence[v];
+
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                nextCache.push_back(v);
+        }
+
+        // LRU: emitted vertices move to the front
+        for (unsigned int v : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                nextCache.push_back(v);
+        }
+
+        // Update scores of everything that moved, including what fell out
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            const unsigned int v = nextCache[i];
+            cachePosition[v] = i < forsythCacheSize ? static_cast<int>(i) : -1;
+
+            const float score = ScoreVertex(cachePosition[v], valence[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            for (unsigned int a = offsets[v], end = offsets[v] + valence[v]; a < end; ++a)
+                triangleScore[adjacency[a]] += delta;
+        }
+
+        if (nextCache.size() > forsythCacheSize)
+            nextCache.resize(forsythCacheSize);
+
+        cache.swap(nextCache);
+
+        // Next triangle is the best live one touching the cache
+        bestTriangle = -1;
+        bestScore = -1.0f;
+
+        for (unsigned int v : cache) {
+            for (unsigned int a = offsets[v], end = offsets[v] + valence[v]; a < end; ++a) {
+                const unsigned int t = adjacency[a];
+
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void
+MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices,
+                                const std::vector<GLfloat>& vertices,
+                                unsigned int stride,
+                                float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+
+    if (triangleCount < 2)
+        return;
+
+    const VertexCacheStatistics meshStats = AnalyzeVertexCache(indices, vertexCount,
+                                                               overdrawCacheSize);
+
+    // Cluster boundaries: a triangle that misses the cache on all three vertices
+    // starts a new cluster (hard boundary). A triangle missing two vertices does
+    // too, once the running cluster ACMR is within threshold of the mesh ACMR.
+    std::vector<size_t> clusterStart;
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = overdrawCacheSize + 1;
+    unsigned int clusterMisses = 0;
+    size_t clusterTriangles = 0;
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        unsigned int misses = 0;
+
+        for (unsigned int k = 0; k < 3; ++k) {
+            const unsigned int v = indices[t * 3 + k];
+            if (time - cacheTime[v] > overdrawCacheSize) {
+                cacheTime[v] = time++;
+                ++misses;
+            }
+        }
+
+        const bool hardBoundary = misses == 3;
+        const bool softBoundary = misses == 2 && clusterTriangles > 0
+                                  && clusterMisses
+                                         <= meshStats.acmr * threshold * clusterTriangles;
+
+        if (t == 0 || hardBoundary || softBoundary) {
+            clusterStart.push_back(t);
+            clusterMisses = 0;
+            clusterTriangles = 0;
+        }
+
+        clusterMisses += misses;
+        ++clusterTriangles;
+    }
+
+    if (clusterStart.size() < 2)
+        return;
+
+    clusterStart.push_back(triangleCount);
+
+    const size_t clusterCount = clusterStart.size() - 1;
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterArea(clusterCount, 0.0f);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; ++c) {
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t) {
+            const glm::vec3 p0 = Position(vertices, stride, indices[t * 3]);
+            const glm::vec3 p1 = Position(vertices, stride, indices[t * 3 + 1]);
+            const glm::vec3 p2 = Position(vertices, stride, indices[t * 3 + 2]);
+
+            // Length of the cross product is twice the area, both sums scale the same
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+            const glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+            clusterCentroid[c] += centroid * area;
+            clusterNormal[c] += normal;
+            clusterArea[c] += area;
+
+            meshCentroid += centroid * area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the mesh centre are the most likely occluders, draw them first
+    std::vector<float> sortKey(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        const float normalLength = glm::length(clusterNormal[c]);
+        if (clusterArea[c] <= 0.0f || normalLength <= 0.0f)
+            continue;
+
+        const glm::vec3 centroid = clusterCentroid[c] / clusterArea[c];
+        sortKey[c] = glm::dot(centroid - meshCentroid, clusterNormal[c] / normalLength);
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+
+    std::stable_sort(order.begin(), order.end(), [&sortKey](size_t lhs, size_t rhs) {
+        return sortKey[lhs] > sortKey[rhs];
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    for (size_t c : order) {
+        result.insert(result.end(),
+                      indices.begin() + clusterStart[c] * 3,
+                      indices.begin() + clusterStart[c + 1] * 3);
+    }
+
+    indices.swap(result);
+}
+
+void
+MeshOptimizer::OptimizeVertexFetch(std::vector<GLfloat>& vertices,
+                                   std::vector<unsigned int>& indices,
+                                   unsigned int stride)
+{
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+    const unsigned int unused = ~0u;
+
+    std::vector<unsigned int> remap(vertexCount, unused);
+    std::vector<GLfloat> reordered;
+    reordered.reserve(vertices.size());
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<unsigned int>(reordered.size() / stride);
+            reordered.insert(reordered.end(),
+                             vertices.begin() + static_cast<size_t>(index) * stride,
+                             vertices.begin() + static_cast<size_t>(index + 1) * stride);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
+
+MeshOptimizer::VertexCacheStatistics
+MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices,
+                                  unsigned int vertexCount,
+                                  unsigned int cacheSize)
+{
+    VertexCacheStatistics stats;
+
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+
+    // A vertex is cached if fewer than cacheSize misses happened since it was loaded
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<char> referenced(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int uniqueVertices = 0;
+
+    for (unsigned int index : indices) {
+        if (time - cacheTime[index] > cacheSize) {
+            cacheTime[index] = time++;
+            ++stats.vertexTransforms;
+        }
+
+        if (!referenced[index]) {
+            referenced[index] = 1;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(stats.vertexTransforms) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(stats.vertexTransforms) / uniqueVertices;
+
+    return stats;
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+// At-load geometry optimization for indexed triangle lists.
+// Vertices are tightly packed GLfloat arrays of "stride" floats per vertex,
+// the first three of which are the position (x, y, z).
+class MeshOptimizer
+{
+public:
+    struct VertexCacheStatistics
+    {
+        unsigned int vertexTransforms {0};
+        // Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0)
+        float acmr {0.0f};
+        // Average transform to vertex ratio: transformed vertices per vertex (1.0 is ideal)
+        float atvr {0.0f};
+    };
+
+    // Weld, vertex cache, overdraw and vertex fetch passes, in that order.
+    // Prints an ACMR/ATVR report before and after.
+    static void Optimize(std::vector<GLfloat>& vertices,
+                         std::vector<unsigned int>& indices,
+                         unsigned int stride);
+
+    // Merges bitwise identical vertices and rewrites indices; returns the new vertex count
+    static unsigned int WeldVertices(std::vector<GLfloat>& vertices,
+                                     std::vector<unsigned int>& indices,
+                                     unsigned int stride);
+
+    // Reorders triangles for the post-transform vertex cache (Forsyth)
+    static void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount);
+
+    // Splits the cache optimized order into clusters and sorts them front to back
+    // from the outside of the mesh in. A threshold above 1 trades some ACMR for smaller clusters.
+    static void OptimizeOverdraw(std::vector<unsigned int>& indices,
+                                 const std::vector<GLfloat>& vertices,
+                                 unsigned int stride,
+                                 float threshold = 1.05f);
+
+    // Reorders vertices by first use so fetches walk the vertex buffer linearly.
+    // Unreferenced vertices are dropped.
+    static void OptimizeVertexFetch(std::vector<GLfloat>& vertices,
+                                    std::vector<unsigned int>& indices,
+                                    unsigned int stride);
+
+    // Simulates a FIFO post-transform cache of the given size
+    static VertexCacheStatistics AnalyzeVertexCache(const std::vector<unsigned int>& indices,
+                                                    unsigned int vertexCount,
+                                                    unsigned int cacheSize = 16);
+};
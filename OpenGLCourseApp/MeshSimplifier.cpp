@@ -0,0 +1,395 @@
+﻿#include "MeshSimplifier.h"
+
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+namespace {
+
+// Symmetric 4x4 plane quadric, plus the total area it was built from
+struct Quadric
+{
+    double a00 {0.0}, a01 {0.0}, a02 {0.0}, a03 {0.0};
+    double a11 {0.0}, a12 {0.0}, a13 {0.0};
+    double a22 {0.0}, a23 {0.0};
+    double a33 {0.0};
+    double weight {0.0};
+
+    void AddPlane(const glm::dvec3& normal, double distance, double area)
+    {
+        a00 += area * normal.x * normal.x;
+        a01 += area * normal.x * normal.y;
+        a02 += area * normal.x * normal.z;
+        a03 += area * normal.x * distance;
+        a11 += area * normal.y * normal.y;
+        a12 += area * normal.y * normal.z;
+        a13 += area * normal.y * distance;
+        a22 += area * normal.z * normal.z;
+        a23 += area * normal.z * distance;
+        a33 += area * distance * distance;
+        weight += area;
+    }
+
+    void Add(const Quadric& other)
+    {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a03 += other.a03;
+        a11 += other.a11;
+        a12 += other.a12;
+        a13 += other.a13;
+        a22 += other.a22;
+        a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+    }
+
+    // Area weighted squared distance to the planes
+    double Evaluate(const glm::vec3& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+
+        double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                        + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y + a22 * z * z
+                        + 2.0 * a23 * z + a33;
+
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    float error; // distance, not squared
+};
+
+glm::vec3
+Position(const std::vector<GLfloat>& vertices, unsigned int stride, unsigned int index)
+{
+    const GLfloat* v = &vertices[static_cast<size_t>(index) * stride];
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+struct PositionHasher
+{
+    const GLfloat* data;
+    unsigned int stride;
+
+    size_t operator()(unsigned int index) const
+    {
+        unsigned int bits[3];
+        memcpy(bits, data + static_cast<size_t>(index) * stride, sizeof(bits));
+
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+struct PositionEqual
+{
+    const GLfloat* data;
+    unsigned int stride;
+
+    bool operator()(unsigned int lhs, unsigned int rhs) const
+    {
+        return memcmp(data + static_cast<size_t>(lhs) * stride,
+                      data + static_cast<size_t>(rhs) * stride,
+                      sizeof(GLfloat) * 3)
+               == 0;
+    }
+};
+
+} // namespace
+
+std::vector<unsigned int>
+MeshSimplifier::Simplify(const std::vector<GLfloat>& vertices,
+                         unsigned int stride,
+                         const std::vector<unsigned int>& indices,
+                         size_t targetIndexCount,
+                         float targetError,
+                         float* resultError)
+{
+    std::vector<unsigned int> result(indices);
+    float reachedError = 0.0f;
+
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+
+    if (result.size() <= targetIndexCount || vertexCount == 0) {
+        if (resultError)
+            *resultError = 0.0f;
+
+        return result;
+    }
+
+    // Wedges sharing a position (attribute seams) are one vertex topologically
+    std::vector<unsigned int> positionId(vertexCount);
+    std::vector<unsigned int> wedgeCount(vertexCount, 0);
+    {
+        std::unordered_map<unsigned int, unsigned int, PositionHasher, PositionEqual>
+            unique(vertexCount,
+                   PositionHasher {vertices.data(), stride},
+                   PositionEqual {vertices.data(), stride});
+
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            positionId[v] = unique.emplace(v, v).first->second;
+            ++wedgeCount[positionId[v]];
+        }
+    }
+
+    // Area weighted plane quadrics
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        const glm::dvec3 p0(Position(vertices, stride, result[t]));
+        const glm::dvec3 p1(Position(vertices, stride, result[t + 1]));
+        const glm::dvec3 p2(Position(vertices, stride, result[t + 2]));
+
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(normal);
+        if (length <= 0.0)
+            continue;
+
+        normal /= length;
+        const double distance = -glm::dot(normal, p0);
+
+        for (unsigned int k = 0; k < 3; ++k)
+            quadrics[positionId[result[t + k]]].AddPlane(normal, distance, length * 0.5);
+    }
+
+    // Border edges have a single triangle. Their vertices, and seam vertices
+    // (more than one wedge), never move.
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::unordered_map<unsigned long long, unsigned int> edgeUse;
+        edgeUse.reserve(result.size());
+
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            for (unsigned int k = 0; k < 3; ++k) {
+                unsigned long long a = positionId[result[t + k]];
+                unsigned long long b = positionId[result[t + (k + 1) % 3]];
+                ++edgeUse[a < b ? (a << 32) | b : (b << 32) | a];
+            }
+        }
+
+        for (const auto& edge : edgeUse) {
+            if (edge.second == 1) {
+                locked[edge.first >> 32] = 1;
+                locked[edge.first & 0xFFFFFFFFull] = 1;
+            }
+        }
+
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            if (wedgeCount[positionId[v]] > 1)
+                locked[positionId[v]] = 1;
+        }
+    }
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<char> touched(vertexCount);
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses every vertex at most once, cheapest edges first
+    while (result.size() > targetIndexCount) {
+        const size_t triangleCount = result.size() / 3;
+
+        // Position -> triangle adjacency for the flip test
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int index : result)
+            ++adjacencyOffsets[positionId[index] + 1];
+        for (unsigned int v = 0; v < vertexCount; ++v)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+        adjacency.resize(result.size());
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i)
+            adjacency[fill[positionId[result[i]]]++] = static_cast<unsigned int>(i / 3);
+
+        collapses.clear();
+
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (unsigned int k = 0; k < 3; ++k) {
+                const unsigned int a = result[t * 3 + k];
+                const unsigned int b = result[t * 3 + (k + 1) % 3];
+                const unsigned int pa = positionId[a];
+                const unsigned int pb = positionId[b];
+
+                if (pa == pb)
+                    continue;
+
+                // Both directions, each only when the moving end is free
+                for (unsigned int direction = 0; direction < 2; ++direction) {
+                    const unsigned int from = direction == 0 ? a : b;
+                    const unsigned int to = direction == 0 ? b : a;
+                    const unsigned int pFrom = positionId[from];
+                    const unsigned int pTo = positionId[to];
+
+                    if (locked[pFrom])
+                        continue;
+
+                    Quadric quadric = quadrics[pFrom];
+                    quadric.Add(quadrics[pTo]);
+
+                    const double error = quadric.weight > 0.0
+                                             ? quadric.Evaluate(Position(vertices, stride, to))
+                                                   / quadric.weight
+                                             : 0.0;
+
+                    collapses.push_back(
+                        Collapse {from, to, static_cast<float>(std::sqrt(error))});
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+            return lhs.error < rhs.error;
+        });
+
+        for (unsigned int v = 0; v < vertexCount; ++v)
+            remap[v] = v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        size_t applied = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > targetError || removed >= trianglesToRemove)
+                break;
+
+            const unsigned int pFrom = positionId[collapse.from];
+            const unsigned int pTo = positionId[collapse.to];
+
+            if (touched[pFrom] || touched[pTo])
+                continue;
+
+            const glm::vec3 target = Position(vertices, stride, collapse.to);
+            bool flips = false;
+            size_t collapsing = 0;
+
+            // Moving "from" onto "to" must not turn any surviving triangle over
+            for (unsigned int a = adjacencyOffsets[pFrom];
+                 a < adjacencyOffsets[pFrom + 1] && !flips;
+                 ++a) {
+                const unsigned int* tri = &result[static_cast<size_t>(adjacency[a]) * 3];
+                glm::vec3 before[3], after[3];
+                bool hasTarget = false;
+
+                for (unsigned int k = 0; k < 3; ++k) {
+                    const unsigned int v = remap[tri[k]];
+                    before[k] = after[k] = Position(vertices, stride, v);
+
+                    if (positionId[v] == pTo)
+                        hasTarget = true;
+                    if (positionId[v] == pFrom)
+                        after[k] = target;
+                }
+
+                if (hasTarget) {
+                    ++collapsing;
+                    continue;
+                }
+
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0],
+                                                          before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+                if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+                    flips = true;
+            }
+
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[pTo].Add(quadrics[pFrom]);
+            touched[pFrom] = touched[pTo] = 1;
+
+            removed += collapsing;
+            reachedError = std::max(reachedError, collapse.error);
+            ++applied;
+        }
+
+        if (applied == 0)
+            break;
+
+        // Apply the pass and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const unsigned int a = remap[result[t * 3]];
+            const unsigned int b = remap[result[t * 3 + 1]];
+            const unsigned int c = remap[result[t * 3 + 2]];
+
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c]
+                || positionId[a] == positionId[c]) {
+                continue;
+            }
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize(write);
+    }
+
+    if (resultError)
+        *resultError = reachedError;
+
+    return result;
+}
+
+void
+MeshSimplifier::BuildLodChain(const std::vector<GLfloat>& vertices,
+                              unsigned int stride,
+                              const std::vector<unsigned int>& indices,
+                              unsigned int maxLods,
+                              std::vector<unsigned int>& lodIndices,
+                              std::vector<Mesh::Lod>& lods)
+{
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / stride);
+
+    lodIndices.assign(indices.begin(), indices.end());
+    lods.assign(1, Mesh::Lod {0, static_cast<GLsizei>(indices.size()), 0.0f});
+
+    std::vector<unsigned int> previous(indices);
+    float error = 0.0f;
+
+    while (lods.size() < maxLods) {
+        const size_t target = previous.size() / 6 * 3;
+
+        // Not worth a level below a few triangles
+        if (target < 12)
+            break;
+
+        float levelError = 0.0f;
+        std::vector<unsigned int> level = Simplify(vertices,
+                                                   stride,
+                                                   previous,
+                                                   target,
+                                                   std::numeric_limits<float>::max(),
+                                                   &levelError);
+
+        // Stuck on locked vertices, further levels would look the same
+        if (level.size() > previous.size() * 9 / 10)
+            break;
+
+        MeshOptimizer::OptimizeVertexCache(level, vertexCount);
+
+        // Cascaded from the previous level, so errors add up
+        error += levelError;
+
+        lods.push_back(Mesh::Lod {static_cast<GLsizei>(lodIndices.size()),
+                                  static_cast<GLsizei>(level.size()),
+                                  error});
+        lodIndices.insert(lodIndices.end(), level.begin(), level.end());
+
+        previous.swap(level);
+    }
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+// Quadric error metric edge collapse (Garland-Heckbert).
+// Collapsed vertices move onto one of their neighbours instead of a new
+// position, so every LOD keeps indexing the original vertex buffer.
+// Vertices are "stride" floats, position first.
+class MeshSimplifier
+{
+public:
+    // Collapses edges until the index count reaches targetIndexCount or the next
+    // collapse would exceed targetError (object space distance). Border vertices
+    // and attribute seams are kept in place. resultError receives the error reached.
+    static std::vector<unsigned int> Simplify(const std::vector<GLfloat>& vertices,
+                                              unsigned int stride,
+                                              const std::vector<unsigned int>& indices,
+                                              size_t targetIndexCount,
+                                              float targetError,
+                                              float* resultError = nullptr);
+
+    // LOD 0 is indices as given, every further LOD aims for half the triangles of
+    // the one before. All LODs are appended to lodIndices (vertex cache optimized)
+    // and described in lods, errors never decrease along the chain.
+    static void BuildLodChain(const std::vector<GLfloat>& vertices,
+                              unsigned int stride,
+                              const std::vector<unsigned int>& indices,
+                              unsigned int maxLods,
+                              std::vector<unsigned int>& lodIndices,
+                              std::vector<Mesh::Lod>& lods);
+};
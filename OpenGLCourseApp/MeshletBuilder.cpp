@@ -0,0 +1,235 @@
+﻿#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+glm::vec3
+Position(const std::vector<GLfloat>& vertices, unsigned int stride, unsigned int index)
+{
+    const GLfloat* v = &vertices[static_cast<size_t>(index) * stride];
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+} // namespace
+
+std::vector<Meshlet>
+MeshletBuilder::Build(const std::vector<GLfloat>& vertices,
+                      unsigned int stride,
+                      unsigned int* indices,
+                      size_t indexCount)
+{
+    std::vector<Meshlet> meshlets;
+
+    const size_t vertexCount = vertices.size() / stride;
+    const size_t triangleCount = indexCount / 3;
+
+    if (triangleCount == 0)
+        return meshlets;
+
+    // Vertex -> triangle adjacency, liveTriangles counts the ones not yet emitted
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++liveTriangles[indices[i]];
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    {
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<unsigned char> emitted(triangleCount, 0);
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+
+    // Stamp of the meshlet a vertex was last added to, avoids clearing per meshlet
+    std::vector<unsigned int> vertexStamp(vertexCount, 0);
+    unsigned int stamp = 0;
+
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+
+    size_t seedCursor = 0;
+    size_t emittedCount = 0;
+
+    const auto newVertices = [&](unsigned int triangle) {
+        unsigned int count = 0;
+        for (unsigned int k = 0; k < 3; ++k)
+            count += vertexStamp[indices[triangle * 3 + k]] != stamp;
+        return count;
+    };
+
+    // Fewest new vertices first, then the triangle whose vertices have the
+    // fewest triangles left so the meshlet border stays compact
+    const auto consider = [&](unsigned int triangle, unsigned int& best, unsigned int& bestScore) {
+        if (emitted[triangle])
+            return;
+
+        const unsigned int extra = newVertices(triangle);
+        if (meshletVertices.size() + extra > maxVertices)
+            return;
+
+        unsigned int live = 0;
+        for (unsigned int k = 0; k < 3; ++k)
+            live += liveTriangles[indices[triangle * 3 + k]];
+
+        const unsigned int score = extra * 1024 + std::min(live, 1023u);
+        if (score < bestScore) {
+            best = triangle;
+            bestScore = score;
+        }
+    };
+
+    unsigned int lastTriangle = ~0u;
+
+    while (emittedCount < triangleCount) {
+        // Seed next to where the previous meshlet ended if possible
+        unsigned int seed = ~0u;
+
+        if (lastTriangle != ~0u) {
+            unsigned int bestScore = ~0u;
+            ++stamp;
+            meshletVertices.clear();
+
+            for (unsigned int k = 0; k < 3 && seed == ~0u; ++k) {
+                const unsigned int v = indices[lastTriangle * 3 + k];
+                for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+                    consider(adjacency[a], seed, bestScore);
+            }
+        }
+
+        if (seed == ~0u) {
+            while (emitted[seedCursor])
+                ++seedCursor;
+            seed = static_cast<unsigned int>(seedCursor);
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<GLsizei>(result.size());
+
+        ++stamp;
+        meshletVertices.clear();
+
+        unsigned int triangle = seed;
+        unsigned int meshletTriangles = 0;
+
+        while (triangle != ~0u) {
+            emitted[triangle] = 1;
+            ++emittedCount;
+            ++meshletTriangles;
+            lastTriangle = triangle;
+
+            for (unsigned int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[triangle * 3 + k];
+
+                result.push_back(v);
+                --liveTriangles[v];
+
+                if (vertexStamp[v] != stamp) {
+                    vertexStamp[v] = stamp;
+                    meshletVertices.push_back(v);
+                }
+            }
+
+            if (meshletTriangles == maxTriangles)
+                break;
+
+            // Neighbours of the last triangle are cheap to check and usually win
+            unsigned int best = ~0u;
+            unsigned int bestScore = ~0u;
+
+            for (unsigned int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[triangle * 3 + k];
+                for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+                    consider(adjacency[a], best, bestScore);
+            }
+
+            if (best == ~0u) {
+                for (unsigned int v : meshletVertices) {
+                    for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+                        consider(adjacency[a], best, bestScore);
+                }
+            }
+
+            triangle = best;
+        }
+
+        meshlet.indexCount = static_cast<GLsizei>(result.size()) - meshlet.firstIndex;
+        ComputeBounds(vertices, stride, result.data() + meshlet.firstIndex, meshlet);
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+
+    return meshlets;
+}
+
+void
+MeshletBuilder::ComputeBounds(const std::vector<GLfloat>& vertices,
+                              unsigned int stride,
+                              const unsigned int* indices,
+                              Meshlet& meshlet)
+{
+    glm::vec3 boundsMin = Position(vertices, stride, indices[0]);
+    glm::vec3 boundsMax = boundsMin;
+
+    for (GLsizei i = 1; i < meshlet.indexCount; ++i) {
+        const glm::vec3 p = Position(vertices, stride, indices[i]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    meshlet.center = (boundsMin + boundsMax) * 0.5f;
+    meshlet.radius = 0.0f;
+
+    for (GLsizei i = 0; i < meshlet.indexCount; ++i) {
+        const glm::vec3 p = Position(vertices, stride, indices[i]);
+        meshlet.radius = std::max(meshlet.radius, glm::length(p - meshlet.center));
+    }
+
+    // Cone around the average normal, degenerate triangles don't face anywhere
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+
+    for (GLsizei i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        const glm::vec3 p0 = Position(vertices, stride, indices[i]);
+        const glm::vec3 p1 = Position(vertices, stride, indices[i + 1]);
+        const glm::vec3 p2 = Position(vertices, stride, indices[i + 2]);
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            axis += normal / length;
+        }
+    }
+
+    const float axisLength = glm::length(axis);
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    if (normals.empty() || axisLength <= 0.0f)
+        return;
+
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+        minDot = std::min(minDot, glm::dot(normal, axis));
+
+    // Spread over 90 degrees, some triangle always faces the camera
+    if (minDot <= 0.0f)
+        return;
+
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
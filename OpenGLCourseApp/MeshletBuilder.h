@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+// A small cluster of connected triangles, stored as a contiguous range of the
+// index buffer so visible clusters can go straight into glMultiDrawElements.
+struct Meshlet
+{
+    GLsizei firstIndex {0};
+    GLsizei indexCount {0};
+
+    // Object space bounding sphere
+    glm::vec3 center {0.0f};
+    float radius {0.0f};
+
+    // Every triangle normal is within the cone around coneAxis. coneCutoff is the
+    // sine of the cone's half angle, 1 when the normals spread too far to cull.
+    glm::vec3 coneAxis {0.0f, 0.0f, 1.0f};
+    float coneCutoff {1.0f};
+};
+
+// Splits an index buffer into meshlets by greedy growth over shared vertices.
+// Vertices are "stride" floats, position first.
+class MeshletBuilder
+{
+public:
+    // Limits of a single meshlet (mesh shader friendly sizes)
+    static const unsigned int maxVertices = 64;
+    static const unsigned int maxTriangles = 124;
+
+    // Below this whole mesh drawing beats per cluster culling
+    static const unsigned int minTriangles = 4096;
+
+    // Reorders indices[0, indexCount) so each meshlet is one range and returns
+    // the meshlets in index buffer order
+    static std::vector<Meshlet> Build(const std::vector<GLfloat>& vertices,
+                                      unsigned int stride,
+                                      unsigned int* indices,
+                                      size_t indexCount);
+
+private:
+    static void ComputeBounds(const std::vector<GLfloat>& vertices,
+                              unsigned int stride,
+                              const unsigned int* indices,
+                              Meshlet& meshlet);
+};
@@ -0,0 +1,351 @@
+﻿#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2 1
+#endif
+
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+    : width_((std::max(width, 4u) + 3) & ~3u)
+    , height_(std::max(height, 1u))
+    , viewProjection_(1.0f)
+{
+    unsigned int levelWidth = width_;
+    unsigned int levelHeight = height_;
+
+    for (;;) {
+        levels_.emplace_back(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+        levelWidths_.push_back(levelWidth);
+        levelHeights_.push_back(levelHeight);
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+
+        levelWidth = std::max(1u, (levelWidth + 1) / 2);
+        levelHeight = std::max(1u, (levelHeight + 1) / 2);
+    }
+}
+
+OcclusionCuller::~OcclusionCuller() {}
+
+void
+OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    viewProjection_ = viewProjection;
+    occluders_.clear();
+
+    for (std::vector<float>& level : levels_)
+        std::fill(level.begin(), level.end(), 1.0f);
+}
+
+void
+OcclusionCuller::AddOccluder(const glm::mat4& model,
+                             const GLfloat* vertices,
+                             unsigned int stride,
+                             const unsigned int* indices,
+                             size_t indexCount)
+{
+    occluders_.push_back(Occluder {model, vertices, stride, indices, indexCount});
+}
+
+void
+OcclusionCuller::Rasterize(ThreadPool* pool)
+{
+    TRACE_SCOPE("OcclusionCuller::Rasterize");
+
+    triangles_.clear();
+
+    // Transform and clip on the calling thread, occluders are meant to be few
+    // and coarse. Only the fill is spread over the pool.
+    for (const Occluder& occluder : occluders_) {
+        const glm::mat4 modelViewProjection = viewProjection_ * occluder.model;
+
+        for (size_t i = 0; i + 2 < occluder.indexCount; i += 3) {
+            glm::vec4 clip[3];
+
+            for (unsigned int k = 0; k < 3; ++k) {
+                const GLfloat* p = occluder.vertices
+                                   + static_cast<size_t>(occluder.indices[i + k]) * occluder.stride;
+                clip[k] = modelViewProjection * glm::vec4(p[0], p[1], p[2], 1.0f);
+            }
+
+            // Entirely outside one frustum plane
+            if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w)
+                || (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w)
+                || (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w)
+                || (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w)
+                || (clip[0].z > clip[0].w && clip[1].z > clip[1].w && clip[2].z > clip[2].w)
+                || (clip[0].z < -clip[0].w && clip[1].z < -clip[1].w
+                    && clip[2].z < -clip[2].w)) {
+                continue;
+            }
+
+            if (clip[0].z >= -clip[0].w && clip[1].z >= -clip[1].w && clip[2].z >= -clip[2].w) {
+                SetupTriangle(clip);
+                continue;
+            }
+
+            // Clip against the near plane (z >= -w), leaves a triangle or a quad
+            glm::vec4 polygon[4];
+            unsigned int count = 0;
+
+            for (unsigned int k = 0; k < 3; ++k) {
+                const glm::vec4& a = clip[k];
+                const glm::vec4& b = clip[(k + 1) % 3];
+                const float da = a.z + a.w;
+                const float db = b.z + b.w;
+
+                if (da >= 0.0f)
+                    polygon[count++] = a;
+
+                if ((da >= 0.0f) != (db >= 0.0f))
+                    polygon[count++] = a + (b - a) * (da / (da - db));
+            }
+
+            for (unsigned int k = 1; k + 1 < count; ++k) {
+                const glm::vec4 fan[3] = {polygon[0], polygon[k], polygon[k + 1]};
+                SetupTriangle(fan);
+            }
+        }
+    }
+
+    const unsigned int bandCount = (height_ + bandHeight - 1) / bandHeight;
+
+    if (pool) {
+        pool->ParallelFor(bandCount, [this](unsigned int band) {
+            RasterizeBand(band * bandHeight, std::min((band + 1) * bandHeight, height_));
+        });
+    } else {
+        RasterizeBand(0, height_);
+    }
+
+    BuildPyramid();
+}
+
+bool
+OcclusionCuller::IsVisible(const glm::mat4& model,
+                           const glm::vec3& boundsMin,
+                           const glm::vec3& boundsMax) const
+{
+    const glm::mat4 modelViewProjection = viewProjection_ * model;
+
+    float minX = 1e30f, minY = 1e30f, minZ = 1e30f;
+    float maxX = -1e30f, maxY = -1e30f;
+
+    for (unsigned int corner = 0; corner < 8; ++corner) {
+        const glm::vec4 clip = modelViewProjection
+                               * glm::vec4(corner & 1 ? boundsMax.x : boundsMin.x,
+                                           corner & 2 ? boundsMax.y : boundsMin.y,
+                                           corner & 4 ? boundsMax.z : boundsMin.z,
+                                           1.0f);
+
+        // Crosses the near plane, no sensible screen rectangle
+        if (clip.z < -clip.w || clip.w <= 0.0f)
+            return true;
+
+        const float inverseW = 1.0f / clip.w;
+        const float x = (clip.x * inverseW * 0.5f + 0.5f) * width_;
+        const float y = (clip.y * inverseW * 0.5f + 0.5f) * height_;
+        const float z = clip.z * inverseW * 0.5f + 0.5f;
+
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, z);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width_ || minY >= height_)
+        return true;
+
+    const int x0 = std::max(0, static_cast<int>(minX));
+    const int y0 = std::max(0, static_cast<int>(minY));
+    const int x1 = std::min(static_cast<int>(width_) - 1, static_cast<int>(maxX));
+    const int y1 = std::min(static_cast<int>(height_) - 1, static_cast<int>(maxY));
+
+    // Coarsest detail where the rectangle touches at most 2x2 texels
+    unsigned int level = 0;
+    while (level + 1 < levels_.size()
+           && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        ++level;
+    }
+
+    const std::vector<float>& depth = levels_[level];
+    const unsigned int levelWidth = levelWidths_[level];
+    float maxDepth = 0.0f;
+
+    for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x)
+            maxDepth = std::max(maxDepth, depth[static_cast<size_t>(y) * levelWidth + x]);
+    }
+
+    return minZ <= maxDepth;
+}
+
+void
+OcclusionCuller::SetupTriangle(const glm::vec4* clip)
+{
+    glm::vec3 screen[3];
+
+    for (unsigned int k = 0; k < 3; ++k) {
+        const float inverseW = 1.0f / clip[k].w;
+        screen[k] = glm::vec3((clip[k].x * inverseW * 0.5f + 0.5f) * width_,
+                              (clip[k].y * inverseW * 0.5f + 0.5f) * height_,
+                              clip[k].z * inverseW * 0.5f + 0.5f);
+    }
+
+    float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)
+                 - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+
+    if (area == 0.0f)
+        return;
+
+    // Two sided, flip clockwise triangles
+    if (area < 0.0f) {
+        std::swap(screen[1], screen[2]);
+        area = -area;
+    }
+
+    ScreenTriangle triangle;
+
+    const float left = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+    const float right = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+    const float bottom = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+    const float top = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+
+    triangle.minX = std::max(0, static_cast<int>(std::floor(left)));
+    triangle.maxX = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::ceil(right)));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(bottom)));
+    triangle.maxY = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::ceil(top)));
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    triangle.zA = triangle.zB = triangle.zC = 0.0f;
+
+    // Edge k runs from vertex k to k + 1, its value over the area is the
+    // barycentric weight of the opposite vertex
+    for (unsigned int k = 0; k < 3; ++k) {
+        const glm::vec3& a = screen[k];
+        const glm::vec3& b = screen[(k + 1) % 3];
+        const float z = screen[(k + 2) % 3].z / area;
+
+        triangle.edgeA[k] = a.y - b.y;
+        triangle.edgeB[k] = b.x - a.x;
+        triangle.edgeC[k] = -(triangle.edgeA[k] * a.x + triangle.edgeB[k] * a.y);
+
+        triangle.zA += triangle.edgeA[k] * z;
+        triangle.zB += triangle.edgeB[k] * z;
+        triangle.zC += triangle.edgeC[k] * z;
+    }
+
+    triangles_.push_back(triangle);
+}
+
+void
+OcclusionCuller::RasterizeBand(unsigned int firstRow, unsigned int endRow)
+{
+    std::vector<float>& depth = levels_[0];
+
+    for (const ScreenTriangle& triangle : triangles_) {
+        const int y0 = std::max(triangle.minY, static_cast<int>(firstRow));
+        const int y1 = std::min(triangle.maxY, static_cast<int>(endRow) - 1);
+
+        if (y0 > y1)
+            continue;
+
+        // Blocks of 4 pixels, rows are a multiple of 4 wide
+        const int x0 = triangle.minX & ~3;
+
+        for (int y = y0; y <= y1; ++y) {
+            const float pixelY = y + 0.5f;
+            float* row = &depth[static_cast<size_t>(y) * width_];
+
+#ifdef OCCLUSION_CULLER_SSE2
+            const __m128 rowEdge0 = _mm_set1_ps(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+            const __m128 rowEdge1 = _mm_set1_ps(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+            const __m128 rowEdge2 = _mm_set1_ps(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+            const __m128 rowZ = _mm_set1_ps(triangle.zB * pixelY + triangle.zC);
+            const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+            const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+            const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+            const __m128 zA = _mm_set1_ps(triangle.zA);
+            const __m128 zero = _mm_setzero_ps();
+
+            for (int x = x0; x <= triangle.maxX; x += 4) {
+                const float base = x + 0.5f;
+                const __m128 pixelX = _mm_setr_ps(base, base + 1.0f, base + 2.0f, base + 3.0f);
+
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0),
+                                             zero);
+                inside = _mm_and_ps(inside,
+                                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1),
+                                                 zero));
+                inside = _mm_and_ps(inside,
+                                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2),
+                                                 zero));
+
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                const __m128 z = _mm_add_ps(_mm_mul_ps(zA, pixelX), rowZ);
+                const __m128 current = _mm_loadu_ps(row + x);
+                const __m128 nearest = _mm_min_ps(current, z);
+
+                _mm_storeu_ps(row + x,
+                              _mm_or_ps(_mm_and_ps(inside, nearest),
+                                        _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = x0; x <= triangle.maxX; ++x) {
+                const float pixelX = x + 0.5f;
+                bool inside = true;
+
+                for (unsigned int k = 0; k < 3 && inside; ++k)
+                    inside = triangle.edgeA[k] * pixelX + triangle.edgeB[k] * pixelY
+                                 + triangle.edgeC[k]
+                             >= 0.0f;
+
+                if (inside) {
+                    const float z = triangle.zA * pixelX + triangle.zB * pixelY + triangle.zC;
+                    row[x] = std::min(row[x], z);
+                }
+            }
+#endif
+        }
+    }
+}
+
+void
+OcclusionCuller::BuildPyramid()
+{
+    for (size_t level = 1; level < levels_.size(); ++level) {
+        const std::vector<float>& source = levels_[level - 1];
+        const unsigned int sourceWidth = levelWidths_[level - 1];
+        const unsigned int sourceHeight = levelHeights_[level - 1];
+        std::vector<float>& target = levels_[level];
+
+        for (unsigned int y = 0; y < levelHeights_[level]; ++y) {
+            const unsigned int y0 = y * 2;
+            const unsigned int y1 = std::min(y0 + 1, sourceHeight - 1);
+
+            for (unsigned int x = 0; x < levelWidths_[level]; ++x) {
+                const unsigned int x0 = x * 2;
+                const unsigned int x1 = std::min(x0 + 1, sourceWidth - 1);
+
+                // Farthest depth, so a texel never claims more occlusion than its pixels
+                const float top = std::max(source[y0 * sourceWidth + x0],
+                                           source[y0 * sourceWidth + x1]);
+                const float bottom = std::max(source[y1 * sourceWidth + x0],
+                                              source[y1 * sourceWidth + x1]);
+                target[static_cast<size_t>(y) * levelWidths_[level] + x] = std::max(top, bottom);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+class ThreadPool;
+
+// Hierarchical Z occlusion culling on the CPU.
+//
+// Occluders are rasterized into a small float depth buffer (window space z,
+// cleared to 1), which is reduced into a max depth mip pyramid. A bounding box is
+// hidden when its nearest depth lies behind the farthest occluder depth of the
+// pyramid texels its screen rectangle touches. The occluders are rasterized on
+// the CPU before the scene's draws are issued, so that work overlaps the GPU
+// still finishing the previous frame.
+class OcclusionCuller
+{
+public:
+    // Depth buffer resolution, width is rounded up to a multiple of 4
+    OcclusionCuller(unsigned int width = 256, unsigned int height = 128);
+    ~OcclusionCuller();
+
+    // Clears depth and occluders. viewProjection takes world space to clip space.
+    void BeginFrame(const glm::mat4& viewProjection);
+
+    // Triangles of vertices ("stride" floats, position first) placed by model.
+    // Referenced, not copied: the data must stay alive until Rasterize returns.
+    // Both sides are rasterized, so winding doesn't matter.
+    void AddOccluder(const glm::mat4& model,
+                     const GLfloat* vertices,
+                     unsigned int stride,
+                     const unsigned int* indices,
+                     size_t indexCount);
+
+    // Rasterizes the occluders in horizontal bands spread over the pool and
+    // builds the pyramid, pool may be null
+    void Rasterize(ThreadPool* pool = nullptr);
+
+    // False only when the box is certainly behind the occluders. Boxes crossing
+    // the near plane or leaving the screen count as visible.
+    bool IsVisible(const glm::mat4& model,
+                   const glm::vec3& boundsMin,
+                   const glm::vec3& boundsMax) const;
+
+    unsigned int GetWidth() const
+    {
+        return width_;
+    }
+    unsigned int GetHeight() const
+    {
+        return height_;
+    }
+
+    // Level 0 is the rasterized depth, rows bottom up
+    const float* GetDepth(unsigned int level = 0) const
+    {
+        return levels_[level].data();
+    }
+    unsigned int GetLevelCount() const
+    {
+        return static_cast<unsigned int>(levels_.size());
+    }
+
+private:
+    struct Occluder
+    {
+        glm::mat4 model;
+        const GLfloat* vertices;
+        unsigned int stride;
+        const unsigned int* indices;
+        size_t indexCount;
+    };
+
+    // Counter clockwise screen space triangle, set up for edge functions
+    struct ScreenTriangle
+    {
+        // Edge k is inside where edgeA[k] * x + edgeB[k] * y + edgeC[k] >= 0
+        float edgeA[3], edgeB[3], edgeC[3];
+        // Depth plane
+        float zA, zB, zC;
+        int minX, maxX, minY, maxY;
+    };
+
+    // Rows per rasterizer job
+    static const unsigned int bandHeight = 16;
+
+    unsigned int width_;
+    unsigned int height_;
+    glm::mat4 viewProjection_;
+
+    std::vector<Occluder> occluders_;
+    std::vector<ScreenTriangle> triangles_;
+
+    // Max depth pyramid, level 0 is the depth buffer
+    std::vector<std::vector<float>> levels_;
+    std::vector<unsigned int> levelWidths_;
+    std::vector<unsigned int> levelHeights_;
+
+    void SetupTriangle(const glm::vec4* clip);
+    void RasterizeBand(unsigned int firstRow, unsigned int endRow);
+    void BuildPyramid();
+};
@@ -0,0 +1,510 @@
+﻿#include "SceneBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+static_assert(sizeof(float) * 12 + sizeof(uint32_t) * 4 == 64, "BVH node must fill a cache line");
+
+const float infinity = std::numeric_limits<float>::infinity();
+
+SceneBvh::Aabb
+EmptyAabb()
+{
+    return SceneBvh::Aabb {glm::vec3(infinity), glm::vec3(-infinity)};
+}
+
+void
+Grow(SceneBvh::Aabb& aabb, const SceneBvh::Aabb& other)
+{
+    aabb.min = glm::min(aabb.min, other.min);
+    aabb.max = glm::max(aabb.max, other.max);
+}
+
+// Half the surface area, the constant doesn't matter to the heuristic
+float
+HalfArea(const SceneBvh::Aabb& aabb)
+{
+    const glm::vec3 extent = glm::max(aabb.max - aabb.min, glm::vec3(0.0f));
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+bool
+BoxInFrustum(const glm::vec4* planes, const SceneBvh::Aabb& box)
+{
+    for (unsigned int p = 0; p < 6; ++p) {
+        const glm::vec4& plane = planes[p];
+        const float farthest = plane.x * (plane.x >= 0.0f ? box.max.x : box.min.x)
+                               + plane.y * (plane.y >= 0.0f ? box.max.y : box.min.y)
+                               + plane.z * (plane.z >= 0.0f ? box.max.z : box.min.z) + plane.w;
+
+        if (farthest < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+SceneBvh::SceneBvh() {}
+
+SceneBvh::~SceneBvh() {}
+
+void
+SceneBvh::Build(const std::vector<Aabb>& bounds)
+{
+    ClearBvh();
+
+    if (bounds.empty())
+        return;
+
+    const uint32_t objectCount = static_cast<uint32_t>(bounds.size());
+
+    bounds_ = bounds;
+    objects_.resize(objectCount);
+    centroids_.resize(objectCount);
+
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        objects_[i] = i;
+        centroids_[i] = (bounds[i].min + bounds[i].max) * 0.5f;
+    }
+
+    const size_t maxNodes = std::max<size_t>(1, objectCount);
+    nodeMemory_.resize(maxNodes * sizeof(Node) + 63);
+    nodes_ = reinterpret_cast<Node*>(
+        (reinterpret_cast<uintptr_t>(nodeMemory_.data()) + 63) & ~static_cast<uintptr_t>(63));
+
+    if (objectCount <= maxLeafSize) {
+        Node& root = nodes_[nodeCount_++];
+        SetChild(root, 0, LeafBounds(0, objectCount), 0, objectCount);
+        SetChild(root, 1, EmptyAabb(), emptyChild, 0);
+    } else {
+        Aabb rootBounds;
+        BuildNode(0, objectCount, 0, rootBounds);
+    }
+
+    centroids_.clear();
+    centroids_.shrink_to_fit();
+
+    buildArea_ = NodeArea();
+    area_ = buildArea_;
+}
+
+void
+SceneBvh::Refit(const std::vector<Aabb>& bounds)
+{
+    if (bounds.size() != bounds_.size())
+        return;
+
+    bounds_ = bounds;
+
+    // Children always come after their parent
+    for (uint32_t i = nodeCount_; i-- > 0;) {
+        Node& node = nodes_[i];
+
+        for (unsigned int slot = 0; slot < 2; ++slot) {
+            if (node.child[slot] == emptyChild)
+                continue;
+
+            if (node.count[slot] > 0) {
+                SetChild(node,
+                         slot,
+                         LeafBounds(node.child[slot], node.count[slot]),
+                         node.child[slot],
+                         node.count[slot]);
+                continue;
+            }
+
+            const Node& child = nodes_[node.child[slot]];
+            Aabb childBounds = EmptyAabb();
+
+            for (unsigned int k = 0; k < 2; ++k) {
+                if (child.child[k] == emptyChild)
+                    continue;
+
+                Grow(childBounds,
+                     Aabb {glm::vec3(child.minX[k], child.minY[k], child.minZ[k]),
+                           glm::vec3(child.maxX[k], child.maxY[k], child.maxZ[k])});
+            }
+
+            SetChild(node, slot, childBounds, node.child[slot], 0);
+        }
+    }
+
+    area_ = NodeArea();
+}
+
+void
+SceneBvh::ClearBvh()
+{
+    nodeMemory_.clear();
+    nodes_ = nullptr;
+    nodeCount_ = 0;
+    objects_.clear();
+    bounds_.clear();
+    centroids_.clear();
+    buildArea_ = 0.0f;
+    area_ = 0.0f;
+}
+
+void
+SceneBvh::QueryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& objects) const
+{
+    if (nodeCount_ == 0)
+        return;
+
+    // Gribb/Hartmann planes, inside where dot(plane.xyz, p) + plane.w >= 0
+    const glm::mat4 rows = glm::transpose(viewProjection);
+    const glm::vec4 planes[6] = {rows[3] + rows[0],
+                                 rows[3] - rows[0],
+                                 rows[3] + rows[1],
+                                 rows[3] - rows[1],
+                                 rows[3] + rows[2],
+                                 rows[3] - rows[2]};
+
+    // Node indices, the high bit marks subtrees already known to be inside
+    const uint32_t insideBit = 0x80000000u;
+    uint32_t stack[maxDepth + 1];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const uint32_t entry = stack[--stackSize];
+        const Node& node = nodes_[entry & ~insideBit];
+        const bool parentInside = (entry & insideBit) != 0;
+
+        for (unsigned int slot = 0; slot < 2; ++slot) {
+            if (node.child[slot] == emptyChild)
+                continue;
+
+            bool inside = parentInside;
+
+            if (!inside) {
+                bool outside = false;
+                inside = true;
+
+                for (unsigned int p = 0; p < 6 && !outside; ++p) {
+                    const glm::vec4& plane = planes[p];
+
+                    // Box corners farthest along and against the plane normal
+                    const bool positiveX = plane.x >= 0.0f;
+                    const bool positiveY = plane.y >= 0.0f;
+                    const bool positiveZ = plane.z >= 0.0f;
+                    const float farthest = plane.x * (positiveX ? node.maxX : node.minX)[slot]
+                                           + plane.y * (positiveY ? node.maxY : node.minY)[slot]
+                                           + plane.z * (positiveZ ? node.maxZ : node.minZ)[slot]
+                                           + plane.w;
+                    const float nearest = plane.x * (positiveX ? node.minX : node.maxX)[slot]
+                                          + plane.y * (positiveY ? node.minY : node.maxY)[slot]
+                                          + plane.z * (positiveZ ? node.minZ : node.maxZ)[slot]
+                                          + plane.w;
+
+                    outside = farthest < 0.0f;
+                    inside = inside && nearest >= 0.0f;
+                }
+
+                if (outside)
+                    continue;
+            }
+
+            if (node.count[slot] > 0) {
+                for (uint32_t i = 0; i < node.count[slot]; ++i) {
+                    const uint32_t object = objects_[node.child[slot] + i];
+
+                    // A leaf straddling a plane may still hold boxes outside it
+                    if (inside || BoxInFrustum(planes, bounds_[object]))
+                        objects.push_back(object);
+                }
+            } else {
+                stack[stackSize++] = node.child[slot] | (inside ? insideBit : 0);
+            }
+        }
+    }
+}
+
+uint32_t
+SceneBvh::Raycast(const glm::vec3& origin,
+                  const glm::vec3& direction,
+                  float maxDistance,
+                  float* hitDistance) const
+{
+    const glm::vec3 inverseDirection = 1.0f / direction;
+
+    return Raycast(
+        origin,
+        direction,
+        maxDistance,
+        [&](uint32_t object, float) {
+            const glm::vec3 t0 = (bounds_[object].min - origin) * inverseDirection;
+            const glm::vec3 t1 = (bounds_[object].max - origin) * inverseDirection;
+            const glm::vec3 tMin = glm::min(t0, t1);
+            const glm::vec3 tMax = glm::max(t0, t1);
+            const float entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+            const float exit = std::min(std::min(tMax.x, tMax.y), tMax.z);
+
+            return entry <= exit ? entry : -1.0f;
+        },
+        hitDistance);
+}
+
+uint32_t
+SceneBvh::Raycast(const glm::vec3& origin,
+                  const glm::vec3& direction,
+                  float maxDistance,
+                  const std::function<float(uint32_t, float)>& intersect,
+                  float* hitDistance) const
+{
+    uint32_t hit = invalidObject;
+    float closest = maxDistance;
+
+    if (nodeCount_ > 0) {
+        const glm::vec3 inverseDirection = 1.0f / direction;
+
+        struct Entry
+        {
+            uint32_t node;
+            float distance;
+        };
+
+        Entry stack[maxDepth + 1];
+        unsigned int stackSize = 0;
+        stack[stackSize++] = Entry {0, 0.0f};
+
+        while (stackSize > 0) {
+            const Entry entry = stack[--stackSize];
+
+            if (entry.distance > closest)
+                continue;
+
+            const Node& node = nodes_[entry.node];
+            float distances[2];
+
+            // Slab test of both children
+            for (unsigned int slot = 0; slot < 2; ++slot) {
+                distances[slot] = infinity;
+
+                if (node.child[slot] == emptyChild)
+                    continue;
+
+                const float tx0 = (node.minX[slot] - origin.x) * inverseDirection.x;
+                const float tx1 = (node.maxX[slot] - origin.x) * inverseDirection.x;
+                const float ty0 = (node.minY[slot] - origin.y) * inverseDirection.y;
+                const float ty1 = (node.maxY[slot] - origin.y) * inverseDirection.y;
+                const float tz0 = (node.minZ[slot] - origin.z) * inverseDirection.z;
+                const float tz1 = (node.maxZ[slot] - origin.z) * inverseDirection.z;
+
+                const float entryT = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                                              std::max(std::min(tz0, tz1), 0.0f));
+                const float exitT = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                                             std::max(tz0, tz1));
+
+                if (entryT <= exitT && entryT <= closest)
+                    distances[slot] = entryT;
+            }
+
+            // Nearer child on top of the stack
+            const unsigned int first = distances[1] < distances[0] ? 1 : 0;
+
+            for (unsigned int order = 0; order < 2; ++order) {
+                const unsigned int slot = order == 0 ? 1 - first : first;
+
+                if (distances[slot] == infinity)
+                    continue;
+
+                if (node.count[slot] == 0) {
+                    stack[stackSize++] = Entry {node.child[slot], distances[slot]};
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < node.count[slot]; ++i) {
+                    const uint32_t object = objects_[node.child[slot] + i];
+                    const float t = intersect(object, closest);
+
+                    if (t >= 0.0f && t <= closest) {
+                        closest = t;
+                        hit = object;
+                    }
+                }
+            }
+        }
+    }
+
+    if (hitDistance && hit != invalidObject)
+        *hitDistance = closest;
+
+    return hit;
+}
+
+uint32_t
+SceneBvh::BuildNode(uint32_t begin, uint32_t end, unsigned int depth, Aabb& nodeBounds)
+{
+    const uint32_t nodeIndex = nodeCount_++;
+
+    // Past maxSahDepth only halve, which bounds the depth for the traversal stacks
+    const uint32_t middle = depth < maxSahDepth ? Split(begin, end) : begin + (end - begin) / 2;
+
+    const uint32_t ranges[2][2] = {{begin, middle}, {middle, end}};
+    nodeBounds = EmptyAabb();
+
+    for (unsigned int slot = 0; slot < 2; ++slot) {
+        const uint32_t first = ranges[slot][0];
+        const uint32_t count = ranges[slot][1] - first;
+        Aabb childBounds;
+
+        if (count <= maxLeafSize) {
+            childBounds = LeafBounds(first, count);
+            SetChild(nodes_[nodeIndex], slot, childBounds, first, count);
+        } else {
+            const uint32_t child = BuildNode(first, first + count, depth + 1, childBounds);
+            SetChild(nodes_[nodeIndex], slot, childBounds, child, 0);
+        }
+
+        Grow(nodeBounds, childBounds);
+    }
+
+    return nodeIndex;
+}
+
+uint32_t
+SceneBvh::Split(uint32_t begin, uint32_t end)
+{
+    Aabb centroidBounds {glm::vec3(infinity), glm::vec3(-infinity)};
+    for (uint32_t i = begin; i < end; ++i) {
+        centroidBounds.min = glm::min(centroidBounds.min, centroids_[objects_[i]]);
+        centroidBounds.max = glm::max(centroidBounds.max, centroids_[objects_[i]]);
+    }
+
+    const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+
+    float bestCost = infinity;
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+
+    // Binned SAH over all three axes
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        const float scale = binCount / extent[axis];
+        Aabb binBounds[binCount];
+        uint32_t binCounts[binCount] = {};
+
+        for (unsigned int b = 0; b < binCount; ++b)
+            binBounds[b] = EmptyAabb();
+
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t object = objects_[i];
+            const float position = (centroids_[object][axis] - centroidBounds.min[axis]) * scale;
+            const unsigned int bin = std::min(binCount - 1, static_cast<unsigned int>(position));
+
+            ++binCounts[bin];
+            Grow(binBounds[bin], bounds_[object]);
+        }
+
+        // Sweep from the right, then evaluate each plane sweeping from the left
+        float rightAreas[binCount];
+        uint32_t rightCounts[binCount];
+        Aabb right = EmptyAabb();
+        uint32_t rightCount = 0;
+
+        for (unsigned int b = binCount - 1; b > 0; --b) {
+            Grow(right, binBounds[b]);
+            rightCount += binCounts[b];
+            rightAreas[b] = HalfArea(right);
+            rightCounts[b] = rightCount;
+        }
+
+        Aabb left = EmptyAabb();
+        uint32_t leftCount = 0;
+
+        for (unsigned int b = 1; b < binCount; ++b) {
+            Grow(left, binBounds[b - 1]);
+            leftCount += binCounts[b - 1];
+
+            if (leftCount == 0 || rightCounts[b] == 0)
+                continue;
+
+            const float cost = leftCount * HalfArea(left) + rightCounts[b] * rightAreas[b];
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis >= 0) {
+        const float scale = binCount / extent[bestAxis];
+        const float minimum = centroidBounds.min[bestAxis];
+
+        uint32_t* middle = std::partition(objects_.data() + begin,
+                                          objects_.data() + end,
+                                          [&](uint32_t object) {
+                                              const unsigned int bin = std::min(
+                                                  binCount - 1,
+                                                  static_cast<unsigned int>(
+                                                      (centroids_[object][bestAxis] - minimum)
+                                                      * scale));
+                                              return bin < bestBin;
+                                          });
+
+        const uint32_t split = static_cast<uint32_t>(middle - objects_.data());
+        if (split > begin && split < end)
+            return split;
+    }
+
+    // Coincident centroids, any even split is as good
+    return begin + (end - begin) / 2;
+}
+
+SceneBvh::Aabb
+SceneBvh::LeafBounds(uint32_t first, uint32_t count) const
+{
+    Aabb leafBounds = EmptyAabb();
+
+    for (uint32_t i = first; i < first + count; ++i)
+        Grow(leafBounds, bounds_[objects_[i]]);
+
+    return leafBounds;
+}
+
+float
+SceneBvh::NodeArea() const
+{
+    float area = 0.0f;
+
+    for (uint32_t i = 0; i < nodeCount_; ++i) {
+        const Node& node = nodes_[i];
+
+        for (unsigned int slot = 0; slot < 2; ++slot) {
+            if (node.child[slot] == emptyChild)
+                continue;
+
+            const Aabb box {glm::vec3(node.minX[slot], node.minY[slot], node.minZ[slot]),
+                            glm::vec3(node.maxX[slot], node.maxY[slot], node.maxZ[slot])};
+            area += HalfArea(box);
+        }
+    }
+
+    return area;
+}
+
+void
+SceneBvh::SetChild(Node& node,
+                   unsigned int slot,
+                   const Aabb& childBounds,
+                   uint32_t child,
+                   uint32_t count)
+{
+    node.minX[slot] = childBounds.min.x;
+    node.minY[slot] = childBounds.min.y;
+    node.minZ[slot] = childBounds.min.z;
+    node.maxX[slot] = childBounds.max.x;
+    node.maxY[slot] = childBounds.max.y;
+    node.maxZ[slot] = childBounds.max.z;
+    node.child[slot] = child;
+    node.count[slot] = count;
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include <glm.hpp>
+
+// Bounding volume hierarchy over scene objects (world space AABBs).
+//
+// Built with the binned surface area heuristic. Each node holds the boxes of
+// both of its children and fills exactly one 64 byte cache line, so a visit
+// tests both children from one line. Nodes are stored parents first, which
+// lets Refit() walk them backwards when objects move without rebuilding.
+class SceneBvh
+{
+public:
+    struct Aabb
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    static const uint32_t invalidObject = ~0u;
+
+    SceneBvh();
+    ~SceneBvh();
+
+    // Object i is bounds[i]
+    void Build(const std::vector<Aabb>& bounds);
+
+    // Same objects with new boxes, keeps the topology. Quality drops as objects
+    // drift from where they were at Build, rebuild once GetRefitGrowth is
+    // well above 1.
+    void Refit(const std::vector<Aabb>& bounds);
+
+    // Summed area of every node's boxes now over that at the last Build, the
+    // part of the SAH cost refits change; 1 right after a Build
+    float GetRefitGrowth() const
+    {
+        return buildArea_ > 0.0f ? area_ / buildArea_ : 1.0f;
+    }
+
+    void ClearBvh();
+
+    // Appends every object whose box intersects the frustum of viewProjection
+    // (clip from world space)
+    void QueryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& objects) const;
+
+    // Nearest object whose box the ray enters within maxDistance, or
+    // invalidObject
+    uint32_t Raycast(const glm::vec3& origin,
+                     const glm::vec3& direction,
+                     float maxDistance,
+                     float* hitDistance = nullptr) const;
+
+    // Same with an exact per-object test: intersect(object, maxDistance)
+    // returns the hit distance or a negative value for a miss
+    uint32_t Raycast(const glm::vec3& origin,
+                     const glm::vec3& direction,
+                     float maxDistance,
+                     const std::function<float(uint32_t, float)>& intersect,
+                     float* hitDistance = nullptr) const;
+
+    size_t GetNodeCount() const
+    {
+        return nodeCount_;
+    }
+
+private:
+    // Child k is a leaf when count[k] > 0 (objects_[child[k]..+count[k]]),
+    // an inner node when count[k] == 0, empty when child[k] == emptyChild
+    struct Node
+    {
+        float minX[2], minY[2], minZ[2];
+        float maxX[2], maxY[2], maxZ[2];
+        uint32_t child[2];
+        uint32_t count[2];
+    };
+
+    static const uint32_t emptyChild = ~0u;
+    static const uint32_t maxLeafSize = 4;
+    static const unsigned int binCount = 12;
+
+    // SAH splits can be lopsided, from maxSahDepth on splits are plain halves
+    // so the tree is never deeper than maxSahDepth + 32 (32 bit object counts)
+    static const unsigned int maxSahDepth = 64;
+    static const unsigned int maxDepth = maxSahDepth + 32;
+
+    // Nodes live in nodeMemory_ aligned to a cache line (std::vector doesn't
+    // honour over-alignment before C++17). n objects never need more than n
+    // nodes.
+    std::vector<unsigned char> nodeMemory_;
+    Node* nodes_ {nullptr};
+    uint32_t nodeCount_ {0};
+
+    std::vector<uint32_t> objects_;
+    std::vector<Aabb> bounds_;
+    std::vector<glm::vec3> centroids_;
+    float buildArea_ {0.0f};
+    float area_ {0.0f};
+
+    uint32_t BuildNode(uint32_t begin, uint32_t end, unsigned int depth, Aabb& nodeBounds);
+    uint32_t Split(uint32_t begin, uint32_t end);
+    Aabb LeafBounds(uint32_t first, uint32_t count) const;
+    float NodeArea() const;
+    static void SetChild(Node& node,
+                         unsigned int slot,
+                         const Aabb& childBounds,
+                         uint32_t child,
+                         uint32_t count);
+};
@@ -1,5 +1,7 @@
 ﻿#include "Shader.h"
 
+#include "Tracing.h"
+
 Shader::Shader() {}
 
 Shader::~Shader()
@@ -53,6 +55,24 @@ Shader::GetModelLocation()
     return uniformModel_;
 }
 
+GLint
+Shader::GetUniformLocation(const char* name)
+{
+    return glGetUniformLocation(shaderID_, name);
+}
+
+bool
+Shader::BindUniformBlock(const char* blockName, GLuint binding)
+{
+    const GLuint blockIndex = glGetUniformBlockIndex(shaderID_, blockName);
+
+    if (blockIndex == GL_INVALID_INDEX)
+        return false;
+
+    glUniformBlockBinding(shaderID_, blockIndex, binding);
+    return true;
+}
+
 void
 Shader::UseShader()
 {
@@ -74,6 +94,8 @@ Shader::ClearShader()
 void
 Shader::CompileShader(const char* vertexCode, const char* fragmentCode)
 {
+    TRACE_SCOPE("Shader::CompileShader");
+
     // Programe sits on graphic card
 
     // id
@@ -21,6 +21,13 @@ public:
     GLuint GetProjectionLocation();
     GLuint GetModelLocation();
 
+    // -1 if the program has no such uniform
+    GLint GetUniformLocation(const char* name);
+
+    // Points the uniform block blockName at buffer binding point binding
+    // (see glBindBufferRange). Returns false if the program has no such block.
+    bool BindUniformBlock(const char* blockName, GLuint binding);
+
     void UseShader();
     void ClearShader();
 
@@ -0,0 +1,41 @@
+#version 330
+
+// RGB to NV12 from FrameCapture's flipped copy, rounded to code values:
+// plane 0 writes Y per pixel, plane 1 U and V of each 2x2 block
+
+out vec4 colour;
+
+uniform sampler2D captureTexture;
+uniform int plane;
+uniform ivec2 captureSize;
+
+// kr, kg, kb of the colour matrix
+uniform vec3 lumaWeights;
+// Luma scale and offset, chroma scale, in code values
+uniform vec3 codeRange;
+
+vec3 Fetch(ivec2 pixel)
+{
+  return texelFetch(captureTexture, min(pixel, captureSize - 1), 0).rgb;
+}
+
+void main()
+{
+  ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+  if (plane == 0) {
+    float y = dot(Fetch(pixel), lumaWeights);
+    colour = vec4(floor(y * codeRange.x + codeRange.y + 0.5) / 255.0, 0.0, 0.0, 1.0);
+    return;
+  }
+
+  // U and V are linear in RGB, so averaging RGB averages them
+  ivec2 corner = pixel * 2;
+  vec3 rgb = (Fetch(corner) + Fetch(corner + ivec2(1, 0))
+              + Fetch(corner + ivec2(0, 1)) + Fetch(corner + ivec2(1, 1))) * 0.25;
+  float y = dot(rgb, lumaWeights);
+  vec2 uv = vec2((rgb.b - y) / (2.0 * (1.0 - lumaWeights.b)),
+                 (rgb.r - y) / (2.0 * (1.0 - lumaWeights.r)));
+
+  colour = vec4(floor(uv * codeRange.z + 128.5) / 255.0, 0.0, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330
+
+in vec2 vTexCoord;
+in vec3 vNormal;
+flat in uint vMaterial;
+
+out vec4 colour;
+
+struct Material
+{
+  vec4 baseColor;
+  ivec4 texture;  // x: layer of materialTextures, -1 for none
+};
+
+// See MaterialBatch::maxMaterials
+layout (std140) uniform Materials
+{
+  Material materials[256];
+};
+
+uniform sampler2DArray materialTextures;
+
+void main()
+{
+  Material m = materials[vMaterial];
+  vec4 albedo = m.baseColor;
+
+  if (m.texture.x >= 0)
+    albedo *= texture(materialTextures, vec3(vTexCoord, float(m.texture.x)));
+
+  // Fixed light from the viewer's upper left
+  float light = 0.4 + 0.6 * max(dot(normalize(vNormal), normalize(vec3(-0.4, 0.5, 1.0))), 0.0);
+
+  colour = vec4(albedo.rgb * light, albedo.a);
+}
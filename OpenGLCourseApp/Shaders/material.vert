@@ -0,0 +1,23 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec3 norm;
+
+// Per-draw row of MaterialBatch, locations 3 to 6 and 7
+layout (location = 3) in mat4 model;
+layout (location = 7) in uint material;
+
+out vec2 vTexCoord;
+out vec3 vNormal;
+flat out uint vMaterial;
+
+uniform mat4 projection;
+
+void main()
+{
+  gl_Position = projection * model * vec4(pos, 1.0);
+  vTexCoord = texCoord;
+  vNormal = mat3(model) * norm;
+  vMaterial = material;
+}
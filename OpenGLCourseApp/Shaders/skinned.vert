@@ -0,0 +1,31 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 norm;
+layout (location = 2) in vec4 jointIndices;
+layout (location = 3) in vec4 jointWeights;
+
+out vec4 vCol;
+
+uniform mat4 model;
+uniform mat4 projection;
+
+// Skin matrices of one character (see Skinning::maxJoints)
+layout (std140) uniform Joints
+{
+  mat4 jointMatrices[128];
+};
+
+void main()
+{
+  // Linear blend skinning, the weights add up to 1
+  mat4 skin = jointMatrices[int(jointIndices.x)] * jointWeights.x
+            + jointMatrices[int(jointIndices.y)] * jointWeights.y
+            + jointMatrices[int(jointIndices.z)] * jointWeights.z
+            + jointMatrices[int(jointIndices.w)] * jointWeights.w;
+
+  vec3 skinnedNormal = normalize(mat3(model) * mat3(skin) * norm);
+
+  gl_Position = projection * model * skin * vec4(pos, 1.0);
+  vCol = vec4(skinnedNormal * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 norm;
+layout (location = 2) in vec4 jointIndices;
+layout (location = 3) in vec4 jointWeights;
+
+out vec4 vCol;
+
+uniform mat4 model;
+uniform mat4 projection;
+
+// Real then dual part of each joint's skin transform (see Skinning::maxJoints)
+layout (std140) uniform JointDualQuaternions
+{
+  vec4 jointDualQuaternions[256];
+};
+
+void main()
+{
+  ivec4 joints = ivec4(jointIndices);
+
+  // Blend in the first joint's hemisphere, q and -q are the same rotation
+  vec4 real0 = jointDualQuaternions[joints.x * 2];
+  vec4 real = real0 * jointWeights.x;
+  vec4 dual = jointDualQuaternions[joints.x * 2 + 1] * jointWeights.x;
+
+  for (int i = 1; i < 4; ++i) {
+    vec4 jointReal = jointDualQuaternions[joints[i] * 2];
+    float weight = dot(real0, jointReal) < 0.0 ? -jointWeights[i] : jointWeights[i];
+
+    real += jointReal * weight;
+    dual += jointDualQuaternions[joints[i] * 2 + 1] * weight;
+  }
+
+  float invLength = 1.0 / length(real);
+  real *= invLength;
+  dual *= invLength;
+
+  // Rotate, then translate by 2 dual * conjugate(real)
+  vec3 rotated = pos + 2.0 * cross(real.xyz, cross(real.xyz, pos) + real.w * pos);
+  vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+  vec3 skinnedNormal = norm + 2.0 * cross(real.xyz, cross(real.xyz, norm) + real.w * norm);
+
+  gl_Position = projection * model * vec4(rotated + translation, 1.0);
+  vCol = vec4(normalize(mat3(model) * skinnedNormal) * 0.5 + 0.5, 1.0);
+}
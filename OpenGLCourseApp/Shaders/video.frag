@@ -0,0 +1,67 @@
+#version 330
+
+// YUV to RGB in integer fixed point, the same arithmetic as the CPU converter
+// (see YuvCoefficients) so both give the same bytes at 1:1 scale
+
+out vec4 colour;
+
+in vec2 texCoord;
+
+// 0 NV12, 1 I420, 2 YUYV (see VideoFormat)
+uniform int videoFormat;
+uniform ivec2 videoSize;
+
+// Y (R8), or Y and U/V pairs for YUYV (RG8)
+uniform sampler2D lumaTexture;
+// UV (RG8) for NV12, U (R8) for I420
+uniform sampler2D chromaTexture;
+// V (R8) for I420
+uniform sampler2D chromaVTexture;
+
+// Scale in 1/8192ths, offset in code values
+uniform ivec2 lumaCoefficients;
+// V to R, U to G, V to G, U to B in 1/8192ths
+uniform ivec4 chromaCoefficients;
+
+ivec2 Sample(sampler2D plane, ivec2 pixel)
+{
+  return ivec2(texelFetch(plane, pixel, 0).rg * 255.0 + 0.5);
+}
+
+int Channel(int value)
+{
+  return clamp(value + 4096, 0, 255 << 13) >> 13;
+}
+
+void main()
+{
+  ivec2 pixel = clamp(ivec2(texCoord * vec2(videoSize)), ivec2(0), videoSize - 1);
+  int y;
+  int u;
+  int v;
+
+  if (videoFormat == 2) {
+    int even = pixel.x & ~1;
+    y = Sample(lumaTexture, pixel).x;
+    u = Sample(lumaTexture, ivec2(even, pixel.y)).y;
+    v = Sample(lumaTexture, ivec2(even + 1, pixel.y)).y;
+  } else if (videoFormat == 1) {
+    y = Sample(lumaTexture, pixel).x;
+    u = Sample(chromaTexture, pixel / 2).x;
+    v = Sample(chromaVTexture, pixel / 2).x;
+  } else {
+    y = Sample(lumaTexture, pixel).x;
+    ivec2 uv = Sample(chromaTexture, pixel / 2);
+    u = uv.x;
+    v = uv.y;
+  }
+
+  int luma = lumaCoefficients.x * (y - lumaCoefficients.y);
+  u -= 128;
+  v -= 128;
+
+  colour = vec4(Channel(luma + chromaCoefficients.x * v),
+                Channel(luma - chromaCoefficients.y * u - chromaCoefficients.z * v),
+                Channel(luma + chromaCoefficients.w * u),
+                255) / 255.0;
+}
@@ -0,0 +1,14 @@
+#version 330
+
+// Full screen quad from gl_VertexID, drawn as a 4 vertex strip without buffers
+
+out vec2 texCoord;
+
+void main()
+{
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+  // Row 0 of the video is the top of the screen
+  texCoord = vec2(corner.x, 1.0 - corner.y);
+  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,75 @@
+﻿#include "Skeleton.h"
+
+namespace {
+
+glm::mat4
+PoseMatrix(const JointPose& pose)
+{
+    glm::mat4 matrix = glm::mat4_cast(pose.rotation);
+    matrix[0] *= pose.scale.x;
+    matrix[1] *= pose.scale.y;
+    matrix[2] *= pose.scale.z;
+    matrix[3] = glm::vec4(pose.translation, 1.0f);
+
+    return matrix;
+}
+
+} // namespace
+
+int
+Skeleton::AddJoint(int parent, const JointPose& bindPose)
+{
+    const int joint = static_cast<int>(parents_.size());
+    if (parent != noParent && (parent < 0 || parent >= joint))
+        return -1;
+
+    const glm::mat4 local = PoseMatrix(bindPose);
+    const glm::mat4 model = parent == noParent ? local : glm::inverse(inverseBind_[parent]) * local;
+
+    parents_.push_back(parent);
+    bindPose_.push_back(bindPose);
+    inverseBind_.push_back(glm::inverse(model));
+
+    return joint;
+}
+
+void
+Skeleton::BuildModelMatrices(const JointPose* localPose, glm::mat4* models) const
+{
+    for (size_t i = 0; i < parents_.size(); ++i) {
+        const int parent = parents_[i];
+
+        const glm::mat4 local = PoseMatrix(localPose[i]);
+
+        models[i] = parent == noParent ? local : models[parent] * local;
+    }
+}
+
+void
+Skeleton::BuildSkinMatrices(const JointPose* localPose, glm::mat4* models, glm::mat4* skin) const
+{
+    BuildModelMatrices(localPose, models);
+
+    for (size_t i = 0; i < parents_.size(); ++i)
+        skin[i] = models[i] * inverseBind_[i];
+}
+
+void
+Skeleton::BlendPoses(const JointPose* a,
+                     const JointPose* b,
+                     float weight,
+                     size_t count,
+                     JointPose* result)
+{
+    const float aWeight = 1.0f - weight;
+
+    for (size_t i = 0; i < count; ++i) {
+        const glm::quat& from = a[i].rotation;
+        const glm::quat& to = b[i].rotation;
+        const float toWeight = glm::dot(from, to) < 0.0f ? -weight : weight;
+
+        result[i].rotation = glm::normalize(from * aWeight + to * toWeight);
+        result[i].translation = a[i].translation * aWeight + b[i].translation * weight;
+        result[i].scale = a[i].scale * aWeight + b[i].scale * weight;
+    }
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+// A joint relative to its parent, applied as scale, then rotation, then translation
+struct JointPose
+{
+    glm::quat rotation {1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 translation {0.0f};
+    glm::vec3 scale {1.0f};
+};
+
+// Joint hierarchy with its bind pose. Joints are stored parents first, so one
+// pass in index order takes a local pose to model space.
+class Skeleton
+{
+public:
+    static const int noParent = -1;
+
+    // parent is noParent or a joint added before. Returns the new joint's index,
+    // -1 for any other parent.
+    int AddJoint(int parent, const JointPose& bindPose);
+
+    size_t GetJointCount() const
+    {
+        return parents_.size();
+    }
+
+    int GetParent(size_t joint) const
+    {
+        return parents_[joint];
+    }
+
+    const JointPose* GetBindPose() const
+    {
+        return bindPose_.data();
+    }
+
+    // Model space matrix of every joint, models holds GetJointCount() matrices
+    void BuildModelMatrices(const JointPose* localPose, glm::mat4* models) const;
+
+    // skin[i] = model space joint i * inverse bind matrix i, takes bind pose
+    // vertices to the posed mesh. models receives the model space matrices.
+    void BuildSkinMatrices(const JointPose* localPose, glm::mat4* models, glm::mat4* skin) const;
+
+    // result = a at weight 0, b at weight 1. Rotations take the normalised
+    // lerp along the shorter arc. result may be a or b.
+    static void BlendPoses(const JointPose* a,
+                           const JointPose* b,
+                           float weight,
+                           size_t count,
+                           JointPose* result);
+
+private:
+    std::vector<int> parents_;
+    std::vector<JointPose> bindPose_;
+    std::vector<glm::mat4> inverseBind_;
+};
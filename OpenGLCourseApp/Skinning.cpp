@@ -0,0 +1,133 @@
+﻿#include "Skinning.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gtc/type_ptr.hpp>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKINNING_SSE2 1
+#endif
+
+const Mesh::VertexAttribute Skinning::vertexAttributes[4] = {
+    {0, 3, GL_FLOAT, GL_FALSE, offsetof(SkinnedVertex, position)},
+    {1, 3, GL_FLOAT, GL_FALSE, offsetof(SkinnedVertex, normal)},
+    {2, 4, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(SkinnedVertex, joints)},
+    {3, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(SkinnedVertex, weights)},
+};
+
+namespace {
+
+void
+SkinRange(const SkinnedVertex* vertices,
+          size_t first,
+          size_t last,
+          const glm::mat4* skinMatrices,
+          glm::vec4* positions,
+          glm::vec4* normals)
+{
+    const float weightScale = 1.0f / 255.0f;
+
+#ifdef SKINNING_SSE2
+    for (size_t i = first; i < last; ++i) {
+        const SkinnedVertex& vertex = vertices[i];
+
+        // Blend the four matrices column by column
+        __m128 column0 = _mm_setzero_ps();
+        __m128 column1 = _mm_setzero_ps();
+        __m128 column2 = _mm_setzero_ps();
+        __m128 column3 = _mm_setzero_ps();
+
+        for (int influence = 0; influence < 4; ++influence) {
+            const float* matrix = &skinMatrices[vertex.joints[influence]][0][0];
+            const __m128 weight = _mm_set1_ps(vertex.weights[influence] * weightScale);
+
+            column0 = _mm_add_ps(column0, _mm_mul_ps(_mm_loadu_ps(matrix), weight));
+            column1 = _mm_add_ps(column1, _mm_mul_ps(_mm_loadu_ps(matrix + 4), weight));
+            column2 = _mm_add_ps(column2, _mm_mul_ps(_mm_loadu_ps(matrix + 8), weight));
+            column3 = _mm_add_ps(column3, _mm_mul_ps(_mm_loadu_ps(matrix + 12), weight));
+        }
+
+        const __m128 position = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(vertex.position[0])),
+                       _mm_mul_ps(column1, _mm_set1_ps(vertex.position[1]))),
+            _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(vertex.position[2])), column3));
+        _mm_storeu_ps(&positions[i][0], position);
+
+        if (normals == nullptr)
+            continue;
+
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(vertex.normal[0])),
+                                              _mm_mul_ps(column1, _mm_set1_ps(vertex.normal[1]))),
+                                   _mm_mul_ps(column2, _mm_set1_ps(vertex.normal[2])));
+
+        // w is 0, the horizontal sum of squares is the squared length
+        __m128 lengthSquared = _mm_mul_ps(normal, normal);
+        lengthSquared = _mm_add_ps(lengthSquared,
+                                   _mm_shuffle_ps(lengthSquared,
+                                                  lengthSquared,
+                                                  _MM_SHUFFLE(2, 3, 0, 1)));
+        lengthSquared = _mm_add_ps(lengthSquared,
+                                   _mm_shuffle_ps(lengthSquared,
+                                                  lengthSquared,
+                                                  _MM_SHUFFLE(1, 0, 3, 2)));
+        normal = _mm_div_ps(normal, _mm_sqrt_ps(_mm_max_ps(lengthSquared, _mm_set1_ps(1e-20f))));
+        _mm_storeu_ps(&normals[i][0], normal);
+    }
+#else
+    for (size_t i = first; i < last; ++i) {
+        const SkinnedVertex& vertex = vertices[i];
+
+        glm::mat4 skin(0.0f);
+        for (int influence = 0; influence < 4; ++influence) {
+            const glm::mat4& matrix = skinMatrices[vertex.joints[influence]];
+            const float weight = vertex.weights[influence] * weightScale;
+
+            skin[0] += matrix[0] * weight;
+            skin[1] += matrix[1] * weight;
+            skin[2] += matrix[2] * weight;
+            skin[3] += matrix[3] * weight;
+        }
+
+        positions[i] = skin * glm::vec4(glm::make_vec3(vertex.position), 1.0f);
+
+        if (normals != nullptr) {
+            const glm::vec4 normal = skin * glm::vec4(glm::make_vec3(vertex.normal), 0.0f);
+            normals[i] = normal / std::sqrt(std::max(glm::dot(normal, normal), 1e-20f));
+        }
+    }
+#endif
+}
+
+} // namespace
+
+void
+Skinning::SkinVertices(const SkinnedVertex* vertices,
+                       size_t count,
+                       const glm::mat4* skinMatrices,
+                       glm::vec4* positions,
+                       glm::vec4* normals,
+                       ThreadPool* pool)
+{
+    // Batches large enough to be worth waking the pool for
+    const size_t batchSize = 4096;
+
+    if (pool == nullptr || count <= batchSize) {
+        SkinRange(vertices, 0, count, skinMatrices, positions, normals);
+        return;
+    }
+
+    const unsigned int batchCount = static_cast<unsigned int>((count + batchSize - 1) / batchSize);
+
+    pool->ParallelFor(batchCount, [&](unsigned int batch) {
+        SkinRange(vertices,
+                  batch * batchSize,
+                  std::min((batch + 1) * batchSize, count),
+                  skinMatrices,
+                  positions,
+                  normals);
+    });
+}
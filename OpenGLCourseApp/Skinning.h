@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glm.hpp>
+
+#include "Mesh.h"
+
+class ThreadPool;
+
+// Bind pose vertex with up to four joint influences, uploaded as is for GPU
+// skinning. Weights are in 255ths and add up to 255.
+struct SkinnedVertex
+{
+    float position[3];
+    float normal[3];
+    uint8_t joints[4];
+    uint8_t weights[4];
+};
+
+// Linear blend skinning on the CPU, for when the joints cannot go to the GPU
+// (more joints than the shader's uniform block holds, or the skinned
+// positions are needed for picking/culling). The GPU shaders are
+// Shaders/skinned.vert (linear blend) and Shaders/skinned_dq.vert (dual quaternion).
+class Skinning
+{
+public:
+    // Joints one shader uniform block holds, per character
+    static const unsigned int maxJoints = 128;
+
+    // Attribute locations 0 to 3 of the skinned shaders for SkinnedVertex:
+    // position, normal, joints (integers read as floats), weights (normalized)
+    static const Mesh::VertexAttribute vertexAttributes[4];
+
+    // positions[i] = blended skin matrix * (position, 1), normals[i] the same
+    // for (normal, 0), renormalised. normals may be null. pool may be null.
+    static void SkinVertices(const SkinnedVertex* vertices,
+                             size_t count,
+                             const glm::mat4* skinMatrices,
+                             glm::vec4* positions,
+                             glm::vec4* normals,
+                             ThreadPool* pool = nullptr);
+};
@@ -0,0 +1,486 @@
+﻿#include "Texture.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "GlStats.h"
+#include "TextureFile.h"
+#include "Tracing.h"
+
+namespace {
+
+// Client format and type matching internalFormat, for glTexImage* when
+// immutable storage is missing and for uncompressed texture files
+void
+StorageFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+    type = GL_UNSIGNED_BYTE;
+
+    switch (internalFormat) {
+    case GL_R8:
+        format = GL_RED;
+        break;
+    case GL_RG8:
+        format = GL_RG;
+        break;
+    case GL_RGB8:
+    case GL_SRGB8:
+        format = GL_RGB;
+        break;
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        format = GL_DEPTH_COMPONENT;
+        type = GL_FLOAT;
+        break;
+    case GL_DEPTH24_STENCIL8:
+        format = GL_DEPTH_STENCIL;
+        type = GL_UNSIGNED_INT_24_8;
+        break;
+    default:
+        format = GL_RGBA;
+        break;
+    }
+}
+
+} // namespace
+
+Texture::Texture() {}
+
+Texture::~Texture()
+{
+    ClearTexture();
+}
+
+bool
+Texture::CreateTexture(Type type,
+                       GLenum internalFormat,
+                       GLsizei width,
+                       GLsizei height,
+                       GLsizei layers,
+                       GLsizei levels)
+{
+    ClearTexture();
+
+    if (type == Type::Texture2D)
+        layers = 1;
+    else if (type == Type::Cube)
+        layers = 6;
+
+    if (width <= 0 || height <= 0 || layers <= 0 || (type == Type::Cube && width != height)) {
+        printf("Invalid texture size %dx%d, %d layers\n", width, height, layers);
+        return false;
+    }
+
+    const GLsizei mipCount = GetMipCount(width, height);
+
+    type_ = type;
+    internalFormat_ = internalFormat;
+    width_ = width;
+    height_ = height;
+    layers_ = layers;
+    levels_ = levels <= 0 ? mipCount : std::min(levels, mipCount);
+
+    const GLenum target = GetTarget();
+
+    glGenTextures(1, &textureID_);
+    glBindTexture(target, textureID_);
+
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+        if (type == Type::Array)
+            glTexStorage3D(target, levels_, internalFormat, width, height, layers);
+        else
+            glTexStorage2D(target, levels_, internalFormat, width, height);
+    } else {
+        GLenum format = GL_RGBA, dataType = GL_UNSIGNED_BYTE;
+        StorageFormat(internalFormat, format, dataType);
+
+        const bool compressed = TextureFile::IsCompressedFormat(internalFormat);
+
+        for (GLint level = 0; level < levels_; ++level) {
+            const GLsizei levelWidth = GetLevelWidth(level);
+            const GLsizei levelHeight = GetLevelHeight(level);
+
+            if (compressed) {
+                AllocateCompressedLevel(level);
+                continue;
+            }
+
+            if (type == Type::Array) {
+                glTexImage3D(target,
+                             level,
+                             internalFormat,
+                             levelWidth,
+                             levelHeight,
+                             layers,
+                             0,
+                             format,
+                             dataType,
+                             nullptr);
+                continue;
+            }
+
+            for (GLsizei face = 0; face < (type == Type::Cube ? 6 : 1); ++face) {
+                glTexImage2D(type == Type::Cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target,
+                             level,
+                             internalFormat,
+                             levelWidth,
+                             levelHeight,
+                             0,
+                             format,
+                             dataType,
+                             nullptr);
+            }
+        }
+
+        // Mutable textures are only complete up to the levels that exist
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
+    }
+
+    const GLint wrap = type == Type::Cube ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+    glTexParameteri(target,
+                    GL_TEXTURE_MIN_FILTER,
+                    levels_ > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+
+    glBindTexture(target, 0);
+
+    return true;
+}
+
+void
+Texture::SetImage(GLint level,
+                  GLsizei layer,
+                  GLint firstRow,
+                  GLsizei rowCount,
+                  GLenum format,
+                  GLenum type,
+                  const void* pixels)
+{
+    const GLenum target = GetTarget();
+    const GLsizei levelWidth = GetLevelWidth(level);
+
+    glBindTexture(target, textureID_);
+
+    if (type_ == Type::Array) {
+        glTexSubImage3D(
+            target, level, 0, firstRow, layer, levelWidth, rowCount, 1, format, type, pixels);
+    } else {
+        glTexSubImage2D(type_ == Type::Cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer : target,
+                        level,
+                        0,
+                        firstRow,
+                        levelWidth,
+                        rowCount,
+                        format,
+                        type,
+                        pixels);
+    }
+
+    glBindTexture(target, 0);
+}
+
+bool
+Texture::CreateFromFile(const char* fileLocation)
+{
+    TRACE_SCOPE("Texture::CreateFromFile");
+
+    TextureFile file;
+
+    if (!file.Open(fileLocation))
+        return false;
+
+    if (!IsFormatSupported(file.GetInternalFormat())) {
+        printf("Texture %s has format 0x%X, which this context can't sample!\n",
+               fileLocation,
+               file.GetInternalFormat());
+        return false;
+    }
+
+    if (!CreateTexture(file.GetType(),
+                       file.GetInternalFormat(),
+                       file.GetWidth(),
+                       file.GetHeight(),
+                       file.GetLayers(),
+                       file.GetLevels())) {
+        return false;
+    }
+
+    UploadFile(file, 0, levels_);
+
+    return true;
+}
+
+bool
+Texture::LoadLayerFromFile(GLsizei layer, const char* fileLocation)
+{
+    TRACE_SCOPE("Texture::LoadLayerFromFile");
+
+    if (textureID_ == 0 || layer < 0 || layer >= layers_) {
+        printf("Texture has no layer %d for %s!\n", layer, fileLocation);
+        return false;
+    }
+
+    TextureFile file;
+
+    if (!file.Open(fileLocation))
+        return false;
+
+    if (file.GetType() != Type::Texture2D || file.GetInternalFormat() != internalFormat_
+        || file.GetWidth() != width_ || file.GetHeight() != height_) {
+        printf("Texture %s is %dx%d with format 0x%X, a layer here is %dx%d with 0x%X!\n",
+               fileLocation,
+               file.GetWidth(),
+               file.GetHeight(),
+               file.GetInternalFormat(),
+               width_,
+               height_,
+               internalFormat_);
+        return false;
+    }
+
+    // Levels the file lacks would stay undefined but still be sampled
+    if (file.GetLevels() < levels_) {
+        printf("Texture %s has %d levels, a layer here has %d!\n",
+               fileLocation,
+               file.GetLevels(),
+               levels_);
+        return false;
+    }
+
+    UploadFile(file, layer, levels_);
+
+    return true;
+}
+
+void
+Texture::UploadFile(const TextureFile& file, GLsizei firstLayer, GLsizei levels)
+{
+    const bool compressed = TextureFile::IsCompressedFormat(internalFormat_);
+
+    // Uncompressed formats are 8 bit, see TextureFile
+    GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+    StorageFormat(internalFormat_, format, type);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, file.GetRowAlignment());
+
+    for (GLint level = 0; level < levels; ++level) {
+        for (GLsizei layer = 0; layer < file.GetLayers(); ++layer) {
+            if (compressed) {
+                SetCompressedImage(level,
+                                   firstLayer + layer,
+                                   static_cast<GLsizei>(file.GetImageSize(level)),
+                                   file.GetImageData(level, layer));
+            } else {
+                SetImage(level,
+                         firstLayer + layer,
+                         0,
+                         GetLevelHeight(level),
+                         format,
+                         type,
+                         file.GetImageData(level, layer));
+            }
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void
+Texture::SetCompressedImage(GLint level, GLsizei layer, GLsizei imageSize, const void* data)
+{
+    const GLenum target = GetTarget();
+    const GLsizei levelWidth = GetLevelWidth(level);
+    const GLsizei levelHeight = GetLevelHeight(level);
+
+    glBindTexture(target, textureID_);
+
+    if (type_ == Type::Array) {
+        glCompressedTexSubImage3D(target,
+                                  level,
+                                  0,
+                                  0,
+                                  layer,
+                                  levelWidth,
+                                  levelHeight,
+                                  1,
+                                  internalFormat_,
+                                  imageSize,
+                                  data);
+    } else {
+        glCompressedTexSubImage2D(type_ == Type::Cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer
+                                                      : target,
+                                  level,
+                                  0,
+                                  0,
+                                  levelWidth,
+                                  levelHeight,
+                                  internalFormat_,
+                                  imageSize,
+                                  data);
+    }
+
+    glBindTexture(target, 0);
+}
+
+void
+Texture::Bind(GLuint unit)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GetTarget(), IsReady() ? textureID_ : 0);
+}
+
+void
+Texture::ClearTexture()
+{
+    if (uploadFence_) {
+        glDeleteSync(uploadFence_);
+        uploadFence_ = nullptr;
+    }
+
+    if (textureID_ != 0) {
+        glDeleteTextures(1, &textureID_);
+        textureID_ = 0;
+    }
+
+    width_ = 0;
+    height_ = 0;
+    layers_ = 0;
+    levels_ = 0;
+    uploading_ = false;
+}
+
+void
+Texture::BeginUpload()
+{
+    uploading_ = true;
+}
+
+void
+Texture::EndUpload(GLsync fence)
+{
+    uploading_ = false;
+
+    if (uploadFence_)
+        glDeleteSync(uploadFence_);
+
+    uploadFence_ = fence;
+}
+
+bool
+Texture::IsReady()
+{
+    if (textureID_ == 0 || uploading_)
+        return false;
+
+    if (uploadFence_) {
+        // Poll only, never wait on the GPU here
+        GLenum result = glClientWaitSync(uploadFence_, 0, 0);
+
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return false;
+
+        glDeleteSync(uploadFence_);
+        uploadFence_ = nullptr;
+    }
+
+    return true;
+}
+
+GLenum
+Texture::GetTarget() const
+{
+    switch (type_) {
+    case Type::Array:
+        return GL_TEXTURE_2D_ARRAY;
+    case Type::Cube:
+        return GL_TEXTURE_CUBE_MAP;
+    default:
+        return GL_TEXTURE_2D;
+    }
+}
+
+GLsizei
+Texture::GetLevelWidth(GLint level) const
+{
+    return std::max(width_ >> level, 1);
+}
+
+GLsizei
+Texture::GetLevelHeight(GLint level) const
+{
+    return std::max(height_ >> level, 1);
+}
+
+bool
+Texture::IsFormatSupported(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc;
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    case GL_COMPRESSED_R11_EAC:
+    case GL_COMPRESSED_SIGNED_R11_EAC:
+    case GL_COMPRESSED_RG11_EAC:
+    case GL_COMPRESSED_SIGNED_RG11_EAC:
+        return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+    default:
+        // RGTC (BC4, BC5) and the 8 bit formats are core in 3.3
+        return TextureFile::IsKnownFormat(internalFormat);
+    }
+}
+
+void
+Texture::AllocateCompressedLevel(GLint level)
+{
+    const GLenum target = GetTarget();
+    const GLsizei levelWidth = GetLevelWidth(level);
+    const GLsizei levelHeight = GetLevelHeight(level);
+    const GLsizei imageSize = static_cast<GLsizei>(
+        TextureFile::GetImageSize(internalFormat_, levelWidth, levelHeight));
+
+    if (type_ == Type::Array) {
+        glCompressedTexImage3D(target,
+                               level,
+                               internalFormat_,
+                               levelWidth,
+                               levelHeight,
+                               layers_,
+                               0,
+                               imageSize * layers_,
+                               nullptr);
+        return;
+    }
+
+    for (GLsizei face = 0; face < (type_ == Type::Cube ? 6 : 1); ++face) {
+        glCompressedTexImage2D(type_ == Type::Cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target,
+                               level,
+                               internalFormat_,
+                               levelWidth,
+                               levelHeight,
+                               0,
+                               imageSize,
+                               nullptr);
+    }
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+
+class TextureFile;
+
+// A 2D, 2D array or cube texture with every level allocated up front,
+// immutable storage (glTexStorage*) when the context has it. Data arrives
+// through SetImage, SetCompressedImage, CreateFromFile or LoadLayerFromFile,
+// or is streamed in by TextureStreamer.
+class Texture
+{
+public:
+    enum class Type
+    {
+        Texture2D,
+        Array,
+        Cube,
+    };
+
+    Texture();
+    ~Texture();
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    // layers is the array size (1 for 2D, 6 faces for cube maps, which must
+    // be square). levels 0 allocates the full mip chain.
+    bool CreateTexture(Type type,
+                       GLenum internalFormat,
+                       GLsizei width,
+                       GLsizei height,
+                       GLsizei layers = 1,
+                       GLsizei levels = 0);
+
+    // KTX, KTX 2 or DDS (see TextureFile), uploaded straight from the file
+    // mapping, block compressed data included, without decoding
+    bool CreateFromFile(const char* fileLocation);
+
+    // Fills one layer of an existing array from a single layer file of the
+    // same size and format with at least as many levels; extra levels in the
+    // file are left out
+    bool LoadLayerFromFile(GLsizei layer, const char* fileLocation);
+
+    // Replaces rows [firstRow, firstRow + rowCount) of one level of one layer
+    // (cube face in the usual +X, -X, +Y, -Y, +Z, -Z order). pixels is an
+    // offset when a pixel unpack buffer is bound.
+    void SetImage(GLint level,
+                  GLsizei layer,
+                  GLint firstRow,
+                  GLsizei rowCount,
+                  GLenum format,
+                  GLenum type,
+                  const void* pixels);
+
+    // Replaces a whole level of one layer with imageSize bytes of blocks in
+    // the texture's compressed format
+    void SetCompressedImage(GLint level, GLsizei layer, GLsizei imageSize, const void* data);
+
+    // Binds to texture unit unit, or binds nothing there until IsReady
+    void Bind(GLuint unit);
+    void ClearTexture();
+
+    // Streamed creation (see TextureStreamer), like Mesh: the texture only
+    // binds once the fence after the last copy has signalled
+    void BeginUpload();
+    void EndUpload(GLsync fence);
+    bool IsReady();
+
+    GLuint GetID() const
+    {
+        return textureID_;
+    }
+    GLenum GetTarget() const;
+    Type GetType() const
+    {
+        return type_;
+    }
+    GLenum GetInternalFormat() const
+    {
+        return internalFormat_;
+    }
+    GLsizei GetWidth() const
+    {
+        return width_;
+    }
+    GLsizei GetHeight() const
+    {
+        return height_;
+    }
+    GLsizei GetLayers() const
+    {
+        return layers_;
+    }
+    GLsizei GetLevels() const
+    {
+        return levels_;
+    }
+
+    // Size of a level, at least 1
+    GLsizei GetLevelWidth(GLint level) const;
+    GLsizei GetLevelHeight(GLint level) const;
+
+    // Levels down to 1x1, inline so the offline tools need no GL
+    static GLsizei GetMipCount(GLsizei width, GLsizei height)
+    {
+        GLsizei count = 1;
+
+        while (((width > height ? width : height) >> count) > 0)
+            ++count;
+
+        return count;
+    }
+
+    // Whether the context can sample internalFormat (BCn and ETC2 depend on
+    // extensions)
+    static bool IsFormatSupported(GLenum internalFormat);
+
+private:
+    GLuint textureID_ {0};
+    Type type_ {Type::Texture2D};
+    GLenum internalFormat_ {GL_RGBA8};
+    GLsizei width_ {0};
+    GLsizei height_ {0};
+    GLsizei layers_ {0};
+    GLsizei levels_ {0};
+
+    bool uploading_ {false};
+    GLsync uploadFence_ {nullptr};
+
+    // glCompressedTexImage* without data, when immutable storage is missing
+    void AllocateCompressedLevel(GLint level);
+
+    // The file's layers from firstLayer on, levels [0, levels)
+    void UploadFile(const TextureFile& file, GLsizei firstLayer, GLsizei levels);
+};
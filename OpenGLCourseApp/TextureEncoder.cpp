@@ -0,0 +1,377 @@
+﻿#include "TextureEncoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+namespace {
+
+const int blockTexels = 16;
+
+int
+Quantize(float value, int maximum)
+{
+    const float clamped = std::min(std::max(value, 0.0f), 255.0f);
+    return static_cast<int>(std::lround(clamped * maximum / 255.0f));
+}
+
+uint16_t
+PackColor(const float color[3])
+{
+    return static_cast<uint16_t>(Quantize(color[0], 31) << 11 | Quantize(color[1], 63) << 5
+                                 | Quantize(color[2], 31));
+}
+
+void
+UnpackColor(uint16_t packed, int color[3])
+{
+    const int r = packed >> 11 & 31;
+    const int g = packed >> 5 & 63;
+    const int b = packed & 31;
+
+    // Bit replication, as the hardware expands them
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// Picks the nearest of the four palette colors for every texel of the block
+// and returns the summed squared error. color0 > color1 (four color mode).
+int
+ChooseColorIndices(const uint8_t* texels, uint16_t color0, uint16_t color1, uint32_t& indices)
+{
+    int palette[4][3];
+    UnpackColor(color0, palette[0]);
+    UnpackColor(color1, palette[1]);
+
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    int error = 0;
+    indices = 0;
+
+    for (int i = 0; i < blockTexels; ++i) {
+        int best = 0;
+        int bestDistance = 0x7FFFFFFF;
+
+        for (int p = 0; p < 4; ++p) {
+            int distance = 0;
+
+            for (int c = 0; c < 3; ++c) {
+                const int delta = texels[i * 4 + c] - palette[p][c];
+                distance += delta * delta;
+            }
+
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = p;
+            }
+        }
+
+        indices |= static_cast<uint32_t>(best) << (i * 2);
+        error += bestDistance;
+    }
+
+    return error;
+}
+
+// Orders the endpoints for four color mode and picks the indices. Equal
+// endpoints would mean three color mode, where index 0 still is the color.
+int
+FinishColorBlock(const uint8_t* texels, uint16_t& color0, uint16_t& color1, uint32_t& indices)
+{
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    if (color0 == color1) {
+        indices = 0;
+
+        int palette[3];
+        UnpackColor(color0, palette);
+
+        int error = 0;
+        for (int i = 0; i < blockTexels; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                const int delta = texels[i * 4 + c] - palette[c];
+                error += delta * delta;
+            }
+        }
+
+        return error;
+    }
+
+    return ChooseColorIndices(texels, color0, color1, indices);
+}
+
+// BC1 color block from 16 RGBA texels
+void
+EncodeColorBlock(const uint8_t* texels, uint8_t* block)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+
+    for (int i = 0; i < blockTexels; ++i) {
+        for (int c = 0; c < 3; ++c)
+            mean[c] += texels[i * 4 + c];
+    }
+
+    for (float& value : mean)
+        value /= blockTexels;
+
+    // Covariance, then its principal axis by power iteration
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (int i = 0; i < blockTexels; ++i) {
+        const float r = texels[i * 4 + 0] - mean[0];
+        const float g = texels[i * 4 + 1] - mean[1];
+        const float b = texels[i * 4 + 2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        const float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+
+        if (length < 1e-6f)
+            break;
+
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    const float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float minimum = 0.0f, maximum = 0.0f;
+
+    for (int i = 0; i < blockTexels; ++i) {
+        const float t = (texels[i * 4 + 0] - mean[0]) * axis[0]
+                        + (texels[i * 4 + 1] - mean[1]) * axis[1]
+                        + (texels[i * 4 + 2] - mean[2]) * axis[2];
+
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+
+    // Pull the endpoints in a little, the extremes are rarely worth an index
+    const float inset = (maximum - minimum) / 16.0f;
+    float end0[3], end1[3];
+
+    for (int c = 0; c < 3; ++c) {
+        end0[c] = mean[c] + axis[c] * (maximum - inset) / std::max(axisLength, 1e-6f);
+        end1[c] = mean[c] + axis[c] * (minimum + inset) / std::max(axisLength, 1e-6f);
+    }
+
+    uint16_t color0 = PackColor(end0);
+    uint16_t color1 = PackColor(end1);
+    uint32_t indices = 0;
+    int error = FinishColorBlock(texels, color0, color1, indices);
+
+    // One least squares pass: the endpoints that best fit the chosen indices
+    if (color0 != color1) {
+        static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+
+        for (int i = 0; i < blockTexels; ++i) {
+            const float a = weights[indices >> (i * 2) & 3];
+            const float b = 1.0f - a;
+
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+
+            for (int c = 0; c < 3; ++c) {
+                ax[c] += a * texels[i * 4 + c];
+                bx[c] += b * texels[i * 4 + c];
+            }
+        }
+
+        const float determinant = aa * bb - ab * ab;
+
+        if (std::fabs(determinant) > 1e-6f) {
+            for (int c = 0; c < 3; ++c) {
+                end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+
+            uint16_t refined0 = PackColor(end0);
+            uint16_t refined1 = PackColor(end1);
+            uint32_t refinedIndices = 0;
+            const int refinedError = FinishColorBlock(texels, refined0, refined1, refinedIndices);
+
+            if (refinedError < error) {
+                color0 = refined0;
+                color1 = refined1;
+                indices = refinedIndices;
+            }
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(color0);
+    block[1] = static_cast<uint8_t>(color0 >> 8);
+    block[2] = static_cast<uint8_t>(color1);
+    block[3] = static_cast<uint8_t>(color1 >> 8);
+    memcpy(block + 4, &indices, sizeof(indices));
+}
+
+// BC4 block from one channel of 16 RGBA texels, eight value mode
+void
+EncodeChannelBlock(const uint8_t* texels, int channel, uint8_t* block)
+{
+    int minimum = 255, maximum = 0;
+
+    for (int i = 0; i < blockTexels; ++i) {
+        minimum = std::min(minimum, static_cast<int>(texels[i * 4 + channel]));
+        maximum = std::max(maximum, static_cast<int>(texels[i * 4 + channel]));
+    }
+
+    block[0] = static_cast<uint8_t>(maximum);
+    block[1] = static_cast<uint8_t>(minimum);
+
+    uint64_t indices = 0;
+
+    if (maximum > minimum) {
+        // Value k of the palette is ((8 - k) * max + (k - 1) * min) / 7 for
+        // k = 2..7, so index 0 is max, 1 is min and the rest step down
+        static const int order[8] = {1, 7, 6, 5, 4, 3, 2, 0};
+        const int range = maximum - minimum;
+
+        for (int i = 0; i < blockTexels; ++i) {
+            const int step = ((texels[i * 4 + channel] - minimum) * 14 + range) / (range * 2);
+            indices |= static_cast<uint64_t>(order[step]) << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+}
+
+size_t
+GetBlockBytes(TextureEncoder::Format format)
+{
+    return format == TextureEncoder::Format::BC1 || format == TextureEncoder::Format::BC4 ? 8
+                                                                                         : 16;
+}
+
+} // namespace
+
+GLenum
+TextureEncoder::GetInternalFormat(Format format, bool srgb)
+{
+    switch (format) {
+    case Format::BC1:
+        return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Format::BC3:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Format::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case Format::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    default:
+        return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+}
+
+void
+TextureEncoder::Downsample(const uint8_t* source,
+                           GLsizei width,
+                           GLsizei height,
+                           int channels,
+                           uint8_t* destination)
+{
+    const GLsizei levelWidth = std::max(width / 2, 1);
+    const GLsizei levelHeight = std::max(height / 2, 1);
+
+    for (GLsizei y = 0; y < levelHeight; ++y) {
+        const uint8_t* row0 = source + static_cast<size_t>(std::min(y * 2, height - 1)) * width
+                                           * channels;
+        const uint8_t* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, height - 1))
+                                           * width * channels;
+
+        for (GLsizei x = 0; x < levelWidth; ++x) {
+            const size_t x0 = static_cast<size_t>(std::min(x * 2, width - 1)) * channels;
+            const size_t x1 = static_cast<size_t>(std::min(x * 2 + 1, width - 1)) * channels;
+
+            for (int c = 0; c < channels; ++c) {
+                *destination++ = static_cast<uint8_t>(
+                    (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+void
+TextureEncoder::Encode(Format format,
+                       const uint8_t* rgba,
+                       GLsizei width,
+                       GLsizei height,
+                       uint8_t* destination,
+                       ThreadPool* pool)
+{
+    TRACE_SCOPE("TextureEncoder::Encode");
+
+    if (format == Format::RGBA8) {
+        memcpy(destination, rgba, static_cast<size_t>(width) * height * 4);
+        return;
+    }
+
+    const GLsizei blocksWide = (width + 3) / 4;
+    const GLsizei blocksHigh = (height + 3) / 4;
+    const size_t blockBytes = GetBlockBytes(format);
+
+    auto encodeRow = [&](unsigned int blockRow) {
+        uint8_t texels[blockTexels * 4];
+        uint8_t* block = destination + blockRow * blocksWide * blockBytes;
+
+        for (GLsizei blockColumn = 0; blockColumn < blocksWide; ++blockColumn) {
+            for (int i = 0; i < blockTexels; ++i) {
+                const GLsizei x = std::min(blockColumn * 4 + i % 4, width - 1);
+                const GLsizei y = std::min(static_cast<GLsizei>(blockRow) * 4 + i / 4, height - 1);
+
+                memcpy(texels + i * 4, rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+            }
+
+            switch (format) {
+            case Format::BC1:
+                EncodeColorBlock(texels, block);
+                break;
+            case Format::BC3:
+                EncodeChannelBlock(texels, 3, block);
+                EncodeColorBlock(texels, block + 8);
+                break;
+            case Format::BC4:
+                EncodeChannelBlock(texels, 0, block);
+                break;
+            default:
+                EncodeChannelBlock(texels, 0, block);
+                EncodeChannelBlock(texels, 1, block + 8);
+                break;
+            }
+
+            block += blockBytes;
+        }
+    };
+
+    if (pool == nullptr || pool->GetThreadCount() <= 1) {
+        for (GLsizei blockRow = 0; blockRow < blocksHigh; ++blockRow)
+            encodeRow(static_cast<unsigned int>(blockRow));
+        return;
+    }
+
+    pool->ParallelFor(static_cast<unsigned int>(blocksHigh), encodeRow);
+}
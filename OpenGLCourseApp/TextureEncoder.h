@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+class ThreadPool;
+
+// CPU side texture processing: box filtered mip levels for TextureStreamer
+// and block compression for the offline TextureCompressor. The encoders fit
+// each 4x4 block's endpoints along its principal axis and refine them once
+// by least squares; good enough for albedo, not a replacement for a
+// production compressor. ETC2 and BC7 files come from external tools.
+class TextureEncoder
+{
+public:
+    enum class Format
+    {
+        RGBA8,
+        BC1, // RGB, alpha ignored
+        BC3, // RGBA
+        BC4, // red
+        BC5, // red and green, e.g. normal map XY
+    };
+
+    // Internal format of the encoded data; the sRGB variants exist for
+    // RGBA8, BC1 and BC3 only
+    static GLenum GetInternalFormat(Format format, bool srgb);
+
+    // Writes the next level of a tightly packed image of 8 bit channels,
+    // max(width / 2, 1) by max(height / 2, 1). Each texel averages the 2x2
+    // texels above it (edge texels repeat for odd sizes), as stored, without
+    // sRGB decoding.
+    static void Downsample(const uint8_t* source,
+                           GLsizei width,
+                           GLsizei height,
+                           int channels,
+                           uint8_t* destination);
+
+    // Encodes a tightly packed RGBA8 image into destination, which holds
+    // TextureFile::GetImageSize bytes. Partial blocks on the right and bottom
+    // edges repeat the edge texels. Block rows are spread over the pool when
+    // given.
+    static void Encode(Format format,
+                       const uint8_t* rgba,
+                       GLsizei width,
+                       GLsizei height,
+                       uint8_t* destination,
+                       ThreadPool* pool = nullptr);
+};
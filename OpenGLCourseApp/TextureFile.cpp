@@ -0,0 +1,895 @@
+﻿#include "TextureFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+const uint8_t ktxMagic[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+const uint8_t ktx2Magic[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+const char ddsMagic[4] = {'D', 'D', 'S', ' '};
+
+// Larger sizes and layer counts are rejected before any size arithmetic
+// can overflow or anything is allocated; 2048 layers is the least
+// GL_MAX_ARRAY_TEXTURE_LAYERS GL 4.5 guarantees
+const uint32_t maxSize = 16384;
+const uint32_t maxLayers = 2048;
+
+struct KtxHeader
+{
+    uint8_t identifier[12];
+    uint32_t endianness; // 0x04030201 as written by the producer
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+const uint32_t ddsdCaps = 0x1;
+const uint32_t ddsdHeight = 0x2;
+const uint32_t ddsdWidth = 0x4;
+const uint32_t ddsdPitch = 0x8;
+const uint32_t ddsdPixelFormat = 0x1000;
+const uint32_t ddsdMipMapCount = 0x20000;
+const uint32_t ddsdLinearSize = 0x80000;
+const uint32_t ddsdDepth = 0x800000;
+const uint32_t ddpfAlphaPixels = 0x1;
+const uint32_t ddpfFourCC = 0x4;
+const uint32_t ddpfRgb = 0x40;
+const uint32_t ddsCapsComplex = 0x8;
+const uint32_t ddsCapsTexture = 0x1000;
+const uint32_t ddsCapsMipMap = 0x400000;
+const uint32_t ddsCaps2CubeMap = 0x200;
+const uint32_t ddsCaps2AllFaces = 0xFC00;
+const uint32_t ddsCaps2Volume = 0x200000;
+const uint32_t dx10TextureCube = 0x4;
+const uint32_t dx10Texture2D = 3;
+
+constexpr uint32_t
+FourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8
+           | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+}
+
+// Data format descriptor (KTX 2 DFD) values for the formats Write supports
+const uint8_t dfdModelRgbsda = 1;
+const uint8_t dfdModelBc1a = 128;
+const uint8_t dfdModelBc3 = 130;
+const uint8_t dfdModelBc4 = 131;
+const uint8_t dfdModelBc5 = 132;
+const uint8_t dfdChannelAlpha = 15;
+const uint8_t dfdQualifierLinear = 0x80;
+
+// Every format with its name in the other APIs the containers use, 0 where
+// it has none. Block formats are 4x4 texels of blockBytes, the others one
+// texel of blockBytes.
+struct FormatInfo
+{
+    GLenum internalFormat;
+    uint32_t vkFormat;
+    uint32_t dxgiFormat;
+    uint32_t fourCC;
+    uint32_t blockBytes;
+    bool compressed;
+    bool srgb;
+    uint8_t dfdModel;
+};
+
+const FormatInfo formats[] = {
+    {GL_R8, 9, 61, 0, 1, false, false, dfdModelRgbsda},
+    {GL_RG8, 16, 49, 0, 2, false, false, dfdModelRgbsda},
+    {GL_RGBA8, 37, 28, 0, 4, false, false, dfdModelRgbsda},
+    {GL_SRGB8_ALPHA8, 43, 29, 0, 4, false, true, dfdModelRgbsda},
+    {GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 131, 0, 0, 8, true, false, dfdModelBc1a},
+    {GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 132, 0, 0, 8, true, true, dfdModelBc1a},
+    {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 133, 71, FourCC('D', 'X', 'T', '1'), 8, true, false, 0},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 134, 72, 0, 8, true, true, 0},
+    {GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 135, 74, FourCC('D', 'X', 'T', '3'), 16, true, false, 0},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 136, 75, 0, 16, true, true, 0},
+    {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+     137,
+     77,
+     FourCC('D', 'X', 'T', '5'),
+     16,
+     true,
+     false,
+     dfdModelBc3},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 138, 78, 0, 16, true, true, dfdModelBc3},
+    {GL_COMPRESSED_RED_RGTC1, 139, 80, FourCC('A', 'T', 'I', '1'), 8, true, false, dfdModelBc4},
+    {GL_COMPRESSED_SIGNED_RED_RGTC1, 140, 81, FourCC('B', 'C', '4', 'S'), 8, true, false, 0},
+    {GL_COMPRESSED_RG_RGTC2, 141, 83, FourCC('A', 'T', 'I', '2'), 16, true, false, dfdModelBc5},
+    {GL_COMPRESSED_SIGNED_RG_RGTC2, 142, 84, FourCC('B', 'C', '5', 'S'), 16, true, false, 0},
+    {GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 143, 95, 0, 16, true, false, 0},
+    {GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 144, 96, 0, 16, true, false, 0},
+    {GL_COMPRESSED_RGBA_BPTC_UNORM, 145, 98, 0, 16, true, false, 0},
+    {GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 146, 99, 0, 16, true, true, 0},
+    {GL_COMPRESSED_RGB8_ETC2, 147, 0, 0, 8, true, false, 0},
+    {GL_COMPRESSED_SRGB8_ETC2, 148, 0, 0, 8, true, true, 0},
+    {GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 149, 0, 0, 8, true, false, 0},
+    {GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 150, 0, 0, 8, true, true, 0},
+    {GL_COMPRESSED_RGBA8_ETC2_EAC, 151, 0, 0, 16, true, false, 0},
+    {GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 152, 0, 0, 16, true, true, 0},
+    {GL_COMPRESSED_R11_EAC, 153, 0, 0, 8, true, false, 0},
+    {GL_COMPRESSED_SIGNED_R11_EAC, 154, 0, 0, 8, true, false, 0},
+    {GL_COMPRESSED_RG11_EAC, 155, 0, 0, 16, true, false, 0},
+    {GL_COMPRESSED_SIGNED_RG11_EAC, 156, 0, 0, 16, true, false, 0},
+};
+
+const FormatInfo*
+FindFormat(GLenum internalFormat)
+{
+    for (const FormatInfo& format : formats) {
+        if (format.internalFormat == internalFormat)
+            return &format;
+    }
+
+    return nullptr;
+}
+
+const FormatInfo*
+FindVkFormat(uint32_t vkFormat)
+{
+    for (const FormatInfo& format : formats) {
+        if (format.vkFormat == vkFormat)
+            return &format;
+    }
+
+    return nullptr;
+}
+
+const FormatInfo*
+FindDxgiFormat(uint32_t dxgiFormat)
+{
+    for (const FormatInfo& format : formats) {
+        if (dxgiFormat != 0 && format.dxgiFormat == dxgiFormat)
+            return &format;
+    }
+
+    return nullptr;
+}
+
+size_t
+ImageSize(const FormatInfo& format, uint32_t width, uint32_t height, uint32_t rowAlignment)
+{
+    if (format.compressed)
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * format.blockBytes;
+
+    const size_t rowSize = static_cast<size_t>(width) * format.blockBytes;
+
+    return (rowSize + rowAlignment - 1) / rowAlignment * rowAlignment * height;
+}
+
+size_t
+AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void
+Append(std::vector<uint8_t>& bytes, const T& value)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    bytes.insert(bytes.end(), data, data + sizeof(T));
+}
+
+// Basic DFD block: the color model and one sample per channel (or per
+// 64 bit half of a block)
+void
+AppendDfd(std::vector<uint8_t>& bytes, const FormatInfo& format)
+{
+    struct Sample
+    {
+        uint8_t channel;
+        uint16_t bitOffset;
+        uint8_t bitLength;
+        uint32_t upper;
+    };
+
+    Sample samples[4];
+    uint32_t sampleCount = 0;
+
+    if (format.dfdModel == dfdModelRgbsda) {
+        const uint8_t channels[4] = {0, 1, 2, dfdChannelAlpha};
+
+        for (uint32_t i = 0; i < format.blockBytes; ++i) {
+            const uint8_t channel = format.blockBytes == 4 ? channels[i] : static_cast<uint8_t>(i);
+            samples[sampleCount++] = Sample {channel, static_cast<uint16_t>(i * 8), 8, 255};
+        }
+    } else if (format.dfdModel == dfdModelBc3) {
+        samples[sampleCount++] = Sample {dfdChannelAlpha, 0, 64, 0xFFFFFFFF};
+        samples[sampleCount++] = Sample {0, 64, 64, 0xFFFFFFFF};
+    } else if (format.dfdModel == dfdModelBc5) {
+        samples[sampleCount++] = Sample {0, 0, 64, 0xFFFFFFFF};
+        samples[sampleCount++] = Sample {1, 64, 64, 0xFFFFFFFF};
+    } else {
+        samples[sampleCount++] = Sample {0, 0, 64, 0xFFFFFFFF};
+    }
+
+    const uint32_t blockSize = 24 + 16 * sampleCount;
+
+    Append(bytes, static_cast<uint32_t>(4 + blockSize)); // total size
+    Append(bytes, static_cast<uint32_t>(0)); // vendor and descriptor type: Khronos basic
+    Append(bytes, static_cast<uint32_t>(2 | blockSize << 16)); // version 1.3
+    bytes.push_back(format.dfdModel);
+    bytes.push_back(1); // BT.709 primaries
+    bytes.push_back(format.srgb ? 2 : 1); // transfer function
+    bytes.push_back(0); // straight alpha
+
+    // Block dimensions minus one, then bytes per plane
+    const uint8_t blockDimension = format.compressed ? 3 : 0;
+    const uint8_t layout[12] = {blockDimension,
+                                blockDimension,
+                                0,
+                                0,
+                                static_cast<uint8_t>(format.blockBytes)};
+    bytes.insert(bytes.end(), layout, layout + sizeof(layout));
+
+    for (uint32_t i = 0; i < sampleCount; ++i) {
+        uint8_t channelType = samples[i].channel;
+
+        if (format.srgb && samples[i].channel == dfdChannelAlpha)
+            channelType |= dfdQualifierLinear;
+
+        Append(bytes, samples[i].bitOffset);
+        bytes.push_back(static_cast<uint8_t>(samples[i].bitLength - 1));
+        bytes.push_back(channelType);
+        Append(bytes, static_cast<uint32_t>(0)); // sample position
+        Append(bytes, static_cast<uint32_t>(0)); // lower
+        Append(bytes, samples[i].upper);
+    }
+}
+
+bool
+WriteFile(const char* fileLocation, const std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(fileLocation, "wb");
+
+    if (!file) {
+        printf("Failed to write texture %s!\n", fileLocation);
+        return false;
+    }
+
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+
+    if (fclose(file) != 0 || !ok) {
+        printf("Failed to write texture %s!\n", fileLocation);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+TextureFile::TextureFile() {}
+
+TextureFile::~TextureFile()
+{
+    Close();
+}
+
+bool
+TextureFile::Open(const char* fileLocation)
+{
+    Close();
+
+    if (!file_.Open(fileLocation))
+        return false;
+
+    const char* data = file_.GetData();
+    const size_t size = file_.GetSize();
+    bool ok = false;
+
+    if (size >= sizeof(ktxMagic) && memcmp(data, ktxMagic, sizeof(ktxMagic)) == 0) {
+        ok = ParseKtx(fileLocation);
+    } else if (size >= sizeof(ktx2Magic) && memcmp(data, ktx2Magic, sizeof(ktx2Magic)) == 0) {
+        ok = ParseKtx2(fileLocation);
+    } else if (size >= sizeof(ddsMagic) && memcmp(data, ddsMagic, sizeof(ddsMagic)) == 0) {
+        ok = ParseDds(fileLocation);
+    } else {
+        printf("%s is not a KTX, KTX 2 or DDS file!\n", fileLocation);
+    }
+
+    if (!ok) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void
+TextureFile::Close()
+{
+    file_.Close();
+
+    width_ = 0;
+    height_ = 0;
+    layers_ = 0;
+    levels_ = 0;
+    offsets_.clear();
+    imageSizes_.clear();
+}
+
+const void*
+TextureFile::GetImageData(GLint level, GLsizei layer) const
+{
+    return file_.GetData() + offsets_[level * layers_ + layer];
+}
+
+size_t
+TextureFile::GetImageSize(GLint level) const
+{
+    return imageSizes_[level];
+}
+
+bool
+TextureFile::IsKnownFormat(GLenum internalFormat)
+{
+    return FindFormat(internalFormat) != nullptr;
+}
+
+bool
+TextureFile::IsCompressedFormat(GLenum internalFormat)
+{
+    const FormatInfo* format = FindFormat(internalFormat);
+
+    return format && format->compressed;
+}
+
+size_t
+TextureFile::GetImageSize(GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    const FormatInfo* format = FindFormat(internalFormat);
+
+    return format ? ImageSize(*format, width, height, 1) : 0;
+}
+
+bool
+TextureFile::SetLayout(const char* fileLocation,
+                       GLenum internalFormat,
+                       uint32_t width,
+                       uint32_t height,
+                       uint32_t arrayElements,
+                       uint32_t faces,
+                       uint32_t levels)
+{
+    const FormatInfo* format = FindFormat(internalFormat);
+
+    if (!format) {
+        printf("Texture %s has unsupported format 0x%X!\n", fileLocation, internalFormat);
+        return false;
+    }
+
+    if (width == 0 || height == 0 || width > maxSize || height > maxSize
+        || arrayElements > maxLayers || (faces != 1 && faces != 6)
+        || (faces == 6 && width != height)) {
+        printf("Texture %s has a corrupt header!\n", fileLocation);
+        return false;
+    }
+
+    if (faces == 6 && arrayElements > 0) {
+        printf("Texture %s is a cube map array, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    // 0 levels asks the loader to generate mips, here only level 0 is used
+    levels = std::max(levels, 1u);
+
+    if (levels > static_cast<uint32_t>(Texture::GetMipCount(width, height))) {
+        printf("Texture %s has more levels than its size allows!\n", fileLocation);
+        return false;
+    }
+
+    if (faces == 6) {
+        type_ = Texture::Type::Cube;
+        layers_ = 6;
+    } else if (arrayElements > 0) {
+        type_ = Texture::Type::Array;
+        layers_ = static_cast<GLsizei>(arrayElements);
+    } else {
+        type_ = Texture::Type::Texture2D;
+        layers_ = 1;
+    }
+
+    internalFormat_ = internalFormat;
+    width_ = static_cast<GLsizei>(width);
+    height_ = static_cast<GLsizei>(height);
+    levels_ = static_cast<GLsizei>(levels);
+
+    imageSizes_.resize(levels_);
+    offsets_.assign(static_cast<size_t>(levels_) * layers_, 0);
+
+    for (GLint level = 0; level < levels_; ++level) {
+        imageSizes_[level] = ImageSize(*format,
+                                       std::max(width >> level, 1u),
+                                       std::max(height >> level, 1u),
+                                       rowAlignment_);
+    }
+
+    return true;
+}
+
+bool
+TextureFile::ParseKtx(const char* fileLocation)
+{
+    const char* data = file_.GetData();
+    const size_t size = file_.GetSize();
+
+    KtxHeader header;
+
+    if (size < sizeof(header)) {
+        printf("Texture %s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.endianness != 0x04030201) {
+        printf("Texture %s is big endian, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    if (header.pixelDepth > 1) {
+        printf("Texture %s is a 3D texture, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    // Uncompressed KTX 1 images pad every row to 4 bytes
+    const bool compressed = header.glType == 0;
+    rowAlignment_ = 4;
+
+    if (compressed != IsCompressedFormat(header.glInternalFormat)
+        || (!compressed && header.glType != GL_UNSIGNED_BYTE)) {
+        printf("Texture %s has unsupported format 0x%X!\n", fileLocation, header.glInternalFormat);
+        return false;
+    }
+
+    if (!SetLayout(fileLocation,
+                   header.glInternalFormat,
+                   header.pixelWidth,
+                   header.pixelHeight,
+                   header.numberOfArrayElements,
+                   header.numberOfFaces,
+                   header.numberOfMipmapLevels)) {
+        return false;
+    }
+
+    // Each level is its size, then every layer and face, faces padded to 4
+    // bytes; only for non-array cube maps is the size that of one face
+    const bool cube = type_ == Texture::Type::Cube;
+    size_t offset = sizeof(header) + static_cast<size_t>(header.bytesOfKeyValueData);
+
+    for (GLint level = 0; level < levels_; ++level) {
+        uint32_t imageSize = 0;
+
+        if (offset > size || size - offset < sizeof(imageSize)) {
+            printf("Texture %s is truncated!\n", fileLocation);
+            return false;
+        }
+
+        memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+
+        if (imageSize != imageSizes_[level] * (cube ? 1 : layers_)) {
+            printf("Texture %s level %d has the wrong size!\n", fileLocation, level);
+            return false;
+        }
+
+        for (GLsizei layer = 0; layer < layers_; ++layer) {
+            if (size - std::min(offset, size) < imageSizes_[level]) {
+                printf("Texture %s is truncated!\n", fileLocation);
+                return false;
+            }
+
+            offsets_[level * layers_ + layer] = offset;
+            offset += cube ? AlignUp(imageSizes_[level], 4) : imageSizes_[level];
+        }
+
+        offset = AlignUp(offset, 4);
+    }
+
+    return true;
+}
+
+bool
+TextureFile::ParseKtx2(const char* fileLocation)
+{
+    const char* data = file_.GetData();
+    const size_t size = file_.GetSize();
+
+    Ktx2Header header;
+
+    if (size < sizeof(header)) {
+        printf("Texture %s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.supercompressionScheme != 0) {
+        printf("Texture %s is supercompressed, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    if (header.pixelDepth > 1) {
+        printf("Texture %s is a 3D texture, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    const FormatInfo* format = FindVkFormat(header.vkFormat);
+
+    if (!format) {
+        printf("Texture %s has unsupported format %u!\n", fileLocation, header.vkFormat);
+        return false;
+    }
+
+    rowAlignment_ = 1;
+
+    if (!SetLayout(fileLocation,
+                   format->internalFormat,
+                   header.pixelWidth,
+                   header.pixelHeight,
+                   header.layerCount,
+                   header.faceCount,
+                   header.levelCount)) {
+        return false;
+    }
+
+    const size_t indexSize = sizeof(Ktx2Level) * std::max(header.levelCount, 1u);
+
+    if (size - sizeof(header) < indexSize) {
+        printf("Texture %s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    // Each level holds every layer and then every face of it, back to back
+    for (GLint level = 0; level < levels_; ++level) {
+        Ktx2Level index;
+        memcpy(&index, data + sizeof(header) + sizeof(index) * level, sizeof(index));
+
+        if (index.byteLength != static_cast<uint64_t>(imageSizes_[level]) * layers_
+            || index.byteOffset > size || size - index.byteOffset < index.byteLength) {
+            printf("Texture %s level %d is out of range!\n", fileLocation, level);
+            return false;
+        }
+
+        for (GLsizei layer = 0; layer < layers_; ++layer) {
+            offsets_[level * layers_ + layer] = static_cast<size_t>(index.byteOffset)
+                                                + imageSizes_[level] * layer;
+        }
+    }
+
+    return true;
+}
+
+bool
+TextureFile::ParseDds(const char* fileLocation)
+{
+    const char* data = file_.GetData();
+    const size_t size = file_.GetSize();
+
+    DdsHeader header;
+    DdsHeaderDx10 header10;
+    memset(&header10, 0, sizeof(header10));
+
+    if (size < sizeof(ddsMagic) + sizeof(header)) {
+        printf("Texture %s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    memcpy(&header, data + sizeof(ddsMagic), sizeof(header));
+    size_t offset = sizeof(ddsMagic) + sizeof(header);
+
+    if (header.size != sizeof(header) || header.pixelFormat.size != sizeof(DdsPixelFormat)) {
+        printf("Texture %s has a corrupt header!\n", fileLocation);
+        return false;
+    }
+
+    if (((header.flags & ddsdDepth) && header.depth > 1) || (header.caps2 & ddsCaps2Volume)) {
+        printf("Texture %s is a 3D texture, which is not supported!\n", fileLocation);
+        return false;
+    }
+
+    const DdsPixelFormat& pixelFormat = header.pixelFormat;
+    const FormatInfo* format = nullptr;
+    uint32_t arrayElements = 0;
+    uint32_t faces = 1;
+
+    if ((pixelFormat.flags & ddpfFourCC) && pixelFormat.fourCC == FourCC('D', 'X', '1', '0')) {
+        if (size - offset < sizeof(header10)) {
+            printf("Texture %s is truncated!\n", fileLocation);
+            return false;
+        }
+
+        memcpy(&header10, data + offset, sizeof(header10));
+        offset += sizeof(header10);
+
+        if (header10.resourceDimension != dx10Texture2D) {
+            printf("Texture %s is not a 2D texture!\n", fileLocation);
+            return false;
+        }
+
+        format = FindDxgiFormat(header10.dxgiFormat);
+        faces = (header10.miscFlag & dx10TextureCube) ? 6 : 1;
+        arrayElements = header10.arraySize > 1 ? header10.arraySize : 0;
+    } else if (pixelFormat.flags & ddpfFourCC) {
+        const uint32_t fourCC = pixelFormat.fourCC;
+
+        // The DX10 era names of BC4 and BC5
+        if (fourCC == FourCC('B', 'C', '4', 'U'))
+            format = FindFormat(GL_COMPRESSED_RED_RGTC1);
+        else if (fourCC == FourCC('B', 'C', '5', 'U'))
+            format = FindFormat(GL_COMPRESSED_RG_RGTC2);
+
+        for (const FormatInfo& known : formats) {
+            if (!format && known.fourCC == fourCC)
+                format = &known;
+        }
+    } else if ((pixelFormat.flags & ddpfRgb) && pixelFormat.rgbBitCount == 32
+               && pixelFormat.rBitMask == 0xFF && pixelFormat.gBitMask == 0xFF00
+               && pixelFormat.bBitMask == 0xFF0000 && (pixelFormat.flags & ddpfAlphaPixels)
+               && pixelFormat.aBitMask == 0xFF000000) {
+        format = FindFormat(GL_RGBA8);
+    }
+
+    if (!format) {
+        printf("Texture %s has an unsupported pixel format!\n", fileLocation);
+        return false;
+    }
+
+    if (header.caps2 & ddsCaps2CubeMap) {
+        if ((header.caps2 & ddsCaps2AllFaces) != ddsCaps2AllFaces) {
+            printf("Texture %s is a partial cube map, which is not supported!\n", fileLocation);
+            return false;
+        }
+
+        faces = 6;
+    }
+
+    rowAlignment_ = 1;
+
+    if (!SetLayout(fileLocation,
+                   format->internalFormat,
+                   header.width,
+                   header.height,
+                   arrayElements,
+                   faces,
+                   (header.flags & ddsdMipMapCount) ? header.mipMapCount : 1)) {
+        return false;
+    }
+
+    // Unlike KTX, each layer (face) holds its whole mip chain
+    for (GLsizei layer = 0; layer < layers_; ++layer) {
+        for (GLint level = 0; level < levels_; ++level) {
+            if (offset > size || size - offset < imageSizes_[level]) {
+                printf("Texture %s is truncated!\n", fileLocation);
+                return false;
+            }
+
+            offsets_[level * layers_ + layer] = offset;
+            offset += imageSizes_[level];
+        }
+    }
+
+    return true;
+}
+
+bool
+TextureFile::Write(const char* fileLocation,
+                   GLenum internalFormat,
+                   GLsizei width,
+                   GLsizei height,
+                   GLsizei levels,
+                   const void* const* levelData)
+{
+    const char* extension = strrchr(fileLocation, '.');
+    const bool ktx2 = extension && strcmp(extension, ".ktx2") == 0;
+    const bool dds = extension && strcmp(extension, ".dds") == 0;
+
+    // DDS has no opaque BC1; the blocks read the same as long as no block
+    // uses the three color mode's transparent black, which the encoder avoids
+    if (dds && internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    else if (dds && internalFormat == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT)
+        internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+
+    const FormatInfo* format = FindFormat(internalFormat);
+
+    if (!ktx2 && !dds) {
+        printf("Texture %s needs a .ktx2 or .dds extension!\n", fileLocation);
+        return false;
+    }
+
+    if (!format || (ktx2 && format->dfdModel == 0) || (dds && format->dxgiFormat == 0)) {
+        printf("Texture %s can't be written in format 0x%X!\n", fileLocation, internalFormat);
+        return false;
+    }
+
+    if (width <= 0 || height <= 0 || levels <= 0 || levels > Texture::GetMipCount(width, height)) {
+        printf("Texture %s has an invalid size!\n", fileLocation);
+        return false;
+    }
+
+    std::vector<size_t> sizes(levels);
+
+    for (GLint level = 0; level < levels; ++level)
+        sizes[level] = ImageSize(*format,
+                                 std::max(width >> level, 1),
+                                 std::max(height >> level, 1),
+                                 1);
+
+    std::vector<uint8_t> bytes;
+
+    if (dds) {
+        // Legacy header where one exists, so older tools can read the file
+        const bool dx10 = format->fourCC == 0 && format->internalFormat != GL_RGBA8;
+
+        DdsHeader header;
+        memset(&header, 0, sizeof(header));
+        header.size = sizeof(header);
+        header.flags = ddsdCaps | ddsdHeight | ddsdWidth | ddsdPixelFormat | ddsdMipMapCount
+                       | (format->compressed ? ddsdLinearSize : ddsdPitch);
+        header.height = static_cast<uint32_t>(height);
+        header.width = static_cast<uint32_t>(width);
+        header.pitchOrLinearSize = static_cast<uint32_t>(
+            format->compressed ? sizes[0] : static_cast<size_t>(width) * format->blockBytes);
+        header.mipMapCount = static_cast<uint32_t>(levels);
+        header.pixelFormat.size = sizeof(DdsPixelFormat);
+        header.caps = ddsCapsTexture | (levels > 1 ? ddsCapsComplex | ddsCapsMipMap : 0);
+
+        if (dx10) {
+            header.pixelFormat.flags = ddpfFourCC;
+            header.pixelFormat.fourCC = FourCC('D', 'X', '1', '0');
+        } else if (format->compressed) {
+            header.pixelFormat.flags = ddpfFourCC;
+            header.pixelFormat.fourCC = format->fourCC;
+        } else {
+            header.pixelFormat.flags = ddpfRgb | ddpfAlphaPixels;
+            header.pixelFormat.rgbBitCount = 32;
+            header.pixelFormat.rBitMask = 0xFF;
+            header.pixelFormat.gBitMask = 0xFF00;
+            header.pixelFormat.bBitMask = 0xFF0000;
+            header.pixelFormat.aBitMask = 0xFF000000;
+        }
+
+        bytes.insert(bytes.end(), ddsMagic, ddsMagic + sizeof(ddsMagic));
+        Append(bytes, header);
+
+        if (dx10) {
+            DdsHeaderDx10 header10;
+            memset(&header10, 0, sizeof(header10));
+            header10.dxgiFormat = format->dxgiFormat;
+            header10.resourceDimension = dx10Texture2D;
+            header10.arraySize = 1;
+            Append(bytes, header10);
+        }
+
+        for (GLint level = 0; level < levels; ++level) {
+            const uint8_t* image = static_cast<const uint8_t*>(levelData[level]);
+            bytes.insert(bytes.end(), image, image + sizes[level]);
+        }
+
+        return WriteFile(fileLocation, bytes);
+    }
+
+    Ktx2Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, ktx2Magic, sizeof(ktx2Magic));
+    header.vkFormat = format->vkFormat;
+    header.typeSize = 1; // 8 bit channels or blocks
+    header.pixelWidth = static_cast<uint32_t>(width);
+    header.pixelHeight = static_cast<uint32_t>(height);
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels);
+
+    std::vector<uint8_t> dfd;
+    AppendDfd(dfd, *format);
+
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + sizeof(Ktx2Level) * levels);
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+
+    // Levels are stored smallest first, each aligned to lcm(block size, 4)
+    const size_t alignment = std::max<size_t>(format->blockBytes, 4);
+    std::vector<Ktx2Level> index(levels);
+    size_t offset = header.dfdByteOffset + dfd.size();
+
+    for (GLint level = levels - 1; level >= 0; --level) {
+        offset = AlignUp(offset, alignment);
+        index[level].byteOffset = offset;
+        index[level].byteLength = sizes[level];
+        index[level].uncompressedByteLength = sizes[level];
+        offset += sizes[level];
+    }
+
+    Append(bytes, header);
+    for (const Ktx2Level& level : index)
+        Append(bytes, level);
+    bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+
+    for (GLint level = levels - 1; level >= 0; --level) {
+        const uint8_t* image = static_cast<const uint8_t*>(levelData[level]);
+        bytes.resize(index[level].byteOffset, 0);
+        bytes.insert(bytes.end(), image, image + sizes[level]);
+    }
+
+    return WriteFile(fileLocation, bytes);
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MappedFile.h"
+#include "Texture.h"
+
+// Read-only memory mapping of a texture container: KTX (1.1), KTX 2 or DDS,
+// told apart by their magic. The payload is handed to GL as stored, so the
+// formats are the ones GL can take directly: BC1-BC7, ETC2/EAC and plain
+// 8 bit R, RG and RGBA. KTX 2 supercompression, 3D textures and cube map
+// arrays are rejected. Little endian only.
+class TextureFile
+{
+public:
+    TextureFile();
+    ~TextureFile();
+
+    TextureFile(const TextureFile&) = delete;
+    TextureFile& operator=(const TextureFile&) = delete;
+
+    // Maps the file and validates the header and that every image fits
+    bool Open(const char* fileLocation);
+    void Close();
+
+    Texture::Type GetType() const
+    {
+        return type_;
+    }
+    GLenum GetInternalFormat() const
+    {
+        return internalFormat_;
+    }
+    GLsizei GetWidth() const
+    {
+        return width_;
+    }
+    GLsizei GetHeight() const
+    {
+        return height_;
+    }
+    GLsizei GetLayers() const
+    {
+        return layers_;
+    }
+    GLsizei GetLevels() const
+    {
+        return levels_;
+    }
+    // Row alignment of uncompressed images (KTX 1 pads rows to 4 bytes)
+    GLint GetRowAlignment() const
+    {
+        return rowAlignment_;
+    }
+
+    // One level of one layer (cube face), a pointer into the mapping valid
+    // until Close()
+    const void* GetImageData(GLint level, GLsizei layer) const;
+    size_t GetImageSize(GLint level) const;
+
+    // Formats the loaders know, compressed or not
+    static bool IsKnownFormat(GLenum internalFormat);
+    static bool IsCompressedFormat(GLenum internalFormat);
+
+    // Tightly packed size of one image, whole 4x4 blocks when compressed
+    static size_t GetImageSize(GLenum internalFormat, GLsizei width, GLsizei height);
+
+    // Writes a 2D texture as KTX 2 or DDS, picked by the .ktx2 or .dds
+    // extension. levelData holds levels images, level 0 first, each tightly
+    // packed.
+    static bool Write(const char* fileLocation,
+                      GLenum internalFormat,
+                      GLsizei width,
+                      GLsizei height,
+                      GLsizei levels,
+                      const void* const* levelData);
+
+private:
+    MappedFile file_;
+
+    Texture::Type type_ {Texture::Type::Texture2D};
+    GLenum internalFormat_ {GL_RGBA8};
+    GLsizei width_ {0};
+    GLsizei height_ {0};
+    GLsizei layers_ {0};
+    GLsizei levels_ {0};
+    GLint rowAlignment_ {1};
+
+    // Offset of every image, level major: offsets_[level * layers_ + layer]
+    std::vector<size_t> offsets_;
+    std::vector<size_t> imageSizes_;
+
+    bool ParseKtx(const char* fileLocation);
+    bool ParseKtx2(const char* fileLocation);
+    bool ParseDds(const char* fileLocation);
+
+    // Checks the size and format and fills in imageSizes_
+    bool SetLayout(const char* fileLocation,
+                   GLenum internalFormat,
+                   uint32_t width,
+                   uint32_t height,
+                   uint32_t arrayElements,
+                   uint32_t faces,
+                   uint32_t levels);
+};
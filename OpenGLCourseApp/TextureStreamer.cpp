@@ -0,0 +1,394 @@
+﻿#include "TextureStreamer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "GlStats.h"
+#include "Texture.h"
+#include "TextureEncoder.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+namespace {
+
+double
+Seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int
+ChannelCount(GLenum format)
+{
+    switch (format) {
+    case GL_RED:
+        return 1;
+    case GL_RG:
+        return 2;
+    case GL_RGB:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer(unsigned int threadCount,
+                                 unsigned int bufferCount,
+                                 size_t bufferSize)
+    : buffers_(std::max(bufferCount, 1u))
+    , bufferSize_(bufferSize)
+{
+    workers_ = ThreadPool::StartThreads(threadCount, [this]() { WorkerLoop(); });
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    condition_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+
+    ClearStreamer();
+}
+
+bool
+TextureStreamer::RequestImage(Texture* texture,
+                              GLsizei layer,
+                              GLenum format,
+                              const void* pixels,
+                              bool generateMips)
+{
+    // Update copies whole rows, level 0's being the longest
+    const size_t rowSize = static_cast<size_t>(texture->GetLevelWidth(0)) * ChannelCount(format);
+
+    if (rowSize > bufferSize_) {
+        printf("Texture row of %zu bytes does not fit the unpack buffers!\n", rowSize);
+
+        // Left uploading for good, also past the texture's other images
+        texture->BeginUpload();
+
+        const auto pending = pendingTextures_.find(texture);
+        if (pending != pendingTextures_.end())
+            pending->second.failed = true;
+
+        return false;
+    }
+
+    std::unique_ptr<Image> image(new Image());
+    image->texture = texture;
+    image->layer = layer;
+    image->format = format;
+    image->channels = ChannelCount(format);
+    image->generateMips = generateMips;
+
+    // The sizes are known now, the loader threads only fill data
+    const GLint levelCount = generateMips ? texture->GetLevels() : 1;
+    size_t size = 0;
+
+    for (GLint level = 0; level < levelCount; ++level) {
+        image->widths.push_back(texture->GetLevelWidth(level));
+        image->heights.push_back(texture->GetLevelHeight(level));
+        image->offsets.push_back(size);
+        size += static_cast<size_t>(image->widths.back()) * image->heights.back()
+                * image->channels;
+    }
+
+    image->data.resize(size);
+    memcpy(image->data.data(), pixels, image->offsets.size() > 1 ? image->offsets[1] : size);
+
+    texture->BeginUpload();
+    ++pendingTextures_[texture].images;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(std::move(image));
+    }
+
+    condition_.notify_one();
+
+    return true;
+}
+
+size_t
+TextureStreamer::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return requests_.size() + building_ + built_.size() + uploading_.size();
+}
+
+TextureStreamer::Stats
+TextureStreamer::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return stats_;
+}
+
+void
+TextureStreamer::ClearStreamer()
+{
+    for (PixelBuffer& buffer : buffers_) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+
+        if (buffer.PBO != 0) {
+            glDeleteBuffers(1, &buffer.PBO);
+            buffer.PBO = 0;
+        }
+    }
+
+    nextBuffer_ = 0;
+    uploading_.clear();
+    pendingTextures_.clear();
+}
+
+void
+TextureStreamer::Update(size_t byteBudget)
+{
+    TRACE_SCOPE("TextureStreamer::Update");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        while (!built_.empty()) {
+            uploading_.push_back(std::move(built_.front()));
+            built_.pop_front();
+        }
+    }
+
+    if (uploading_.empty() || byteBudget == 0)
+        return;
+
+    const double start = Seconds();
+    size_t budgetLeft = byteBudget;
+    size_t uploadedBytes = 0;
+    bool busy = false;
+
+    struct Copy
+    {
+        Texture* texture;
+        GLint level;
+        GLsizei layer;
+        GLint firstRow;
+        GLsizei rowCount;
+        GLenum format;
+        GLintptr offset;
+    };
+
+    std::vector<Copy> copies;
+    std::vector<Texture*> finished;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    while (!uploading_.empty() && budgetLeft > 0) {
+        PixelBuffer* buffer = AcquireBuffer();
+
+        if (buffer == nullptr) {
+            busy = true;
+            break;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->PBO);
+
+        // Unsynchronized: the buffer's fence has signalled, the GPU is done with it
+        uint8_t* staging = static_cast<uint8_t*>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                             0,
+                             static_cast<GLsizeiptr>(bufferSize_),
+                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+                                 | GL_MAP_UNSYNCHRONIZED_BIT));
+
+        if (staging == nullptr)
+            break;
+
+        const size_t capacity = std::min(bufferSize_, budgetLeft);
+        size_t used = 0;
+
+        copies.clear();
+        finished.clear();
+
+        // Whole rows, as many as fit
+        while (!uploading_.empty()) {
+            Image& image = *uploading_.front();
+            const size_t rowSize = static_cast<size_t>(image.widths[image.level])
+                                   * image.channels;
+
+            // At least one row per Update however small the budget, rows fit
+            // a buffer (see RequestImage)
+            const size_t limit = uploadedBytes == 0 && used == 0 ? std::max(capacity, rowSize)
+                                                                 : capacity;
+            const size_t room = limit - std::min(used, limit);
+            const GLsizei rows = std::min(
+                image.heights[image.level] - image.row,
+                static_cast<GLsizei>(std::min(room / rowSize, size_t(1) << 30)));
+
+            if (rows == 0)
+                break;
+
+            memcpy(staging + used,
+                   image.data.data() + image.offsets[image.level] + image.row * rowSize,
+                   rows * rowSize);
+
+            copies.push_back(Copy {image.texture,
+                                   image.level,
+                                   image.layer,
+                                   image.row,
+                                   rows,
+                                   image.format,
+                                   static_cast<GLintptr>(used)});
+
+            used += rows * rowSize;
+            image.row += rows;
+
+            if (image.row < image.heights[image.level])
+                break;
+
+            image.row = 0;
+
+            if (++image.level < static_cast<GLint>(image.widths.size()))
+                continue;
+
+            // Everything is in staging, the CPU copy can go
+            finished.push_back(image.texture);
+            uploading_.pop_front();
+        }
+
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        for (const Copy& copy : copies) {
+            copy.texture->SetImage(copy.level,
+                                   copy.layer,
+                                   copy.firstRow,
+                                   copy.rowCount,
+                                   copy.format,
+                                   GL_UNSIGNED_BYTE,
+                                   reinterpret_cast<const void*>(copy.offset));
+        }
+
+        buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        for (Texture* texture : finished) {
+            PendingTexture& pending = pendingTextures_[texture];
+
+            if (--pending.images == 0) {
+                if (!pending.failed)
+                    texture->EndUpload(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+                pendingTextures_.erase(texture);
+            }
+        }
+
+        uploadedBytes += used;
+        budgetLeft -= std::min(budgetLeft, std::max(used, size_t(1)));
+
+        if (used == 0)
+            break;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.uploadedBytes += uploadedBytes;
+    stats_.uploadSeconds += Seconds() - start;
+    stats_.busyUpdates += busy ? 1 : 0;
+}
+
+TextureStreamer::PixelBuffer*
+TextureStreamer::AcquireBuffer()
+{
+    for (size_t tried = 0; tried < buffers_.size(); ++tried) {
+        PixelBuffer& buffer = buffers_[nextBuffer_];
+        nextBuffer_ = (nextBuffer_ + 1) % buffers_.size();
+
+        if (buffer.PBO == 0) {
+            glGenBuffers(1, &buffer.PBO);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.PBO);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                         static_cast<GLsizeiptr>(bufferSize_),
+                         nullptr,
+                         GL_STREAM_DRAW);
+            return &buffer;
+        }
+
+        if (buffer.fence) {
+            // Poll only, a busy buffer is skipped
+            GLenum result = glClientWaitSync(buffer.fence, 0, 0);
+
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+                continue;
+
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+
+        return &buffer;
+    }
+
+    return nullptr;
+}
+
+void
+TextureStreamer::WorkerLoop()
+{
+    TRACE_THREAD_NAME("Texture loader");
+
+    for (;;) {
+        std::unique_ptr<Image> image;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+
+            if (stopping_)
+                return;
+
+            image = std::move(requests_.front());
+            requests_.pop_front();
+            ++building_;
+        }
+
+        const double start = Seconds();
+        {
+            TRACE_SCOPE("TextureStreamer::BuildMips");
+            BuildMips(*image);
+        }
+        const double seconds = Seconds() - start;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --building_;
+
+        if (image->offsets.size() > 1) {
+            stats_.mipBytes += image->data.size() - image->offsets[1];
+            stats_.mipSeconds += seconds;
+        }
+
+        built_.push_back(std::move(image));
+    }
+}
+
+void
+TextureStreamer::BuildMips(Image& image)
+{
+    for (size_t level = 1; level < image.offsets.size(); ++level) {
+        TextureEncoder::Downsample(image.data.data() + image.offsets[level - 1],
+                                   image.widths[level - 1],
+                                   image.heights[level - 1],
+                                   image.channels,
+                                   image.data.data() + image.offsets[level]);
+    }
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+class Texture;
+
+// Asynchronous texture uploads.
+//
+// Loader threads build the mip chain of each requested image with a box
+// filter. Once per frame the GL thread calls Update(), which copies finished
+// levels into a pool of pixel unpack buffers and points glTexSubImage* at
+// them, at most byteBudget bytes per frame. A buffer is reused once the
+// fence after its copies has signalled; when none is free Update returns
+// instead of waiting, so the CPU never blocks on the GPU. A texture becomes
+// bindable once its last copy has finished (Texture::IsReady).
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        // Copied into the unpack buffers and the time Update spent on it
+        unsigned long long uploadedBytes {0};
+        double uploadSeconds {0.0};
+        // Mip levels built by the loader threads and their time, summed over threads
+        unsigned long long mipBytes {0};
+        double mipSeconds {0.0};
+        // Updates that found every buffer still in use by the GPU
+        unsigned long long busyUpdates {0};
+    };
+
+    // 0 uses every hardware thread but one. Each of the bufferCount unpack
+    // buffers holds bufferSize bytes.
+    explicit TextureStreamer(unsigned int threadCount = 0,
+                             unsigned int bufferCount = 4,
+                             size_t bufferSize = 4 * 1024 * 1024);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Level 0 of one layer (or cube face) of texture, tightly packed 8 bit
+    // channels in format (GL_RED, GL_RG, GL_RGB or GL_RGBA). The pixels are
+    // copied. generateMips fills every other level of that layer too; mips
+    // are averaged as stored, without sRGB decoding. GL thread only, the
+    // texture must stay alive until it IsReady() or the streamer is destroyed.
+    // Returns false, and the texture never becomes ready, when a row of the
+    // image does not fit an unpack buffer.
+    bool RequestImage(Texture* texture,
+                      GLsizei layer,
+                      GLenum format,
+                      const void* pixels,
+                      bool generateMips = true);
+
+    // GL thread only, once per frame. At least one row goes up per call,
+    // even when byteBudget is smaller, unless it is 0.
+    void Update(size_t byteBudget = 16 * 1024 * 1024);
+
+    // Images not yet fully copied
+    size_t GetPendingCount();
+
+    Stats GetStats();
+
+    // Releases GL objects, needs the context current
+    void ClearStreamer();
+
+private:
+    struct Image
+    {
+        Texture* texture {nullptr};
+        GLsizei layer {0};
+        GLenum format {GL_RGBA};
+        int channels {4};
+        bool generateMips {true};
+
+        // Every level in data, one after another
+        std::vector<GLsizei> widths;
+        std::vector<GLsizei> heights;
+        std::vector<size_t> offsets;
+        std::vector<uint8_t> data;
+
+        // Copy progress
+        GLint level {0};
+        GLsizei row {0};
+    };
+
+    struct PixelBuffer
+    {
+        GLuint PBO {0};
+        GLsync fence {nullptr};
+    };
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::unique_ptr<Image>> requests_;
+    std::deque<std::unique_ptr<Image>> built_;
+    size_t building_ {0};
+    bool stopping_ {false};
+    Stats stats_;
+
+    // GL thread only
+    std::deque<std::unique_ptr<Image>> uploading_;
+    struct PendingTexture
+    {
+        unsigned int images {0};
+        // An image was rejected, the texture stays unready
+        bool failed {false};
+    };
+
+    std::unordered_map<Texture*, PendingTexture> pendingTextures_;
+    std::vector<PixelBuffer> buffers_;
+    size_t bufferSize_ {0};
+    unsigned int nextBuffer_ {0};
+
+    void WorkerLoop();
+    static void BuildMips(Image& image);
+    PixelBuffer* AcquireBuffer();
+};
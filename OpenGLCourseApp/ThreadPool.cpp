@@ -0,0 +1,128 @@
+﻿#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Tracing.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int i = 1; i < threadCount; ++i)
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+std::vector<std::thread>
+ThreadPool::StartThreads(unsigned int threadCount, const std::function<void()>& loop)
+{
+    // hardware_concurrency may be 0 when unknown
+    if (threadCount == 0) {
+        const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for (unsigned int i = 0; i < threadCount; ++i)
+        threads.emplace_back(loop);
+
+    return threads;
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+}
+
+void
+ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& function)
+{
+    if (count == 0)
+        return;
+
+    // Not worth a wake up
+    if (count == 1 || workers_.empty()) {
+        for (unsigned int i = 0; i < count; ++i)
+            function(i);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &function;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        ++generation_;
+    }
+
+    wake_.notify_all();
+
+    RunJob(function, count);
+
+    // Workers still inside the job hold a pointer to function
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    job_ = nullptr;
+}
+
+void
+ThreadPool::WorkerLoop()
+{
+    TRACE_THREAD_NAME("Thread pool worker");
+
+    unsigned long long seen = 0;
+
+    for (;;) {
+        const std::function<void(unsigned int)>* job;
+        unsigned int count;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || (job_ && generation_ != seen); });
+
+            if (stopping_)
+                return;
+
+            seen = generation_;
+            job = job_;
+            count = count_;
+            ++busy_;
+        }
+
+        {
+            TRACE_SCOPE("ThreadPool::RunJob");
+            RunJob(*job, count);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+        }
+
+        done_.notify_one();
+    }
+}
+
+void
+ThreadPool::RunJob(const std::function<void(unsigned int)>& function, unsigned int count)
+{
+    for (;;) {
+        const unsigned int i = next_.fetch_add(1, std::memory_order_relaxed);
+
+        if (i >= count)
+            return;
+
+        function(i);
+    }
+}
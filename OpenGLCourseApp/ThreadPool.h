@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for per-frame data parallel work. Unlike the
+// importer's one-shot threads, waking the pool costs microseconds, so it can be
+// used every frame.
+class ThreadPool
+{
+public:
+    // 0 uses every hardware thread (the caller counts as one)
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Workers plus the calling thread
+    unsigned int GetThreadCount() const
+    {
+        return static_cast<unsigned int>(workers_.size()) + 1;
+    }
+
+    // Runs function(i) for every i in [0, count) and returns once all are done.
+    // The calling thread takes part. One caller at a time.
+    void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& function);
+
+    // Long running threads for the streamers' loader loops: threadCount of
+    // them, or with 0 one per hardware thread but one, leaving a core for the
+    // render thread, and at least one
+    static std::vector<std::thread> StartThreads(unsigned int threadCount,
+                                                 const std::function<void()>& loop);
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    // Current job, guarded by mutex_ except for the counters
+    const std::function<void(unsigned int)>* job_ {nullptr};
+    unsigned int count_ {0};
+    unsigned long long generation_ {0};
+    unsigned int busy_ {0};
+    bool stopping_ {false};
+    std::atomic<unsigned int> next_ {0};
+
+    void WorkerLoop();
+    void RunJob(const std::function<void(unsigned int)>& function, unsigned int count);
+};
@@ -0,0 +1,319 @@
+﻿#include "Tracing.h"
+
+#include <stdio.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Tracer::recording_ {false};
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Per thread, about 400 KB: a few frames of events between drains
+const uint64_t ringSize = 1 << 14;
+
+// Single producer (the owning thread), single consumer (the writer thread).
+// The counters only grow, an event's slot is its count modulo ringSize.
+struct ThreadRing
+{
+    TraceEvent events[ringSize];
+
+    // Producer side
+    std::atomic<uint64_t> head {0};
+    uint64_t cachedTail {0};
+    std::atomic<uint64_t> dropped {0};
+    char producerPadding[64];
+
+    // Consumer side
+    std::atomic<uint64_t> tail {0};
+    const char* writtenName {nullptr};
+    char consumerPadding[64];
+
+    std::atomic<const char*> name {nullptr};
+    // Set when the thread exits, the ring is reused once drained
+    std::atomic<bool> released {false};
+    uint32_t threadId {0};
+};
+
+struct TraceSession;
+void
+StopSession(TraceSession& session);
+
+struct TraceSession
+{
+    // A recording still running at exit is finished, not cut off
+    ~TraceSession()
+    {
+        StopSession(*this);
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    uint32_t nextThreadId {1};
+
+    // Writer thread and output, guarded by mutex
+    std::thread writer;
+    std::condition_variable wake;
+    bool stopping {false};
+    FILE* file {nullptr};
+    bool firstEvent {true};
+    uint64_t startTicks {0};
+    double microsecondsPerTick {1e-3};
+    uint64_t droppedAtStart {0};
+};
+
+TraceSession&
+Session()
+{
+    static TraceSession session;
+    return session;
+}
+
+// Trivially destructible, the fast path reads it without a TLS guard
+thread_local ThreadRing* threadRing = nullptr;
+
+// Hands the ring back when the thread exits
+struct ThreadRingRelease
+{
+    ThreadRing* ring {nullptr};
+
+    ~ThreadRingRelease()
+    {
+        if (ring != nullptr)
+            ring->released.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadRingRelease threadRingRelease;
+
+ThreadRing*
+AcquireRing()
+{
+    TraceSession& session = Session();
+    std::lock_guard<std::mutex> lock(session.mutex);
+
+    ThreadRing* ring = nullptr;
+
+    // Short lived threads (the importer's) take over drained rings
+    for (const std::unique_ptr<ThreadRing>& candidate : session.rings) {
+        if (candidate->released.load(std::memory_order_acquire)
+            && candidate->tail.load(std::memory_order_relaxed)
+                   == candidate->head.load(std::memory_order_relaxed)) {
+            ring = candidate.get();
+            ring->released.store(false, std::memory_order_relaxed);
+            ring->name.store(nullptr, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    if (ring == nullptr) {
+        session.rings.emplace_back(new ThreadRing());
+        ring = session.rings.back().get();
+    }
+
+    ring->threadId = session.nextThreadId++;
+    ring->writtenName = nullptr;
+
+    threadRing = ring;
+    threadRingRelease.ring = ring;
+
+    return ring;
+}
+
+void
+WriteSeparator(TraceSession& session)
+{
+    fputs(session.firstEvent ? "\n" : ",\n", session.file);
+    session.firstEvent = false;
+}
+
+// Writes out every ring's new events, called with the mutex held
+void
+Drain(TraceSession& session)
+{
+    for (const std::unique_ptr<ThreadRing>& ring : session.rings) {
+        const char* name = ring->name.load(std::memory_order_acquire);
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+
+        // Threads that are gone only need a name for their last events
+        const bool finished = ring->released.load(std::memory_order_relaxed) && tail == head;
+
+        if (name != nullptr && name != ring->writtenName && !finished) {
+            WriteSeparator(session);
+            fprintf(session.file,
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"name\":\"%s\"}}",
+                    ring->threadId,
+                    name);
+            ring->writtenName = name;
+        }
+
+        for (; tail != head; ++tail) {
+            const TraceEvent& event = ring->events[tail & (ringSize - 1)];
+
+            // Begun before this recording started
+            if (event.begin < session.startTicks)
+                continue;
+
+            WriteSeparator(session);
+            fprintf(session.file,
+                    "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.name,
+                    ring->threadId,
+                    (event.begin - session.startTicks) * session.microsecondsPerTick,
+                    (event.end - event.begin) * session.microsecondsPerTick);
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+void
+WriterLoop()
+{
+    TraceSession& session = Session();
+    std::unique_lock<std::mutex> lock(session.mutex);
+
+    while (!session.stopping) {
+        session.wake.wait_for(lock, std::chrono::milliseconds(20));
+        Drain(session);
+    }
+}
+
+uint64_t
+CountDropped(TraceSession& session)
+{
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<ThreadRing>& ring : session.rings)
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+
+    return dropped;
+}
+
+void
+StopSession(TraceSession& session)
+{
+    if (!session.writer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.stopping = true;
+    }
+
+    session.wake.notify_one();
+    session.writer.join();
+
+    std::lock_guard<std::mutex> lock(session.mutex);
+    Drain(session);
+
+    fputs("\n]}\n", session.file);
+    fclose(session.file);
+    session.file = nullptr;
+}
+
+} // namespace
+
+bool
+Tracer::Start(const char* fileLocation)
+{
+    TraceSession& session = Session();
+
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+
+        if (session.file != nullptr)
+            return true;
+
+        session.file = fopen(fileLocation, "w");
+
+        if (session.file == nullptr) {
+            printf("Failed to write %s\n", fileLocation);
+            return false;
+        }
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", session.file);
+        session.firstEvent = true;
+        session.stopping = false;
+        session.droppedAtStart = CountDropped(session);
+
+        // The thread names go out again for this file
+        for (const std::unique_ptr<ThreadRing>& ring : session.rings)
+            ring->writtenName = nullptr;
+    }
+
+#ifdef TRACING_RDTSC
+    // Time stamp counter rate against the steady clock, over 20 ms
+    const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+    const uint64_t ticksStart = Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const uint64_t ticksEnd = Now();
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+
+    session.microsecondsPerTick = seconds * 1e6 / static_cast<double>(ticksEnd - ticksStart);
+#else
+    session.microsecondsPerTick = 1e-3;
+#endif
+
+    session.startTicks = Now();
+    session.writer = std::thread(WriterLoop);
+    recording_.store(true, std::memory_order_relaxed);
+
+    return true;
+}
+
+void
+Tracer::Stop()
+{
+    recording_.store(false, std::memory_order_relaxed);
+    StopSession(Session());
+}
+
+void
+Tracer::SetThreadName(const char* name)
+{
+    ThreadRing* ring = threadRing != nullptr ? threadRing : AcquireRing();
+    ring->name.store(name, std::memory_order_release);
+}
+
+uint64_t
+Tracer::GetDroppedEvents()
+{
+    TraceSession& session = Session();
+    std::lock_guard<std::mutex> lock(session.mutex);
+
+    return CountDropped(session) - session.droppedAtStart;
+}
+
+void
+Tracer::Record(const char* name, uint64_t begin, uint64_t end)
+{
+    ThreadRing* ring = threadRing != nullptr ? threadRing : AcquireRing();
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    // Only look at the consumer's counter when the ring seems full
+    if (head - ring->cachedTail >= ringSize) {
+        ring->cachedTail = ring->tail.load(std::memory_order_acquire);
+
+        if (head - ring->cachedTail >= ringSize) {
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    ring->events[head & (ringSize - 1)] = TraceEvent {name, begin, end};
+    ring->head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACING_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACING_RDTSC 1
+#endif
+
+// CPU tracing.
+//
+// TRACE_SCOPE("name") times the rest of the enclosing block. Every thread
+// writes fixed size events into its own single producer ring, no locks and
+// no allocation after the thread's first event; a background thread drains
+// the rings into a Chrome trace JSON file (chrome://tracing, Perfetto). A
+// full ring drops events rather than wait. Nothing is recorded until
+// Tracer::Start, and building with TRACING_ENABLED 0 removes every macro.
+#ifndef TRACING_ENABLED
+#define TRACING_ENABLED 1
+#endif
+
+class Tracer
+{
+public:
+    // Starts recording to fileLocation, a Start while recording is ignored.
+    // Returns false if the file cannot be written.
+    static bool Start(const char* fileLocation);
+
+    // Writes out the remaining events and closes the file
+    static void Stop();
+
+    // Shown for the calling thread in the trace, name must be a string literal
+    static void SetThreadName(const char* name);
+
+    // Events lost to full rings since Start
+    static uint64_t GetDroppedEvents();
+
+    static bool IsRecording()
+    {
+        return recording_.load(std::memory_order_relaxed);
+    }
+
+    // Ticks of the trace clock: the time stamp counter where there is one
+    // (a few ns to read), otherwise steady_clock nanoseconds
+    static uint64_t Now()
+    {
+#ifdef TRACING_RDTSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    // One finished scope on the calling thread
+    static void Record(const char* name, uint64_t begin, uint64_t end);
+
+private:
+    static std::atomic<bool> recording_;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : name_(Tracer::IsRecording() ? name : nullptr)
+        , begin_(name_ != nullptr ? Tracer::Now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (name_ != nullptr)
+            Tracer::Record(name_, begin_, Tracer::Now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t begin_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b)       TRACE_CONCAT_INNER(a, b)
+
+#if TRACING_ENABLED
+#define TRACE_SCOPE(name)       TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Tracer::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
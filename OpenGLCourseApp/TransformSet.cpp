@@ -0,0 +1,105 @@
+﻿#include "TransformSet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <gtx/matrix_batch.hpp>
+
+#include "Tracing.h"
+
+void
+TransformSet::Resize(size_t count)
+{
+    const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+
+    positions_.resize(count, glm::vec3(0.0f));
+    orientations_.resize(count, identity);
+    previousOrientations_.resize(count, identity);
+    scales_.resize(count, glm::vec3(1.0f));
+    pivots_.resize(count, glm::vec3(0.0f));
+    angularVelocities_.resize(count, glm::vec3(0.0f));
+}
+
+void
+TransformSet::SetOrientation(size_t object, const glm::quat& orientation)
+{
+    orientations_[object] = orientation;
+    previousOrientations_[object] = orientation;
+}
+
+void
+TransformSet::Integrate(float timeStep)
+{
+    // The current orientations become the previous ones, the step writes over
+    // the older buffer
+    previousOrientations_.swap(orientations_);
+
+    const float halfStep = 0.5f * timeStep;
+
+    for (size_t i = 0; i < orientations_.size(); ++i) {
+        const glm::quat& from = previousOrientations_[i];
+
+        // dq/dt = (angularVelocity, 0) * q / 2, one Euler step and back to unit
+        // length. That turns by 2 atan(angle / 2) instead of angle, short by
+        // about angle^3 / 12: nothing at per frame angles, and no trig.
+        // (w, 0) * (v, s) = (s w + w x v, -w . v)
+        const glm::vec3 w = angularVelocities_[i] * halfStep;
+        const glm::vec3 v(from.x, from.y, from.z);
+        const glm::vec3 toVector = v + from.w * w + glm::cross(w, v);
+        const float toScalar = from.w - glm::dot(w, v);
+        const float scale = 1.0f / std::sqrt(glm::dot(toVector, toVector) + toScalar * toScalar);
+
+        orientations_[i] = glm::quat(toScalar * scale, toVector * scale);
+    }
+}
+
+void
+TransformSet::BuildModels(std::vector<glm::mat4>& models, float alpha)
+{
+    TRACE_SCOPE("TransformSet::BuildModels");
+
+    const size_t count = positions_.size();
+    models.resize(count);
+
+    const glm::quat* orientations = orientations_.data();
+
+    if (alpha < 1.0f) {
+        // Normalised lerp along the shorter arc, close enough to slerp for the
+        // small turn of one step
+        blended_.resize(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            const glm::quat& from = previousOrientations_[i];
+            const glm::quat& to = orientations_[i];
+            const float toWeight = glm::dot(from, to) < 0.0f ? -alpha : alpha;
+
+            blended_[i] = glm::normalize(from * (1.0f - alpha) + to * toWeight);
+        }
+
+        orientations = blended_.data();
+    }
+
+    // Blocks small enough for the rotations to still be in L1 when the scale
+    // and translation are added
+    const size_t blockSize = 256;
+
+    for (size_t first = 0; first < count; first += blockSize) {
+        const size_t last = std::min(first + blockSize, count);
+
+        glm::batchMat4Cast(orientations + first, models.data() + first, last - first);
+
+        for (size_t i = first; i < last; ++i) {
+            glm::mat4& model = models[i];
+            const glm::vec3& pivot = pivots_[i];
+
+            model[0] *= scales_[i].x;
+            model[1] *= scales_[i].y;
+            model[2] *= scales_[i].z;
+            model[3] = glm::vec4(positions_[i] - glm::vec3(model[0]) * pivot.x
+                                     - glm::vec3(model[1]) * pivot.y
+                                     - glm::vec3(model[2]) * pivot.z,
+                                 1.0f);
+        }
+    }
+}
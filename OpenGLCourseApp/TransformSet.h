@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+// Object transforms as position, orientation, scale and pivot, one array each.
+// Orientations are quaternions: angular velocity is integrated on the
+// quaternion itself, and every model matrix comes out of one batched
+// quaternion to matrix conversion instead of a glm::rotate (sin, cos and a
+// matrix product) per object.
+class TransformSet
+{
+public:
+    // Added objects sit at the origin, unrotated, unscaled and at rest
+    void Resize(size_t count);
+
+    size_t GetCount() const
+    {
+        return positions_.size();
+    }
+
+    void SetPosition(size_t object, const glm::vec3& position)
+    {
+        positions_[object] = position;
+    }
+
+    void SetScale(size_t object, const glm::vec3& scale)
+    {
+        scales_[object] = scale;
+    }
+
+    // Object space point placed at the position, the centre of rotation and scale
+    void SetPivot(size_t object, const glm::vec3& pivot)
+    {
+        pivots_[object] = pivot;
+    }
+
+    // World space axis times radians per unit of Integrate's timeStep
+    void SetAngularVelocity(size_t object, const glm::vec3& angularVelocity)
+    {
+        angularVelocities_[object] = angularVelocity;
+    }
+
+    // Also resets the previous orientation, no interpolation across the jump
+    void SetOrientation(size_t object, const glm::quat& orientation);
+
+    const glm::quat& GetOrientation(size_t object) const
+    {
+        return orientations_[object];
+    }
+
+    // Turns every object by its angular velocity over timeStep. The orientations
+    // before the step are kept for BuildModels.
+    void Integrate(float timeStep);
+
+    // models[i] = translate(position) * mat4_cast(orientation) * scale(scale) * translate(-pivot).
+    // alpha < 1 blends each orientation from before the last Integrate (0) to
+    // the current one (1), for rendering between fixed simulation steps.
+    void BuildModels(std::vector<glm::mat4>& models, float alpha = 1.0f);
+
+private:
+    std::vector<glm::vec3> positions_;
+    std::vector<glm::quat> orientations_;
+    std::vector<glm::quat> previousOrientations_;
+    std::vector<glm::vec3> scales_;
+    std::vector<glm::vec3> pivots_;
+    std::vector<glm::vec3> angularVelocities_;
+
+    // Blended orientations, reused by BuildModels
+    std::vector<glm::quat> blended_;
+};
@@ -0,0 +1,519 @@
+﻿#include "TriangleBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRIANGLE_BVH_SSE2 1
+#endif
+
+namespace {
+
+const float infinity = std::numeric_limits<float>::infinity();
+
+float
+HalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    const glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+} // namespace
+
+TriangleBvh::TriangleBvh() {}
+
+TriangleBvh::~TriangleBvh() {}
+
+void
+TriangleBvh::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+    nodes_.clear();
+    packs_.clear();
+
+    triangleCount_ = indices.size() / 3;
+
+    std::vector<BuildTriangle> triangles(triangleCount_);
+
+    for (size_t i = 0; i < triangleCount_; ++i) {
+        const glm::vec3& p0 = positions[indices[i * 3]];
+        const glm::vec3& p1 = positions[indices[i * 3 + 1]];
+        const glm::vec3& p2 = positions[indices[i * 3 + 2]];
+
+        BuildTriangle& triangle = triangles[i];
+        triangle.min = glm::min(p0, glm::min(p1, p2));
+        triangle.max = glm::max(p0, glm::max(p1, p2));
+        triangle.centroid = (triangle.min + triangle.max) * 0.5f;
+        triangle.index = static_cast<uint32_t>(i);
+    }
+
+    // The root is always an inner node, even over a single pack
+    nodes_.reserve(triangleCount_ / 2 + 1);
+    packs_.reserve(triangleCount_ / 2 + 1);
+
+    glm::vec3 rootMin, rootMax;
+    BuildNode(triangles,
+              positions,
+              indices,
+              0,
+              static_cast<uint32_t>(triangleCount_),
+              0,
+              rootMin,
+              rootMax);
+}
+
+bool
+TriangleBvh::Raycast(const glm::vec3& origin,
+                     const glm::vec3& direction,
+                     float maxDistance,
+                     Hit& hit) const
+{
+    if (nodes_.empty())
+        return false;
+
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    float closest = maxDistance;
+    bool found = false;
+
+    struct Entry
+    {
+        uint32_t node;
+        float distance;
+    };
+
+    // Every visit pops one entry and pushes at most four
+    Entry stack[maxDepth * 3 + 4];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = Entry {0, 0.0f};
+
+#ifdef TRIANGLE_BVH_SSE2
+    const __m128 originX = _mm_set1_ps(origin.x);
+    const __m128 originY = _mm_set1_ps(origin.y);
+    const __m128 originZ = _mm_set1_ps(origin.z);
+    const __m128 directionX = _mm_set1_ps(direction.x);
+    const __m128 directionY = _mm_set1_ps(direction.y);
+    const __m128 directionZ = _mm_set1_ps(direction.z);
+    const __m128 inverseX = _mm_set1_ps(inverseDirection.x);
+    const __m128 inverseY = _mm_set1_ps(inverseDirection.y);
+    const __m128 inverseZ = _mm_set1_ps(inverseDirection.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+#endif
+
+    while (stackSize > 0) {
+        const Entry entry = stack[--stackSize];
+
+        if (entry.distance > closest)
+            continue;
+
+        const Node& node = nodes_[entry.node];
+        float distances[4];
+
+#ifdef TRIANGLE_BVH_SSE2
+        {
+            const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), originX), inverseX);
+            const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), originX), inverseX);
+            const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), originY), inverseY);
+            const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), originY), inverseY);
+            const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), originZ), inverseZ);
+            const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), originZ), inverseZ);
+
+            const __m128 entryT = _mm_max_ps(
+                _mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+                _mm_max_ps(_mm_min_ps(tz0, tz1), zero));
+            const __m128 exitT = _mm_min_ps(
+                _mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+                _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_set1_ps(closest)));
+
+            // Misses get an infinite distance
+            const __m128 hitMask = _mm_cmple_ps(entryT, exitT);
+            _mm_storeu_ps(distances,
+                          _mm_or_ps(_mm_and_ps(hitMask, entryT),
+                                    _mm_andnot_ps(hitMask, _mm_set1_ps(infinity))));
+        }
+#else
+        for (unsigned int k = 0; k < 4; ++k) {
+            const float tx0 = (node.minX[k] - origin.x) * inverseDirection.x;
+            const float tx1 = (node.maxX[k] - origin.x) * inverseDirection.x;
+            const float ty0 = (node.minY[k] - origin.y) * inverseDirection.y;
+            const float ty1 = (node.maxY[k] - origin.y) * inverseDirection.y;
+            const float tz0 = (node.minZ[k] - origin.z) * inverseDirection.z;
+            const float tz1 = (node.maxZ[k] - origin.z) * inverseDirection.z;
+
+            const float entryT = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                                          std::max(std::min(tz0, tz1), 0.0f));
+            const float exitT = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                                         std::min(std::max(tz0, tz1), closest));
+
+            distances[k] = entryT <= exitT ? entryT : infinity;
+        }
+#endif
+
+        // Hit children far to near, so the nearest is popped first
+        unsigned int order[4];
+        unsigned int orderCount = 0;
+
+        for (unsigned int k = 0; k < 4; ++k) {
+            // The slab test is symmetric, an inverted box alone does not miss
+            if (distances[k] == infinity || node.child[k] == emptyChild)
+                continue;
+
+            unsigned int position = orderCount++;
+            while (position > 0 && distances[order[position - 1]] < distances[k]) {
+                order[position] = order[position - 1];
+                --position;
+            }
+            order[position] = k;
+        }
+
+        for (unsigned int o = 0; o < orderCount; ++o) {
+            const unsigned int k = order[o];
+
+            if (node.count[k] == 0) {
+                stack[stackSize++] = Entry {node.child[k], distances[k]};
+                continue;
+            }
+
+            const TrianglePack& pack = packs_[node.child[k]];
+
+#ifdef TRIANGLE_BVH_SSE2
+            // Moller-Trumbore on all four lanes
+            const __m128 edge1X = _mm_loadu_ps(pack.edge1X);
+            const __m128 edge1Y = _mm_loadu_ps(pack.edge1Y);
+            const __m128 edge1Z = _mm_loadu_ps(pack.edge1Z);
+            const __m128 edge2X = _mm_loadu_ps(pack.edge2X);
+            const __m128 edge2Y = _mm_loadu_ps(pack.edge2Y);
+            const __m128 edge2Z = _mm_loadu_ps(pack.edge2Z);
+
+            // p = direction x edge2
+            const __m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z),
+                                         _mm_mul_ps(directionZ, edge2Y));
+            const __m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X),
+                                         _mm_mul_ps(directionX, edge2Z));
+            const __m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y),
+                                         _mm_mul_ps(directionY, edge2X));
+
+            const __m128 determinant = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+            const __m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+            const __m128 sX = _mm_sub_ps(originX, _mm_loadu_ps(pack.v0X));
+            const __m128 sY = _mm_sub_ps(originY, _mm_loadu_ps(pack.v0Y));
+            const __m128 sZ = _mm_sub_ps(originZ, _mm_loadu_ps(pack.v0Z));
+
+            const __m128 u = _mm_mul_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)),
+                inverseDeterminant);
+
+            // q = s x edge1
+            const __m128 qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+            const __m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+            const __m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+
+            const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX),
+                                                              _mm_mul_ps(directionY, qY)),
+                                                   _mm_mul_ps(directionZ, qZ)),
+                                        inverseDeterminant);
+            const __m128 t = _mm_mul_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)),
+                           _mm_mul_ps(edge2Z, qZ)),
+                inverseDeterminant);
+
+            // Degenerate lanes divide by zero and fail the comparisons
+            __m128 mask = _mm_cmpneq_ps(determinant, zero);
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(t, _mm_set1_ps(closest)));
+
+            int lanes = _mm_movemask_ps(mask);
+            if (lanes == 0)
+                continue;
+
+            float laneT[4], laneU[4], laneV[4];
+            _mm_storeu_ps(laneT, t);
+            _mm_storeu_ps(laneU, u);
+            _mm_storeu_ps(laneV, v);
+
+            for (unsigned int lane = 0; lane < 4; ++lane) {
+                if ((lanes >> lane & 1) && laneT[lane] <= closest) {
+                    closest = laneT[lane];
+                    hit.triangle = pack.triangle[lane];
+                    hit.u = laneU[lane];
+                    hit.v = laneV[lane];
+                    hit.distance = closest;
+                    found = true;
+                }
+            }
+#else
+            for (unsigned int lane = 0; lane < node.count[k]; ++lane) {
+                const glm::vec3 edge1(pack.edge1X[lane], pack.edge1Y[lane], pack.edge1Z[lane]);
+                const glm::vec3 edge2(pack.edge2X[lane], pack.edge2Y[lane], pack.edge2Z[lane]);
+                const glm::vec3 p = glm::cross(direction, edge2);
+                const float determinant = glm::dot(edge1, p);
+
+                if (determinant == 0.0f)
+                    continue;
+
+                const float inverseDeterminant = 1.0f / determinant;
+                const glm::vec3 v0(pack.v0X[lane], pack.v0Y[lane], pack.v0Z[lane]);
+                const glm::vec3 s = origin - v0;
+                const float u = glm::dot(s, p) * inverseDeterminant;
+                const glm::vec3 q = glm::cross(s, edge1);
+                const float v = glm::dot(direction, q) * inverseDeterminant;
+                const float t = glm::dot(edge2, q) * inverseDeterminant;
+
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= closest) {
+                    closest = t;
+                    hit.triangle = pack.triangle[lane];
+                    hit.u = u;
+                    hit.v = v;
+                    hit.distance = t;
+                    found = true;
+                }
+            }
+#endif
+        }
+    }
+
+    return found;
+}
+
+uint32_t
+TriangleBvh::BuildNode(std::vector<BuildTriangle>& triangles,
+                       const std::vector<glm::vec3>& positions,
+                       const std::vector<uint32_t>& indices,
+                       uint32_t begin,
+                       uint32_t end,
+                       unsigned int depth,
+                       glm::vec3& nodeMin,
+                       glm::vec3& nodeMax)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+
+    // Two levels of binary splits give up to four children
+    uint32_t ranges[4][2];
+    unsigned int rangeCount = 0;
+
+    if (end - begin <= packSize) {
+        ranges[rangeCount][0] = begin;
+        ranges[rangeCount++][1] = end;
+    } else {
+        const uint32_t middle = Split(triangles, begin, end, depth < maxSahDepth);
+        const uint32_t halves[2][2] = {{begin, middle}, {middle, end}};
+
+        for (const uint32_t* half : halves) {
+            if (half[1] - half[0] <= packSize) {
+                ranges[rangeCount][0] = half[0];
+                ranges[rangeCount++][1] = half[1];
+                continue;
+            }
+
+            const uint32_t quarter = Split(triangles, half[0], half[1], depth + 1 < maxSahDepth);
+            ranges[rangeCount][0] = half[0];
+            ranges[rangeCount++][1] = quarter;
+            ranges[rangeCount][0] = quarter;
+            ranges[rangeCount++][1] = half[1];
+        }
+    }
+
+    nodeMin = glm::vec3(infinity);
+    nodeMax = glm::vec3(-infinity);
+
+    for (unsigned int k = 0; k < 4; ++k) {
+        glm::vec3 childMin(infinity);
+        glm::vec3 childMax(-infinity);
+        uint32_t child = emptyChild;
+        uint32_t count = 0;
+
+        if (k < rangeCount) {
+            const uint32_t first = ranges[k][0];
+            const uint32_t last = ranges[k][1];
+
+            if (last - first <= packSize) {
+                for (uint32_t i = first; i < last; ++i) {
+                    childMin = glm::min(childMin, triangles[i].min);
+                    childMax = glm::max(childMax, triangles[i].max);
+                }
+
+                child = BuildPack(triangles, positions, indices, first, last);
+                count = last - first;
+            } else {
+                child = BuildNode(triangles,
+                                  positions,
+                                  indices,
+                                  first,
+                                  last,
+                                  depth + 2,
+                                  childMin,
+                                  childMax);
+            }
+
+            nodeMin = glm::min(nodeMin, childMin);
+            nodeMax = glm::max(nodeMax, childMax);
+        }
+
+        // nodes_ may have grown, index again
+        Node& node = nodes_[nodeIndex];
+        node.minX[k] = childMin.x;
+        node.minY[k] = childMin.y;
+        node.minZ[k] = childMin.z;
+        node.maxX[k] = childMax.x;
+        node.maxY[k] = childMax.y;
+        node.maxZ[k] = childMax.z;
+        node.child[k] = child;
+        node.count[k] = count;
+    }
+
+    return nodeIndex;
+}
+
+uint32_t
+TriangleBvh::Split(std::vector<BuildTriangle>& triangles, uint32_t begin, uint32_t end, bool useSah)
+{
+    glm::vec3 centroidMin(infinity), centroidMax(-infinity);
+    for (uint32_t i = begin; i < end; ++i) {
+        centroidMin = glm::min(centroidMin, triangles[i].centroid);
+        centroidMax = glm::max(centroidMax, triangles[i].centroid);
+    }
+
+    const glm::vec3 extent = centroidMax - centroidMin;
+
+    float bestCost = infinity;
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+
+    // Binned SAH over all three axes
+    for (int axis = 0; axis < 3 && useSah; ++axis) {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        const float scale = binCount / extent[axis];
+        glm::vec3 binMin[binCount], binMax[binCount];
+        uint32_t binCounts[binCount] = {};
+
+        for (unsigned int b = 0; b < binCount; ++b) {
+            binMin[b] = glm::vec3(infinity);
+            binMax[b] = glm::vec3(-infinity);
+        }
+
+        for (uint32_t i = begin; i < end; ++i) {
+            const float position = (triangles[i].centroid[axis] - centroidMin[axis]) * scale;
+            const unsigned int bin = std::min(binCount - 1, static_cast<unsigned int>(position));
+
+            ++binCounts[bin];
+            binMin[bin] = glm::min(binMin[bin], triangles[i].min);
+            binMax[bin] = glm::max(binMax[bin], triangles[i].max);
+        }
+
+        float rightAreas[binCount];
+        uint32_t rightCounts[binCount];
+        glm::vec3 rightMin(infinity), rightMax(-infinity);
+        uint32_t rightCount = 0;
+
+        for (unsigned int b = binCount - 1; b > 0; --b) {
+            rightMin = glm::min(rightMin, binMin[b]);
+            rightMax = glm::max(rightMax, binMax[b]);
+            rightCount += binCounts[b];
+            rightAreas[b] = HalfArea(rightMin, rightMax);
+            rightCounts[b] = rightCount;
+        }
+
+        glm::vec3 leftMin(infinity), leftMax(-infinity);
+        uint32_t leftCount = 0;
+
+        for (unsigned int b = 1; b < binCount; ++b) {
+            leftMin = glm::min(leftMin, binMin[b - 1]);
+            leftMax = glm::max(leftMax, binMax[b - 1]);
+            leftCount += binCounts[b - 1];
+
+            if (leftCount == 0 || rightCounts[b] == 0)
+                continue;
+
+            const float cost = leftCount * HalfArea(leftMin, leftMax)
+                               + rightCounts[b] * rightAreas[b];
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis >= 0) {
+        const float scale = binCount / extent[bestAxis];
+        const float minimum = centroidMin[bestAxis];
+
+        const auto middle = std::partition(triangles.begin() + begin,
+                                           triangles.begin() + end,
+                                           [&](const BuildTriangle& triangle) {
+                                               const float position =
+                                                   (triangle.centroid[bestAxis] - minimum) * scale;
+                                               const unsigned int bin = std::min(
+                                                   binCount - 1,
+                                                   static_cast<unsigned int>(position));
+                                               return bin < bestBin;
+                                           });
+
+        const uint32_t split = static_cast<uint32_t>(middle - triangles.begin());
+        if (split > begin && split < end)
+            return split;
+    }
+
+    // Median along the widest axis
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+                                                                   : (extent.y >= extent.z ? 1 : 2);
+    const uint32_t middle = begin + (end - begin) / 2;
+
+    std::nth_element(triangles.begin() + begin,
+                     triangles.begin() + middle,
+                     triangles.begin() + end,
+                     [axis](const BuildTriangle& lhs, const BuildTriangle& rhs) {
+                         return lhs.centroid[axis] < rhs.centroid[axis];
+                     });
+
+    return middle;
+}
+
+uint32_t
+TriangleBvh::BuildPack(const std::vector<BuildTriangle>& triangles,
+                       const std::vector<glm::vec3>& positions,
+                       const std::vector<uint32_t>& indices,
+                       uint32_t begin,
+                       uint32_t end)
+{
+    TrianglePack pack;
+
+    for (uint32_t lane = 0; lane < packSize; ++lane) {
+        glm::vec3 p0(0.0f), p1(0.0f), p2(0.0f);
+        uint32_t triangle = 0;
+
+        if (begin + lane < end) {
+            triangle = triangles[begin + lane].index;
+            p0 = positions[indices[triangle * 3]];
+            p1 = positions[indices[triangle * 3 + 1]];
+            p2 = positions[indices[triangle * 3 + 2]];
+        }
+
+        const glm::vec3 edge1 = p1 - p0;
+        const glm::vec3 edge2 = p2 - p0;
+
+        pack.v0X[lane] = p0.x;
+        pack.v0Y[lane] = p0.y;
+        pack.v0Z[lane] = p0.z;
+        pack.edge1X[lane] = edge1.x;
+        pack.edge1Y[lane] = edge1.y;
+        pack.edge1Z[lane] = edge1.z;
+        pack.edge2X[lane] = edge2.x;
+        pack.edge2Y[lane] = edge2.y;
+        pack.edge2Z[lane] = edge2.z;
+        pack.triangle[lane] = triangle;
+    }
+
+    packs_.push_back(pack);
+
+    return static_cast<uint32_t>(packs_.size() - 1);
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <glm.hpp>
+
+// Four-wide BVH over the triangles of one mesh, for ray picking.
+//
+// Every node holds the boxes of up to four children and every leaf is a pack of
+// up to four triangles, both laid out so one SSE instruction handles all four
+// lanes: a node visit is a single 4-wide slab test and a leaf a single 4-wide
+// Moller-Trumbore test. The triangles are copied in, the source data can go.
+class TriangleBvh
+{
+public:
+    struct Hit
+    {
+        uint32_t triangle {0};
+        // Hit point = (1 - u - v) * p0 + u * p1 + v * p2
+        float u {0.0f};
+        float v {0.0f};
+        // In units of the ray direction
+        float distance {0.0f};
+    };
+
+    TriangleBvh();
+    ~TriangleBvh();
+
+    // Triangle i is indices[3i..3i+2] into positions
+    void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+    // Nearest hit within maxDistance, both triangle sides count
+    bool Raycast(const glm::vec3& origin,
+                 const glm::vec3& direction,
+                 float maxDistance,
+                 Hit& hit) const;
+
+    size_t GetTriangleCount() const
+    {
+        return triangleCount_;
+    }
+
+private:
+    // Child k: inner node when count[k] == 0, pack of count[k] triangles
+    // otherwise, nothing when child[k] == emptyChild
+    struct Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        uint32_t child[4];
+        uint32_t count[4];
+    };
+
+    // Unused lanes are degenerate and never hit
+    struct TrianglePack
+    {
+        float v0X[4], v0Y[4], v0Z[4];
+        float edge1X[4], edge1Y[4], edge1Z[4];
+        float edge2X[4], edge2Y[4], edge2Z[4];
+        uint32_t triangle[4];
+    };
+
+    struct BuildTriangle
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::vec3 centroid;
+        uint32_t index;
+    };
+
+    static const uint32_t emptyChild = ~0u;
+    static const uint32_t packSize = 4;
+    static const unsigned int binCount = 12;
+    static const unsigned int maxSahDepth = 48;
+    // Each node level splits twice, see BuildNode
+    static const unsigned int maxDepth = maxSahDepth + 32;
+
+    std::vector<Node> nodes_;
+    std::vector<TrianglePack> packs_;
+    size_t triangleCount_ {0};
+
+    uint32_t BuildNode(std::vector<BuildTriangle>& triangles,
+                       const std::vector<glm::vec3>& positions,
+                       const std::vector<uint32_t>& indices,
+                       uint32_t begin,
+                       uint32_t end,
+                       unsigned int depth,
+                       glm::vec3& nodeMin,
+                       glm::vec3& nodeMax);
+    static uint32_t Split(std::vector<BuildTriangle>& triangles,
+                          uint32_t begin,
+                          uint32_t end,
+                          bool useSah);
+    uint32_t BuildPack(const std::vector<BuildTriangle>& triangles,
+                       const std::vector<glm::vec3>& positions,
+                       const std::vector<uint32_t>& indices,
+                       uint32_t begin,
+                       uint32_t end);
+};
@@ -0,0 +1,87 @@
+﻿#include "VideoFrame.h"
+
+#include <cmath>
+
+int
+VideoFrame::GetPlaneCount(VideoFormat format)
+{
+    switch (format) {
+    case VideoFormat::NV12:
+        return 2;
+    case VideoFormat::I420:
+        return 3;
+    case VideoFormat::YUYV:
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+VideoFrame::GetPlaneWidth(VideoFormat format, int width, int plane)
+{
+    if (format == VideoFormat::YUYV)
+        return (width + 1) / 2 * 2;
+
+    if (plane == 0)
+        return width;
+
+    return (width + 1) / 2;
+}
+
+int
+VideoFrame::GetPlaneHeight(VideoFormat format, int height, int plane)
+{
+    if (plane == 0 || format == VideoFormat::YUYV)
+        return height;
+
+    return (height + 1) / 2;
+}
+
+int
+VideoFrame::GetPlaneChannels(VideoFormat format, int plane)
+{
+    if (format == VideoFormat::YUYV || (format == VideoFormat::NV12 && plane == 1))
+        return 2;
+
+    return 1;
+}
+
+size_t
+VideoFrame::GetFrameSize(VideoFormat format, int width, int height)
+{
+    size_t size = 0;
+
+    for (int plane = 0; plane < GetPlaneCount(format); ++plane) {
+        size += static_cast<size_t>(GetPlaneWidth(format, width, plane))
+                * GetPlaneHeight(format, height, plane) * GetPlaneChannels(format, plane);
+    }
+
+    return size;
+}
+
+YuvCoefficients
+YuvCoefficients::Get(ColorMatrix matrix, ColorRange range)
+{
+    // Luma weights of red and blue
+    const double kr = matrix == ColorMatrix::BT709 ? 0.2126 : 0.299;
+    const double kb = matrix == ColorMatrix::BT709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+
+    const bool limited = range == ColorRange::Limited;
+    const double lumaScale = limited ? 255.0 / 219.0 : 1.0;
+    const double chromaScale = limited ? 255.0 / 224.0 : 1.0;
+    const double one = static_cast<double>(1 << bits);
+
+    YuvCoefficients coefficients;
+    coefficients.lumaScale = static_cast<int>(std::lround(lumaScale * one));
+    coefficients.lumaOffset = limited ? 16 : 0;
+    coefficients.vToR = static_cast<int>(std::lround(2.0 * (1.0 - kr) * chromaScale * one));
+    coefficients.uToG = static_cast<int>(
+        std::lround(2.0 * (1.0 - kb) * kb / kg * chromaScale * one));
+    coefficients.vToG = static_cast<int>(
+        std::lround(2.0 * (1.0 - kr) * kr / kg * chromaScale * one));
+    coefficients.uToB = static_cast<int>(std::lround(2.0 * (1.0 - kb) * chromaScale * one));
+
+    return coefficients;
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Planar and packed YUV layouts, 8 bits per sample
+enum class VideoFormat
+{
+    // Y plane, then one plane of interleaved U and V at half width and height
+    NV12,
+    // Y, U and V planes, U and V at half width and height
+    I420,
+    // One plane of Y0 U Y1 V per pair of pixels
+    YUYV,
+};
+
+enum class ColorMatrix
+{
+    BT601,
+    BT709,
+};
+
+enum class ColorRange
+{
+    // Y in [16, 235], U and V in [16, 240]
+    Limited,
+    Full,
+};
+
+// One frame in memory owned by the caller. Planes are in the order listed
+// above; stride is the distance between rows in bytes.
+struct VideoFrame
+{
+    VideoFormat format {VideoFormat::NV12};
+    int width {0};
+    int height {0};
+    const uint8_t* planes[3] {nullptr, nullptr, nullptr};
+    size_t strides[3] {0, 0, 0};
+
+    static int GetPlaneCount(VideoFormat format);
+
+    // Size of a plane in samples of GetPlaneChannels bytes each. YUYV is
+    // samples of two channels (Y and alternately U or V), an odd width
+    // rounded up to whole pairs.
+    static int GetPlaneWidth(VideoFormat format, int width, int plane);
+    static int GetPlaneHeight(VideoFormat format, int height, int plane);
+    static int GetPlaneChannels(VideoFormat format, int plane);
+
+    // Bytes of every plane with rows packed tightly
+    static size_t GetFrameSize(VideoFormat format, int width, int height);
+};
+
+// YUV to RGB in fixed point, shared by the shader and the CPU converter so
+// both produce the same bytes:
+//
+//   y = lumaScale * (Y - lumaOffset)
+//   R = (y + vToR * (V - 128) + round) >> bits
+//   G = (y - uToG * (U - 128) - vToG * (V - 128) + round) >> bits
+//   B = (y + uToB * (U - 128) + round) >> bits
+//
+// each clamped to [0, 255 << bits] before the shift. Chroma is not
+// interpolated, a pixel takes the U and V of the sample it lies in.
+struct YuvCoefficients
+{
+    static const int bits = 13;
+
+    int lumaScale;
+    int lumaOffset;
+    int vToR;
+    int uToG;
+    int vToG;
+    int uToB;
+
+    static YuvCoefficients Get(ColorMatrix matrix, ColorRange range);
+};
@@ -0,0 +1,276 @@
+﻿#include "VideoRenderer.h"
+
+#include <string.h>
+
+#include "GlStats.h"
+#include "Tracing.h"
+
+namespace {
+
+// Region starts stay aligned for the memcpy into the mapped buffer
+const GLsizeiptr regionAlignment = 256;
+
+GLenum
+PlaneFormat(VideoFormat format, int plane)
+{
+    return VideoFrame::GetPlaneChannels(format, plane) == 2 ? GL_RG : GL_RED;
+}
+
+GLint
+PlaneInternalFormat(VideoFormat format, int plane)
+{
+    return VideoFrame::GetPlaneChannels(format, plane) == 2 ? GL_RG8 : GL_R8;
+}
+
+} // namespace
+
+VideoRenderer::VideoRenderer() {}
+
+VideoRenderer::~VideoRenderer()
+{
+    ClearRenderer();
+}
+
+void
+VideoRenderer::CreateFromFiles(const char* vertexLocation, const char* fragmentLocation)
+{
+    shader_.CreateFromFiles(vertexLocation, fragmentLocation);
+
+    uniformFormat_ = shader_.GetUniformLocation("videoFormat");
+    uniformSize_ = shader_.GetUniformLocation("videoSize");
+    uniformLumaCoefficients_ = shader_.GetUniformLocation("lumaCoefficients");
+    uniformChromaCoefficients_ = shader_.GetUniformLocation("chromaCoefficients");
+
+    // The samplers never change units
+    shader_.UseShader();
+    glUniform1i(shader_.GetUniformLocation("lumaTexture"), 0);
+    glUniform1i(shader_.GetUniformLocation("chromaTexture"), 1);
+    glUniform1i(shader_.GetUniformLocation("chromaVTexture"), 2);
+    Shader::UnUseShader();
+
+    // The quad comes from gl_VertexID, but core profile draws need a vertex array
+    if (VAO_ == 0)
+        glGenVertexArrays(1, &VAO_);
+}
+
+bool
+VideoRenderer::Upload(const VideoFrame& frame)
+{
+    TRACE_SCOPE("VideoRenderer::Upload");
+
+    if (frame.width <= 0 || frame.height <= 0)
+        return false;
+
+    if (frame.format != format_ || frame.width != width_ || frame.height != height_
+        || PBO_ == 0) {
+        AllocateFrame(frame.format, frame.width, frame.height);
+    }
+
+    // Only waits when every region is still queued on the GPU
+    GLsync& regionFence = regionFences_[region_];
+
+    if (regionFence) {
+        GLenum result = glClientWaitSync(regionFence, 0, 0);
+
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            ++stalls_;
+            result = glClientWaitSync(regionFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+
+        if (result == GL_WAIT_FAILED || result == GL_TIMEOUT_EXPIRED)
+            return false;
+
+        glDeleteSync(regionFence);
+        regionFence = nullptr;
+    }
+
+    const GLintptr regionOffset = region_ * regionSize_;
+    const int planeCount = VideoFrame::GetPlaneCount(format_);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO_);
+
+    // Unsynchronized: the region fence above already guarantees the GPU is done with it
+    uint8_t* staging = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                                              regionOffset,
+                                                              regionSize_,
+                                                              GL_MAP_WRITE_BIT
+                                                                  | GL_MAP_INVALIDATE_RANGE_BIT
+                                                                  | GL_MAP_UNSYNCHRONIZED_BIT));
+
+    if (staging == nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    // Rows packed tightly, one plane after another
+    size_t planeOffsets[3] {0, 0, 0};
+    size_t offset = 0;
+
+    for (int plane = 0; plane < planeCount; ++plane) {
+        const size_t rowSize
+            = static_cast<size_t>(VideoFrame::GetPlaneWidth(format_, width_, plane))
+              * VideoFrame::GetPlaneChannels(format_, plane);
+        const int rows = VideoFrame::GetPlaneHeight(format_, height_, plane);
+        const uint8_t* source = frame.planes[plane];
+
+        planeOffsets[plane] = offset;
+
+        if (frame.strides[plane] == rowSize) {
+            memcpy(staging + offset, source, rowSize * rows);
+            offset += rowSize * rows;
+            continue;
+        }
+
+        for (int row = 0; row < rows; ++row) {
+            memcpy(staging + offset, source + row * frame.strides[plane], rowSize);
+            offset += rowSize;
+        }
+    }
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int plane = 0; plane < planeCount; ++plane) {
+        glBindTexture(GL_TEXTURE_2D, textures_[plane]);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        VideoFrame::GetPlaneWidth(format_, width_, plane),
+                        VideoFrame::GetPlaneHeight(format_, height_, plane),
+                        PlaneFormat(format_, plane),
+                        GL_UNSIGNED_BYTE,
+                        reinterpret_cast<const void*>(regionOffset + planeOffsets[plane]));
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    regionFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region_ = (region_ + 1) % regionCount;
+
+    ++uploadedFrames_;
+    uploadedBytes_ += offset;
+
+    return true;
+}
+
+void
+VideoRenderer::Render()
+{
+    if (textures_[0] == 0 || VAO_ == 0)
+        return;
+
+    const YuvCoefficients coefficients = YuvCoefficients::Get(matrix_, range_);
+
+    shader_.UseShader();
+    glUniform1i(uniformFormat_, static_cast<GLint>(format_));
+    glUniform2i(uniformSize_, width_, height_);
+    glUniform2i(uniformLumaCoefficients_, coefficients.lumaScale, coefficients.lumaOffset);
+    glUniform4i(uniformChromaCoefficients_,
+                coefficients.vToR,
+                coefficients.uToG,
+                coefficients.vToG,
+                coefficients.uToB);
+
+    for (int plane = 0; plane < 3; ++plane) {
+        glActiveTexture(GL_TEXTURE0 + plane);
+        glBindTexture(GL_TEXTURE_2D, textures_[plane]);
+    }
+
+    glBindVertexArray(VAO_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    for (int plane = 2; plane >= 0; --plane) {
+        glActiveTexture(GL_TEXTURE0 + plane);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    Shader::UnUseShader();
+}
+
+void
+VideoRenderer::AllocateFrame(VideoFormat format, int width, int height)
+{
+    ClearFrame();
+
+    format_ = format;
+    width_ = width;
+    height_ = height;
+
+    for (int plane = 0; plane < VideoFrame::GetPlaneCount(format); ++plane) {
+        glGenTextures(1, &textures_[plane]);
+        glBindTexture(GL_TEXTURE_2D, textures_[plane]);
+
+        // Only read with texelFetch, but a texture with mipmap filtering and
+        // one level is incomplete
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     PlaneInternalFormat(format, plane),
+                     VideoFrame::GetPlaneWidth(format, width, plane),
+                     VideoFrame::GetPlaneHeight(format, height, plane),
+                     0,
+                     PlaneFormat(format, plane),
+                     GL_UNSIGNED_BYTE,
+                     nullptr);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    const GLsizeiptr frameSize = static_cast<GLsizeiptr>(
+        VideoFrame::GetFrameSize(format, width, height));
+    regionSize_ = (frameSize + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+    glGenBuffers(1, &PBO_);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO_);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, regionSize_ * regionCount, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void
+VideoRenderer::ClearFrame()
+{
+    for (GLsync& fence : regionFences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    for (GLuint& texture : textures_) {
+        if (texture != 0) {
+            glDeleteTextures(1, &texture);
+            texture = 0;
+        }
+    }
+
+    if (PBO_ != 0) {
+        glDeleteBuffers(1, &PBO_);
+        PBO_ = 0;
+    }
+
+    regionSize_ = 0;
+    region_ = 0;
+    width_ = 0;
+    height_ = 0;
+}
+
+void
+VideoRenderer::ClearRenderer()
+{
+    ClearFrame();
+
+    if (VAO_ != 0) {
+        glDeleteVertexArrays(1, &VAO_);
+        VAO_ = 0;
+    }
+
+    shader_.ClearShader();
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+#include "Shader.h"
+#include "VideoFrame.h"
+
+// Video frames drawn over the whole viewport.
+//
+// Each plane is an R8 or RG8 texture (Y, UV or U and V; YUYV as one RG8
+// plane) and the fragment shader converts to RGB. Upload copies a frame into
+// one region of a pixel unpack buffer ring and points glTexSubImage2D at it,
+// so the copy to the textures runs on the GPU timeline; a fence per region
+// keeps the CPU from overwriting a region still being read. Upload only
+// waits when the GPU is regionCount frames behind.
+class VideoRenderer
+{
+public:
+    static const unsigned int regionCount = 3;
+
+    VideoRenderer();
+    ~VideoRenderer();
+
+    VideoRenderer(const VideoRenderer&) = delete;
+    VideoRenderer& operator=(const VideoRenderer&) = delete;
+
+    // Shaders/video.vert and Shaders/video.frag
+    void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
+
+    void SetColorMatrix(ColorMatrix matrix)
+    {
+        matrix_ = matrix;
+    }
+
+    void SetColorRange(ColorRange range)
+    {
+        range_ = range;
+    }
+
+    // Copies the frame, the caller may reuse its memory on return. A new
+    // format or size reallocates the textures.
+    bool Upload(const VideoFrame& frame);
+
+    // Draws the last uploaded frame stretched over the viewport
+    void Render();
+
+    unsigned long long GetUploadedFrames() const
+    {
+        return uploadedFrames_;
+    }
+
+    unsigned long long GetUploadedBytes() const
+    {
+        return uploadedBytes_;
+    }
+
+    // Uploads that had to wait for the GPU to release a region
+    unsigned long long GetStalls() const
+    {
+        return stalls_;
+    }
+
+    void ClearRenderer();
+
+private:
+    Shader shader_;
+    GLint uniformFormat_ {-1};
+    GLint uniformSize_ {-1};
+    GLint uniformLumaCoefficients_ {-1};
+    GLint uniformChromaCoefficients_ {-1};
+
+    GLuint VAO_ {0};
+    GLuint PBO_ {0};
+    GLuint textures_[3] {0, 0, 0};
+
+    VideoFormat format_ {VideoFormat::NV12};
+    int width_ {0};
+    int height_ {0};
+    ColorMatrix matrix_ {ColorMatrix::BT709};
+    ColorRange range_ {ColorRange::Limited};
+
+    GLsizeiptr regionSize_ {0};
+    unsigned int region_ {0};
+    GLsync regionFences_[regionCount] {nullptr, nullptr, nullptr};
+
+    unsigned long long uploadedFrames_ {0};
+    unsigned long long uploadedBytes_ {0};
+    unsigned long long stalls_ {0};
+
+    void AllocateFrame(VideoFormat format, int width, int height);
+    void ClearFrame();
+};
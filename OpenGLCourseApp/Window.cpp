@@ -16,6 +16,8 @@ Window::~Window()
 int
 Window::Initialise()
 {
+    TRACE_SCOPE("Window::Initialise");
+
     // Init GLFW
     if (!glfwInit()) {
         printf("GLFW Init failed!");
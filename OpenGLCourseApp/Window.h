@@ -5,6 +5,8 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "Tracing.h"
+
 class Window
 {
 public:
@@ -24,6 +26,39 @@ public:
         return bufferHeight_;
     }
 
+    // The buffer and window sizes follow window resizes only when asked,
+    // together so cursor to buffer pixel scaling stays right
+    void updateBufferSize()
+    {
+        glfwGetFramebufferSize(mainWindow_, &bufferWidth_, &bufferHeight_);
+        glfwGetWindowSize(mainWindow_, &width_, &height_);
+    }
+
+    GLint getWidth()
+    {
+        return width_;
+    }
+    GLint getHeight()
+    {
+        return height_;
+    }
+
+    // Window coordinates (see getWidth/getHeight), origin top left
+    void getCursorPosition(double& x, double& y)
+    {
+        glfwGetCursorPos(mainWindow_, &x, &y);
+    }
+
+    bool getMouseButton(int button)
+    {
+        return glfwGetMouseButton(mainWindow_, button) == GLFW_PRESS;
+    }
+
+    void setTitle(const char* title)
+    {
+        glfwSetWindowTitle(mainWindow_, title);
+    }
+
     bool getShouldClose()
     {
         return glfwWindowShouldClose(mainWindow_);
@@ -31,6 +66,8 @@ public:
 
     void swapBuffers()
     {
+        TRACE_SCOPE("Window::swapBuffers");
+
         // triple/two buffer (buffer that can be seen)
         glfwSwapBuffers(mainWindow_);
     }
@@ -0,0 +1,453 @@
+﻿#include "YuvConverter.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+#include "Tracing.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YUV_SSE2 1
+#endif
+
+// AVX2 is compiled in for every x86 build and only used when the CPU has it
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define YUV_AVX2 1
+#define YUV_AVX2_TARGET
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define YUV_AVX2 1
+#define YUV_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+const int roundingBias = 1 << (YuvCoefficients::bits - 1);
+
+// One output row; u and v advance by chromaStep per pair of pixels (2 for NV12)
+struct RowSource
+{
+    const uint8_t* y;
+    const uint8_t* u;
+    const uint8_t* v;
+    int chromaStep;
+};
+
+inline uint8_t
+Channel(int value)
+{
+    value = std::min(std::max(value + roundingBias, 0), 255 << YuvCoefficients::bits);
+    return static_cast<uint8_t>(value >> YuvCoefficients::bits);
+}
+
+inline void
+ConvertPixel(int y, int u, int v, const YuvCoefficients& c, uint8_t* rgba)
+{
+    const int luma = c.lumaScale * (y - c.lumaOffset);
+    u -= 128;
+    v -= 128;
+
+    rgba[0] = Channel(luma + c.vToR * v);
+    rgba[1] = Channel(luma - c.uToG * u - c.vToG * v);
+    rgba[2] = Channel(luma + c.uToB * u);
+    rgba[3] = 255;
+}
+
+// Pixels [first, width), also the tail of the SIMD kernels
+void
+ConvertRowScalar(const RowSource& source,
+                 int first,
+                 int width,
+                 const YuvCoefficients& c,
+                 uint8_t* rgba)
+{
+    for (int x = first; x < width; ++x) {
+        const int chroma = (x / 2) * source.chromaStep;
+        ConvertPixel(source.y[x], source.u[chroma], source.v[chroma], c, rgba + x * 4);
+    }
+}
+
+void
+ConvertYuyvRow(const uint8_t* row, int width, const YuvCoefficients& c, uint8_t* rgba)
+{
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* pair = row + (x / 2) * 4;
+        ConvertPixel(row[x * 2], pair[1], pair[3], c, rgba + x * 4);
+    }
+}
+
+#ifdef YUV_SSE2
+
+// 16 pixels a step: luma times its scale and chroma times each coefficient
+// as exact 32 bit products (mullo/mulhi pairs, madd for green), chroma at
+// half width then doubled, and the sums shifted down and saturated to bytes
+// by the packs, which clamps exactly like Channel
+void
+ConvertRowSse2(const RowSource& source, int width, const YuvCoefficients& c, uint8_t* rgba)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lumaOffset = _mm_set1_epi16(static_cast<short>(c.lumaOffset));
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i lumaScale = _mm_set1_epi16(static_cast<short>(c.lumaScale));
+    const __m128i vToR = _mm_set1_epi16(static_cast<short>(c.vToR));
+    const __m128i uToB = _mm_set1_epi16(static_cast<short>(c.uToB));
+    const __m128i toG = _mm_set1_epi32(
+        static_cast<int>((static_cast<uint32_t>(-c.vToG) << 16) | (-c.uToG & 0xffff)));
+    const __m128i bias = _mm_set1_epi32(roundingBias);
+    const __m128i lowBytes = _mm_set1_epi16(0xff);
+    const __m128i alpha = _mm_set1_epi8(-1);
+
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.y + x));
+        __m128i u16, v16;
+
+        if (source.chromaStep == 2) {
+            const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.u + x));
+            u16 = _mm_and_si128(uv, lowBytes);
+            v16 = _mm_srli_epi16(uv, 8);
+        } else {
+            u16 = _mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source.u + x / 2)), zero);
+            v16 = _mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source.v + x / 2)), zero);
+        }
+
+        u16 = _mm_sub_epi16(u16, chromaOffset);
+        v16 = _mm_sub_epi16(v16, chromaOffset);
+
+        // Luma terms, pixels 0-3, 4-7, 8-11, 12-15
+        __m128i luma[4];
+        for (int half = 0; half < 2; ++half) {
+            const __m128i y16 = _mm_sub_epi16(
+                half == 0 ? _mm_unpacklo_epi8(y8, zero) : _mm_unpackhi_epi8(y8, zero), lumaOffset);
+            const __m128i low = _mm_mullo_epi16(y16, lumaScale);
+            const __m128i high = _mm_mulhi_epi16(y16, lumaScale);
+            luma[half * 2] = _mm_add_epi32(_mm_unpacklo_epi16(low, high), bias);
+            luma[half * 2 + 1] = _mm_add_epi32(_mm_unpackhi_epi16(low, high), bias);
+        }
+
+        // Chroma terms, chroma samples 0-3 and 4-7
+        const __m128i rLow = _mm_mullo_epi16(v16, vToR);
+        const __m128i rHigh = _mm_mulhi_epi16(v16, vToR);
+        const __m128i bLow = _mm_mullo_epi16(u16, uToB);
+        const __m128i bHigh = _mm_mulhi_epi16(u16, uToB);
+        const __m128i red[2] = {_mm_unpacklo_epi16(rLow, rHigh), _mm_unpackhi_epi16(rLow, rHigh)};
+        const __m128i blue[2] = {_mm_unpacklo_epi16(bLow, bHigh), _mm_unpackhi_epi16(bLow, bHigh)};
+        const __m128i green[2] = {_mm_madd_epi16(_mm_unpacklo_epi16(u16, v16), toG),
+                                  _mm_madd_epi16(_mm_unpackhi_epi16(u16, v16), toG)};
+
+        __m128i channels[3][4];
+        const __m128i* chroma[3] = {red, green, blue};
+
+        for (int channel = 0; channel < 3; ++channel) {
+            for (int i = 0; i < 4; ++i) {
+                // Each chroma sample covers two pixels
+                const __m128i terms = chroma[channel][i / 2];
+                const __m128i doubled = (i & 1) == 0 ? _mm_unpacklo_epi32(terms, terms)
+                                                     : _mm_unpackhi_epi32(terms, terms);
+                channels[channel][i] = _mm_srai_epi32(_mm_add_epi32(luma[i], doubled),
+                                                      YuvCoefficients::bits);
+            }
+        }
+
+        __m128i bytes[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            bytes[channel] = _mm_packus_epi16(
+                _mm_packs_epi32(channels[channel][0], channels[channel][1]),
+                _mm_packs_epi32(channels[channel][2], channels[channel][3]));
+        }
+
+        const __m128i rg[2] = {_mm_unpacklo_epi8(bytes[0], bytes[1]),
+                               _mm_unpackhi_epi8(bytes[0], bytes[1])};
+        const __m128i ba[2] = {_mm_unpacklo_epi8(bytes[2], alpha),
+                               _mm_unpackhi_epi8(bytes[2], alpha)};
+        __m128i* out = reinterpret_cast<__m128i*>(rgba + x * 4);
+
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(rg[0], ba[0]));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg[0], ba[0]));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg[1], ba[1]));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg[1], ba[1]));
+    }
+
+    ConvertRowScalar(source, x, width, c, rgba);
+}
+
+#endif
+
+#ifdef YUV_AVX2
+
+// The SSE2 kernel twice over: each 128 bit lane converts 16 of the 32
+// pixels, the loads put pixels 0-15 in the low lane and 16-31 in the high
+// one and the stores put the lanes back in order
+YUV_AVX2_TARGET void
+ConvertRowAvx2(const RowSource& source, int width, const YuvCoefficients& c, uint8_t* rgba)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lumaOffset = _mm256_set1_epi16(static_cast<short>(c.lumaOffset));
+    const __m256i chromaOffset = _mm256_set1_epi16(128);
+    const __m256i lumaScale = _mm256_set1_epi16(static_cast<short>(c.lumaScale));
+    const __m256i vToR = _mm256_set1_epi16(static_cast<short>(c.vToR));
+    const __m256i uToB = _mm256_set1_epi16(static_cast<short>(c.uToB));
+    const __m256i toG = _mm256_set1_epi32(
+        static_cast<int>((static_cast<uint32_t>(-c.vToG) << 16) | (-c.uToG & 0xffff)));
+    const __m256i bias = _mm256_set1_epi32(roundingBias);
+    const __m256i lowBytes = _mm256_set1_epi16(0xff);
+    const __m256i alpha = _mm256_set1_epi8(-1);
+
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        const __m256i y8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source.y + x));
+        __m256i u16, v16;
+
+        if (source.chromaStep == 2) {
+            const __m256i uv = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(source.u + x));
+            u16 = _mm256_and_si256(uv, lowBytes);
+            v16 = _mm256_srli_epi16(uv, 8);
+        } else {
+            u16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.u + x / 2)));
+            v16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.v + x / 2)));
+        }
+
+        u16 = _mm256_sub_epi16(u16, chromaOffset);
+        v16 = _mm256_sub_epi16(v16, chromaOffset);
+
+        __m256i luma[4];
+        for (int half = 0; half < 2; ++half) {
+            const __m256i y16 = _mm256_sub_epi16(half == 0 ? _mm256_unpacklo_epi8(y8, zero)
+                                                           : _mm256_unpackhi_epi8(y8, zero),
+                                                 lumaOffset);
+            const __m256i low = _mm256_mullo_epi16(y16, lumaScale);
+            const __m256i high = _mm256_mulhi_epi16(y16, lumaScale);
+            luma[half * 2] = _mm256_add_epi32(_mm256_unpacklo_epi16(low, high), bias);
+            luma[half * 2 + 1] = _mm256_add_epi32(_mm256_unpackhi_epi16(low, high), bias);
+        }
+
+        const __m256i rLow = _mm256_mullo_epi16(v16, vToR);
+        const __m256i rHigh = _mm256_mulhi_epi16(v16, vToR);
+        const __m256i bLow = _mm256_mullo_epi16(u16, uToB);
+        const __m256i bHigh = _mm256_mulhi_epi16(u16, uToB);
+        const __m256i red[2] = {_mm256_unpacklo_epi16(rLow, rHigh),
+                                _mm256_unpackhi_epi16(rLow, rHigh)};
+        const __m256i blue[2] = {_mm256_unpacklo_epi16(bLow, bHigh),
+                                 _mm256_unpackhi_epi16(bLow, bHigh)};
+        const __m256i green[2] = {_mm256_madd_epi16(_mm256_unpacklo_epi16(u16, v16), toG),
+                                  _mm256_madd_epi16(_mm256_unpackhi_epi16(u16, v16), toG)};
+
+        __m256i channels[3][4];
+        const __m256i* chroma[3] = {red, green, blue};
+
+        for (int channel = 0; channel < 3; ++channel) {
+            for (int i = 0; i < 4; ++i) {
+                const __m256i terms = chroma[channel][i / 2];
+                const __m256i doubled = (i & 1) == 0 ? _mm256_unpacklo_epi32(terms, terms)
+                                                     : _mm256_unpackhi_epi32(terms, terms);
+                channels[channel][i] = _mm256_srai_epi32(_mm256_add_epi32(luma[i], doubled),
+                                                         YuvCoefficients::bits);
+            }
+        }
+
+        __m256i bytes[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            bytes[channel] = _mm256_packus_epi16(
+                _mm256_packs_epi32(channels[channel][0], channels[channel][1]),
+                _mm256_packs_epi32(channels[channel][2], channels[channel][3]));
+        }
+
+        const __m256i rg[2] = {_mm256_unpacklo_epi8(bytes[0], bytes[1]),
+                               _mm256_unpackhi_epi8(bytes[0], bytes[1])};
+        const __m256i ba[2] = {_mm256_unpacklo_epi8(bytes[2], alpha),
+                               _mm256_unpackhi_epi8(bytes[2], alpha)};
+
+        // Pixels 0-3 | 16-19, 4-7 | 20-23, 8-11 | 24-27, 12-15 | 28-31
+        const __m256i quads[4] = {_mm256_unpacklo_epi16(rg[0], ba[0]),
+                                  _mm256_unpackhi_epi16(rg[0], ba[0]),
+                                  _mm256_unpacklo_epi16(rg[1], ba[1]),
+                                  _mm256_unpackhi_epi16(rg[1], ba[1])};
+        __m256i* out = reinterpret_cast<__m256i*>(rgba + x * 4);
+
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(quads[0], quads[1], 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(quads[2], quads[3], 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(quads[0], quads[1], 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(quads[2], quads[3], 0x31));
+    }
+
+    ConvertRowScalar(source, x, width, c, rgba);
+}
+
+bool
+CpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+
+    if (info[0] < 7)
+        return false;
+
+    // The OS must save the AVX registers too
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    if (!osxsave || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+} // namespace
+
+bool
+YuvConverter::IsSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Scalar:
+        return true;
+    case Kernel::SSE2:
+#ifdef YUV_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case Kernel::AVX2:
+#ifdef YUV_AVX2
+    {
+        static const bool avx2 = CpuHasAvx2();
+        return avx2;
+    }
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+YuvConverter::Kernel
+YuvConverter::GetBestKernel()
+{
+    if (IsSupported(Kernel::AVX2))
+        return Kernel::AVX2;
+
+    if (IsSupported(Kernel::SSE2))
+        return Kernel::SSE2;
+
+    return Kernel::Scalar;
+}
+
+const char*
+YuvConverter::GetKernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Scalar:
+        return "scalar";
+    case Kernel::SSE2:
+        return "SSE2";
+    case Kernel::AVX2:
+        return "AVX2";
+    }
+
+    return "";
+}
+
+bool
+YuvConverter::Convert(const VideoFrame& frame,
+                      ColorMatrix matrix,
+                      ColorRange range,
+                      uint8_t* rgba,
+                      size_t rgbaStride,
+                      ThreadPool* pool)
+{
+    return Convert(frame, matrix, range, rgba, rgbaStride, pool, GetBestKernel());
+}
+
+bool
+YuvConverter::Convert(const VideoFrame& frame,
+                      ColorMatrix matrix,
+                      ColorRange range,
+                      uint8_t* rgba,
+                      size_t rgbaStride,
+                      ThreadPool* pool,
+                      Kernel kernel)
+{
+    TRACE_SCOPE("YuvConverter::Convert");
+
+    if (frame.width <= 0 || frame.height <= 0 || !IsSupported(kernel))
+        return false;
+
+    const YuvCoefficients coefficients = YuvCoefficients::Get(matrix, range);
+
+    auto convertRows = [&](int firstRow, int lastRow) {
+        for (int row = firstRow; row < lastRow; ++row) {
+            uint8_t* out = rgba + row * rgbaStride;
+
+            if (frame.format == VideoFormat::YUYV) {
+                ConvertYuyvRow(frame.planes[0] + row * frame.strides[0],
+                               frame.width,
+                               coefficients,
+                               out);
+                continue;
+            }
+
+            const uint8_t* chromaRow = frame.planes[1] + (row / 2) * frame.strides[1];
+            RowSource source;
+            source.y = frame.planes[0] + row * frame.strides[0];
+
+            if (frame.format == VideoFormat::NV12) {
+                source.u = chromaRow;
+                source.v = chromaRow + 1;
+                source.chromaStep = 2;
+            } else {
+                source.u = chromaRow;
+                source.v = frame.planes[2] + (row / 2) * frame.strides[2];
+                source.chromaStep = 1;
+            }
+
+            switch (kernel) {
+#ifdef YUV_AVX2
+            case Kernel::AVX2:
+                ConvertRowAvx2(source, frame.width, coefficients, out);
+                break;
+#endif
+#ifdef YUV_SSE2
+            case Kernel::SSE2:
+                ConvertRowSse2(source, frame.width, coefficients, out);
+                break;
+#endif
+            default:
+                ConvertRowScalar(source, 0, frame.width, coefficients, out);
+                break;
+            }
+        }
+    };
+
+    if (pool == nullptr || pool->GetThreadCount() <= 1) {
+        convertRows(0, frame.height);
+        return true;
+    }
+
+    // A few bands per thread so an uneven split evens out
+    const unsigned int bandCount = std::min(pool->GetThreadCount() * 4,
+                                            static_cast<unsigned int>(frame.height));
+    const int bandRows = (frame.height + bandCount - 1) / bandCount;
+
+    pool->ParallelFor(bandCount, [&](unsigned int band) {
+        const int firstRow = static_cast<int>(band) * bandRows;
+        convertRows(firstRow, std::min(firstRow + bandRows, frame.height));
+    });
+
+    return true;
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "VideoFrame.h"
+
+class ThreadPool;
+
+// YUV to RGBA8 on the CPU, for machines without a GPU and to check the video
+// shader against. Same fixed point arithmetic as video.frag (see
+// YuvCoefficients), so at 1:1 scale both give the same bytes. NV12 and I420
+// have SSE2 and AVX2 kernels, YUYV only the scalar one.
+class YuvConverter
+{
+public:
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Compiled in and supported by this CPU
+    static bool IsSupported(Kernel kernel);
+    static Kernel GetBestKernel();
+    static const char* GetKernelName(Kernel kernel);
+
+    // rgba receives frame.height rows of rgbaStride bytes, row 0 at the top
+    // like the frame, alpha 255. Row bands are spread over the pool when
+    // given. Returns false for an unsupported kernel or an empty frame.
+    static bool Convert(const VideoFrame& frame,
+                        ColorMatrix matrix,
+                        ColorRange range,
+                        uint8_t* rgba,
+                        size_t rgbaStride,
+                        ThreadPool* pool = nullptr);
+    static bool Convert(const VideoFrame& frame,
+                        ColorMatrix matrix,
+                        ColorRange range,
+                        uint8_t* rgba,
+                        size_t rgbaStride,
+                        ThreadPool* pool,
+                        Kernel kernel);
+};
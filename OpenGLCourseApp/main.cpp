@@ -1,5 +1,7 @@
 ﻿#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -10,8 +12,25 @@
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 
+#include "AnimationClip.h"
+#include "AnimationSet.h"
+#include "AssetStreamer.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "GlStats.h"
+#include "GpuProfiler.h"
+#include "JointBuffer.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "OcclusionCuller.h"
+#include "SceneBvh.h"
 #include "Shader.h"
+#include "Skeleton.h"
+#include "Skinning.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+#include "TransformSet.h"
 #include "Window.h"
 
 // Window dim
@@ -21,12 +40,22 @@ const float toRadians = 3.14159265f / 180.0f;
 std::vector<Mesh*> meshList;
 std::vector<Shader*> shaderList;
 
+// CPU copy of the pyramid, the pyramids are the occluders
+std::vector<GLfloat> pyramidVertices;
+std::vector<unsigned int> pyramidIndices;
+
+// Skinned tentacle: a cylinder on a chain of joints blending two clips
+Skeleton tentacleSkeleton;
+AnimationClip tentacleSway, tentacleCurl;
+Mesh* tentacle = nullptr;
+
 bool direction = true;
 float triOffset = 0.0f;
 float triMaxOffset = 0.7f;
 float triIncrement = 0.0005f;
 
-float currentAngle = 0.0f;
+// Spin of the rotating objects, radians per frame about y
+const glm::vec3 spin(0.0f, 0.005f * toRadians, 0.0f);
 
 bool sizeDirection = true;
 float currentSize = 0.4f;
@@ -45,70 +74,379 @@ static const char* vShader = "Shaders/shader.vert";
 // Here it interpolates the vertices to pixels
 static const char* fShader = "Shaders/shader.frag";
 
+// Dual quaternion skinning, the tentacle twists without collapsing
+static const char* vSkinnedShader = "Shaders/skinned_dq.vert";
+
 void
 CreateObject()
 {
     // Vertex to use in order from vertices array
     // to draw a pyramid
-    unsigned int indices[] = {0, 3, 1, 1, 3, 2, 2, 3, 0, 0, 1, 2};
-
-    GLfloat vertices[] = {-1.0f,
-                          -1.0f,
-                          0.0f, // x, y ,z
-                          0.0f,
-                          -1.0f,
-                          1.0f,
-                          1.0f,
-                          -1.0f,
-                          0.0f,
-                          0.0f,
-                          1.0f,
-                          0.0f};
+    std::vector<unsigned int>& indices = pyramidIndices;
+    indices = {0, 3, 1, 1, 3, 2, 2, 3, 0, 0, 1, 2};
+
+    std::vector<GLfloat>& vertices = pyramidVertices;
+    vertices = {-1.0f,
+                -1.0f,
+                0.0f, // x, y ,z
+                0.0f,
+                -1.0f,
+                1.0f,
+                1.0f,
+                -1.0f,
+                0.0f,
+                0.0f,
+                1.0f,
+                0.0f};
+
+    // Reorder for the vertex cache/overdraw before upload, x, y, z per vertex
+    MeshOptimizer::Optimize(vertices, indices, 3);
+
+    unsigned int numOfVertices = static_cast<unsigned int>(vertices.size());
+    unsigned int numOfIndices = static_cast<unsigned int>(indices.size());
 
     Mesh* obj1 = new Mesh();
-    obj1->CreateMesh(vertices, indices, 12, 12);
+    obj1->SetPickable(true);
+    obj1->CreateMesh(vertices.data(), indices.data(), numOfVertices, numOfIndices);
     meshList.emplace_back(obj1);
 
     Mesh* obj2 = new Mesh();
-    obj2->CreateMesh(vertices, indices, 12, 12);
+    obj2->SetPickable(true);
+    obj2->CreateMesh(vertices.data(), indices.data(), numOfVertices, numOfIndices);
     meshList.emplace_back(obj2);
 }
 
+void
+CreateTentacle()
+{
+    const int jointCount = 8;
+    const float length = 2.0f, radius = 0.15f;
+    const float jointLength = length / jointCount;
+
+    for (int i = 0; i < jointCount; ++i) {
+        JointPose bindPose;
+        bindPose.translation = glm::vec3(0.0f, i == 0 ? 0.0f : jointLength, 0.0f);
+        tentacleSkeleton.AddJoint(i - 1, bindPose);
+    }
+
+    // Rings along y, each vertex split between the two nearest joints
+    const int rings = 48, sides = 16;
+    std::vector<SkinnedVertex> vertices;
+    std::vector<unsigned int> indices;
+
+    for (int ring = 0; ring <= rings; ++ring) {
+        const float height = length * ring / rings;
+        const float joint = std::min(std::max(height / jointLength - 0.5f, 0.0f),
+                                     static_cast<float>(jointCount - 1));
+        const int joint0 = std::min(static_cast<int>(joint), jointCount - 2);
+        const uint8_t weight1 = static_cast<uint8_t>((joint - joint0) * 255.0f + 0.5f);
+
+        for (int side = 0; side < sides; ++side) {
+            const float angle = 2.0f * 3.14159265f * side / sides;
+            const float taper = radius * (1.0f - 0.7f * height / length);
+
+            SkinnedVertex vertex = {};
+            vertex.position[0] = std::cos(angle) * taper;
+            vertex.position[1] = height;
+            vertex.position[2] = std::sin(angle) * taper;
+            vertex.normal[0] = std::cos(angle);
+            vertex.normal[2] = std::sin(angle);
+            vertex.joints[0] = static_cast<uint8_t>(joint0);
+            vertex.joints[1] = static_cast<uint8_t>(joint0 + 1);
+            vertex.weights[0] = static_cast<uint8_t>(255 - weight1);
+            vertex.weights[1] = weight1;
+            vertices.push_back(vertex);
+
+            if (ring < rings) {
+                const unsigned int a = ring * sides + side;
+                const unsigned int b = ring * sides + (side + 1) % sides;
+
+                indices.insert(indices.end(), {a, a + sides, b, b, a + sides, b + sides});
+            }
+        }
+    }
+
+    // Two second loops, 30 keys a second. The sway bends the chain in a wave,
+    // the curl rolls it up while twisting.
+    const int frameCount = 61;
+    std::vector<JointPose> swayFrames, curlFrames;
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const float phase = 2.0f * 3.14159265f * frame / (frameCount - 1);
+
+        for (int i = 0; i < jointCount; ++i) {
+            JointPose pose = tentacleSkeleton.GetBindPose()[i];
+
+            pose.rotation = glm::angleAxis(0.3f * std::sin(phase - 0.6f * i),
+                                           glm::vec3(0.0f, 0.0f, 1.0f));
+            swayFrames.push_back(pose);
+
+            const glm::vec3 yAxis(0.0f, 1.0f, 0.0f), xAxis(1.0f, 0.0f, 0.0f);
+            pose.rotation = glm::angleAxis(0.4f * std::sin(phase), yAxis)
+                            * glm::angleAxis(0.2f * (1.0f - std::cos(phase)), xAxis);
+            curlFrames.push_back(pose);
+        }
+    }
+
+    tentacleSway.Build(swayFrames.data(), frameCount, jointCount, 30.0f);
+    tentacleCurl.Build(curlFrames.data(), frameCount, jointCount, 30.0f);
+
+    MeshOptimizer::OptimizeVertexCache(indices, static_cast<unsigned int>(vertices.size()));
+
+    tentacle = new Mesh();
+    tentacle->CreateMesh(vertices.data(),
+                         static_cast<GLsizeiptr>(vertices.size() * sizeof(SkinnedVertex)),
+                         sizeof(SkinnedVertex),
+                         Skinning::vertexAttributes,
+                         4,
+                         indices.data(),
+                         static_cast<GLsizei>(indices.size()),
+                         GL_UNSIGNED_INT);
+}
+
+// World space box around a transformed object space box
+SceneBvh::Aabb
+TransformBounds(const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    const glm::vec3 center(model * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    const glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+    const glm::vec3 worldHalfExtent = glm::abs(glm::vec3(model[0])) * halfExtent.x
+                                      + glm::abs(glm::vec3(model[1])) * halfExtent.y
+                                      + glm::abs(glm::vec3(model[2])) * halfExtent.z;
+
+    return SceneBvh::Aabb {center - worldHalfExtent, center + worldHalfExtent};
+}
+
+// Nearest triangle along a world space ray, maxDistance in units of direction.
+// The scene BVH finds the candidate objects, each mesh tests its own triangles.
+uint32_t
+PickScene(const SceneBvh& sceneBvh,
+          const std::vector<glm::mat4>& objectModels,
+          const glm::vec3& origin,
+          const glm::vec3& direction,
+          float maxDistance,
+          Mesh::MeshHit& hit)
+{
+    return sceneBvh.Raycast(origin, direction, maxDistance, [&](uint32_t object, float closest) {
+        if (!meshList[object]->IsPickable())
+            return -1.0f;
+
+        // Affine models keep the ray parameter, distances compare across objects
+        const glm::mat4 inverseModel = glm::inverse(objectModels[object]);
+        const glm::vec3 objectOrigin(inverseModel * glm::vec4(origin, 1.0f));
+        const glm::vec3 objectDirection(inverseModel * glm::vec4(direction, 0.0f));
+
+        Mesh::MeshHit meshHit;
+        if (!meshList[object]->Pick(objectOrigin, objectDirection, closest, meshHit))
+            return -1.0f;
+
+        hit = meshHit;
+        return meshHit.distance;
+    });
+}
+
 void
 CreateShader()
 {
     Shader* shader1 = new Shader();
     shader1->CreateFromFiles(vShader, fShader);
     shaderList.emplace_back(shader1);
+
+    Shader* skinnedShader = new Shader();
+    skinnedShader->CreateFromFiles(vSkinnedShader, fShader);
+    skinnedShader->BindUniformBlock("JointDualQuaternions", 0);
+    shaderList.emplace_back(skinnedShader);
 }
 
 int
-main()
+main(int argc, char** argv)
 {
+    // CPU trace of the whole run when OPENGLCOURSEAPP_TRACE names a file
+    const char* traceFile = getenv("OPENGLCOURSEAPP_TRACE");
+    if (traceFile != nullptr)
+        Tracer::Start(traceFile);
+
+    TRACE_THREAD_NAME("Main");
+
     Window mainWindow(WIDTH, HEIGHT);
     mainWindow.Initialise();
 
+    // GL call counts per frame when OPENGLCOURSEAPP_GLSTATS names a file,
+    // summarised in the window title once a second
+    const char* glStatsFile = getenv("OPENGLCOURSEAPP_GLSTATS");
+    if (glStatsFile != nullptr)
+        GlStats::Install();
+
+    double lastSummaryTime = glfwGetTime();
+
     CreateObject();
+    CreateTentacle();
     CreateShader();
 
+    // Mesh files given on the command line stream in while the loop runs
+    AssetStreamer streamer;
+    const size_t numOfBuiltInMeshes = meshList.size();
+
+    for (int i = 1; i < argc; ++i) {
+        Mesh* mesh = new Mesh();
+        mesh->SetPickable(true);
+        streamer.RequestMesh(mesh, argv[i]);
+        meshList.emplace_back(mesh);
+    }
+
+    // Per frame CPU work (cluster and occlusion culling)
+    ThreadPool framePool;
+    OcclusionCuller occlusionCuller;
+
+    // World transforms and bounds of every mesh, indexed like meshList
+    TransformSet transforms;
+    transforms.Resize(meshList.size());
+
+    // Translation z value to make sure that it does not get too close, x, y
+    // scaled down. The first pyramid spins, the second slides.
+    transforms.SetPosition(0, glm::vec3(0.0f, 0.0f, -2.5f));
+    transforms.SetScale(0, glm::vec3(0.4f, 0.4f, 1.0f));
+    transforms.SetAngularVelocity(0, spin);
+    transforms.SetScale(1, glm::vec3(0.4f, 0.4f, 1.0f));
+
+    std::vector<glm::mat4> objectModels(meshList.size(), glm::mat4(1.0f));
+    std::vector<SceneBvh::Aabb> objectBounds(meshList.size(),
+                                             SceneBvh::Aabb {glm::vec3(0.0f), glm::vec3(0.0f)});
+    std::vector<uint32_t> visibleObjects;
+
+    // Built from the first frame's boxes, then refit; rebuilt when streamed
+    // meshes arrive or refits have let the boxes grow too far
+    SceneBvh sceneBvh;
+    size_t bvhReadyMeshes = 0;
+    const float bvhRebuildGrowth = 1.5f;
+
+    // The blend between the tentacle's clips drifts back and forth
+    AnimationSet animations(tentacleSkeleton);
+    animations.Resize(1);
+    animations.SetSkinningMode(AnimationSet::SkinningMode::DualQuaternion);
+    animations.SetClips(0, &tentacleSway, &tentacleCurl, 0.0f);
+
+    JointBuffer jointBuffer(2 * Skinning::maxJoints * sizeof(glm::vec4));
+    const glm::mat4 tentacleModel = glm::scale(
+        glm::translate(glm::mat4(1.0f), glm::vec3(1.2f, -1.0f, -3.5f)), glm::vec3(0.6f));
+    double lastTime = glfwGetTime();
+
+    bool mouseWasDown = false;
+
     GLuint uniformProjection = 0, uniformModel = 0;
 
+    // OPENGLCOURSEAPP_RENDER_SIZE ("1280x720") fixes the internal resolution:
+    // the scene renders offscreen, with OPENGLCOURSEAPP_MSAA samples, and is
+    // scaled to fit the window
+    Framebuffer sceneTarget;
+    GLsizei renderWidth = static_cast<GLsizei>(mainWindow.getBufferWidth());
+    GLsizei renderHeight = static_cast<GLsizei>(mainWindow.getBufferHeight());
+    const char* renderSize = getenv("OPENGLCOURSEAPP_RENDER_SIZE");
+    const char* msaa = getenv("OPENGLCOURSEAPP_MSAA");
+    int targetWidth = 0, targetHeight = 0;
+
+    // OPENGLCOURSEAPP_FRAME_BUDGET_MS scales the part of the target the
+    // scene renders into to keep its GPU time within the budget, offscreen
+    // at the window's size when no internal resolution is given
+    const char* frameBudget = getenv("OPENGLCOURSEAPP_FRAME_BUDGET_MS");
+    DynamicResolution::Settings resolutionSettings;
+
+    if (frameBudget != nullptr)
+        resolutionSettings.budgetSeconds = atof(frameBudget) / 1000.0;
+
+    DynamicResolution dynamicResolution(resolutionSettings);
+    bool scaleResolution = frameBudget != nullptr && resolutionSettings.budgetSeconds > 0.0;
+
+    if (renderSize == nullptr || sscanf(renderSize, "%dx%d", &targetWidth, &targetHeight) != 2) {
+        targetWidth = scaleResolution ? renderWidth : 0;
+        targetHeight = scaleResolution ? renderHeight : 0;
+    }
+
+    const bool offscreen = targetWidth > 0 && targetHeight > 0
+                           && sceneTarget.CreateFramebuffer(targetWidth,
+                                                            targetHeight,
+                                                            msaa != nullptr ? atoi(msaa) : 0);
+
+    if (offscreen) {
+        renderWidth = targetWidth;
+        renderHeight = targetHeight;
+    }
+
+    scaleResolution = scaleResolution && offscreen;
+
+    // Where the scene lands in the window's framebuffer, for picking
+    GLint presentX = 0, presentY = 0;
+    GLsizei presentWidth = renderWidth, presentHeight = renderHeight;
+
+    // OPENGLCOURSEAPP_CAPTURE names a raw video file at the internal
+    // resolution, NV12 (ffmpeg -f rawvideo -pix_fmt nv12 -s WxH) unless the
+    // name ends in .rgba. Frames are read back asynchronously and written on
+    // the capture thread, a couple of frames late.
+    const char* captureFile = getenv("OPENGLCOURSEAPP_CAPTURE");
+    FILE* captureOutput = captureFile != nullptr ? fopen(captureFile, "wb") : nullptr;
+    FrameCapture frameCapture;
+
+    if (captureOutput != nullptr) {
+        const size_t nameLength = strlen(captureFile);
+        const bool rgba = nameLength >= 5 && strcmp(captureFile + nameLength - 5, ".rgba") == 0;
+
+        frameCapture.CreateFromFiles("Shaders/video.vert", "Shaders/capture_nv12.frag");
+
+        if (!frameCapture.CreateCapture(
+                renderWidth,
+                renderHeight,
+                rgba ? FrameCapture::Format::RGBA : FrameCapture::Format::NV12,
+                [captureOutput](const FrameCapture::CapturedFrame& frame) {
+                    fwrite(frame.planes[0], 1, frame.strides[0] * frame.height, captureOutput);
+
+                    if (frame.format == FrameCapture::Format::NV12)
+                        fwrite(frame.planes[1],
+                               1,
+                               frame.strides[1]
+                                   * VideoFrame::GetPlaneHeight(VideoFormat::NV12,
+                                                                frame.height,
+                                                                1),
+                               captureOutput);
+                })) {
+            fclose(captureOutput);
+            captureOutput = nullptr;
+        } else {
+            printf("Capturing %dx%d %s to %s\n",
+                   renderWidth,
+                   renderHeight,
+                   rgba ? "RGBA" : "NV12",
+                   captureFile);
+        }
+    }
+
     // Perspective projection
     // 1: field of view: how wide our view is: 45 degrees
     // 2: Width of the window / height of the window
     // 3: Near field
     // 4: Far field
     glm::mat4 projection = glm::perspective(45.0f,
-                                            mainWindow.getBufferWidth()
-                                                / mainWindow.getBufferHeight(),
+                                            static_cast<GLfloat>(renderWidth) / renderHeight,
                                             0.1f,
                                             100.0f);
 
+    // CPU and GPU time of the passes below when OPENGLCOURSEAPP_GPU_PROFILE
+    // names a file, written out on exit
+    const char* gpuProfileFile = getenv("OPENGLCOURSEAPP_GPU_PROFILE");
+    GpuProfiler profiler(gpuProfileFile != nullptr ? 4 : 0);
+
     // Loop until window closes
     while (!mainWindow.getShouldClose()) {
+        TRACE_SCOPE("Frame");
+
+        profiler.BeginFrame();
+        profiler.BeginScope("Frame");
+
         // Get + handle user input events
         glfwPollEvents();
 
+        // Upload a slice of whatever the loader threads finished
+        streamer.Update();
+
         if (direction) {
             triOffset += triIncrement;
         } else {
@@ -118,10 +456,6 @@ main()
         if (abs(triOffset) >= triMaxOffset)
             direction = !direction;
 
-        currentAngle += 0.005f;
-        if (currentAngle >= 360.0f)
-            currentAngle -= 360;
-
         if (sizeDirection) {
             currentSize += 0.0001f;
         } else {
@@ -131,45 +465,255 @@ main()
         if (currentSize >= maxSize || currentSize <= minSize)
             sizeDirection = !sizeDirection;
 
+        // The scene's GPU time picks the scale of later frames
+        GLsizei scaledWidth = renderWidth, scaledHeight = renderHeight;
+
+        if (scaleResolution) {
+            dynamicResolution.BeginFrame();
+            dynamicResolution.GetScaledSize(renderWidth, renderHeight, scaledWidth, scaledHeight);
+            sceneTarget.SetRenderSize(scaledWidth, scaledHeight);
+        }
+
+        profiler.BeginScope("Clear");
+        if (offscreen)
+            sceneTarget.Bind();
+
         // Clear window (buffer cannot be seen)
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        profiler.EndScope();
 
         shaderList[0]->UseShader();
         uniformModel = shaderList[0]->GetModelLocation();
         uniformProjection = shaderList[0]->GetProjectionLocation();
 
-        // Identity matrix
-        glm::mat4 model(1.0f);
+        transforms.SetPosition(1, glm::vec3(-triOffset, 0.0f, -2.5f));
+
+        // Streamed meshes fitted into a unit cube next to the pyramids
+        for (size_t i = numOfBuiltInMeshes; i < meshList.size(); ++i) {
+            glm::vec3 extent = meshList[i]->GetBoundsMax() - meshList[i]->GetBoundsMin();
+            glm::vec3 center = (meshList[i]->GetBoundsMax() + meshList[i]->GetBoundsMin()) * 0.5f;
+            float size = std::max(extent.x, std::max(extent.y, extent.z));
+
+            transforms.SetPosition(i, glm::vec3(triOffset, 0.0f, -2.5f));
+            transforms.SetScale(i, glm::vec3(size > 0.0f ? 0.8f / size : 1.0f));
+            transforms.SetPivot(i, center);
+            transforms.SetAngularVelocity(i, spin);
+        }
+
+        // The animation advances per frame, like the offsets above
+        transforms.Integrate(1.0f);
+        transforms.BuildModels(objectModels);
 
-        // Translation z value to make sure that if does not get too close
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
+        // Clips play in seconds, not frames
+        const double now = glfwGetTime();
+        animations.SetBlendWeight(0, 0.5f + 0.5f * std::sin(static_cast<float>(now) * 0.5f));
+        animations.Update(static_cast<float>(now - lastTime), &framePool);
+        lastTime = now;
 
-        // The distortion is because of lacking Projection matrix
-        model = glm::rotate(model, currentAngle * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
+        // Everything moves every frame, refit rather than rebuild
+        size_t readyMeshes = 0;
 
-        // x, y scale by 2
-        model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
+        for (size_t i = 0; i < meshList.size(); ++i) {
+            objectBounds[i] = TransformBounds(objectModels[i],
+                                              meshList[i]->GetBoundsMin(),
+                                              meshList[i]->GetBoundsMax());
+            readyMeshes += meshList[i]->IsReady() ? 1 : 0;
+        }
+
+        if (sceneBvh.GetNodeCount() > 0 && readyMeshes == bvhReadyMeshes)
+            sceneBvh.Refit(objectBounds);
+
+        if (sceneBvh.GetNodeCount() == 0 || readyMeshes != bvhReadyMeshes
+            || sceneBvh.GetRefitGrowth() > bvhRebuildGrowth) {
+            sceneBvh.Build(objectBounds);
+            bvhReadyMeshes = readyMeshes;
+        }
+
+        // No camera yet, the projection alone takes world space to clip space
+        visibleObjects.clear();
+        sceneBvh.QueryFrustum(projection, visibleObjects);
+        std::sort(visibleObjects.begin(), visibleObjects.end());
+
+        // Left click reports the triangle under the cursor
+        const bool mouseDown = mainWindow.getMouseButton(GLFW_MOUSE_BUTTON_LEFT);
+
+        if (mouseDown && !mouseWasDown) {
+            double cursorX = 0.0, cursorY = 0.0;
+            mainWindow.getCursorPosition(cursorX, cursorY);
+
+            // Cursor to framebuffer pixels (rows from the bottom), then to
+            // the near and far plane, the projection alone is the camera
+            const double pixelX = cursorX * mainWindow.getBufferWidth() / mainWindow.getWidth();
+            const double pixelY = mainWindow.getBufferHeight()
+                                  - cursorY * mainWindow.getBufferHeight() / mainWindow.getHeight();
+            const float ndcX = static_cast<float>(2.0 * (pixelX - presentX) / presentWidth - 1.0);
+            const float ndcY = static_cast<float>(2.0 * (pixelY - presentY) / presentHeight - 1.0);
+            const glm::mat4 inverseProjection = glm::inverse(projection);
+            glm::vec4 nearPoint = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farPoint = inverseProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            nearPoint /= nearPoint.w;
+            farPoint /= farPoint.w;
+
+            Mesh::MeshHit hit;
+            const uint32_t object = PickScene(sceneBvh,
+                                              objectModels,
+                                              glm::vec3(nearPoint),
+                                              glm::vec3(farPoint - nearPoint),
+                                              1.0f,
+                                              hit);
+
+            if (object != SceneBvh::invalidObject) {
+                printf("Picked mesh %u triangle %u (%.3f, %.3f, %.3f)\n",
+                       object,
+                       hit.triangle,
+                       hit.barycentrics.x,
+                       hit.barycentrics.y,
+                       hit.barycentrics.z);
+            }
+        }
+
+        mouseWasDown = mouseDown;
+
+        // Occluder depth for this frame, rasterized on the CPU before the
+        // scene's draws are issued
+        occlusionCuller.BeginFrame(projection);
+        for (size_t i = 0; i < numOfBuiltInMeshes; ++i)
+            occlusionCuller.AddOccluder(objectModels[i],
+                                        pyramidVertices.data(),
+                                        3,
+                                        pyramidIndices.data(),
+                                        pyramidIndices.size());
+        occlusionCuller.Rasterize(&framePool);
 
         // Set uniform var
-        glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
         glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projection));
 
-        meshList[0]->RenderMesh();
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-triOffset, 0.0f, -2.5f));
-        model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-        glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
+        for (uint32_t i : visibleObjects) {
+            const glm::mat4& model = objectModels[i];
+
+            // Streamed meshes are skipped when hidden behind the pyramids,
+            // and by RenderMesh until they are ready
+            if (i >= numOfBuiltInMeshes) {
+                if (!occlusionCuller.IsVisible(model,
+                                               meshList[i]->GetBoundsMin(),
+                                               meshList[i]->GetBoundsMax())) {
+                    continue;
+                }
+
+                // No camera yet, model space is view space
+                meshList[i]->SelectLod(model, projection, static_cast<float>(scaledHeight));
+                meshList[i]->CullClusters(model, projection, &framePool);
+            }
+
+            GpuProfiler::Scope scope(profiler, "RenderMesh");
+            glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
+            meshList[i]->RenderMesh();
+        }
 
-        meshList[1]->RenderMesh();
+        // The tentacle's joints, one block per character
+        shaderList[1]->UseShader();
+        glUniformMatrix4fv(shaderList[1]->GetProjectionLocation(),
+                           1,
+                           GL_FALSE,
+                           glm::value_ptr(projection));
+        glUniformMatrix4fv(shaderList[1]->GetModelLocation(),
+                           1,
+                           GL_FALSE,
+                           glm::value_ptr(tentacleModel));
+
+        jointBuffer.Upload(animations.GetSkinDualQuaternions(),
+                           2 * animations.GetJointCount() * sizeof(glm::vec4),
+                           animations.GetCount());
+        jointBuffer.Bind(0, 0);
+
+        profiler.BeginScope("RenderSkinnedMesh");
+        tentacle->RenderMesh();
+        profiler.EndScope();
 
         // Unassign the shader
         Shader::UnUseShader();
 
+        // The internal resolution scaled onto the window, black bars where
+        // the aspect ratios differ
+        if (offscreen) {
+            profiler.BeginScope("Present");
+            sceneTarget.Resolve();
+
+            if (scaleResolution)
+                dynamicResolution.EndFrame();
+
+            mainWindow.updateBufferSize();
+            const GLsizei windowWidth = static_cast<GLsizei>(mainWindow.getBufferWidth());
+            const GLsizei windowHeight = static_cast<GLsizei>(mainWindow.getBufferHeight());
+            Framebuffer::BindDefault(windowWidth, windowHeight);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            Framebuffer::FitRect(renderWidth,
+                                 renderHeight,
+                                 windowWidth,
+                                 windowHeight,
+                                 presentX,
+                                 presentY,
+                                 presentWidth,
+                                 presentHeight);
+            sceneTarget.BlitToDefault(presentX, presentY, presentWidth, presentHeight);
+            profiler.EndScope();
+        }
+
+        // What was rendered, not the letterboxed window
+        if (captureOutput != nullptr) {
+            profiler.BeginScope("Capture");
+
+            if (offscreen)
+                frameCapture.Capture(sceneTarget.GetID(), scaledWidth, scaledHeight);
+            else
+                frameCapture.Capture(0,
+                                     static_cast<GLsizei>(mainWindow.getBufferWidth()),
+                                     static_cast<GLsizei>(mainWindow.getBufferHeight()));
+
+            profiler.EndScope();
+        }
+
         // triple/two buffer (buffer that can be seen)
+        profiler.BeginScope("Swap");
         mainWindow.swapBuffers();
+        profiler.EndScope();
+
+        profiler.EndScope();
+        profiler.EndFrame();
+
+        GlStats::EndFrame();
+
+        if (GlStats::IsInstalled() && now - lastSummaryTime >= 1.0) {
+            char summary[256];
+            GlStats::FormatSummary(GlStats::GetLastFrame(), summary, sizeof(summary));
+            mainWindow.setTitle(summary);
+            lastSummaryTime = now;
+        }
+    }
+
+    // Open in chrome://tracing or ui.perfetto.dev
+    if (gpuProfileFile != nullptr)
+        profiler.WriteChromeTrace(gpuProfileFile);
+
+    if (scaleResolution)
+        dynamicResolution.WriteLog("resolution_scale.csv");
+
+    if (glStatsFile != nullptr)
+        GlStats::WriteJson(glStatsFile);
+
+    if (captureOutput != nullptr) {
+        frameCapture.Finish();
+        fclose(captureOutput);
+
+        const FrameCapture::Stats captureStats = frameCapture.GetStats();
+        printf("Captured %llu frames, %llu dropped\n",
+               captureStats.deliveredFrames,
+               captureStats.droppedFrames);
     }
 
+    Tracer::Stop();
+
     return 0;
 }
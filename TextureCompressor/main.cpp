@@ -0,0 +1,259 @@
+﻿#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Texture.h"
+#include "TextureEncoder.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+
+// Compresses an image into the KTX 2 or DDS containers loaded by Texture::CreateFromFile,
+// with its mip chain, so the app uploads blocks straight from the file mapping
+// Usage: TextureCompressor [--format rgba8|bc1|bc3|bc4|bc5] [--srgb] [--no-mips]
+//                          input.pgm|input.ppm|input.pam output.ktx2|output.dds
+// Without --format, 1 channel images become BC4, images with alpha BC3 and the rest BC1.
+
+namespace {
+
+struct FormatName
+{
+    const char* name;
+    TextureEncoder::Format format;
+};
+
+const FormatName formatNames[] = {
+    {"rgba8", TextureEncoder::Format::RGBA8},
+    {"bc1", TextureEncoder::Format::BC1},
+    {"bc3", TextureEncoder::Format::BC3},
+    {"bc4", TextureEncoder::Format::BC4},
+    {"bc5", TextureEncoder::Format::BC5},
+};
+
+// Next header token of a netpbm file, skipping whitespace and comments
+bool
+ReadToken(FILE* file, char* token, size_t size)
+{
+    int c = fgetc(file);
+
+    for (;;) {
+        while (c != EOF && isspace(c))
+            c = fgetc(file);
+
+        if (c != '#')
+            break;
+
+        while (c != EOF && c != '\n')
+            c = fgetc(file);
+    }
+
+    size_t length = 0;
+
+    while (c != EOF && !isspace(c) && length + 1 < size) {
+        token[length++] = static_cast<char>(c);
+        c = fgetc(file);
+    }
+
+    token[length] = '\0';
+
+    // The single whitespace after the last token separates it from the pixels
+    return length > 0;
+}
+
+// Binary PGM (P5), PPM (P6) or PAM (P7) with 8 bit samples, expanded to RGBA
+bool
+ReadImage(const char* fileLocation,
+          std::vector<uint8_t>& rgba,
+          int& width,
+          int& height,
+          int& channels)
+{
+    FILE* file = fopen(fileLocation, "rb");
+
+    if (!file) {
+        printf("Failed to open %s!\n", fileLocation);
+        return false;
+    }
+
+    char token[64];
+    int maximum = 0;
+    bool ok = ReadToken(file, token, sizeof(token));
+    width = height = channels = 0;
+
+    if (ok && (strcmp(token, "P5") == 0 || strcmp(token, "P6") == 0)) {
+        channels = token[1] == '5' ? 1 : 3;
+        ok = ReadToken(file, token, sizeof(token)) && (width = atoi(token)) > 0;
+        ok = ok && ReadToken(file, token, sizeof(token)) && (height = atoi(token)) > 0;
+        ok = ok && ReadToken(file, token, sizeof(token)) && (maximum = atoi(token)) > 0;
+    } else if (ok && strcmp(token, "P7") == 0) {
+        while ((ok = ReadToken(file, token, sizeof(token))) && strcmp(token, "ENDHDR") != 0) {
+            char value[64];
+
+            if (strcmp(token, "TUPLTYPE") == 0) {
+                ok = ReadToken(file, value, sizeof(value));
+                continue;
+            }
+
+            if (!(ok = ReadToken(file, value, sizeof(value))))
+                break;
+
+            if (strcmp(token, "WIDTH") == 0)
+                width = atoi(value);
+            else if (strcmp(token, "HEIGHT") == 0)
+                height = atoi(value);
+            else if (strcmp(token, "DEPTH") == 0)
+                channels = atoi(value);
+            else if (strcmp(token, "MAXVAL") == 0)
+                maximum = atoi(value);
+        }
+    } else {
+        ok = false;
+    }
+
+    if (!ok || width <= 0 || height <= 0 || width > 16384 || height > 16384 || channels < 1
+        || channels > 4 || maximum != 255) {
+        printf("%s is not an 8 bit binary PGM, PPM or PAM image!\n", fileLocation);
+        fclose(file);
+        return false;
+    }
+
+    std::vector<uint8_t> samples(static_cast<size_t>(width) * height * channels);
+    ok = fread(samples.data(), 1, samples.size(), file) == samples.size();
+    fclose(file);
+
+    if (!ok) {
+        printf("%s is truncated!\n", fileLocation);
+        return false;
+    }
+
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+
+    // Gray, gray and alpha, RGB or RGBA
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+        const uint8_t* sample = samples.data() + i * channels;
+        uint8_t* texel = rgba.data() + i * 4;
+
+        texel[0] = sample[0];
+        texel[1] = channels >= 3 ? sample[1] : sample[0];
+        texel[2] = channels >= 3 ? sample[2] : sample[0];
+        texel[3] = channels == 2 || channels == 4 ? sample[channels - 1] : 255;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    const char* formatName = nullptr;
+    bool srgb = false;
+    bool mips = true;
+    int argument = 1;
+
+    for (; argument < argc && strncmp(argv[argument], "--", 2) == 0; ++argument) {
+        if (strcmp(argv[argument], "--format") == 0 && argument + 1 < argc)
+            formatName = argv[++argument];
+        else if (strcmp(argv[argument], "--srgb") == 0)
+            srgb = true;
+        else if (strcmp(argv[argument], "--no-mips") == 0)
+            mips = false;
+        else
+            break;
+    }
+
+    if (argc - argument != 2) {
+        printf("Usage: %s [--format rgba8|bc1|bc3|bc4|bc5] [--srgb] [--no-mips]\n", argv[0]);
+        printf("       %*s input.pgm|input.ppm|input.pam output.ktx2|output.dds\n",
+               static_cast<int>(strlen(argv[0])),
+               "");
+        return 1;
+    }
+
+    const char* input = argv[argument];
+    const char* output = argv[argument + 1];
+
+    std::vector<uint8_t> rgba;
+    int width = 0, height = 0, channels = 0;
+
+    if (!ReadImage(input, rgba, width, height, channels))
+        return 1;
+
+    TextureEncoder::Format format = channels == 1 ? TextureEncoder::Format::BC4
+                                    : channels == 2 || channels == 4 ? TextureEncoder::Format::BC3
+                                                                     : TextureEncoder::Format::BC1;
+
+    if (formatName) {
+        const FormatName* found = nullptr;
+
+        for (const FormatName& known : formatNames) {
+            if (strcmp(known.name, formatName) == 0)
+                found = &known;
+        }
+
+        if (!found) {
+            printf("Unknown format %s!\n", formatName);
+            return 1;
+        }
+
+        format = found->format;
+    }
+
+    const GLenum internalFormat = TextureEncoder::GetInternalFormat(format, srgb);
+    const GLsizei levels = mips ? Texture::GetMipCount(width, height) : 1;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    ThreadPool pool;
+    std::vector<std::vector<uint8_t>> levelData(levels);
+    std::vector<const void*> levelPointers(levels);
+    std::vector<uint8_t> next;
+    size_t compressedSize = 0, uncompressedSize = 0;
+
+    for (GLint level = 0; level < levels; ++level) {
+        const GLsizei levelWidth = std::max(width >> level, 1);
+        const GLsizei levelHeight = std::max(height >> level, 1);
+
+        levelData[level].resize(TextureFile::GetImageSize(internalFormat, levelWidth, levelHeight));
+        TextureEncoder::Encode(format,
+                               rgba.data(),
+                               levelWidth,
+                               levelHeight,
+                               levelData[level].data(),
+                               &pool);
+        levelPointers[level] = levelData[level].data();
+
+        compressedSize += levelData[level].size();
+        uncompressedSize += static_cast<size_t>(levelWidth) * levelHeight * 4;
+
+        if (level + 1 < levels) {
+            next.resize(static_cast<size_t>(std::max(levelWidth / 2, 1))
+                        * std::max(levelHeight / 2, 1) * 4);
+            TextureEncoder::Downsample(rgba.data(), levelWidth, levelHeight, 4, next.data());
+            rgba.swap(next);
+        }
+    }
+
+    if (!TextureFile::Write(output, internalFormat, width, height, levels, levelPointers.data()))
+        return 1;
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                               .count();
+
+    printf("%s: %dx%d, %d levels, %zu bytes, %.1fx smaller than RGBA8, %.0f ms\n",
+           output,
+           width,
+           height,
+           levels,
+           compressedSize,
+           static_cast<double>(uncompressedSize) / compressedSize,
+           seconds * 1000.0);
+
+    return 0;
+}